@@ -0,0 +1,30 @@
+/*
+ * Copyright (c) 2016 ARM Limited. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __KNOCK_CORE_ACCEL_EVENT_H__
+#define __KNOCK_CORE_ACCEL_EVENT_H__
+
+#include <stdint.h>
+
+/*
+ * An accelerometer interrupt edge, as queued by the interrupt handler
+ */
+struct AccelEvent {
+    uint32_t timestamp;     // free-running us counter at the edge
+    uint32_t ticks;         // perf_ticks() at the edge
+};
+
+#endif // __KNOCK_CORE_ACCEL_EVENT_H__
@@ -0,0 +1,32 @@
+/*
+ * Copyright (c) 2016 ARM Limited. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __KNOCK_CORE_ACCEL_SAMPLE_H__
+#define __KNOCK_CORE_ACCEL_SAMPLE_H__
+
+#include <stdint.h>
+
+/*
+ * One raw accelerometer reading, in sensor counts (14 bit, sign extended).
+ * At the default +/-2g range one count is 0.244 mg.
+ */
+struct AccelSample {
+    int16_t x;
+    int16_t y;
+    int16_t z;
+};
+
+#endif // __KNOCK_CORE_ACCEL_SAMPLE_H__
@@ -0,0 +1,130 @@
+/*
+ * Copyright (c) 2016 ARM Limited. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __KNOCK_CORE_ADAPTIVE_RATE_H__
+#define __KNOCK_CORE_ADAPTIVE_RATE_H__
+
+#include <stdint.h>
+
+/*
+ * Hysteresis of AdaptiveRate, times in ms
+ */
+struct AdaptiveRateConfig {
+    AdaptiveRateConfig()
+        : idle_after(5000), max_idle_after(60000) {
+    }
+
+    AdaptiveRateConfig(uint32_t idle_after, uint32_t max_idle_after)
+        : idle_after(idle_after), max_idle_after(max_idle_after) {
+    }
+
+    uint32_t idle_after;        // without motion for this long, the rate goes down
+    uint32_t max_idle_after;    // the wait doubles up to this when it comes back up soon after
+};
+
+/*
+ * Decides when the accelerometer runs at its active rate and when at its
+ * idle one. Any motion while idle brings the rate up at once; it goes down
+ * again after `idle_after` without motion. When motion comes back sooner
+ * than that after going down, the next wait is twice as long, up to
+ * `max_idle_after`, so a door that keeps being hammered or a rattling frame
+ * does not switch the rate back and forth. A rest longer than
+ * `max_idle_after` resets the wait.
+ *
+ * The caller switches the sensor and calls motion() for every motion
+ * interrupt and every knock, and quiet() from the event loop. Timestamps
+ * are in us and do not wrap.
+ */
+class AdaptiveRate {
+public:
+    enum Mode {
+        IDLE,
+        ACTIVE
+    };
+
+    AdaptiveRate(const AdaptiveRateConfig &config = AdaptiveRateConfig())
+        : _config(config), _mode(ACTIVE), _idle_after(config.idle_after), _last_motion(0), _idle_since(0),
+          _wakeups(0) {
+    }
+
+    const AdaptiveRateConfig &config() const {
+        return _config;
+    }
+
+    // starts out active, as if there had been motion at `now`
+    void start(uint64_t now) {
+        _mode = ACTIVE;
+        _last_motion = now;
+    }
+
+    /*
+    * Motion, or a knock, at `now`. Returns true when it ends an idle
+    * period, and the sensor has to go to the active rate.
+    */
+    bool motion(uint64_t now) {
+        _last_motion = now;
+        if (_mode == ACTIVE) {
+            return false;
+        }
+        uint64_t idle = (now - _idle_since) / 1000;
+        if (idle > _config.max_idle_after) {
+            _idle_after = _config.idle_after;
+        } else if (idle < _idle_after) {
+            _idle_after = _idle_after > _config.max_idle_after / 2 ? _config.max_idle_after : _idle_after * 2;
+        }
+        _mode = ACTIVE;
+        _wakeups++;
+        return true;
+    }
+
+    /*
+    * Returns true when it has been quiet for long enough, and the sensor
+    * has to go to the idle rate.
+    */
+    bool quiet(uint64_t now) {
+        if (_mode == IDLE || now - _last_motion < (uint64_t)_idle_after * 1000) {
+            return false;
+        }
+        _mode = IDLE;
+        _idle_since = now;
+        return true;
+    }
+
+    // interrupt safe
+    Mode mode() const {
+        return (Mode)_mode;
+    }
+
+    // the current wait before going idle, in ms
+    uint32_t idle_after() const {
+        return _idle_after;
+    }
+
+    // number of times motion ended an idle period
+    uint32_t wakeups() const {
+        return _wakeups;
+    }
+
+private:
+    AdaptiveRateConfig  _config;
+    volatile uint8_t    _mode;
+    uint32_t            _idle_after;
+    uint64_t            _last_motion;
+    uint64_t            _idle_since;
+    uint32_t            _wakeups;
+};
+
+#endif // __KNOCK_CORE_ADAPTIVE_RATE_H__
@@ -0,0 +1,380 @@
+/*
+ * Copyright (c) 2016 ARM Limited. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __KNOCK_CORE_CLOCK_SYNC_H__
+#define __KNOCK_CORE_CLOCK_SYNC_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "minar/minar.h"
+#include "core-util/FunctionPointer.h"
+#include "mbed-client/m2minterfacefactory.h"
+#include "mbed-client/m2mobject.h"
+#include "mbed-client/m2mobjectinstance.h"
+#include "mbed-client/m2mresource.h"
+#include "knock-core/int_format.h"
+
+// one NTP style exchange
+struct ClockSample {
+    uint64_t    local;      // local us halfway through the exchange
+    int64_t     offset;     // server minus local time, us
+    uint32_t    rtt;        // us, without the time the server took
+};
+
+/*
+ * Estimates the server time for a local time from NTP style exchanges:
+ * local send t1, server receive t2, server send t3, local receive t4.
+ *
+ * Of the last `Window` exchanges the one with the smallest error bound is
+ * taken, half its round trip plus DISPERSION_PPM of its age, so a round trip
+ * that queued somewhere does not move the estimate. The phase comes from
+ * that exchange; the frequency error is tracked from how far each newly
+ * taken exchange is off the prediction, so the estimate does not walk away
+ * between exchanges on a drifting crystal.
+ */
+template <size_t Window = 8>
+class ClockSync {
+public:
+    enum {
+        DISPERSION_PPM      = 15,       // NTP's PHI
+        SKEW_GAIN           = 4,        // an observed frequency error moves the estimate by 1/4 of it
+        MAX_SKEW_PPB        = 500000
+    };
+
+    // exchanges closer together than this say little about the frequency
+    static const uint64_t MIN_SKEW_INTERVAL_US = 60000000;
+
+    ClockSync()
+        : _count(0), _next(0), _synced(false), _skew(0), _exchanges(0) {
+    }
+
+    /*
+    * Adds an exchange, local times in us on a clock that does not wrap,
+    * server times in us on the server clock. Returns false when the times
+    * can not be from one exchange.
+    */
+    bool add(uint64_t t1, uint64_t t2, uint64_t t3, uint64_t t4) {
+        if (t4 < t1 || t3 < t2) {
+            return false;
+        }
+        int64_t rtt = (int64_t)(t4 - t1) - (int64_t)(t3 - t2);
+        if (rtt > (int64_t)UINT32_MAX) {
+            return false;
+        }
+
+        ClockSample &sample = _window[_next];
+        sample.local = t1 + (t4 - t1) / 2;
+        sample.offset = ((int64_t)(t2 - t1) + (int64_t)(t3 - t4)) / 2;
+        // the server clock may run a little faster over its part
+        sample.rtt = rtt < 0 ? 0 : (uint32_t)rtt;
+        _next = (_next + 1) % Window;
+        if (_count < Window) {
+            _count++;
+        }
+        _exchanges++;
+
+        select(t4);
+        return true;
+    }
+
+    bool synced() const {
+        return _synced;
+    }
+
+    // estimated server time at `local`, valid once synced()
+    uint64_t server_us(uint64_t local) const {
+        int64_t elapsed = (int64_t)(local - _reference.local);
+        return local + _reference.offset + elapsed * _skew / 1000000000;
+    }
+
+    // how far server_us() may be off at `local`: half the round trip plus dispersion
+    uint32_t uncertainty_us(uint64_t local) const {
+        return _reference.rtt / 2 + dispersion(local - _reference.local);
+    }
+
+    // the exchange the estimate is from
+    const ClockSample &reference() const {
+        return _reference;
+    }
+
+    // local clock slower than the server's by this much, in parts per billion
+    int32_t skew_ppb() const {
+        return _skew;
+    }
+
+    uint32_t exchanges() const {
+        return _exchanges;
+    }
+
+private:
+    static uint32_t dispersion(uint64_t age) {
+        return (uint32_t)(age * DISPERSION_PPM / 1000000);
+    }
+
+    void select(uint64_t now) {
+        const ClockSample *best = NULL;
+        uint64_t best_bound = 0;
+        for (size_t i = 0; i < _count; i++) {
+            uint64_t bound = _window[i].rtt / 2 + dispersion(now - _window[i].local);
+            if (!best || bound < best_bound) {
+                best = &_window[i];
+                best_bound = bound;
+            }
+        }
+        if (_synced && best->local <= _reference.local) {
+            // still the one before, or older
+            return;
+        }
+
+        if (_synced && best->local - _reference.local >= MIN_SKEW_INTERVAL_US) {
+            int64_t elapsed = (int64_t)(best->local - _reference.local);
+            int64_t error = best->offset + (int64_t)best->local - (int64_t)server_us(best->local);
+            int64_t skew = _skew + error * 1000000000 / elapsed / SKEW_GAIN;
+            if (skew > MAX_SKEW_PPB) {
+                skew = MAX_SKEW_PPB;
+            } else if (skew < -MAX_SKEW_PPB) {
+                skew = -MAX_SKEW_PPB;
+            }
+            _skew = (int32_t)skew;
+        }
+        _reference = *best;
+        _synced = true;
+    }
+
+    ClockSample     _window[Window];
+    size_t          _count;
+    size_t          _next;
+    bool            _synced;
+    ClockSample     _reference;
+    int32_t         _skew;
+    uint32_t        _exchanges;
+};
+
+/*
+ * Aligns a MonotonicClock with the server clock through the LWM2M object
+ * /time/0:
+ *
+ *     /time/0/ping         local time of the last ping in us, wrapping at 2^32
+ *     /time/0/pong         written by the server, "<ping> <received> <sent>"
+ *     /time/0/uncertainty  how far the server time may be off now, in us,
+ *                          -1 before the first exchange
+ *     /time/0/skew         local clock slower than the server's, in ppb
+ *
+ * A ping is a notification of /time/0/ping. A server that observes it
+ * answers with a PUT of /time/0/pong, carrying the ping and its own clock in
+ * us when the notification came and when the PUT left; the four times are
+ * one exchange for ClockSync. Pings go out in bursts of `burst`, 2 s apart,
+ * every `period_ms`, and more often until the first answer. The period has
+ * to stay under 35 minutes, it also keeps the clock widened.
+ *
+ * A server that does not know about /time/0, like mbed Device Connector,
+ * never answers, and server_us() stays 0. After UNANSWERED_BURSTS bursts in
+ * a row without an answer the pings stop, and only client_registered()
+ * starts them again; the rounds go on without pinging to keep the clock
+ * widened.
+ */
+template <typename Clock, size_t Window = 8>
+class ClockSyncResource {
+public:
+    ClockSyncResource(Clock &clock, uint32_t period_ms = 300000, uint8_t burst = 4)
+        : _clock(clock), _period_ms(period_ms), _retry_ms(FIRST_RETRY_MS), _burst(burst), _pings_left(0),
+          _ping(0), _outstanding(false), _answered(true), _unanswered(0), _paused(false) {
+        _object = M2MInterfaceFactory::create_object("time");
+        M2MObjectInstance* inst = _object->create_object_instance();
+
+        _ping_res = inst->create_dynamic_resource("ping", "ClockPing",
+            M2MResourceInstance::INTEGER, true /* observable */);
+        _ping_res->set_operation(M2MBase::GET_ALLOWED);
+        _ping_res->set_value((uint8_t*)"0", 1);
+
+        _pong_res = inst->create_dynamic_resource("pong", "ClockPong",
+            M2MResourceInstance::STRING, false /* observable */);
+        _pong_res->set_operation(M2MBase::PUT_ALLOWED);
+        _pong_res->set_value_updated_function(value_updated_callback(this, &ClockSyncResource::pong));
+
+        _uncertainty_res = inst->create_dynamic_resource("uncertainty", "ClockUncertainty",
+            M2MResourceInstance::INTEGER, false /* observable */);
+        _uncertainty_res->set_operation(M2MBase::GET_ALLOWED);
+        _uncertainty_res->set_value((uint8_t*)"-1", 2);
+
+        _skew_res = inst->create_dynamic_resource("skew", "ClockSkew",
+            M2MResourceInstance::INTEGER, false /* observable */);
+        _skew_res->set_operation(M2MBase::GET_ALLOWED);
+        _skew_res->set_value((uint8_t*)"0", 1);
+
+        schedule(_retry_ms);
+    }
+
+    M2MObject* get_object() {
+        return _object;
+    }
+
+    // estimated server time at the local time `local`, in us since the Unix epoch, 0 when unknown
+    uint64_t server_us(uint64_t local) const {
+        return _sync.synced() ? _sync.server_us(local) : 0;
+    }
+
+    /*
+    * A ping is out and a server that answered before may still answer, so a
+    * sleeping board should keep its network stack up
+    */
+    bool awaiting_pong() {
+        return _outstanding && _sync.synced() && _clock.now() - _ping < PONG_WAIT_US;
+    }
+
+    const ClockSync<Window> &sync() const {
+        return _sync;
+    }
+
+    /*
+    * Called whenever a registration was accepted, the server may be another
+    * one now; pings that had stopped start again
+    */
+    void client_registered() {
+        _unanswered = 0;
+        _answered = true;
+        _retry_ms = FIRST_RETRY_MS;
+        if (_paused) {
+            _paused = false;
+            minar::Scheduler::cancelCallback(_timer);
+            schedule(FIRST_RETRY_MS);
+        }
+    }
+
+private:
+    enum {
+        BURST_SPACING_MS    = 2000,
+        FIRST_RETRY_MS      = 15000,
+        UNANSWERED_BURSTS   = 6
+    };
+
+    // answers later than this are not waited for
+    static const uint64_t PONG_WAIT_US = 2000000;
+
+    void schedule(uint32_t delay_ms) {
+        _timer = minar::Scheduler::postCallback(mbed::util::FunctionPointer0<void>(this, &ClockSyncResource::round).bind())
+            .delay(minar::milliseconds(delay_ms))
+            .getHandle();
+    }
+
+    void round() {
+        // the last answer to the burst before has come by now; stops
+        // counting once paused, so it does not wrap
+        if (_unanswered < UNANSWERED_BURSTS) {
+            _unanswered = _answered ? 0 : _unanswered + 1;
+        }
+        if (_unanswered >= UNANSWERED_BURSTS) {
+            if (!_paused) {
+                printf("no answer to %u clock ping bursts, pinging again after the next registration\r\n",
+                       (unsigned)_unanswered);
+                _paused = true;
+            }
+            _clock.now();
+            schedule(_period_ms);
+            return;
+        }
+        _answered = false;
+        _pings_left = _burst;
+        ping();
+    }
+
+    void ping() {
+        _ping = _clock.now();
+        _outstanding = true;
+        char buffer[INT_FORMAT_SIZE];
+        size_t length = format_uint(buffer, (uint32_t)_ping);
+        // not through the notify policy of the client, a ping that is held
+        // back would only be a longer round trip
+        _ping_res->set_value((uint8_t*)buffer, length);
+
+        if (--_pings_left) {
+            _timer = minar::Scheduler::postCallback(mbed::util::FunctionPointer0<void>(this, &ClockSyncResource::ping).bind())
+                .delay(minar::milliseconds(BURST_SPACING_MS))
+                .getHandle();
+        } else if (_sync.synced()) {
+            schedule(_period_ms);
+        } else {
+            // nobody answered yet, maybe not registered yet
+            schedule(_retry_ms);
+            _retry_ms = _retry_ms * 2 < _period_ms ? _retry_ms * 2 : _period_ms;
+        }
+    }
+
+    void pong(const char */*name*/) {
+        uint64_t received = _clock.now();
+        uint64_t values[3];
+        if (!_outstanding || !parse(_pong_res->value(), _pong_res->value_length(), values) ||
+            values[0] != (uint32_t)_ping) {
+            return;
+        }
+        _outstanding = false;
+        _answered = true;
+
+        bool first = !_sync.synced();
+        if (!_sync.add(_ping, values[1], values[2], received)) {
+            return;
+        }
+        if (first) {
+            printf("clock aligned with the server to +-%lu us\r\n",
+                   (unsigned long)_sync.uncertainty_us(received));
+        }
+
+        char buffer[INT_FORMAT_SIZE];
+        size_t length = format_int(buffer, _sync.uncertainty_us(received));
+        _uncertainty_res->set_value((uint8_t*)buffer, length);
+        length = format_int(buffer, _sync.skew_ppb());
+        _skew_res->set_value((uint8_t*)buffer, length);
+    }
+
+    // three unsigned decimals separated by spaces
+    static bool parse(const uint8_t *value, uint32_t length, uint64_t values[3]) {
+        uint32_t i = 0;
+        for (int n = 0; n < 3; n++) {
+            if (n && (i == length || value[i++] != ' ')) {
+                return false;
+            }
+            if (i == length || value[i] < '0' || value[i] > '9') {
+                return false;
+            }
+            values[n] = 0;
+            for (; i < length && value[i] >= '0' && value[i] <= '9'; i++) {
+                values[n] = values[n] * 10 + (value[i] - '0');
+            }
+        }
+        return i == length;
+    }
+
+    Clock               &_clock;
+    uint32_t            _period_ms;
+    uint32_t            _retry_ms;
+    uint8_t             _burst;
+    uint8_t             _pings_left;
+    uint64_t            _ping;          // local time of the last ping
+    bool                _outstanding;   // and no answer to it yet
+    bool                _answered;      // the current burst, or nothing to answer yet
+    uint8_t             _unanswered;    // bursts in a row
+    bool                _paused;        // no pings until the next registration
+    minar::callback_handle_t _timer;    // the next round or ping
+    ClockSync<Window>   _sync;
+    M2MObject*          _object;
+    M2MResource*        _ping_res;
+    M2MResource*        _pong_res;
+    M2MResource*        _uncertainty_res;
+    M2MResource*        _skew_res;
+};
+
+#endif // __KNOCK_CORE_CLOCK_SYNC_H__
@@ -0,0 +1,38 @@
+/*
+ * Copyright (c) 2016 ARM Limited. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __KNOCK_CORE_CRC16_H__
+#define __KNOCK_CORE_CRC16_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * CRC-16/CCITT-FALSE (polynomial 0x1021, initial value 0xFFFF), bit by bit
+ * so it costs no table in flash. Pass the previous result as `crc` to
+ * continue over several buffers.
+ */
+inline uint16_t crc16_ccitt(const uint8_t *data, size_t length, uint16_t crc = 0xFFFF) {
+    for (size_t i = 0; i < length; i++) {
+        crc ^= (uint16_t)data[i] << 8;
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+        }
+    }
+    return crc;
+}
+
+#endif // __KNOCK_CORE_CRC16_H__
@@ -0,0 +1,105 @@
+/*
+ * Copyright (c) 2016 ARM Limited. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __KNOCK_CORE_EVENT_CLOCK_H__
+#define __KNOCK_CORE_EVENT_CLOCK_H__
+
+#include <stdint.h>
+
+/*
+ * Widens a free-running 32 bit microsecond counter, which wraps every ~71
+ * minutes, to 64 bits that do not wrap. Interrupt handlers only take the
+ * 32 bit reading; the event loop widens it later with widen().
+ *
+ * `Counter` provides:
+ *
+ *     static uint32_t read_us();
+ *
+ * The clock has to see the counter at least once every 2^31 us (~35
+ * minutes), through now() or widen(), and starts out assuming the counter
+ * started at 0. Not interrupt safe.
+ */
+template <typename Counter>
+class MonotonicClock {
+public:
+    MonotonicClock()
+        : _last(0) {
+    }
+
+    uint64_t now() {
+        return widen(Counter::read_us());
+    }
+
+    /*
+    * `reading` is a value of Counter::read_us() from at most 2^31 us before
+    * the newest one this clock has seen, or any time after that
+    */
+    uint64_t widen(uint32_t reading) {
+        int32_t delta = (int32_t)(reading - (uint32_t)_last);
+        if (delta < 0) {
+            // taken before the newest reading, e.g. in an interrupt
+            return _last - (uint32_t)-delta;
+        }
+        _last += delta;
+        return _last;
+    }
+
+private:
+    uint64_t    _last;
+};
+
+/*
+ * Maps the numbers of the samples streamed out of a sensor FIFO to local
+ * time. The sensor runs on its own oscillator, so counting sample periods
+ * drifts off the local clock; every anchor pins one sample to a local time
+ * again, and the samples around it are counted from there.
+ *
+ * The best anchor is the watermark interrupt: the sample that reached the
+ * watermark was taken at the edge, which the interrupt handler timestamps.
+ * Without one, e.g. after the FIFO overflowed, the newest sample of a burst
+ * is at most one period old when the burst is read.
+ */
+class SampleClock {
+public:
+    SampleClock(uint32_t period_us)
+        : _period(period_us), _sample(0), _local(0), _anchored(false) {
+    }
+
+    // `sample` was taken at `local_us`
+    void anchor(uint32_t sample, uint64_t local_us) {
+        _sample = sample;
+        _local = local_us;
+        _anchored = true;
+    }
+
+    bool anchored() const {
+        return _anchored;
+    }
+
+    // local time of `sample`, counted from the last anchor
+    uint64_t local_us(uint32_t sample) const {
+        int32_t samples = (int32_t)(sample - _sample);
+        return _local + (int64_t)samples * _period;
+    }
+
+private:
+    uint32_t    _period;
+    uint32_t    _sample;
+    uint64_t    _local;
+    bool        _anchored;
+};
+
+#endif // __KNOCK_CORE_EVENT_CLOCK_H__
@@ -0,0 +1,273 @@
+/*
+ * Copyright (c) 2016 ARM Limited. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __KNOCK_CORE_FXOS8700CQ_ACQUISITION_H__
+#define __KNOCK_CORE_FXOS8700CQ_ACQUISITION_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include "core-util/FunctionPointer.h"
+#include "knock-core/accel_sample.h"
+#include "knock-core/fxos8700cq_fifo.h"
+#include "knock-core/sample_ring.h"
+
+/*
+ * Services an FXOS8700CQ interrupt without the CPU waiting on the bus: the
+ * reads of FXOS8700CQFifo::read_sources(), drain() and
+ * FXOS8700CQ::clear_int() as a chain of asynchronous reads, each started
+ * from the completion of the one before. A round is
+ *
+ *     INT_SOURCE -> F_STATUS and a watermark of samples -> the rest of the
+ *     FIFO -> FF_MT_SRC
+ *
+ * leaving out what INT_SOURCE does not ask for. The samples wait in a
+ * buffer of the acquisition until take() moves them into the sample ring
+ * from the event loop, so the ring is never touched from an interrupt.
+ *
+ * `Bus` is the Bus of FXOS8700CQFifo, plus
+ *
+ *     bool read_async(uint8_t reg, uint8_t *data, int length,
+ *                     const mbed::util::FunctionPointer1<void, bool> &done);
+ *
+ * which is I2CRegisterBus on the board. A bus that calls `done` before
+ * read_async() returns, like the host one, works too. Start rounds from
+ * the event loop or from one interrupt priority only.
+ */
+template <typename Bus>
+class FXOS8700CQAcquisition {
+public:
+    typedef FXOS8700CQFifo<Bus> Fifo;
+
+    explicit FXOS8700CQAcquisition(Bus &bus)
+        : _bus(bus), _state(IDLE), _watermark(0), _sources(0), _motion(0), _count(0), _rest(0),
+          _failed(false), _rounds(0), _bursts(0), _overflows(0), _errors(0) {
+    }
+
+    /*
+    * Starts a round for a FIFO configured with `watermark`, 0 when the FIFO
+    * is not used. `done` is called from the interrupt of the last read;
+    * post to the event loop from there and take() the samples. Returns false
+    * while the round before is not taken yet, or when the first read does
+    * not start.
+    */
+    bool start(uint8_t watermark, const mbed::util::FunctionPointer0<void> &done) {
+        if (_state != IDLE || watermark >= Fifo::CAPACITY) {
+            return false;
+        }
+        _watermark = watermark;
+        _done = done;
+        _sources = 0;
+        _count = 0;
+        _failed = false;
+        _state = SOURCES;
+        if (!_bus.read_async(REG_INT_SOURCE, &_sources, 1, transferred_callback())) {
+            _state = IDLE;
+            _errors++;
+            return false;
+        }
+        _rounds++;
+        return true;
+    }
+
+    /*
+    * Reads FF_MT_SRC alone, which releases a latched motion interrupt. Cheap
+    * enough for the interrupt handler; false when a round or another clear
+    * is still running, which will release it as well.
+    */
+    bool clear_motion() {
+        if (_state != IDLE) {
+            return false;
+        }
+        _state = CLEAR;
+        if (!_bus.read_async(REG_FF_MT_SRC, &_motion, 1, transferred_callback())) {
+            _state = IDLE;
+            _errors++;
+            return false;
+        }
+        return true;
+    }
+
+    // a round or a clear is running, or the samples of a round wait for take()
+    bool busy() const {
+        return _state != IDLE;
+    }
+
+    // the round is over and take() may be called
+    bool done() const {
+        return _state == DONE;
+    }
+
+    // INT_SOURCE of the round, see FXOS8700CQFifo::InterruptSource
+    uint8_t sources() const {
+        return _sources;
+    }
+
+    // a read of the round failed, what came before it is still taken
+    bool failed() const {
+        return _failed;
+    }
+
+    /*
+    * Moves the samples of the finished round into `ring` and ends it.
+    * Returns the number of samples, or -1 when no round is finished.
+    */
+    template <size_t N>
+    int take(SampleRing<AccelSample, N> &ring) {
+        if (_state != DONE) {
+            return -1;
+        }
+        int count = _count;
+        Fifo::unpack(_data + 1, count, ring);
+        _state = IDLE;
+        return count;
+    }
+
+    uint32_t rounds() const {
+        return _rounds;
+    }
+
+    // FIFO reads, one or two per round
+    uint32_t bursts() const {
+        return _bursts;
+    }
+
+    // number of times the sensor FIFO wrapped before it was read
+    uint32_t overflows() const {
+        return _overflows;
+    }
+
+    // reads that failed or did not start
+    uint32_t errors() const {
+        return _errors;
+    }
+
+private:
+    enum State {
+        IDLE,
+        SOURCES,        // reading INT_SOURCE
+        BURST,          // F_STATUS and a watermark of samples
+        REST,           // the samples past the watermark
+        MOTION,         // FF_MT_SRC, to release the motion interrupt
+        DONE,           // until take()
+        CLEAR           // FF_MT_SRC for clear_motion()
+    };
+
+    enum {
+        REG_STATUS          = 0x00,
+        REG_OUT_X_MSB       = 0x01,
+        REG_INT_SOURCE      = 0x0C,
+        REG_FF_MT_SRC       = 0x16
+    };
+
+    enum {
+        BYTES_PER_SAMPLE    = 6,
+        F_STATUS_OVF        = 0x80,
+        F_STATUS_CNT_MASK   = 0x3F
+    };
+
+    mbed::util::FunctionPointer1<void, bool> transferred_callback() {
+        return mbed::util::FunctionPointer1<void, bool>(this, &FXOS8700CQAcquisition::transferred);
+    }
+
+    // from the bus interrupt, or from read_async() itself
+    void transferred(bool ok) {
+        if (_state == CLEAR) {
+            if (!ok) {
+                _errors++;
+            }
+            _state = IDLE;
+            return;
+        }
+        if (!ok) {
+            _errors++;
+            _failed = true;
+            finish();
+            return;
+        }
+
+        switch (_state) {
+            case SOURCES:
+                if ((_sources & Fifo::SRC_FIFO) && _watermark) {
+                    next(BURST, REG_STATUS, _data, 1 + _watermark * BYTES_PER_SAMPLE);
+                    return;
+                }
+                break;
+            case BURST: {
+                _bursts++;
+                uint8_t status = _data[0];
+                if (status & F_STATUS_OVF) {
+                    _overflows++;
+                }
+                // the watermark samples were known to be there, the rest
+                // are read behind them, so the buffer stays in order
+                int queued = status & F_STATUS_CNT_MASK;
+                _count = queued < _watermark ? queued : _watermark;
+                if (queued > _count && queued <= Fifo::CAPACITY) {
+                    _rest = queued - _count;
+                    next(REST, REG_OUT_X_MSB, _data + 1 + _count * BYTES_PER_SAMPLE, _rest * BYTES_PER_SAMPLE);
+                    return;
+                }
+                break;
+            }
+            case REST:
+                _bursts++;
+                _count += _rest;
+                break;
+            case MOTION:
+                finish();
+                return;
+            default:
+                return;
+        }
+        if (_sources & Fifo::SRC_FFMT) {
+            next(MOTION, REG_FF_MT_SRC, &_motion, 1);
+            return;
+        }
+        finish();
+    }
+
+    // the next read of the round, which ends it when it does not start
+    void next(State state, uint8_t reg, uint8_t *data, int length) {
+        _state = state;
+        if (!_bus.read_async(reg, data, length, transferred_callback())) {
+            _errors++;
+            _failed = true;
+            finish();
+        }
+    }
+
+    void finish() {
+        _state = DONE;
+        _done.call();
+    }
+
+    Bus                                 &_bus;
+    volatile uint8_t                    _state;
+    uint8_t                             _watermark;
+    uint8_t                             _sources;
+    uint8_t                             _motion;        // FF_MT_SRC, read to clear it
+    int                                 _count;         // samples in _data
+    int                                 _rest;
+    bool                                _failed;
+    mbed::util::FunctionPointer0<void>  _done;
+    uint32_t                            _rounds;
+    uint32_t                            _bursts;
+    uint32_t                            _overflows;
+    uint32_t                            _errors;
+    uint8_t                             _data[1 + Fifo::CAPACITY * BYTES_PER_SAMPLE];
+};
+
+#endif // __KNOCK_CORE_FXOS8700CQ_ACQUISITION_H__
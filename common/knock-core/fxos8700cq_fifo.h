@@ -0,0 +1,289 @@
+/*
+ * Copyright (c) 2016 ARM Limited. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __KNOCK_CORE_FXOS8700CQ_FIFO_H__
+#define __KNOCK_CORE_FXOS8700CQ_FIFO_H__
+
+#include <stdint.h>
+#include "knock-core/accel_sample.h"
+#include "knock-core/sample_ring.h"
+
+/*
+ * Streams accelerometer samples out of the 32 entry FIFO of the FXOS8700CQ.
+ *
+ * The sensor raises its watermark interrupt once F_WMRK samples are queued,
+ * after which the whole batch is pulled in with a single I2C burst (status
+ * byte plus 6 bytes per sample) instead of one transaction per sample.
+ *
+ * The register access goes through `Bus`, which needs to provide:
+ *
+ *     bool read(uint8_t reg, uint8_t *data, int length);
+ *     bool write(uint8_t reg, uint8_t value);
+ *
+ * On the board that is I2CRegisterBus, on a host it can be anything that
+ * models the register file.
+ */
+template <typename Bus>
+class FXOS8700CQFifo {
+public:
+    // CTRL_REG1[DR] values when only the accelerometer is active
+    enum DataRate {
+        ODR_800HZ   = 0,
+        ODR_400HZ   = 1,
+        ODR_200HZ   = 2,
+        ODR_100HZ   = 3,
+        ODR_50HZ    = 4,
+        ODR_12_5HZ  = 5,
+        ODR_6_25HZ  = 6,
+        ODR_1_56HZ  = 7
+    };
+
+    // CTRL_REG2[MODS], the oversampling scheme in active mode
+    enum PowerMode {
+        MODS_NORMAL                 = 0,
+        MODS_LOW_NOISE_LOW_POWER    = 1,
+        MODS_HIGH_RESOLUTION        = 2,
+        MODS_LOW_POWER              = 3
+    };
+
+    // INT_SOURCE bits we care about
+    enum InterruptSource {
+        SRC_FFMT    = 0x04,
+        SRC_FIFO    = 0x40
+    };
+
+    static const uint8_t CAPACITY = 32;
+
+    FXOS8700CQFifo(Bus &bus)
+        : _bus(bus), _watermark(0), _bursts(0), _overflows(0) {
+    }
+
+    /*
+    * Puts the sensor in accelerometer-only circular FIFO mode and routes the
+    * watermark interrupt to the same pin as the motion interrupt, so both
+    * keep working on PTC13. Call after FXOS8700CQ::enable().
+    */
+    bool configure(uint8_t watermark, DataRate rate) {
+        if (watermark == 0 || watermark >= CAPACITY) {
+            return false;
+        }
+
+        uint8_t ctrl1, ctrl4, ctrl5, m_ctrl1, m_ctrl2;
+        if (!_bus.read(REG_CTRL_REG1, &ctrl1, 1) ||
+            !_bus.read(REG_CTRL_REG4, &ctrl4, 1) ||
+            !_bus.read(REG_CTRL_REG5, &ctrl5, 1) ||
+            !_bus.read(REG_M_CTRL_REG1, &m_ctrl1, 1) ||
+            !_bus.read(REG_M_CTRL_REG2, &m_ctrl2, 1)) {
+            return false;
+        }
+
+        // control registers can only be changed in standby
+        if (!_bus.write(REG_CTRL_REG1, ctrl1 & ~CTRL1_ACTIVE)) {
+            return false;
+        }
+
+        // accelerometer only, so the burst address pointer wraps from
+        // OUT_Z_LSB back to OUT_X_MSB instead of into the magnetometer block
+        m_ctrl1 &= ~M_CTRL1_HMS_MASK;
+        m_ctrl2 &= ~M_CTRL2_HYB_AUTOINC;
+
+        // INT_CFG_FIFO follows INT_CFG_FFMT
+        ctrl5 = (ctrl5 & ~CTRL5_CFG_FIFO) | ((ctrl5 & CTRL5_CFG_FFMT) ? CTRL5_CFG_FIFO : 0);
+        ctrl4 |= CTRL4_EN_FIFO;
+        ctrl1 = (ctrl1 & ~(CTRL1_DR_MASK | CTRL1_F_READ)) | (rate << CTRL1_DR_SHIFT);
+
+        bool ok = _bus.write(REG_M_CTRL_REG1, m_ctrl1) &&
+                  _bus.write(REG_M_CTRL_REG2, m_ctrl2) &&
+                  _bus.write(REG_F_SETUP, F_MODE_CIRCULAR | watermark) &&
+                  _bus.write(REG_CTRL_REG4, ctrl4) &&
+                  _bus.write(REG_CTRL_REG5, ctrl5);
+
+        // back to active, even if one of the writes failed
+        if (!_bus.write(REG_CTRL_REG1, ctrl1 | CTRL1_ACTIVE)) {
+            return false;
+        }
+
+        if (ok) {
+            _watermark = watermark;
+        }
+        return ok;
+    }
+
+    /*
+    * Turns the watermark interrupt off or back on, leaving the motion
+    * interrupt as the only wake-up source. The FIFO keeps filling in circular
+    * mode, so the last CAPACITY samples are still there when it is turned
+    * back on. CTRL_REG4 is written in place; a standby round trip could drop
+    * those samples.
+    */
+    bool set_watermark_interrupt(bool enabled) {
+        uint8_t ctrl4;
+        if (!_bus.read(REG_CTRL_REG4, &ctrl4, 1)) {
+            return false;
+        }
+        ctrl4 = enabled ? (ctrl4 | CTRL4_EN_FIFO) : (ctrl4 & ~CTRL4_EN_FIFO);
+        return _bus.write(REG_CTRL_REG4, ctrl4);
+    }
+
+    /*
+    * Changes the output data rate and the oversampling scheme of a
+    * configured FIFO, and the threshold of the motion detector, in steps of
+    * 63 mg. The detector only sees the samples taken at the new rate. All of
+    * it is changed in standby, and the FIFO is emptied on the way, since its
+    * samples were taken at the old rate.
+    */
+    bool set_rate(DataRate rate, PowerMode mode, uint8_t motion_threshold) {
+        uint8_t ctrl1, ctrl2, ths;
+        if (_watermark == 0 ||
+            !_bus.read(REG_CTRL_REG1, &ctrl1, 1) ||
+            !_bus.read(REG_CTRL_REG2, &ctrl2, 1) ||
+            !_bus.read(REG_FF_MT_THS, &ths, 1)) {
+            return false;
+        }
+        if (!_bus.write(REG_CTRL_REG1, ctrl1 & ~CTRL1_ACTIVE)) {
+            return false;
+        }
+
+        ctrl1 = (ctrl1 & ~CTRL1_DR_MASK) | (rate << CTRL1_DR_SHIFT);
+        ctrl2 = (ctrl2 & ~CTRL2_MODS_MASK) | mode;
+        ths = (ths & ~FF_MT_THS_MASK) | (motion_threshold & FF_MT_THS_MASK);
+        bool ok = _bus.write(REG_CTRL_REG2, ctrl2) &&
+                  _bus.write(REG_FF_MT_THS, ths) &&
+                  _bus.write(REG_F_SETUP, 0) &&
+                  _bus.write(REG_F_SETUP, F_MODE_CIRCULAR | _watermark);
+
+        if (!_bus.write(REG_CTRL_REG1, ctrl1 | CTRL1_ACTIVE)) {
+            return false;
+        }
+        return ok;
+    }
+
+    /*
+    * Reads INT_SOURCE, which tells which block(s) hold the interrupt line
+    */
+    bool read_sources(uint8_t &sources) {
+        return _bus.read(REG_INT_SOURCE, &sources, 1);
+    }
+
+    /*
+    * Moves everything queued in the sensor FIFO into `ring`.
+    *
+    * The first burst starts at F_STATUS and reads `watermark` samples, which
+    * are known to be there because the watermark interrupt fired. Only when
+    * F_STATUS reports more samples than that is a second burst needed.
+    * Returns the number of samples read, or -1 on a bus error.
+    */
+    template <size_t N>
+    int drain(SampleRing<AccelSample, N> &ring) {
+        uint8_t buffer[1 + CAPACITY * BYTES_PER_SAMPLE];
+
+        if (_watermark == 0) {
+            return -1;
+        }
+
+        if (!_bus.read(REG_STATUS, buffer, 1 + _watermark * BYTES_PER_SAMPLE)) {
+            return -1;
+        }
+        _bursts++;
+
+        uint8_t status = buffer[0];
+        if (status & F_STATUS_OVF) {
+            _overflows++;
+        }
+
+        int queued = status & F_STATUS_CNT_MASK;
+        int count = queued < _watermark ? queued : _watermark;
+        unpack(buffer + 1, count, ring);
+
+        int remaining = queued - count;
+        if (remaining > 0) {
+            if (!_bus.read(REG_OUT_X_MSB, buffer, remaining * BYTES_PER_SAMPLE)) {
+                return -1;
+            }
+            _bursts++;
+            unpack(buffer, remaining, ring);
+            count += remaining;
+        }
+        return count;
+    }
+
+    uint8_t watermark() const {
+        return _watermark;
+    }
+
+    // number of I2C bursts issued by drain()
+    uint32_t bursts() const {
+        return _bursts;
+    }
+
+    // number of times the sensor FIFO wrapped before it was drained
+    uint32_t overflows() const {
+        return _overflows;
+    }
+
+    // Decodes `count` samples of a burst from OUT_X_MSB on into `ring`
+    template <size_t N>
+    static void unpack(const uint8_t *data, int count, SampleRing<AccelSample, N> &ring) {
+        for (int i = 0; i < count; i++, data += BYTES_PER_SAMPLE) {
+            AccelSample sample;
+            // 14 bit left justified
+            sample.x = (int16_t)((data[0] << 8) | data[1]) >> 2;
+            sample.y = (int16_t)((data[2] << 8) | data[3]) >> 2;
+            sample.z = (int16_t)((data[4] << 8) | data[5]) >> 2;
+            ring.push(sample);
+        }
+    }
+
+private:
+    enum {
+        REG_STATUS          = 0x00,
+        REG_OUT_X_MSB       = 0x01,
+        REG_F_SETUP         = 0x09,
+        REG_INT_SOURCE      = 0x0C,
+        REG_FF_MT_THS       = 0x17,
+        REG_CTRL_REG1       = 0x2A,
+        REG_CTRL_REG2       = 0x2B,
+        REG_CTRL_REG4       = 0x2D,
+        REG_CTRL_REG5       = 0x2E,
+        REG_M_CTRL_REG1     = 0x5B,
+        REG_M_CTRL_REG2     = 0x5C
+    };
+
+    enum {
+        BYTES_PER_SAMPLE    = 6,
+        F_STATUS_OVF        = 0x80,
+        F_STATUS_CNT_MASK   = 0x3F,
+        F_MODE_CIRCULAR     = 0x40,
+        CTRL1_ACTIVE        = 0x01,
+        CTRL1_F_READ        = 0x02,
+        CTRL1_DR_SHIFT      = 3,
+        CTRL1_DR_MASK       = 0x38,
+        CTRL2_MODS_MASK     = 0x03,
+        FF_MT_THS_MASK      = 0x7F,
+        CTRL4_EN_FIFO       = 0x40,
+        CTRL5_CFG_FFMT      = 0x04,
+        CTRL5_CFG_FIFO      = 0x40,
+        M_CTRL1_HMS_MASK    = 0x03,
+        M_CTRL2_HYB_AUTOINC = 0x20
+    };
+
+    Bus         &_bus;
+    uint8_t     _watermark;
+    uint32_t    _bursts;
+    uint32_t    _overflows;
+};
+
+#endif // __KNOCK_CORE_FXOS8700CQ_FIFO_H__
@@ -0,0 +1,128 @@
+/*
+ * Copyright (c) 2016 ARM Limited. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __KNOCK_CORE_HEAP_RESOURCE_H__
+#define __KNOCK_CORE_HEAP_RESOURCE_H__
+
+#include <malloc.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "minar/minar.h"
+#include "core-util/FunctionPointer.h"
+#include "mbed-client/m2minterfacefactory.h"
+#include "mbed-client/m2mobject.h"
+#include "mbed-client/m2mobjectinstance.h"
+#include "mbed-client/m2mresource.h"
+#include "knock-core/int_format.h"
+#include "knock-core/static_arena.h"
+
+/*
+ * Heap usage from the C library, in bytes
+ */
+struct HeapStats {
+    uint32_t arena;         // taken from the system by malloc so far
+    uint32_t used;          // in allocated blocks
+    uint32_t free;          // in free blocks inside the arena
+    uint32_t free_chunks;   // number of free blocks, many small ones is fragmentation
+    uint32_t peak;          // most ever in use, 0 when the C library does not track it
+
+    static HeapStats read() {
+        HeapStats stats;
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+        struct mallinfo2 info = mallinfo2();
+#else
+        struct mallinfo info = mallinfo();
+#endif
+        stats.arena = info.arena;
+        stats.used = info.uordblks;
+        stats.free = info.fordblks;
+        stats.free_chunks = info.ordblks;
+        // newlib keeps the high-water mark here, glibc leaves it 0
+        stats.peak = info.usmblks;
+        return stats;
+    }
+};
+
+/*
+ * Publishes heap and arena usage as the read-only LWM2M object /heap/0:
+ *
+ *     /heap/0/used         bytes in allocated blocks
+ *     /heap/0/peak         most bytes ever in use
+ *     /heap/0/free         bytes in free blocks
+ *     /heap/0/free_chunks  number of free blocks
+ *     /heap/0/arena_used   bytes taken from `arena`
+ *     /heap/0/arena_size
+ *
+ * When the C library does not keep the peak, it is the largest `used` seen
+ * by the refreshes. The resources are not observable; they are refreshed
+ * every `period_ms` and read with GET.
+ */
+class HeapResource {
+public:
+    HeapResource(const Arena &arena, uint32_t period_ms = 10000)
+        : _arena(arena), _peak(0) {
+        _object = M2MInterfaceFactory::create_object("heap");
+        M2MObjectInstance* inst = _object->create_object_instance();
+
+        static const char *const NAMES[VALUES] = {
+            "used", "peak", "free", "free_chunks", "arena_used", "arena_size"
+        };
+        for (size_t i = 0; i < VALUES; i++) {
+            _values[i] = inst->create_dynamic_resource(NAMES[i], "HeapStat",
+                M2MResourceInstance::INTEGER, false /* observable */);
+            _values[i]->set_operation(M2MBase::GET_ALLOWED);
+        }
+        refresh();
+
+        minar::Scheduler::postCallback(mbed::util::FunctionPointer0<void>(this, &HeapResource::refresh).bind())
+            .period(minar::milliseconds(period_ms));
+    }
+
+    M2MObject* get_object() {
+        return _object;
+    }
+
+private:
+    enum {
+        VALUES = 6
+    };
+
+    void refresh() {
+        HeapStats heap = HeapStats::read();
+        if (heap.peak > _peak) {
+            _peak = heap.peak;
+        }
+        if (heap.used > _peak) {
+            _peak = heap.used;
+        }
+
+        uint32_t values[VALUES] = {
+            heap.used, _peak, heap.free, heap.free_chunks, (uint32_t)_arena.used(), (uint32_t)_arena.capacity()
+        };
+        for (size_t i = 0; i < VALUES; i++) {
+            char buffer[INT_FORMAT_SIZE];
+            size_t length = format_uint(buffer, values[i]);
+            _values[i]->set_value((uint8_t*)buffer, length);
+        }
+    }
+
+    const Arena &_arena;
+    uint32_t _peak;
+    M2MObject* _object;
+    M2MResource* _values[VALUES];
+};
+
+#endif // __KNOCK_CORE_HEAP_RESOURCE_H__
@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) 2016 ARM Limited. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __KNOCK_CORE_I2C_REGISTER_BUS_H__
+#define __KNOCK_CORE_I2C_REGISTER_BUS_H__
+
+#include <stdint.h>
+#include "mbed-drivers/mbed.h"
+
+/*
+ * Register read/write on top of mbed's I2C driver, used as the `Bus` for
+ * FXOS8700CQFifo and FXOS8700CQAcquisition. The FXOS8700CQ driver keeps its
+ * own I2C object private, so this opens a second one on the same pins; the
+ * mbed I2C class re-applies its settings whenever the owner of the
+ * peripheral changes.
+ *
+ * On targets with DEVICE_I2C_ASYNCH, read_async() runs a read in the
+ * background, with the HAL asked to move the bytes by DMA (the eDMA on the
+ * K64F). The blocking calls fail while it runs.
+ */
+class I2CRegisterBus {
+public:
+    I2CRegisterBus(PinName sda, PinName scl, int address)
+        : _i2c(sda, scl), _address(address), _busy(false) {
+        // the FIFO burst is up to 193 bytes, keep it short
+        _i2c.frequency(400000);
+#if DEVICE_I2C_ASYNCH
+        _i2c.set_dma_usage(DMA_USAGE_ALWAYS);
+#endif
+    }
+
+    bool read(uint8_t reg, uint8_t *data, int length) {
+        char r = reg;
+        if (_busy || _i2c.write(_address, &r, 1, true) != 0) {
+            return false;
+        }
+        return _i2c.read(_address, (char *)data, length) == 0;
+    }
+
+    bool write(uint8_t reg, uint8_t value) {
+        char buffer[2] = { (char)reg, (char)value };
+        return !_busy && _i2c.write(_address, buffer, 2) == 0;
+    }
+
+#if DEVICE_I2C_ASYNCH
+    /*
+    * Starts reading `length` bytes from `reg` into `data`, which has to stay
+    * valid until `done` is called with whether the read went through. That
+    * happens in the I2C interrupt, and `done` may start the next read.
+    * Returns false without calling `done` when a read is still running.
+    */
+    bool read_async(uint8_t reg, uint8_t *data, int length, const mbed::util::FunctionPointer1<void, bool> &done) {
+        if (_busy) {
+            return false;
+        }
+        _busy = true;
+        _reg = reg;
+        _done = done;
+        if (_i2c.transfer(_address, (const char *)&_reg, 1, (char *)data, length,
+                          event_callback_t(this, &I2CRegisterBus::transferred), I2C_EVENT_ALL) != 0) {
+            _busy = false;
+            return false;
+        }
+        return true;
+    }
+#endif
+
+private:
+#if DEVICE_I2C_ASYNCH
+    void transferred(int event) {
+        // `done` may start the next read, which replaces _done
+        mbed::util::FunctionPointer1<void, bool> done = _done;
+        _busy = false;
+        done.call(event == I2C_EVENT_TRANSFER_COMPLETE);
+    }
+
+    char _reg;
+    mbed::util::FunctionPointer1<void, bool> _done;
+#endif
+
+    I2C _i2c;
+    int _address;
+    volatile bool _busy;
+};
+
+#endif // __KNOCK_CORE_I2C_REGISTER_BUS_H__
@@ -0,0 +1,64 @@
+/*
+ * Copyright (c) 2016 ARM Limited. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __KNOCK_CORE_INT_FORMAT_H__
+#define __KNOCK_CORE_INT_FORMAT_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Decimal formatting for resource values without stringstream, std::string
+ * or printf, so nothing is allocated and no iostream code is linked in.
+ *
+ *     char buffer[INT_FORMAT_SIZE];
+ *     size_t length = format_int(buffer, counter);
+ *     res->set_value((uint8_t*)buffer, length);
+ */
+
+// number of decimal digits in `value`, usable in constant expressions
+constexpr size_t decimal_digits(uint32_t value) {
+    return value < 10 ? 1 : 1 + decimal_digits(value / 10);
+}
+
+// big enough for any int32_t or uint32_t, including sign and terminator
+const size_t INT_FORMAT_SIZE = decimal_digits(UINT32_MAX) + 2;
+
+/*
+ * Writes `value` to `buffer` with a terminating NUL and returns the number
+ * of characters, not counting the NUL
+ */
+inline size_t format_uint(char *buffer, uint32_t value) {
+    size_t length = decimal_digits(value);
+    buffer[length] = '\0';
+    char *p = buffer + length;
+    do {
+        *--p = '0' + value % 10;
+        value /= 10;
+    } while (value);
+    return length;
+}
+
+inline size_t format_int(char *buffer, int32_t value) {
+    if (value < 0) {
+        buffer[0] = '-';
+        // negate in unsigned, INT32_MIN has no positive counterpart
+        return 1 + format_uint(buffer + 1, 0u - (uint32_t)value);
+    }
+    return format_uint(buffer, value);
+}
+
+#endif // __KNOCK_CORE_INT_FORMAT_H__
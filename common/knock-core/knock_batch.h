@@ -0,0 +1,160 @@
+/*
+ * Copyright (c) 2016 ARM Limited. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __KNOCK_CORE_KNOCK_BATCH_H__
+#define __KNOCK_CORE_KNOCK_BATCH_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Packs several knocks into one resource value, so a burst of knocks costs
+ * one notification instead of one each. Layout, version 2:
+ *
+ *     u8      version         2
+ *     u8      count           number of knocks
+ *     u64     local           local time of the first knock, us since boot
+ *     u64     server          estimated server time of the first knock, us
+ *                             since the Unix epoch, 0 when not known
+ *     count times:
+ *       varint  delta << 2 | axis
+ *                             local us since the previous knock (0 for the
+ *                             first), axis 0 = x, 1 = y, 2 = z, 3 = unknown;
+ *                             at most MAX_DELTA, a knock further apart
+ *                             starts a batch of its own
+ *       u8      magnitude     square root of the Q15 envelope peak, 0 if unknown
+ *
+ * Multi-byte fields are big endian. varint is LEB128: 7 bits per byte,
+ * least significant first, high bit set on all but the last byte. A knock
+ * typically takes 4 to 5 bytes.
+ *
+ * web/knock-batch.js decodes this format, keep the two in sync.
+ */
+template <size_t MaxKnocks>
+class KnockBatch {
+public:
+    enum {
+        VERSION         = 2,
+        HEADER_SIZE     = 18,
+        AXIS_UNKNOWN    = 3
+    };
+
+    // delta << 2 has to fit in 32 bits, ~18 minutes
+    static const uint32_t MAX_DELTA = 0x3FFFFFFF;
+
+    KnockBatch() {
+        clear();
+    }
+
+    void clear() {
+        for (size_t i = 0; i < HEADER_SIZE; i++) {
+            _buffer[i] = 0;
+        }
+        _buffer[0] = VERSION;
+        _length = HEADER_SIZE;
+        _previous = 0;
+    }
+
+    /*
+    * Appends a knock. `local` is in microseconds since boot, `server` the
+    * server time for it or 0, and is only used for the first knock of a
+    * batch. Returns false when the batch is full, or when `local` is before
+    * the previous knock or more than MAX_DELTA after it; that knock has to
+    * go into a new batch, timed from its own header.
+    */
+    bool add(uint64_t local, uint64_t server, int32_t peak, uint8_t axis) {
+        if (full()) {
+            return false;
+        }
+
+        uint32_t delta = 0;
+        if (count() == 0) {
+            put64(2, local);
+            put64(10, server);
+        } else {
+            if (local < _previous || local - _previous > MAX_DELTA) {
+                return false;
+            }
+            delta = (uint32_t)(local - _previous);
+        }
+        _previous = local;
+
+        uint32_t value = (delta << 2) | (axis & 3);
+        do {
+            uint8_t byte = value & 0x7F;
+            value >>= 7;
+            _buffer[_length++] = value ? byte | 0x80 : byte;
+        } while (value);
+        _buffer[_length++] = magnitude(peak);
+
+        _buffer[1]++;
+        return true;
+    }
+
+    size_t count() const {
+        return _buffer[1];
+    }
+
+    bool full() const {
+        return count() == MaxKnocks;
+    }
+
+    const uint8_t *data() const {
+        return _buffer;
+    }
+
+    // encoded size in bytes
+    size_t length() const {
+        return _length;
+    }
+
+private:
+    static_assert(MaxKnocks <= 255, "the knock count is a single byte");
+
+    static const size_t MAX_KNOCK_SIZE = 5 + 1;
+
+    void put64(size_t position, uint64_t value) {
+        for (int i = 7; i >= 0; i--, value >>= 8) {
+            _buffer[position + i] = (uint8_t)value;
+        }
+    }
+
+    static uint8_t magnitude(int32_t peak) {
+        if (peak <= 0) {
+            return 0;
+        }
+        // integer square root, peak is at most 32767 so the result fits
+        uint32_t root = 0;
+        uint32_t bit = 1 << 14;
+        uint32_t value = peak;
+        while (bit) {
+            if (value >= root + bit) {
+                value -= root + bit;
+                root = (root >> 1) + bit;
+            } else {
+                root >>= 1;
+            }
+            bit >>= 2;
+        }
+        return root > 255 ? 255 : root;
+    }
+
+    uint8_t     _buffer[HEADER_SIZE + MaxKnocks * MAX_KNOCK_SIZE];
+    size_t      _length;
+    uint64_t    _previous;
+};
+
+#endif // __KNOCK_CORE_KNOCK_BATCH_H__
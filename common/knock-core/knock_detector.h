@@ -0,0 +1,271 @@
+/*
+ * Copyright (c) 2016 ARM Limited. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __KNOCK_CORE_KNOCK_DETECTOR_H__
+#define __KNOCK_CORE_KNOCK_DETECTOR_H__
+
+#include <stdint.h>
+#include "knock-core/accel_sample.h"
+
+/*
+ * Tuning for KnockDetector. Durations are in samples, the defaults are for
+ * 400 Hz. Energies are Q15, where 1.0 is a full scale (2g) vector.
+ */
+struct KnockDetectorConfig {
+    KnockDetectorConfig()
+        : highpass_pole(26214),     // 0.8, ~13 Hz corner at 400 Hz
+          attack(16384),            // 0.5
+          release(8192),            // 0.25, ~10 ms decay at 400 Hz
+          min_threshold(24),        // ~0.05g
+          noise_factor(6),
+          max_rise(8),              // 20 ms
+          max_duration(48),         // 120 ms
+          min_interval(40) {        // 100 ms
+    }
+
+    int16_t  highpass_pole;     // pole of the DC blocker, removes gravity and sway
+    int16_t  attack;            // envelope coefficient while the energy rises
+    int16_t  release;           // envelope coefficient while the energy falls
+    int32_t  min_threshold;     // onset threshold when the noise floor is low
+    uint8_t  noise_factor;      // onset threshold in multiples of the noise floor
+    uint16_t max_rise;          // knocks peak fast...
+    uint16_t max_duration;      // ...and die out fast, unlike slams
+    uint16_t min_interval;      // onsets closer than this are ringing, not knocks
+};
+
+/*
+ * A confirmed knock
+ */
+struct KnockOnset {
+    uint32_t sample;            // sample index of the onset
+    uint32_t interval;          // samples since the previous knock, 0 for the first
+    int32_t  peak;              // Q15 peak of the energy envelope
+    uint16_t duration;          // samples from onset until the envelope died out
+    uint8_t  axis;              // 0 = x, 1 = y, 2 = z, most energy at the peak
+};
+
+/*
+ * Knock detection on raw accelerometer samples, all in Q15 fixed point:
+ *
+ *   high-pass per axis -> energy -> envelope -> peak picking -> timing
+ *
+ * An event starts when the envelope crosses the onset threshold and ends
+ * when it drops below half of it. It only counts as a knock when the envelope
+ * peaks within `max_rise`, the event is over within `max_duration` and it
+ * starts at least `min_interval` after the previous knock. Door slams ring
+ * for too long and footsteps rise too slowly, so both are rejected.
+ */
+class KnockDetector {
+public:
+    KnockDetector(const KnockDetectorConfig &config = KnockDetectorConfig())
+        : _config(config) {
+        reset();
+    }
+
+    void reset() {
+        for (int i = 0; i < 3; i++) {
+            _previous_in[i] = 0;
+            _previous_out[i] = 0;
+        }
+        _index = 0;
+        _primed = false;
+        _envelope = 0;
+        _noise_floor = 0;
+        _in_peak = false;
+        _onset = 0;
+        _peak = 0;
+        _peak_index = 0;
+        _peak_axis = 0;
+        _threshold = 0;
+        _have_knock = false;
+        _last_knock = 0;
+        _candidates = 0;
+        _rejected = 0;
+    }
+
+    /*
+    * After a gap in the samples, e.g. while the sensor ran at another rate:
+    * the high-pass starts from the next sample again, so the jump across
+    * the gap is not taken for a knock, and an event in progress is dropped.
+    * The sample count, the noise floor and the last knock stay.
+    */
+    void resume() {
+        for (int i = 0; i < 3; i++) {
+            _previous_out[i] = 0;
+        }
+        _primed = false;
+        _envelope = 0;
+        _in_peak = false;
+    }
+
+    /*
+    * Feeds one sample, returns true and fills `knock` when it completes a
+    * knock. A knock is reported once the envelope has decayed, which is at
+    * most `max_duration` samples after the onset.
+    */
+    bool process(const AccelSample &sample, KnockOnset &knock) {
+        if (!_primed) {
+            // start the high-pass from the first sample, not from 0g
+            _previous_in[0] = sample.x * 4;
+            _previous_in[1] = sample.y * 4;
+            _previous_in[2] = sample.z * 4;
+            _primed = true;
+        }
+
+        int32_t energy[3];
+        energy[0] = axis_energy(0, sample.x);
+        energy[1] = axis_energy(1, sample.y);
+        energy[2] = axis_energy(2, sample.z);
+
+        int32_t total = energy[0] + energy[1] + energy[2];
+        if (total > 32767) {
+            total = 32767;
+        }
+
+        int32_t coefficient = total > _envelope ? _config.attack : _config.release;
+        _envelope += ((total - _envelope) * coefficient) >> 15;
+
+        uint32_t index = _index++;
+
+        if (!_in_peak) {
+            // noise floor only follows the quiet parts, kept scaled up by 64
+            // so small envelopes still move it
+            _noise_floor += _envelope - (_noise_floor >> 6);
+
+            int32_t threshold = (_noise_floor >> 6) * _config.noise_factor;
+            if (threshold < _config.min_threshold) {
+                threshold = _config.min_threshold;
+            }
+            if (_envelope > threshold) {
+                _in_peak = true;
+                _onset = index;
+                _peak = _envelope;
+                _peak_index = index;
+                _peak_axis = dominant_axis(energy);
+                _threshold = threshold;
+                _candidates++;
+            }
+            return false;
+        }
+
+        if (_envelope > _peak) {
+            _peak = _envelope;
+            _peak_index = index;
+            _peak_axis = dominant_axis(energy);
+        }
+
+        // half the onset threshold, so ripple around it does not split an
+        // event in two
+        if (_envelope > _threshold >> 1) {
+            return false;
+        }
+
+        _in_peak = false;
+
+        uint32_t duration = index - _onset;
+        if (_peak_index - _onset > _config.max_rise || duration > _config.max_duration) {
+            _rejected++;
+            return false;
+        }
+        if (_have_knock && _onset - _last_knock < _config.min_interval) {
+            _rejected++;
+            return false;
+        }
+
+        knock.sample = _onset;
+        knock.interval = _have_knock ? _onset - _last_knock : 0;
+        knock.peak = _peak;
+        knock.duration = duration;
+        knock.axis = _peak_axis;
+
+        _have_knock = true;
+        _last_knock = _onset;
+        return true;
+    }
+
+    // number of samples processed since reset()
+    uint32_t samples() const {
+        return _index;
+    }
+
+    // onsets seen, whether they turned out to be knocks or not
+    uint32_t candidates() const {
+        return _candidates;
+    }
+
+    // onsets that failed the shape or timing checks
+    uint32_t rejected() const {
+        return _rejected;
+    }
+
+    int32_t envelope() const {
+        return _envelope;
+    }
+
+    int32_t noise_floor() const {
+        return _noise_floor >> 6;
+    }
+
+private:
+    static int16_t saturate(int32_t value) {
+        if (value > 32767) {
+            return 32767;
+        }
+        if (value < -32768) {
+            return -32768;
+        }
+        return value;
+    }
+
+    /*
+    * DC blocker y[n] = x[n] - x[n-1] + p * y[n-1], then squared. The 14 bit
+    * sample is scaled up to Q15 first.
+    */
+    int32_t axis_energy(int axis, int16_t raw) {
+        int32_t in = raw * 4;
+        int32_t out = in - _previous_in[axis] + ((_config.highpass_pole * _previous_out[axis]) >> 15);
+        _previous_in[axis] = in;
+        _previous_out[axis] = saturate(out);
+        return (_previous_out[axis] * _previous_out[axis]) >> 15;
+    }
+
+    static uint8_t dominant_axis(const int32_t energy[3]) {
+        if (energy[0] >= energy[1] && energy[0] >= energy[2]) {
+            return 0;
+        }
+        return energy[1] >= energy[2] ? 1 : 2;
+    }
+
+    KnockDetectorConfig _config;
+    int32_t     _previous_in[3];
+    int32_t     _previous_out[3];
+    uint32_t    _index;
+    bool        _primed;
+    int32_t     _envelope;
+    int32_t     _noise_floor;
+    bool        _in_peak;
+    uint32_t    _onset;
+    int32_t     _peak;
+    uint32_t    _peak_index;
+    uint8_t     _peak_axis;
+    int32_t     _threshold;
+    bool        _have_knock;
+    uint32_t    _last_knock;
+    uint32_t    _candidates;
+    uint32_t    _rejected;
+};
+
+#endif // __KNOCK_CORE_KNOCK_DETECTOR_H__
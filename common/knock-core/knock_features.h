@@ -0,0 +1,378 @@
+/*
+ * Copyright (c) 2016 ARM Limited. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __KNOCK_CORE_KNOCK_FEATURES_H__
+#define __KNOCK_CORE_KNOCK_FEATURES_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include "knock-core/accel_sample.h"
+
+#if defined(ARM_MATH_CM4) && defined(__ARM_FEATURE_DSP)
+#include "arm_math.h"
+#define KNOCK_FEATURES_CMSIS
+#endif
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__)) && defined(__SSE2__)
+#include <immintrin.h>
+#define KNOCK_FEATURES_X86
+#endif
+
+/*
+ * What a knock looked like, from a window of raw samples around its onset.
+ * Everything is relative to the mean of the window, so gravity drops out.
+ */
+struct KnockFeatures {
+    uint16_t magnitude;     // peak vector magnitude, in sensor counts
+    uint8_t  axis;          // 0 = x, 1 = y, 2 = z, most energy over the window
+    int8_t   sign;          // +1 or -1, direction of the largest swing on that axis
+    uint16_t centroid;      // spectral centroid in DFT bins, Q8
+    uint64_t energy[3];     // sum of squares per axis, in counts^2
+};
+
+/*
+ * The kernels the extractor runs, in one class per instruction set. All of
+ * them compute exactly the same integers, so the backends can be checked
+ * against each other bit for bit. Operands are at most +/-16383.
+ *
+ *   dot(a, b, n)               sum of a[i] * b[i], exact in 64 bits
+ *   max_magnitude2(x, y, z, n) largest x[i]^2 + y[i]^2 + z[i]^2
+ */
+struct KnockFeatureScalar {
+    static const char *name() {
+        return "scalar";
+    }
+
+    static bool supported() {
+        return true;
+    }
+
+    static int64_t dot(const int16_t *a, const int16_t *b, size_t count) {
+        int64_t sum = 0;
+        for (size_t i = 0; i < count; i++) {
+            sum += (int32_t)a[i] * b[i];
+        }
+        return sum;
+    }
+
+    static int32_t max_magnitude2(const int16_t *x, const int16_t *y, const int16_t *z, size_t count) {
+        int32_t best = 0;
+        for (size_t i = 0; i < count; i++) {
+            int32_t magnitude2 = (int32_t)x[i] * x[i] + (int32_t)y[i] * y[i] + (int32_t)z[i] * z[i];
+            if (magnitude2 > best) {
+                best = magnitude2;
+            }
+        }
+        return best;
+    }
+};
+
+#ifdef KNOCK_FEATURES_CMSIS
+/*
+ * Cortex-M4 with CMSIS-DSP. arm_dot_prod_q15 accumulates the products
+ * unsaturated in 64 bits with SMLALD, which is exact. The magnitude loop is
+ * one MUL and two MLA per sample in plain C already.
+ */
+struct KnockFeatureCmsis : KnockFeatureScalar {
+    static const char *name() {
+        return "cmsis";
+    }
+
+    static int64_t dot(const int16_t *a, const int16_t *b, size_t count) {
+        q63_t sum;
+        arm_dot_prod_q15((q15_t *)a, (q15_t *)b, count, &sum);
+        return sum;
+    }
+};
+#endif
+
+#ifdef KNOCK_FEATURES_X86
+/*
+ * SSE2, 8 samples per step. PMADDWD gives pairs of products summed in 32
+ * bits, which cannot overflow for operands within +/-16383; they are
+ * widened to 64 bits before they are added up.
+ */
+struct KnockFeatureSse2 {
+    static const char *name() {
+        return "sse2";
+    }
+
+    static bool supported() {
+        return true;
+    }
+
+    static int64_t dot(const int16_t *a, const int16_t *b, size_t count) {
+        __m128i sum = _mm_setzero_si128();
+        size_t i = 0;
+        for (; i + 8 <= count; i += 8) {
+            __m128i pairs = _mm_madd_epi16(_mm_loadu_si128((const __m128i *)(a + i)),
+                                           _mm_loadu_si128((const __m128i *)(b + i)));
+            __m128i sign = _mm_srai_epi32(pairs, 31);
+            sum = _mm_add_epi64(sum, _mm_unpacklo_epi32(pairs, sign));
+            sum = _mm_add_epi64(sum, _mm_unpackhi_epi32(pairs, sign));
+        }
+        int64_t lanes[2];
+        _mm_storeu_si128((__m128i *)lanes, sum);
+        return lanes[0] + lanes[1] + KnockFeatureScalar::dot(a + i, b + i, count - i);
+    }
+
+    static int32_t max_magnitude2(const int16_t *x, const int16_t *y, const int16_t *z, size_t count) {
+        const __m128i zero = _mm_setzero_si128();
+        __m128i best = zero;
+        size_t i = 0;
+        for (; i + 8 <= count; i += 8) {
+            __m128i vx = _mm_loadu_si128((const __m128i *)(x + i));
+            __m128i vy = _mm_loadu_si128((const __m128i *)(y + i));
+            __m128i vz = _mm_loadu_si128((const __m128i *)(z + i));
+            __m128i xy = _mm_unpacklo_epi16(vx, vy);
+            __m128i z0 = _mm_unpacklo_epi16(vz, zero);
+            best = max_epi32(best, _mm_add_epi32(_mm_madd_epi16(xy, xy), _mm_madd_epi16(z0, z0)));
+            xy = _mm_unpackhi_epi16(vx, vy);
+            z0 = _mm_unpackhi_epi16(vz, zero);
+            best = max_epi32(best, _mm_add_epi32(_mm_madd_epi16(xy, xy), _mm_madd_epi16(z0, z0)));
+        }
+        int32_t lanes[4];
+        _mm_storeu_si128((__m128i *)lanes, best);
+        int32_t result = KnockFeatureScalar::max_magnitude2(x + i, y + i, z + i, count - i);
+        for (int lane = 0; lane < 4; lane++) {
+            if (lanes[lane] > result) {
+                result = lanes[lane];
+            }
+        }
+        return result;
+    }
+
+private:
+    // PMAXSD is SSE4.1
+    static __m128i max_epi32(__m128i a, __m128i b) {
+        __m128i greater = _mm_cmpgt_epi32(a, b);
+        return _mm_or_si128(_mm_and_si128(greater, a), _mm_andnot_si128(greater, b));
+    }
+};
+
+/*
+ * AVX2, 16 samples per step. Compiled for AVX2 whatever the build flags
+ * are; only call it when supported() says the CPU has it.
+ */
+struct KnockFeatureAvx2 {
+    static const char *name() {
+        return "avx2";
+    }
+
+    static bool supported() {
+        return __builtin_cpu_supports("avx2");
+    }
+
+    __attribute__((target("avx2")))
+    static int64_t dot(const int16_t *a, const int16_t *b, size_t count) {
+        __m256i sum = _mm256_setzero_si256();
+        size_t i = 0;
+        for (; i + 16 <= count; i += 16) {
+            __m256i pairs = _mm256_madd_epi16(_mm256_loadu_si256((const __m256i *)(a + i)),
+                                              _mm256_loadu_si256((const __m256i *)(b + i)));
+            sum = _mm256_add_epi64(sum, _mm256_cvtepi32_epi64(_mm256_castsi256_si128(pairs)));
+            sum = _mm256_add_epi64(sum, _mm256_cvtepi32_epi64(_mm256_extracti128_si256(pairs, 1)));
+        }
+        int64_t lanes[4];
+        _mm256_storeu_si256((__m256i *)lanes, sum);
+        return lanes[0] + lanes[1] + lanes[2] + lanes[3] + KnockFeatureScalar::dot(a + i, b + i, count - i);
+    }
+
+    __attribute__((target("avx2")))
+    static int32_t max_magnitude2(const int16_t *x, const int16_t *y, const int16_t *z, size_t count) {
+        const __m256i zero = _mm256_setzero_si256();
+        __m256i best = zero;
+        size_t i = 0;
+        for (; i + 16 <= count; i += 16) {
+            __m256i vx = _mm256_loadu_si256((const __m256i *)(x + i));
+            __m256i vy = _mm256_loadu_si256((const __m256i *)(y + i));
+            __m256i vz = _mm256_loadu_si256((const __m256i *)(z + i));
+            // unpacking works within 128 bit lanes, the order does not
+            // matter for the maximum
+            __m256i xy = _mm256_unpacklo_epi16(vx, vy);
+            __m256i z0 = _mm256_unpacklo_epi16(vz, zero);
+            best = _mm256_max_epi32(best, _mm256_add_epi32(_mm256_madd_epi16(xy, xy), _mm256_madd_epi16(z0, z0)));
+            xy = _mm256_unpackhi_epi16(vx, vy);
+            z0 = _mm256_unpackhi_epi16(vz, zero);
+            best = _mm256_max_epi32(best, _mm256_add_epi32(_mm256_madd_epi16(xy, xy), _mm256_madd_epi16(z0, z0)));
+        }
+        int32_t lanes[8];
+        _mm256_storeu_si256((__m256i *)lanes, best);
+        int32_t result = KnockFeatureScalar::max_magnitude2(x + i, y + i, z + i, count - i);
+        for (int lane = 0; lane < 8; lane++) {
+            if (lanes[lane] > result) {
+                result = lanes[lane];
+            }
+        }
+        return result;
+    }
+};
+#endif
+
+// what KnockFeatureExtractor uses unless told otherwise
+#if defined(KNOCK_FEATURES_CMSIS)
+typedef KnockFeatureCmsis KnockFeatureDefault;
+#elif defined(KNOCK_FEATURES_X86) && defined(__AVX2__)
+typedef KnockFeatureAvx2 KnockFeatureDefault;
+#elif defined(KNOCK_FEATURES_X86)
+typedef KnockFeatureSse2 KnockFeatureDefault;
+#else
+typedef KnockFeatureScalar KnockFeatureDefault;
+#endif
+
+/*
+ * Extracts KnockFeatures from WINDOW samples (80 ms at 400 Hz):
+ *
+ *   remove the mean per axis -> energy per axis -> dominant axis and sign
+ *                            -> peak vector magnitude
+ *                            -> DFT bins 1..WINDOW/2 -> spectral centroid
+ *
+ * The DFT is a dot product with Q15 cosine and sine rows per bin, so all
+ * the work is in `Kernels`. The rows take 2 KB, build one extractor and
+ * keep it.
+ */
+template <typename Kernels = KnockFeatureDefault>
+class KnockFeatureExtractor {
+public:
+    enum {
+        WINDOW = 32,
+        BINS = WINDOW / 2
+    };
+
+    KnockFeatureExtractor() {
+        // cos(2 pi j / WINDOW) in Q15, sin is the same a quarter turn later
+        static const int16_t COS[WINDOW] = {
+            32767, 32137, 30273, 27245, 23170, 18204, 12539, 6393,
+            0, -6393, -12539, -18204, -23170, -27245, -30273, -32137,
+            -32767, -32137, -30273, -27245, -23170, -18204, -12539, -6393,
+            0, 6393, 12539, 18204, 23170, 27245, 30273, 32137
+        };
+        for (int k = 0; k < BINS; k++) {
+            for (int i = 0; i < WINDOW; i++) {
+                _cos[k][i] = COS[((k + 1) * i) & (WINDOW - 1)];
+                _sin[k][i] = COS[((k + 1) * i + 3 * WINDOW / 4) & (WINDOW - 1)];
+            }
+        }
+    }
+
+    /*
+    * Features of samples.at(first) to samples.at(first + WINDOW - 1), for
+    * anything with an at() like SampleRing or std::vector
+    */
+    template <typename Samples>
+    void extract(const Samples &samples, size_t first, KnockFeatures &features) {
+        int32_t sum[3] = { 0, 0, 0 };
+        for (int i = 0; i < WINDOW; i++) {
+            const AccelSample &sample = samples.at(first + i);
+            _axes[0][i] = sample.x;
+            _axes[1][i] = sample.y;
+            _axes[2][i] = sample.z;
+            sum[0] += sample.x;
+            sum[1] += sample.y;
+            sum[2] += sample.z;
+        }
+        for (int axis = 0; axis < 3; axis++) {
+            int32_t mean = sum[axis] / WINDOW;
+            for (int i = 0; i < WINDOW; i++) {
+                _axes[axis][i] = clamp(_axes[axis][i] - mean);
+            }
+        }
+        compute(features);
+    }
+
+    // spectral centroid of `features` in Hz, for samples `sample_rate` Hz apart
+    static uint32_t centroid_hz(const KnockFeatures &features, uint32_t sample_rate) {
+        return ((uint32_t)features.centroid * sample_rate / WINDOW + 128) >> 8;
+    }
+
+private:
+    // 14 bit samples can be 2^14 - 1 away from their mean, anything wider
+    // would overflow the kernels
+    static int16_t clamp(int32_t value) {
+        if (value > 16383) {
+            return 16383;
+        }
+        if (value < -16383) {
+            return -16383;
+        }
+        return value;
+    }
+
+    static uint32_t isqrt(uint32_t value) {
+        uint32_t root = 0;
+        uint32_t bit = 1UL << 30;
+        while (bit > value) {
+            bit >>= 2;
+        }
+        while (bit) {
+            if (value >= root + bit) {
+                value -= root + bit;
+                root = (root >> 1) + bit;
+            } else {
+                root >>= 1;
+            }
+            bit >>= 2;
+        }
+        return root;
+    }
+
+    void compute(KnockFeatures &features) {
+        for (int axis = 0; axis < 3; axis++) {
+            features.energy[axis] = Kernels::dot(_axes[axis], _axes[axis], WINDOW);
+        }
+        uint8_t axis = 0;
+        if (features.energy[1] > features.energy[axis]) {
+            axis = 1;
+        }
+        if (features.energy[2] > features.energy[axis]) {
+            axis = 2;
+        }
+        features.axis = axis;
+
+        int16_t swing = 0;
+        for (int i = 0; i < WINDOW; i++) {
+            int16_t value = _axes[axis][i];
+            if ((value < 0 ? -value : value) > (swing < 0 ? -swing : swing)) {
+                swing = value;
+            }
+        }
+        features.sign = swing < 0 ? -1 : 1;
+
+        features.magnitude = isqrt(Kernels::max_magnitude2(_axes[0], _axes[1], _axes[2], WINDOW));
+
+        // |re| and |im| stay below 2^19 after the shift, so the power of
+        // a bin fits 41 bits and the weighted sum 46
+        uint64_t total = 0;
+        uint64_t weighted = 0;
+        for (int k = 0; k < BINS; k++) {
+            uint64_t power = 0;
+            for (int a = 0; a < 3; a++) {
+                int64_t re = Kernels::dot(_axes[a], _cos[k], WINDOW) >> 15;
+                int64_t im = Kernels::dot(_axes[a], _sin[k], WINDOW) >> 15;
+                power += re * re + im * im;
+            }
+            total += power;
+            weighted += power * (k + 1);
+        }
+        features.centroid = total ? (uint16_t)((weighted << 8) / total) : 0;
+    }
+
+    int16_t _cos[BINS][WINDOW];
+    int16_t _sin[BINS][WINDOW];
+    int16_t _axes[3][WINDOW];
+};
+
+#endif // __KNOCK_CORE_KNOCK_FEATURES_H__
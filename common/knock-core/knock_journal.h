@@ -0,0 +1,409 @@
+/*
+ * Copyright (c) 2016 ARM Limited. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __KNOCK_CORE_KNOCK_JOURNAL_H__
+#define __KNOCK_CORE_KNOCK_JOURNAL_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "knock-core/crc16.h"
+
+// a knock as the journal keeps it, what KnockBatch::add() takes
+struct JournalKnock {
+    uint32_t    sequence;   // for KnockJournal::forwarded()
+    uint64_t    local;      // us since the boot it happened in
+    uint64_t    server;     // server us since the Unix epoch, 0 if unknown
+    int16_t     peak;
+    uint8_t     axis;
+};
+
+/*
+ * Append-only journal of knocks in a flash region, to keep them while the
+ * client can not send them and forward them later, oldest first.
+ *
+ * The region is a ring of sectors written one after the other. A sector is
+ * erased just before its first record goes in, which drops the knocks in it
+ * that were not forwarded yet when the ring is full. Every sector is erased
+ * once per turn of the ring, so the wear is even without bookkeeping.
+ *
+ * Records take one 32 byte slot each, in the byte order of the CPU:
+ *
+ *     u32     sequence        one counter for all records, never 0xFFFFFFFF
+ *     u8      type            HEADER, KNOCK or FORWARDED
+ *     u8      axis            KNOCK
+ *     i16     peak            KNOCK
+ *     u64     local           KNOCK: local us; HEADER: erases of this sector
+ *     u64     server          KNOCK: server us, 0 if unknown
+ *     u32     forwarded       HEADER, FORWARDED: knocks up to this sequence
+ *                             went out
+ *     u16     reserved        0xFFFF
+ *     u16     crc             CRC-16/CCITT of the 30 bytes before
+ *
+ * The first slot of every sector is its header. A FORWARDED record is
+ * appended after every batch that went out, and each header repeats the
+ * last one, so erasing the sector that held it loses nothing. A record torn
+ * by a reset fails its CRC and is skipped. Knocks are forwarded at least
+ * once: a reset between sending a batch and its FORWARDED record sends the
+ * batch again.
+ *
+ * Flash is the region, addresses relative to its start:
+ *
+ *     uint32_t size() const;
+ *     uint32_t sector_size() const;       // erase unit
+ *     uint32_t program_size() const;      // program unit, has to divide 32
+ *     bool read(uint32_t address, void *data, uint32_t length);
+ *     bool program(uint32_t address, const void *data, uint32_t length);
+ *     bool erase(uint32_t address);       // the sector at `address`, to 0xFF
+ *
+ * StorageFlash in knock-core/storage_flash.h runs it on a CMSIS storage
+ * driver, host::FileFlash in host/source/file_flash.h on a file. Not
+ * interrupt safe, and append() may erase a sector, which blocks for tens of
+ * milliseconds on the K64F.
+ */
+template <typename Flash>
+class KnockJournal {
+public:
+    enum {
+        SLOT_SIZE   = 32
+    };
+
+    explicit KnockJournal(Flash &flash)
+        : _flash(flash), _sectors(0), _slots(0), _write(0), _read(0), _sequence(1), _forwarded(0),
+          _pending(0), _dropped(0), _erases(0), _failures(0) {
+    }
+
+    /*
+    * Finds the records already in the region. Returns false when the flash
+    * does not fit the journal. Whatever else the region holds is erased
+    * sector by sector as the journal gets to it.
+    */
+    bool mount() {
+        uint32_t sector_size = _flash.sector_size();
+        uint32_t program_size = _flash.program_size();
+        if (sector_size == 0 || program_size == 0 || SLOT_SIZE % program_size ||
+            sector_size % SLOT_SIZE || _flash.size() / sector_size < 2) {
+            return false;
+        }
+        _sectors = _flash.size() / sector_size;
+        _slots = sector_size / SLOT_SIZE;
+        _write = _read = 0;
+        _sequence = 1;
+        _forwarded = 0;
+        _pending = 0;
+
+        // the newest sector has the highest header sequence, and its header
+        // the last forwarded sequence from before it
+        Slot slot;
+        bool found = false;
+        uint32_t newest = 0;
+        uint32_t newest_sequence = 0;
+        for (uint32_t sector = 0; sector < _sectors; sector++) {
+            if (read_slot(sector * _slots, slot) && slot.type == HEADER &&
+                (!found || slot.sequence > newest_sequence)) {
+                found = true;
+                newest = sector;
+                newest_sequence = slot.sequence;
+                _forwarded = slot.forwarded;
+            }
+        }
+        if (!found) {
+            return true;
+        }
+
+        // its records, up to the first erased slot
+        uint32_t last = newest_sequence;
+        uint32_t end = (newest + 1) * _slots;
+        for (_write = newest * _slots + 1; _write < end; _write++) {
+            if (!_flash.read(_write * SLOT_SIZE, &slot, SLOT_SIZE)) {
+                continue;
+            }
+            if (erased(slot)) {
+                break;
+            }
+            if (valid(slot)) {
+                last = slot.sequence > last ? slot.sequence : last;
+                if (slot.type == FORWARDED && slot.forwarded > _forwarded) {
+                    _forwarded = slot.forwarded;
+                }
+            }
+        }
+        uint32_t newest_end = _write;
+        _write %= _sectors * _slots;
+        _sequence = last + 1;
+
+        // the knocks not forwarded yet, from the oldest sector on
+        bool first = true;
+        for (uint32_t i = 1; i <= _sectors; i++) {
+            uint32_t sector = (newest + i) % _sectors;
+            if (!read_slot(sector * _slots, slot) || slot.type != HEADER) {
+                continue;
+            }
+            uint32_t stop = sector == newest ? newest_end : sector * _slots + _slots;
+            for (uint32_t position = sector * _slots + 1; position < stop; position++) {
+                if (pending_knock(position, slot)) {
+                    if (first) {
+                        _read = position;
+                        first = false;
+                    }
+                    _pending++;
+                }
+            }
+        }
+        if (first) {
+            _read = _write;
+        }
+        return true;
+    }
+
+    /*
+    * Adds a knock, false when it could not be written or the journal is not
+    * mounted. Erases the next sector when the current one is full.
+    */
+    bool append(uint64_t local, uint64_t server, int32_t peak, uint8_t axis) {
+        Slot slot = blank(KNOCK);
+        slot.axis = axis;
+        slot.peak = peak > INT16_MAX ? INT16_MAX : peak < INT16_MIN ? INT16_MIN : (int16_t)peak;
+        slot.local = local;
+        slot.server = server;
+
+        uint32_t position;
+        if (!write(slot, position)) {
+            return false;
+        }
+        if (_pending++ == 0) {
+            _read = position;
+        }
+        return true;
+    }
+
+    /*
+    * Copies up to `max` of the oldest knocks that were not forwarded yet to
+    * `knocks`, and returns how many. They stay in the journal until
+    * forwarded() says they went out.
+    */
+    size_t peek(JournalKnock *knocks, size_t max) {
+        size_t count = 0;
+        Slot slot;
+        for (uint32_t position = _read; count < max && position != _write; position = next(position)) {
+            if (pending_knock(position, slot)) {
+                JournalKnock &knock = knocks[count++];
+                knock.sequence = slot.sequence;
+                knock.local = slot.local;
+                knock.server = slot.server;
+                knock.peak = slot.peak;
+                knock.axis = slot.axis;
+            }
+        }
+        return count;
+    }
+
+    /*
+    * The knocks up to `sequence` went out. Appends a FORWARDED record,
+    * returns false when that could not be written; they go out again after
+    * a reset then. When the ring is full the record waits for the next
+    * one instead of erasing the oldest knocks to make room.
+    */
+    bool forwarded(uint32_t sequence) {
+        if (sequence <= _forwarded) {
+            return true;
+        }
+        Slot slot;
+        for (; _read != _write; _read = next(_read)) {
+            if (pending_knock(_read, slot)) {
+                if (slot.sequence > sequence) {
+                    break;
+                }
+                _pending--;
+            }
+        }
+        _forwarded = sequence;
+        if (_write % _slots == 0 && _pending && _read / _slots == _write / _slots) {
+            return true;
+        }
+
+        slot = blank(FORWARDED);
+        slot.forwarded = sequence;
+        uint32_t position;
+        bool written = write(slot, position);
+        if (_pending == 0) {
+            _read = _write;
+        }
+        return written;
+    }
+
+    // knocks not forwarded yet
+    uint32_t pending() const {
+        return _pending;
+    }
+
+    // knocks erased before they were forwarded, since mount()
+    uint32_t dropped() const {
+        return _dropped;
+    }
+
+    // knocks the journal holds at least before it drops the oldest
+    uint32_t capacity() const {
+        return (_sectors - 1) * (_slots - 1);
+    }
+
+    // sectors erased since mount()
+    uint32_t erases() const {
+        return _erases;
+    }
+
+    // records or sectors that could not be written since mount()
+    uint32_t failures() const {
+        return _failures;
+    }
+
+private:
+    enum {
+        HEADER      = 1,
+        KNOCK       = 2,
+        FORWARDED   = 3
+    };
+
+    struct Slot {
+        uint32_t    sequence;
+        uint8_t     type;
+        uint8_t     axis;
+        int16_t     peak;
+        uint64_t    local;
+        uint64_t    server;
+        uint32_t    forwarded;
+        uint16_t    reserved;
+        uint16_t    crc;
+    };
+    static_assert(sizeof(Slot) == SLOT_SIZE, "a journal record has to fill its slot");
+
+    static Slot blank(uint8_t type) {
+        Slot slot;
+        memset(&slot, 0xFF, sizeof(slot));
+        slot.type = type;
+        return slot;
+    }
+
+    static uint16_t crc(const Slot &slot) {
+        return crc16_ccitt((const uint8_t*)&slot, SLOT_SIZE - 2);
+    }
+
+    static bool erased(const Slot &slot) {
+        const uint8_t *bytes = (const uint8_t*)&slot;
+        for (size_t i = 0; i < SLOT_SIZE; i++) {
+            if (bytes[i] != 0xFF) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    static bool valid(const Slot &slot) {
+        return slot.sequence != UINT32_MAX && slot.crc == crc(slot);
+    }
+
+    bool read_slot(uint32_t position, Slot &slot) {
+        return _flash.read(position * SLOT_SIZE, &slot, SLOT_SIZE) && valid(slot);
+    }
+
+    // a knock at `position` that was not forwarded yet, headers skipped
+    bool pending_knock(uint32_t position, Slot &slot) {
+        return position % _slots && read_slot(position, slot) && slot.type == KNOCK &&
+               slot.sequence > _forwarded;
+    }
+
+    uint32_t next(uint32_t position) const {
+        return position + 1 == _sectors * _slots ? 0 : position + 1;
+    }
+
+    /*
+    * Writes `slot` at the end, opening the next sector first when the
+    * current one is full. The slot is used up even when programming fails,
+    * it may hold part of the record.
+    */
+    bool write(Slot &slot, uint32_t &position) {
+        if (_slots == 0 || (_write % _slots == 0 && !open(_write / _slots))) {
+            // not mounted, or the sector could not be erased
+            _failures++;
+            return false;
+        }
+        slot.sequence = _sequence++;
+        slot.crc = crc(slot);
+        position = _write;
+        _write = next(_write);
+        if (!_flash.program(position * SLOT_SIZE, &slot, SLOT_SIZE)) {
+            _failures++;
+            return false;
+        }
+        return true;
+    }
+
+    /*
+    * Erases `sector` and writes its header. When the ring is full the knocks
+    * in it that were not forwarded are dropped, and the oldest pending knock
+    * is in the next sector.
+    */
+    bool open(uint32_t sector) {
+        uint32_t first = sector * _slots;
+        Slot slot;
+        uint64_t erases = read_slot(first, slot) && slot.type == HEADER ? slot.local + 1 : 1;
+
+        if (_pending && _read / _slots == sector) {
+            for (; _read < first + _slots; _read++) {
+                if (pending_knock(_read, slot)) {
+                    _pending--;
+                    _dropped++;
+                }
+            }
+            _read = next(_read - 1);
+        }
+
+        if (!_flash.erase(sector * _flash.sector_size())) {
+            return false;
+        }
+        _erases++;
+
+        slot = blank(HEADER);
+        slot.sequence = _sequence++;
+        slot.local = erases;
+        slot.forwarded = _forwarded;
+        slot.crc = crc(slot);
+        // without its header the sector is ignored after a reset, but the
+        // records still go in until then
+        _write = first + 1;
+        if (_pending == 0) {
+            _read = _write;
+        }
+        if (!_flash.program(first * SLOT_SIZE, &slot, SLOT_SIZE)) {
+            _failures++;
+        }
+        return true;
+    }
+
+    Flash       &_flash;
+    uint32_t    _sectors;
+    uint32_t    _slots;         // per sector, the header included
+    uint32_t    _write;         // slot of the next record
+    uint32_t    _read;          // slot of the oldest pending knock, or _write
+    uint32_t    _sequence;      // of the next record
+    uint32_t    _forwarded;
+    uint32_t    _pending;
+    uint32_t    _dropped;
+    uint32_t    _erases;
+    uint32_t    _failures;
+};
+
+#endif // __KNOCK_CORE_KNOCK_JOURNAL_H__
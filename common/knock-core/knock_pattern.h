@@ -0,0 +1,172 @@
+/*
+ * Copyright (c) 2016 ARM Limited. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __KNOCK_CORE_KNOCK_PATTERN_H__
+#define __KNOCK_CORE_KNOCK_PATTERN_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Result of a finished knock sequence
+ */
+struct PatternMatch {
+    int      index = -1;            // template that matched, -1 if none did
+    uint32_t score = UINT32_MAX;    // Q15 distance to that template, lower is better
+    uint8_t  knocks = 0;            // number of knocks in the sequence
+};
+
+/*
+ * Recognises knock rhythms ("secret knocks") against a fixed set of templates.
+ *
+ * Knocks are collected until nothing happens for `gap` time units, then the
+ * intervals of the sequence are normalised to Q15 fractions of its total
+ * length, so tempo does not matter, and compared to every template with the
+ * same number of knocks. The score is the sum of absolute differences; each
+ * template costs one pass over its intervals, with an early exit once it is
+ * worse than the best so far.
+ *
+ * Timestamps are in any unit that wraps at 2^32 (e.g. us_ticker_read()).
+ * All storage is fixed at compile time.
+ */
+template <size_t MaxKnocks, size_t MaxTemplates>
+class KnockPatternMatcher {
+    static_assert(MaxKnocks >= 2, "a pattern needs at least two knocks");
+
+public:
+    KnockPatternMatcher(uint32_t gap, uint32_t tolerance)
+        : _gap(gap), _tolerance(tolerance), _templates(0) {
+        reset();
+    }
+
+    /*
+    * Adds a template, given as the relative time between consecutive
+    * knocks, e.g. {2, 1, 1, 2, 4, 2} for "shave and a haircut, two bits".
+    * Returns the template index, or -1 if it does not fit.
+    */
+    int add_template(const uint16_t *intervals, size_t count) {
+        if (_templates == MaxTemplates || count == 0 || count >= MaxKnocks) {
+            return -1;
+        }
+        uint32_t values[MaxKnocks - 1];
+        for (size_t i = 0; i < count; i++) {
+            values[i] = intervals[i];
+        }
+        Template &t = _template[_templates];
+        t.count = count;
+        if (!normalise(values, count, t.intervals)) {
+            return -1;
+        }
+        return _templates++;
+    }
+
+    size_t templates() const {
+        return _templates;
+    }
+
+    void knock(uint32_t timestamp) {
+        if (_knocks > 0 && _count < MaxKnocks - 1) {
+            _intervals[_count++] = timestamp - _last;
+        } else if (_knocks > 0) {
+            // longer than any template can be, can not match anymore
+            _overflow = true;
+        }
+        if (_knocks < 255) {
+            _knocks++;
+        }
+        _last = timestamp;
+    }
+
+    /*
+    * Call regularly. Once the sequence has been quiet for `gap`, scores it,
+    * fills `match`, starts a new sequence and returns true.
+    */
+    bool poll(uint32_t now, PatternMatch &match) {
+        if (_knocks == 0 || now - _last < _gap) {
+            return false;
+        }
+
+        match.index = -1;
+        match.score = UINT32_MAX;
+        match.knocks = _knocks;
+
+        uint16_t sequence[MaxKnocks - 1];
+        if (!_overflow && _count > 0 && normalise(_intervals, _count, sequence)) {
+            score(sequence, _count, match);
+        }
+        reset();
+        return true;
+    }
+
+    void reset() {
+        _knocks = 0;
+        _count = 0;
+        _overflow = false;
+        _last = 0;
+    }
+
+private:
+    struct Template {
+        uint8_t  count;
+        uint16_t intervals[MaxKnocks - 1];
+    };
+
+    static bool normalise(const uint32_t *in, size_t count, uint16_t *out) {
+        uint64_t total = 0;
+        for (size_t i = 0; i < count; i++) {
+            total += in[i];
+        }
+        if (total == 0) {
+            return false;
+        }
+        for (size_t i = 0; i < count; i++) {
+            out[i] = ((uint64_t)in[i] << 15) / total;
+        }
+        return true;
+    }
+
+    void score(const uint16_t *sequence, size_t count, PatternMatch &match) const {
+        uint32_t best = _tolerance + 1;
+        for (size_t t = 0; t < _templates; t++) {
+            const Template &candidate = _template[t];
+            if (candidate.count != count) {
+                continue;
+            }
+            uint32_t distance = 0;
+            for (size_t i = 0; i < count && distance < best; i++) {
+                int32_t diff = (int32_t)sequence[i] - candidate.intervals[i];
+                distance += diff < 0 ? -diff : diff;
+            }
+            if (distance < best) {
+                best = distance;
+                match.index = t;
+                match.score = distance;
+            }
+        }
+    }
+
+    uint32_t    _gap;
+    uint32_t    _tolerance;
+    Template    _template[MaxTemplates];
+    size_t      _templates;
+    uint32_t    _intervals[MaxKnocks - 1];
+    size_t      _count;
+    uint8_t     _knocks;
+    bool        _overflow;
+    uint32_t    _last;
+};
+
+#endif // __KNOCK_CORE_KNOCK_PATTERN_H__
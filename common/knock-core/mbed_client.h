@@ -0,0 +1,679 @@
+/*
+ * Copyright (c) 2016 ARM Limited. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __KNOCK_CORE_MBED_CLIENT_H__
+#define __KNOCK_CORE_MBED_CLIENT_H__
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "mbed-client/m2mdevice.h"
+#include "mbed-client/m2minterface.h"
+#include "mbed-client/m2minterfacefactory.h"
+#include "mbed-client/m2minterfaceobserver.h"
+#include "mbed-client/m2mobject.h"
+#include "mbed-client/m2mobjectinstance.h"
+#include "mbed-client/m2mresource.h"
+#include "mbed-client/m2msecurity.h"
+#include "mbed-drivers/test_env.h"
+#include "mbed-hal/lp_ticker_api.h"
+#include "mbed-hal/us_ticker_api.h"
+#include "minar/minar.h"
+#include "core-util/FunctionPointer.h"
+#include "knock-core/int_format.h"
+#include "knock-core/notify_policy.h"
+#include "knock-core/reconnect_backoff.h"
+#include "knock-core/registration_scheduler.h"
+
+struct MbedClientDevice {
+    const char* Manufacturer;
+    const char* Type;
+    const char* ModelNumber;
+    const char* SerialNumber;
+    const char* DeviceType;     // endpoint type, empty or NULL for the transport's
+};
+
+/*
+ * Defaults for MbedClientConfig, see the "knock-detector" section in the
+ * config.json of firmware-6lowpan. Times in ms unless noted.
+ */
+#ifndef YOTTA_CFG_KNOCK_DETECTOR_NOTIFY_MIN_INTERVAL
+#define YOTTA_CFG_KNOCK_DETECTOR_NOTIFY_MIN_INTERVAL 1000
+#endif
+#ifndef YOTTA_CFG_KNOCK_DETECTOR_NOTIFY_MAX_INTERVAL
+#define YOTTA_CFG_KNOCK_DETECTOR_NOTIFY_MAX_INTERVAL 60000
+#endif
+#ifndef YOTTA_CFG_KNOCK_DETECTOR_NOTIFY_STEP
+#define YOTTA_CFG_KNOCK_DETECTOR_NOTIFY_STEP 0
+#endif
+#ifndef YOTTA_CFG_KNOCK_DETECTOR_NOTIFY_BURST
+#define YOTTA_CFG_KNOCK_DETECTOR_NOTIFY_BURST 5
+#endif
+#ifndef YOTTA_CFG_KNOCK_DETECTOR_NOTIFY_REFILL
+#define YOTTA_CFG_KNOCK_DETECTOR_NOTIFY_REFILL 2000
+#endif
+
+// Registration lifetime in seconds. Updates are planned at a percentage of
+// it with random jitter, and may go out with notifications once the
+// piggyback percentage has passed.
+#ifndef YOTTA_CFG_KNOCK_DETECTOR_REGISTRATION_LIFETIME
+#define YOTTA_CFG_KNOCK_DETECTOR_REGISTRATION_LIFETIME 3600
+#endif
+#ifndef YOTTA_CFG_KNOCK_DETECTOR_REGISTRATION_UPDATE_PERCENT
+#define YOTTA_CFG_KNOCK_DETECTOR_REGISTRATION_UPDATE_PERCENT 75
+#endif
+#ifndef YOTTA_CFG_KNOCK_DETECTOR_REGISTRATION_JITTER_PERCENT
+#define YOTTA_CFG_KNOCK_DETECTOR_REGISTRATION_JITTER_PERCENT 10
+#endif
+#ifndef YOTTA_CFG_KNOCK_DETECTOR_REGISTRATION_PIGGYBACK_PERCENT
+#define YOTTA_CFG_KNOCK_DETECTOR_REGISTRATION_PIGGYBACK_PERCENT 50
+#endif
+
+// Reconnect backoff, see ReconnectBackoff. "network" is for lost
+// connections, "rejected" for a server that refused the registration.
+#ifndef YOTTA_CFG_KNOCK_DETECTOR_RECONNECT_NETWORK_BASE
+#define YOTTA_CFG_KNOCK_DETECTOR_RECONNECT_NETWORK_BASE 5000
+#endif
+#ifndef YOTTA_CFG_KNOCK_DETECTOR_RECONNECT_NETWORK_CAP
+#define YOTTA_CFG_KNOCK_DETECTOR_RECONNECT_NETWORK_CAP 300000
+#endif
+#ifndef YOTTA_CFG_KNOCK_DETECTOR_RECONNECT_REJECTED_BASE
+#define YOTTA_CFG_KNOCK_DETECTOR_RECONNECT_REJECTED_BASE 60000
+#endif
+#ifndef YOTTA_CFG_KNOCK_DETECTOR_RECONNECT_REJECTED_CAP
+#define YOTTA_CFG_KNOCK_DETECTOR_RECONNECT_REJECTED_CAP 3600000
+#endif
+
+/*
+ * Lifetime and update policy of MbedClientCore. A firmware derives from it
+ * and hides the members it wants different:
+ *
+ *     struct EthernetClientConfig : MbedClientConfig {
+ *         static const uint32_t LIFETIME = 100;
+ *     };
+ *
+ * Everything is a compile-time constant, so a feature switched off here
+ * (PIGGYBACK or NOTIFY_SLOTS of 0) leaves no code behind.
+ */
+struct MbedClientConfig {
+    static const uint32_t LIFETIME = YOTTA_CFG_KNOCK_DETECTOR_REGISTRATION_LIFETIME;   // s
+
+    // Q15 fractions of the lifetime
+    static const uint16_t UPDATE_FRACTION = YOTTA_CFG_KNOCK_DETECTOR_REGISTRATION_UPDATE_PERCENT * 32768 / 100;
+    static const uint16_t UPDATE_JITTER = YOTTA_CFG_KNOCK_DETECTOR_REGISTRATION_JITTER_PERCENT * 32768 / 100;
+    // notifications carry the update once this much has passed, 0 never
+    static const uint16_t PIGGYBACK = YOTTA_CFG_KNOCK_DETECTOR_REGISTRATION_PIGGYBACK_PERCENT * 32768 / 100;
+
+    // an update that failed for another reason than a lost connection is
+    // retried after this long
+    static const uint32_t RETRY_MS = 30 * 1000;
+
+    static const uint32_t NETWORK_BASE = YOTTA_CFG_KNOCK_DETECTOR_RECONNECT_NETWORK_BASE;
+    static const uint32_t NETWORK_CAP = YOTTA_CFG_KNOCK_DETECTOR_RECONNECT_NETWORK_CAP;
+    static const uint32_t REJECTED_BASE = YOTTA_CFG_KNOCK_DETECTOR_RECONNECT_REJECTED_BASE;
+    static const uint32_t REJECTED_CAP = YOTTA_CFG_KNOCK_DETECTOR_RECONNECT_REJECTED_CAP;
+
+    // default notify policy for resources updated through set_value(). It
+    // is fixed device policy: the server sees it in /notify/0 but cannot
+    // change it, LWM2M write-attributes on a resource are not handled.
+    static const uint32_t NOTIFY_MIN_INTERVAL = YOTTA_CFG_KNOCK_DETECTOR_NOTIFY_MIN_INTERVAL;
+    static const uint32_t NOTIFY_MAX_INTERVAL = YOTTA_CFG_KNOCK_DETECTOR_NOTIFY_MAX_INTERVAL;
+    static const uint32_t NOTIFY_STEP = YOTTA_CFG_KNOCK_DETECTOR_NOTIFY_STEP;
+    static const uint8_t  NOTIFY_BURST = YOTTA_CFG_KNOCK_DETECTOR_NOTIFY_BURST;
+    static const uint32_t NOTIFY_REFILL = YOTTA_CFG_KNOCK_DETECTOR_NOTIFY_REFILL;
+    // resources that can be held back, 0 sends every set_value() right away
+    static const size_t   NOTIFY_SLOTS = 8;
+};
+
+/*
+ * The mbed client of both firmwares: registers the objects, keeps the
+ * registration alive, reconnects with backoff and rate limits
+ * notifications.
+ *
+ * Transport says how to reach the server:
+ *
+ *     struct Transport {
+ *         static const M2MInterface::BindingMode BINDING;
+ *         static const M2MInterface::NetworkStack STACK;
+ *         static const char *server_uri();
+ *         static const char *domain();
+ *         static const char *endpoint_name();
+ *         static String endpoint_type();          // when the device has none
+ *         static uint32_t seed(const String &endpoint_name);   // tells nodes apart
+ *         static void set_credentials(M2MSecurity *security);
+ *     };
+ *
+ * Config is an MbedClientConfig. The application creates the client once,
+ * adds its objects with object_list_push() and calls network_connected()
+ * when the network is up; the first registration goes out after a backoff
+ * delay, so nodes that come up together do not register together.
+ */
+template <typename Transport, typename Config = MbedClientConfig>
+class MbedClientCore : public M2MInterfaceObserver {
+public:
+    MbedClientCore(const MbedClientDevice &device, const String &endpoint_name = Transport::endpoint_name())
+        : _interface(NULL),
+          _register_security(NULL),
+          _update_timer_handle(NULL),
+          _reconnect_timer_handle(NULL),
+          _registered(false),
+          _registering(false),
+          _updating(false),
+          _device_info(device),
+          _endpoint_name(endpoint_name),
+          _registration(Config::LIFETIME, Config::UPDATE_FRACTION, Config::UPDATE_JITTER, Config::PIGGYBACK),
+          _last_refresh(0),
+          _backoff(backoff_strategy(Config::NETWORK_BASE, Config::NETWORK_CAP),
+                   backoff_strategy(Config::REJECTED_BASE, Config::REJECTED_CAP)),
+          _reconnect_reason(ReconnectBackoff::NETWORK),
+          _notify_count(0),
+          _notify_timer_handle(NULL),
+          _clock_ms(0),
+          _clock_us(lp_ticker_read()) {
+        // Create LWM2M device object specifying device resources
+        // as per OMA LWM2M specification.
+        _object_list.push_back(create_device_object());
+        if (Config::NOTIFY_SLOTS) {
+            _object_list.push_back(create_notify_object());
+        }
+    }
+
+    ~MbedClientCore() {
+        if (_register_security) {
+            delete _register_security;
+        }
+        if (_interface) {
+            delete _interface;
+        }
+        if (_update_timer_handle) {
+            minar::Scheduler::cancelCallback(_update_timer_handle);
+        }
+        if (_reconnect_timer_handle) {
+            minar::Scheduler::cancelCallback(_reconnect_timer_handle);
+        }
+        if (_notify_timer_handle) {
+            minar::Scheduler::cancelCallback(_notify_timer_handle);
+        }
+    }
+
+    // Adds an object to register, before network_connected()
+    void object_list_push(M2MObject* obj) {
+        _object_list.push_back(obj);
+    }
+
+    // The network came up, register after a backoff delay
+    void network_connected() {
+        _reconnect_reason = ReconnectBackoff::NETWORK;
+        wait();
+    }
+
+    bool registered() const {
+        return _registered;
+    }
+
+    // Called whenever a registration was accepted, the first one and every
+    // one after a reconnect
+    void on_registered(const mbed::util::FunctionPointer0<void> &callback) {
+        _on_registered = callback;
+    }
+
+    // a registration or update is out and the reply has not come yet
+    bool awaiting_response() const {
+        return _registering || _updating;
+    }
+
+    // Sends the registration update early when the piggyback point has
+    // passed, so it goes out while the node is awake anyway
+    void align_update() {
+        if (Config::PIGGYBACK && _registered && !_updating &&
+            _registration.piggyback(now_ms() - _last_refresh)) {
+            printf("piggybacking registration update\r\n");
+            update_registration();
+        }
+    }
+
+    void test_unregister() {
+        if (_interface) {
+            _interface->unregister_object(NULL);
+        }
+    }
+
+    // Updates an observable resource through its notify policy. Updates that
+    // come in faster than the policy allows are held back, and only the
+    // latest one is sent once it does.
+    void set_value(M2MResource *res, const uint8_t *value, uint32_t length) {
+        NotifySlot *slot = notify_slot(res);
+        if (!slot || length > sizeof(slot->value)) {
+            // no room to hold it back, send it as is
+            res->set_value(value, length);
+            return;
+        }
+
+        if (slot->pending) {
+            slot->policy.superseded();
+        }
+        memcpy(slot->value, value, length);
+        slot->length = length;
+        slot->numeric = res->resource_instance_type() == M2MResourceInstance::INTEGER &&
+                        parse_int(value, length, slot->number);
+        slot->pending = true;
+
+        flush_notifications();
+    }
+
+    // Overrides the default policy of Config for one resource
+    void set_notify_policy(M2MResource *res, const NotifyPolicyConfig &config) {
+        NotifySlot *slot = notify_slot(res);
+        if (slot) {
+            slot->policy.configure(config);
+        }
+    }
+
+    //Callback from mbed client stack when the bootstrap
+    // is successful, it returns the mbed Device Server object
+    // which will be used for registering the resources to
+    // mbed Device server.
+    void bootstrap_done(M2MSecurity */*server_object*/) {
+    }
+
+    //Callback from mbed client stack when the registration
+    // is successful, it returns the mbed Device Server object
+    // to which the resources are registered and registered objects.
+    void object_registered(M2MSecurity */*security_object*/, const M2MServer &/*server_object*/) {
+        printf("object_registered()\r\n");
+        _backoff.reset();
+        idle();
+        if (_on_registered) {
+            _on_registered();
+        }
+    }
+
+    //Callback from mbed client stack when the unregistration
+    // is successful, it returns the mbed Device Server object
+    // to which the resources were unregistered.
+    void object_unregistered(M2MSecurity */*server_object*/) {
+        printf("object_unregistered()\r\n");
+        _registered = false;
+        // This will turn on the LED on the board specifying that
+        // the application has run successfully.
+        notify_completion(!_registered);
+        minar::Scheduler::stop();
+    }
+
+    void registration_updated(M2MSecurity */*security_object*/, const M2MServer & /*server_object*/) {
+        printf("registration_updated()\r\n");
+        _updating = false;
+        _last_refresh = now_ms();
+        schedule_update(_registration.next_delay());
+    }
+
+    //Callback from mbed client stack if any error is encountered
+    // during any of the LWM2M operations. Error type is passed in
+    // the callback.
+    void error(M2MInterface::Error error) {
+        printf("error %d\r\n", error);
+        switch (error) {
+            case M2MInterface::NetworkError:
+                printf("Reconnecting to server\r\n");
+                _reconnect_reason = ReconnectBackoff::NETWORK;
+                minar::Scheduler::postCallback(this, &MbedClientCore::wait);
+                break;
+            case M2MInterface::NotAllowed:
+                printf("Reconnecting to server\r\n");
+                _reconnect_reason = ReconnectBackoff::REJECTED;
+                minar::Scheduler::postCallback(this, &MbedClientCore::wait);
+                break;
+            default:
+                if (_updating) {
+                    _updating = false;
+                    schedule_update(Config::RETRY_MS);
+                }
+                break;
+        }
+    }
+
+    //Callback from mbed client stack if any value has changed
+    // during PUT operation. Object and its type is passed in
+    // the callback.
+    void value_updated(M2MBase *base, M2MBase::BaseType type) {
+        printf("PUT request received, name '%s', type %d, resource type '%s'\r\n",
+               base->name().c_str(), type, base->resource_type().c_str());
+    }
+
+private:
+    struct NotifySlot {
+        M2MResource     *resource;
+        NotifyPolicy    policy;
+        uint8_t         value[64];
+        uint32_t        length;
+        bool            numeric;
+        int32_t         number;
+        bool            pending;
+    };
+
+    static BackoffStrategy backoff_strategy(uint32_t base, uint32_t cap) {
+        BackoffStrategy strategy = { base, cap };
+        return strategy;
+    }
+
+    static NotifyPolicyConfig default_notify_policy() {
+        return NotifyPolicyConfig(Config::NOTIFY_MIN_INTERVAL, Config::NOTIFY_MAX_INTERVAL, Config::NOTIFY_STEP,
+                                  Config::NOTIFY_BURST, Config::NOTIFY_REFILL);
+    }
+
+    // Reads a resource value written by format_int, false if it is anything else
+    static bool parse_int(const uint8_t *value, uint32_t length, int32_t &result) {
+        uint32_t i = 0;
+        bool negative = length > 0 && value[0] == '-';
+        if (negative) {
+            i++;
+        }
+        if (i == length || length - i > 10) {
+            return false;
+        }
+        int64_t number = 0;
+        for (; i < length; i++) {
+            if (value[i] < '0' || value[i] > '9') {
+                return false;
+            }
+            number = number * 10 + (value[i] - '0');
+        }
+        if (negative) {
+            number = -number;
+        }
+        if (number > INT32_MAX || number < INT32_MIN) {
+            return false;
+        }
+        result = number;
+        return true;
+    }
+
+    bool create_interface() {
+        srand(time(NULL));
+        uint16_t port = rand() % 65535 + 12345;
+
+        uint32_t seed = Transport::seed(_endpoint_name);
+        _registration.seed(seed);
+        _backoff.seed(seed ^ us_ticker_read());
+
+        String endpoint_type;
+        if (_device_info.DeviceType && *_device_info.DeviceType) {
+            endpoint_type = _device_info.DeviceType;
+        } else {
+            endpoint_type = Transport::endpoint_type();
+        }
+
+        _interface = M2MInterfaceFactory::create_interface(*this,
+                     _endpoint_name,
+                     endpoint_type,
+                     Config::LIFETIME,
+                     port,
+                     Transport::domain(),
+                     Transport::BINDING,
+                     Transport::STACK,
+                     "");
+        return (_interface == NULL) ? false : true;
+    }
+
+    M2MSecurity *create_register_object() {
+        // Creates register server object with mbed device server address and other parameters
+        // required for client to connect to mbed device server.
+        M2MSecurity *security = M2MInterfaceFactory::create_security(M2MSecurity::M2MServer);
+        if (security) {
+            security->set_resource_value(M2MSecurity::M2MServerUri, Transport::server_uri());
+            security->set_resource_value(M2MSecurity::BootstrapServer, 0);
+            security->set_resource_value(M2MSecurity::SecurityMode, M2MSecurity::Certificate);
+            Transport::set_credentials(security);
+        }
+        return security;
+    }
+
+    M2MDevice *create_device_object() {
+        // The device object is a singleton in mbed-client, clients in the
+        // same process share it
+        M2MDevice *device = M2MInterfaceFactory::create_device();
+        if (device && !device->is_resource_present(M2MDevice::Manufacturer)) {
+            device->create_resource(M2MDevice::Manufacturer, _device_info.Manufacturer);
+            device->create_resource(M2MDevice::DeviceType, _device_info.Type);
+            device->create_resource(M2MDevice::ModelNumber, _device_info.ModelNumber);
+            device->create_resource(M2MDevice::SerialNumber, _device_info.SerialNumber);
+        }
+        return device;
+    }
+
+    M2MObject *create_notify_object() {
+        // Publishes the default notify policy, so the server can see how often
+        // it can expect notifications. Read only and in ms; these are not the
+        // LWM2M pmin/pmax/st attributes, which are in seconds and written by
+        // the server. Resources with their own policy from set_notify_policy()
+        // are not listed here.
+        M2MObject *object = M2MInterfaceFactory::create_object("notify");
+        if (object) {
+            M2MObjectInstance *inst = object->create_object_instance();
+            if (inst) {
+                const char *names[] = { "min_interval_ms", "max_interval_ms", "step" };
+                uint32_t values[] = {
+                    Config::NOTIFY_MIN_INTERVAL,
+                    Config::NOTIFY_MAX_INTERVAL,
+                    Config::NOTIFY_STEP
+                };
+                for (int i = 0; i < 3; i++) {
+                    char buffer[INT_FORMAT_SIZE];
+                    size_t size = format_uint(buffer, values[i]);
+                    inst->create_static_resource(names[i],
+                                                 "NotifyPolicy",
+                                                 M2MResourceInstance::INTEGER,
+                                                 (uint8_t *)buffer,
+                                                 size);
+                }
+            }
+        }
+        return object;
+    }
+
+    NotifySlot *notify_slot(M2MResource *res) {
+        for (size_t i = 0; i < _notify_count; i++) {
+            if (_notify[i].resource == res) {
+                return &_notify[i];
+            }
+        }
+        if (_notify_count == Config::NOTIFY_SLOTS) {
+            return NULL;
+        }
+        NotifySlot *slot = &_notify[_notify_count++];
+        slot->resource = res;
+        slot->policy.configure(default_notify_policy());
+        slot->length = 0;
+        slot->numeric = false;
+        slot->number = 0;
+        slot->pending = false;
+        return slot;
+    }
+
+    /*
+     * Sends every held back value its policy allows now, and sets one timer for
+     * the earliest of the rest. A value below `step` with no max_interval stays held back
+     * until a bigger change replaces it.
+     */
+    void flush_notifications() {
+        if (_notify_timer_handle) {
+            minar::Scheduler::cancelCallback(_notify_timer_handle);
+            _notify_timer_handle = NULL;
+        }
+
+        uint32_t now = now_ms();
+        uint32_t next = NotifyPolicy::NEVER;
+        bool sent = false;
+        for (size_t i = 0; i < _notify_count; i++) {
+            NotifySlot &slot = _notify[i];
+            if (!slot.pending) {
+                continue;
+            }
+            uint32_t delay = slot.policy.offer(now, slot.numeric, slot.number);
+            if (delay == 0) {
+                slot.resource->set_value(slot.value, slot.length);
+                slot.policy.sent(now, slot.numeric, slot.number);
+                slot.pending = false;
+                sent = true;
+            } else if (delay < next) {
+                next = delay;
+            }
+        }
+
+        if (next != NotifyPolicy::NEVER) {
+            mbed::util::FunctionPointer0<void> fp(this, &MbedClientCore::notify_timeout);
+            _notify_timer_handle = minar::Scheduler::postCallback(fp.bind())
+                    .delay(minar::milliseconds(next))
+                    .getHandle();
+        }
+
+        if (sent) {
+            align_update();
+        }
+    }
+
+    void notify_timeout() {
+        // already fired, must not be cancelled anymore
+        _notify_timer_handle = NULL;
+        flush_notifications();
+    }
+
+    // Milliseconds since start, wrapping at 2^32. Runs on the low power
+    // ticker, since the us_ticker stops in deep sleep and the intervals of
+    // the notify policy and the piggyback point would fall behind. Needs to be
+    // called at least once per ticker wrap (~71 minutes), which the
+    // registration updates do for lifetimes up to ~80 minutes.
+    uint32_t now_ms() {
+        uint32_t elapsed = lp_ticker_read() - _clock_us;
+        _clock_ms += elapsed / 1000;
+        _clock_us += elapsed - elapsed % 1000;
+        return _clock_ms;
+    }
+
+    void send_registration() {
+        // already fired, must not be cancelled anymore
+        _reconnect_timer_handle = NULL;
+        if (_interface && !_registered && !_registering && !_updating) {
+            printf("send_registration()\r\n");
+            _registering = true;
+            _interface->register_object(_register_security, _object_list);
+        }
+    }
+
+    void update_registration() {
+        printf("update_registration()\r\n");
+        if (_registered && !_updating) {
+            if (_update_timer_handle) {
+                // piggybacked, the planned one is not needed anymore
+                minar::Scheduler::cancelCallback(_update_timer_handle);
+                _update_timer_handle = NULL;
+            }
+            _interface->update_registration(_register_security, Config::LIFETIME);
+            _updating = true;
+        }
+    }
+
+    void update_timeout() {
+        // already fired, must not be cancelled anymore
+        _update_timer_handle = NULL;
+        update_registration();
+    }
+
+    void schedule_update(uint32_t delay) {
+        if (_update_timer_handle) {
+            minar::Scheduler::cancelCallback(_update_timer_handle);
+        }
+        printf("next registration update in %lu s\r\n", (unsigned long)(delay / 1000));
+        mbed::util::FunctionPointer0<void> fp(this, &MbedClientCore::update_timeout);
+        _update_timer_handle = minar::Scheduler::postCallback(fp.bind())
+                .delay(minar::milliseconds(delay))
+                .getHandle();
+    }
+
+    void wait() {
+        _registering = false;
+        _registered = false;
+        _updating = false;
+
+        if (_update_timer_handle) {
+            minar::Scheduler::cancelCallback(_update_timer_handle);
+            _update_timer_handle = NULL;
+        }
+        if (_reconnect_timer_handle) {
+            minar::Scheduler::cancelCallback(_reconnect_timer_handle);
+            _reconnect_timer_handle = NULL;
+        }
+
+        // The interface and security object are created once and kept for good;
+        // register_object() starts a new session on the same interface, also
+        // after the server refused us. Recreating them on every reconnect would
+        // fragment the heap over weeks of uptime.
+        if (!_interface) {
+            // Create LWM2M Client API interface to manage bootstrap,
+            // register and unregister
+            if (create_interface() == false) {
+                printf("Fatal error, can't create interface\r\n");
+                return;
+            }
+        }
+        if (!_register_security) {
+            _register_security = create_register_object();
+        }
+
+        // Issue register command.
+        uint32_t delay = _backoff.next_delay(_reconnect_reason);
+        printf("waiting %lu ms before sending registration (attempt %d)...\r\n",
+               (unsigned long)delay, _backoff.attempts());
+        mbed::util::FunctionPointer0<void> fp(this, &MbedClientCore::send_registration);
+        _reconnect_timer_handle = minar::Scheduler::postCallback(fp.bind())
+                .delay(minar::milliseconds(delay))
+                .getHandle();
+    }
+
+    void idle() {
+        _registered = true;
+        _registering = false;
+        _updating = false;
+
+        _last_refresh = now_ms();
+        schedule_update(_registration.next_delay());
+    }
+
+    M2MInterface        *_interface;
+    M2MSecurity         *_register_security;
+    minar::callback_handle_t   _update_timer_handle;
+    minar::callback_handle_t   _reconnect_timer_handle;
+    M2MObjectList       _object_list;
+    bool                _registered;
+    bool                _registering;
+    bool                _updating;
+    MbedClientDevice    _device_info;
+    String              _endpoint_name;
+    RegistrationScheduler   _registration;
+    uint32_t            _last_refresh;  // ms, last registration or update
+    ReconnectBackoff    _backoff;
+    ReconnectBackoff::Reason   _reconnect_reason;
+    NotifySlot          _notify[Config::NOTIFY_SLOTS ? Config::NOTIFY_SLOTS : 1];
+    size_t              _notify_count;
+    minar::callback_handle_t   _notify_timer_handle;
+    uint32_t            _clock_ms;
+    uint32_t            _clock_us;
+    mbed::util::FunctionPointer0<void>  _on_registered;
+};
+
+#endif // __KNOCK_CORE_MBED_CLIENT_H__
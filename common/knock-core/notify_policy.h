@@ -0,0 +1,183 @@
+/*
+ * Copyright (c) 2016 ARM Limited. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __KNOCK_CORE_NOTIFY_POLICY_H__
+#define __KNOCK_CORE_NOTIFY_POLICY_H__
+
+#include <stdint.h>
+
+/*
+ * Limits for one observable resource, times in ms. min_interval, max_interval
+ * and step work like the LWM2M pmin, pmax and st attributes, but are set by
+ * the device and not written by the server.
+ */
+struct NotifyPolicyConfig {
+    NotifyPolicyConfig()
+        : min_interval(0), max_interval(0), step(0), burst(0), refill(0) {
+    }
+
+    NotifyPolicyConfig(uint32_t min_interval, uint32_t max_interval, uint32_t step, uint8_t burst,
+                       uint32_t refill)
+        : min_interval(min_interval), max_interval(max_interval), step(step), burst(burst), refill(refill) {
+    }
+
+    uint32_t min_interval;  // minimum time between notifications
+    uint32_t max_interval;  // changes smaller than `step` wait at most this long, 0 = forever
+    uint32_t step;          // minimum change of a numeric value, 0 = any change
+    uint8_t  burst;         // token bucket size, 0 = no bucket
+    uint32_t refill;        // time to earn back one token
+};
+
+/*
+ * Decides when an update of a resource may go out as a notification.
+ *
+ * The caller offers each new value with offer(). When it returns 0 the
+ * value is sent and sent() is called, otherwise the caller keeps the value
+ * (replacing any older one it held back) and offers it again after the
+ * returned delay. That way bursts collapse into one notification carrying
+ * the latest value, and nothing is lost.
+ *
+ * Timestamps are in ms and may wrap at 2^32.
+ */
+class NotifyPolicy {
+public:
+    static const uint32_t NEVER = UINT32_MAX;
+
+    NotifyPolicy(const NotifyPolicyConfig &config = NotifyPolicyConfig()) {
+        configure(config);
+    }
+
+    void configure(const NotifyPolicyConfig &config) {
+        _config = config;
+        _tokens = config.burst;
+        _last_refill = 0;
+        _last_sent = 0;
+        _last_value = 0;
+        _has_sent = false;
+        _sent = 0;
+        _held = 0;
+    }
+
+    const NotifyPolicyConfig &config() const {
+        return _config;
+    }
+
+    /*
+    * Returns how long to wait before the value may be sent, 0 for right now
+    * or NEVER when it only differs by less than `step` and there is no max_interval.
+    * `numeric` says whether `value` holds the value as a number; `step` is
+    * ignored for anything else.
+    */
+    uint32_t offer(uint32_t now, bool numeric, int32_t value) {
+        refill(now);
+        if (!_has_sent) {
+            return bucket_wait(now);
+        }
+
+        uint32_t since = now - _last_sent;
+        uint32_t wait = since < _config.min_interval ? _config.min_interval - since : 0;
+
+        if (numeric && !significant(value)) {
+            if (_config.max_interval == 0) {
+                return NEVER;
+            }
+            uint32_t max_wait = since < _config.max_interval ? _config.max_interval - since : 0;
+            if (max_wait > wait) {
+                wait = max_wait;
+            }
+        }
+
+        uint32_t tokens_wait = bucket_wait(now);
+        return tokens_wait > wait ? tokens_wait : wait;
+    }
+
+    void sent(uint32_t now, bool numeric, int32_t value) {
+        refill(now);
+        if (_config.burst && _tokens) {
+            _tokens--;
+        }
+        _last_sent = now;
+        if (numeric) {
+            _last_value = value;
+        }
+        _has_sent = true;
+        _sent++;
+    }
+
+    // a value was held back and later replaced by a newer one
+    void superseded() {
+        _held++;
+    }
+
+    // notifications sent
+    uint32_t notifications() const {
+        return _sent;
+    }
+
+    // updates that never went out because a newer value replaced them
+    uint32_t coalesced() const {
+        return _held;
+    }
+
+private:
+    bool significant(int32_t value) const {
+        if (_config.step == 0) {
+            return true;
+        }
+        int64_t diff = (int64_t)value - _last_value;
+        return (diff < 0 ? -diff : diff) >= _config.step;
+    }
+
+    void refill(uint32_t now) {
+        if (_config.burst == 0 || _config.refill == 0) {
+            return;
+        }
+        if (_tokens == _config.burst) {
+            _last_refill = now;
+            return;
+        }
+        uint32_t earned = (now - _last_refill) / _config.refill;
+        if (earned == 0) {
+            return;
+        }
+        if (earned >= (uint32_t)(_config.burst - _tokens)) {
+            _tokens = _config.burst;
+            _last_refill = now;
+        } else {
+            _tokens += earned;
+            _last_refill += earned * _config.refill;
+        }
+    }
+
+    uint32_t bucket_wait(uint32_t now) const {
+        if (_config.burst == 0 || _config.refill == 0 || _tokens > 0) {
+            return 0;
+        }
+        uint32_t since = now - _last_refill;
+        return since < _config.refill ? _config.refill - since : 0;
+    }
+
+    NotifyPolicyConfig _config;
+    uint8_t     _tokens;
+    uint32_t    _last_refill;
+    uint32_t    _last_sent;
+    int32_t     _last_value;
+    bool        _has_sent;
+    uint32_t    _sent;
+    uint32_t    _held;
+};
+
+#endif // __KNOCK_CORE_NOTIFY_POLICY_H__
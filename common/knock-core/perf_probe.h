@@ -0,0 +1,187 @@
+/*
+ * Copyright (c) 2016 ARM Limited. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __KNOCK_CORE_PERF_PROBE_H__
+#define __KNOCK_CORE_PERF_PROBE_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Cheap timestamps for the perf probes, in ticks of perf_clock_hz():
+ *
+ * - Cortex-M3/M4/M7: the DWT cycle counter, one tick per CPU cycle. It
+ *   wraps after 2^32 cycles, 35 s at 120 MHz, so keep measured spans short.
+ * - other ARM cores: us_ticker_read(), 1 MHz
+ * - host builds: std::chrono::steady_clock in ns, plus the time the CPU
+ *   would have waited on simulated hardware, see perf_host_stall_ns()
+ *
+ * Call perf_clock_init() once before the first probe.
+ */
+#if defined(__ARM_ARCH_7M__) || defined(__ARM_ARCH_7EM__)
+
+// CMSIS system clock, set by SystemCoreClockUpdate()
+extern "C" uint32_t SystemCoreClock;
+
+inline void perf_clock_init() {
+    volatile uint32_t *demcr = (volatile uint32_t *)0xE000EDFC;
+    volatile uint32_t *dwt_ctrl = (volatile uint32_t *)0xE0001000;
+    *demcr |= 1u << 24;         // TRCENA, turns on the DWT
+    *dwt_ctrl |= 1u;            // CYCCNTENA
+}
+
+inline uint32_t perf_ticks() {
+    return *(volatile uint32_t *)0xE0001004;   // DWT_CYCCNT
+}
+
+inline uint32_t perf_clock_hz() {
+    return SystemCoreClock;
+}
+
+#elif defined(__arm__)
+
+#include "mbed-hal/us_ticker_api.h"
+
+inline void perf_clock_init() {
+}
+
+inline uint32_t perf_ticks() {
+    return us_ticker_read();
+}
+
+inline uint32_t perf_clock_hz() {
+    return 1000000;
+}
+
+#else
+
+#include <chrono>
+
+inline void perf_clock_init() {
+}
+
+/*
+ * ns the host shim adds for hardware the CPU would wait on, such as the
+ * bytes of a blocking I2C call, which the host moves instantly
+ */
+inline uint64_t &perf_host_stall_ns() {
+    static uint64_t stall = 0;
+    return stall;
+}
+
+inline uint32_t perf_ticks() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count() + perf_host_stall_ns();
+}
+
+inline uint32_t perf_clock_hz() {
+    return 1000000000;
+}
+
+#endif
+
+/*
+ * Counters for one stage of the hot path. The histogram is log2: bucket 0
+ * counts spans below 2^(FIRST_BUCKET_SHIFT + 1) ticks, bucket i spans of
+ * [2^(i + FIRST_BUCKET_SHIFT), 2^(i + FIRST_BUCKET_SHIFT + 1)) ticks, and
+ * the last bucket everything longer.
+ */
+struct PerfStats {
+    enum {
+        BUCKETS             = 20,
+        FIRST_BUCKET_SHIFT  = 6     // 2^7 cycles is ~1 us at 120 MHz
+    };
+
+    uint32_t    count;
+    uint32_t    min;
+    uint32_t    max;
+    uint64_t    total;
+    uint32_t    histogram[BUCKETS];
+
+    uint32_t mean() const {
+        return count ? total / count : 0;
+    }
+};
+
+/*
+ * Per stage counters in a fixed arena, no allocation. A stage must only be
+ * recorded from one context, either one interrupt handler or the event
+ * loop, since updates are not atomic.
+ *
+ *     uint32_t start = perf_ticks();
+ *     ...
+ *     perf.record_since(STAGE, start);
+ */
+template <size_t Stages>
+class PerfCounters {
+public:
+    PerfCounters() {
+        reset();
+    }
+
+    void reset() {
+        for (size_t i = 0; i < Stages; i++) {
+            PerfStats &s = _stats[i];
+            s.count = 0;
+            s.min = UINT32_MAX;
+            s.max = 0;
+            s.total = 0;
+            for (size_t b = 0; b < PerfStats::BUCKETS; b++) {
+                s.histogram[b] = 0;
+            }
+        }
+    }
+
+    void record(size_t stage, uint32_t ticks) {
+        PerfStats &s = _stats[stage];
+        s.count++;
+        s.total += ticks;
+        if (ticks < s.min) {
+            s.min = ticks;
+        }
+        if (ticks > s.max) {
+            s.max = ticks;
+        }
+        s.histogram[bucket(ticks)]++;
+    }
+
+    // records the ticks from `start` until now, wrap safe
+    void record_since(size_t stage, uint32_t start) {
+        record(stage, perf_ticks() - start);
+    }
+
+    const PerfStats &stats(size_t stage) const {
+        return _stats[stage];
+    }
+
+    size_t stages() const {
+        return Stages;
+    }
+
+private:
+    static size_t bucket(uint32_t ticks) {
+        if (ticks >> (PerfStats::FIRST_BUCKET_SHIFT + 1) == 0) {
+            return 0;
+        }
+        // a single CLZ instruction on Cortex-M3 and up
+        size_t b = 31 - __builtin_clz(ticks) - PerfStats::FIRST_BUCKET_SHIFT;
+        return b < PerfStats::BUCKETS ? b : PerfStats::BUCKETS - 1;
+    }
+
+    PerfStats _stats[Stages];
+};
+
+#endif // __KNOCK_CORE_PERF_PROBE_H__
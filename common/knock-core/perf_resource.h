@@ -0,0 +1,96 @@
+/*
+ * Copyright (c) 2016 ARM Limited. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __KNOCK_CORE_PERF_RESOURCE_H__
+#define __KNOCK_CORE_PERF_RESOURCE_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include "minar/minar.h"
+#include "core-util/FunctionPointer.h"
+#include "mbed-client/m2minterfacefactory.h"
+#include "mbed-client/m2mobject.h"
+#include "mbed-client/m2mobjectinstance.h"
+#include "mbed-client/m2mresource.h"
+#include "knock-core/int_format.h"
+#include "knock-core/perf_probe.h"
+
+/*
+ * Publishes PerfCounters as the read-only LWM2M object /perf/0, so the
+ * hot path timing of every node can be read through the connector:
+ *
+ *     /perf/0/clock_hz    ticks per second of the probes
+ *     /perf/0/<stage>     "count,min,max,mean,h0,...,h19" in ticks
+ *
+ * h0..h19 is the log2 histogram of PerfStats. The resources are not
+ * observable; they are refreshed every `period_ms` and read with GET.
+ */
+template <size_t Stages>
+class PerfResource {
+public:
+    PerfResource(const PerfCounters<Stages> &counters, const char *const names[Stages],
+                 uint32_t period_ms = 10000)
+        : _counters(counters) {
+        _object = M2MInterfaceFactory::create_object("perf");
+        M2MObjectInstance* inst = _object->create_object_instance();
+
+        char buffer[INT_FORMAT_SIZE];
+        size_t length = format_uint(buffer, perf_clock_hz());
+        inst->create_static_resource("clock_hz", "PerfClock",
+            M2MResourceInstance::INTEGER, (uint8_t*)buffer, length);
+
+        for (size_t i = 0; i < Stages; i++) {
+            _stages[i] = inst->create_dynamic_resource(names[i], "PerfStage",
+                M2MResourceInstance::STRING, false /* observable */);
+            _stages[i]->set_operation(M2MBase::GET_ALLOWED);
+        }
+        refresh();
+
+        minar::Scheduler::postCallback(mbed::util::FunctionPointer0<void>(this, &PerfResource::refresh).bind())
+            .period(minar::milliseconds(period_ms));
+    }
+
+    M2MObject* get_object() {
+        return _object;
+    }
+
+private:
+    void refresh() {
+        for (size_t i = 0; i < Stages; i++) {
+            const PerfStats &s = _counters.stats(i);
+            char buffer[(4 + PerfStats::BUCKETS) * INT_FORMAT_SIZE];
+            size_t length = 0;
+            length += format_uint(buffer + length, s.count);
+            buffer[length++] = ',';
+            length += format_uint(buffer + length, s.count ? s.min : 0);
+            buffer[length++] = ',';
+            length += format_uint(buffer + length, s.max);
+            buffer[length++] = ',';
+            length += format_uint(buffer + length, s.mean());
+            for (size_t b = 0; b < PerfStats::BUCKETS; b++) {
+                buffer[length++] = ',';
+                length += format_uint(buffer + length, s.histogram[b]);
+            }
+            _stages[i]->set_value((uint8_t*)buffer, length);
+        }
+    }
+
+    const PerfCounters<Stages> &_counters;
+    M2MObject* _object;
+    M2MResource* _stages[Stages];
+};
+
+#endif // __KNOCK_CORE_PERF_RESOURCE_H__
@@ -0,0 +1,248 @@
+/*
+ * Copyright (c) 2016 ARM Limited. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __KNOCK_CORE_POWER_MANAGER_H__
+#define __KNOCK_CORE_POWER_MANAGER_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include "minar/minar.h"
+#include "core-util/FunctionPointer.h"
+#include "mbed-client/m2minterfacefactory.h"
+#include "mbed-client/m2mobject.h"
+#include "mbed-client/m2mobjectinstance.h"
+#include "mbed-client/m2mresource.h"
+#include "knock-core/int_format.h"
+
+enum PowerState {
+    POWER_ACTIVE,           // running, or waiting for the next event in the loop
+    POWER_SLEEP,            // dozing, but something needed the clocks up
+    POWER_DEEP_SLEEP,       // dozing with only the wake-up sources alive
+    POWER_STATES
+};
+
+/*
+ * Time spent in each power state and the number of wake-ups, on a
+ * microsecond clock that wraps at 2^32. update() needs to be called at least
+ * once per wrap (~71 minutes).
+ */
+class PowerAccounting {
+public:
+    PowerAccounting()
+        : _state(POWER_ACTIVE), _since(0), _wakeups(0) {
+        for (size_t i = 0; i < POWER_STATES; i++) {
+            _us[i] = 0;
+        }
+    }
+
+    void start(uint32_t now) {
+        _since = now;
+    }
+
+    void enter(PowerState state, uint32_t now) {
+        update(now);
+        if (state == POWER_ACTIVE && _state != POWER_ACTIVE) {
+            _wakeups++;
+        }
+        _state = state;
+    }
+
+    // adds the time since the last call to the current state
+    void update(uint32_t now) {
+        _us[_state] += now - _since;
+        _since = now;
+    }
+
+    PowerState state() const {
+        return _state;
+    }
+
+    uint64_t time_us(PowerState state) const {
+        return _us[state];
+    }
+
+    uint32_t wakeups() const {
+        return _wakeups;
+    }
+
+    // share of the time not in deep sleep, in 1/1000
+    uint32_t duty_permille() const {
+        uint64_t total = _us[POWER_ACTIVE] + _us[POWER_SLEEP] + _us[POWER_DEEP_SLEEP];
+        if (!total) {
+            return 1000;
+        }
+        return (uint32_t)((total - _us[POWER_DEEP_SLEEP]) * 1000 / total);
+    }
+
+private:
+    PowerState  _state;
+    uint32_t    _since;
+    uint64_t    _us[POWER_STATES];
+    uint32_t    _wakeups;
+};
+
+/*
+ * Sleeps between events while nothing is going on. The application calls
+ * activity() for every event that needs the sensor stream, and doze() once
+ * idle() says it has been quiet for long enough and its wake-up source is
+ * armed. From then on every round is a minar callback that sleeps until the
+ * next interrupt, and the callbacks that came due in the meantime run in
+ * between, so timers such as registration updates still fire. An interrupt
+ * handler calls wake() to stop after the current round.
+ *
+ * `Platform` provides:
+ *
+ *     static uint32_t clock_us();          // keeps running in deep sleep
+ *     static bool deep_sleep_allowed();    // false while e.g. a reply is due
+ *     static void sleep();
+ *     static void deep_sleep();
+ *
+ * On the K64F the clock is the low power ticker; the us_ticker stops in deep
+ * sleep.
+ */
+template <typename Platform>
+class PowerManager {
+public:
+    PowerManager(uint32_t idle_ms)
+        : _idle_us(idle_ms * 1000), _last_activity(Platform::clock_us()), _dozing(false) {
+        _accounting.start(_last_activity);
+    }
+
+    // restarts the idle timeout
+    void activity() {
+        _last_activity = Platform::clock_us();
+    }
+
+    bool idle() const {
+        return Platform::clock_us() - _last_activity >= _idle_us;
+    }
+
+    void doze() {
+        if (!_dozing) {
+            _dozing = true;
+            post_round();
+        }
+    }
+
+    // interrupt safe
+    void wake() {
+        _dozing = false;
+    }
+
+    bool dozing() const {
+        return _dozing;
+    }
+
+    const PowerAccounting &accounting() {
+        _accounting.update(Platform::clock_us());
+        return _accounting;
+    }
+
+private:
+    void post_round() {
+        minar::Scheduler::postCallback(mbed::util::FunctionPointer0<void>(this, &PowerManager::round).bind());
+    }
+
+    void round() {
+        if (!_dozing) {
+            return;
+        }
+        bool deep = Platform::deep_sleep_allowed();
+        _accounting.enter(deep ? POWER_DEEP_SLEEP : POWER_SLEEP, Platform::clock_us());
+        if (deep) {
+            Platform::deep_sleep();
+        } else {
+            Platform::sleep();
+        }
+        _accounting.enter(POWER_ACTIVE, Platform::clock_us());
+        if (_dozing) {
+            post_round();
+        }
+    }
+
+    uint32_t            _idle_us;
+    uint32_t            _last_activity;
+    volatile bool       _dozing;
+    PowerAccounting     _accounting;
+};
+
+/*
+ * Publishes the accounting of a PowerManager as the read-only LWM2M object
+ * /power/0:
+ *
+ *     /power/0/active_s        seconds awake
+ *     /power/0/sleep_s         seconds dozing with the clocks up
+ *     /power/0/deep_sleep_s    seconds in deep sleep
+ *     /power/0/wakeups
+ *     /power/0/duty            share of the time awake, in 1/1000
+ *
+ * Refreshed every `period_ms`, which also keeps the accounting clock from
+ * wrapping unnoticed. Read with GET; a server request to a sleeping node
+ * is answered once it is awake again.
+ */
+template <typename Platform>
+class PowerResource {
+public:
+    PowerResource(PowerManager<Platform> &power, uint32_t period_ms = 60000)
+        : _power(power) {
+        _object = M2MInterfaceFactory::create_object("power");
+        M2MObjectInstance* inst = _object->create_object_instance();
+
+        static const char *const NAMES[VALUES] = {
+            "active_s", "sleep_s", "deep_sleep_s", "wakeups", "duty"
+        };
+        for (size_t i = 0; i < VALUES; i++) {
+            _values[i] = inst->create_dynamic_resource(NAMES[i], "PowerStat",
+                M2MResourceInstance::INTEGER, false /* observable */);
+            _values[i]->set_operation(M2MBase::GET_ALLOWED);
+        }
+        refresh();
+
+        minar::Scheduler::postCallback(mbed::util::FunctionPointer0<void>(this, &PowerResource::refresh).bind())
+            .period(minar::milliseconds(period_ms));
+    }
+
+    M2MObject* get_object() {
+        return _object;
+    }
+
+private:
+    enum {
+        VALUES = 5
+    };
+
+    void refresh() {
+        const PowerAccounting &accounting = _power.accounting();
+        uint32_t values[VALUES] = {
+            (uint32_t)(accounting.time_us(POWER_ACTIVE) / 1000000),
+            (uint32_t)(accounting.time_us(POWER_SLEEP) / 1000000),
+            (uint32_t)(accounting.time_us(POWER_DEEP_SLEEP) / 1000000),
+            accounting.wakeups(),
+            accounting.duty_permille()
+        };
+        for (size_t i = 0; i < VALUES; i++) {
+            char buffer[INT_FORMAT_SIZE];
+            size_t length = format_uint(buffer, values[i]);
+            _values[i]->set_value((uint8_t*)buffer, length);
+        }
+    }
+
+    PowerManager<Platform> &_power;
+    M2MObject* _object;
+    M2MResource* _values[VALUES];
+};
+
+#endif // __KNOCK_CORE_POWER_MANAGER_H__
@@ -0,0 +1,91 @@
+/*
+ * Copyright (c) 2016 ARM Limited. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __KNOCK_CORE_RECONNECT_BACKOFF_H__
+#define __KNOCK_CORE_RECONNECT_BACKOFF_H__
+
+#include <stdint.h>
+#include "knock-core/xorshift.h"
+
+/*
+ * Backoff for one class of errors, in ms
+ */
+struct BackoffStrategy {
+    uint32_t base;      // upper bound of the first delay
+    uint32_t cap;       // the bound stops doubling here
+};
+
+/*
+ * Capped exponential backoff with full jitter for reconnecting to the server.
+ *
+ * Attempt n waits a random time between 0 and min(cap, base * 2^n), so after
+ * a border router reboot the nodes of a mesh spread their registrations out
+ * instead of all coming back in lockstep. Each class of error has its own
+ * strategy: a network error is usually over in seconds, while a server that
+ * refuses the client is not going to change its mind soon.
+ *
+ * Call reset() once the client is registered again.
+ */
+class ReconnectBackoff {
+public:
+    enum Reason {
+        NETWORK     = 0,    // lost connection, timeouts
+        REJECTED    = 1,    // the server refused the registration
+        REASONS
+    };
+
+    ReconnectBackoff(const BackoffStrategy &network, const BackoffStrategy &rejected, uint32_t seed = 1)
+        : _random(seed), _attempts(0) {
+        _strategy[NETWORK] = network;
+        _strategy[REJECTED] = rejected;
+    }
+
+    void seed(uint32_t seed) {
+        _random.seed(seed);
+    }
+
+    // ms to wait before the next attempt
+    uint32_t next_delay(Reason reason) {
+        const BackoffStrategy &strategy = _strategy[reason];
+        uint32_t bound = strategy.base;
+        for (uint8_t i = 0; i < _attempts && bound < strategy.cap; i++) {
+            bound = bound > strategy.cap / 2 ? strategy.cap : bound * 2;
+        }
+        if (bound > strategy.cap) {
+            bound = strategy.cap;
+        }
+        if (_attempts < 255) {
+            _attempts++;
+        }
+        return _random.below_or_equal(bound);
+    }
+
+    // attempts since the last reset()
+    uint8_t attempts() const {
+        return _attempts;
+    }
+
+    void reset() {
+        _attempts = 0;
+    }
+
+private:
+    BackoffStrategy _strategy[REASONS];
+    Xorshift32      _random;
+    uint8_t         _attempts;
+};
+
+#endif // __KNOCK_CORE_RECONNECT_BACKOFF_H__
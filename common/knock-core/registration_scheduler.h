@@ -0,0 +1,93 @@
+/*
+ * Copyright (c) 2016 ARM Limited. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __KNOCK_CORE_REGISTRATION_SCHEDULER_H__
+#define __KNOCK_CORE_REGISTRATION_SCHEDULER_H__
+
+#include <stdint.h>
+#include "knock-core/xorshift.h"
+
+/*
+ * Plans LWM2M registration updates from the registration lifetime instead of
+ * a fixed poll.
+ *
+ * The next update is due after `fraction` of the lifetime, give or take
+ * `jitter` of the lifetime drawn at random, so nodes that registered at the
+ * same time drift apart instead of updating in lockstep. Once `early` of the
+ * lifetime has passed, an update may also go out together with other traffic,
+ * while the radio is awake anyway. Fractions are Q15.
+ *
+ * The random sequence comes from `seed`, see Xorshift32.
+ */
+class RegistrationScheduler {
+public:
+    RegistrationScheduler(uint32_t lifetime,    // seconds
+                          uint16_t fraction = 24576,    // 0.75
+                          uint16_t jitter = 3277,       // 0.1
+                          uint16_t early = 16384,       // 0.5
+                          uint32_t seed = 1)
+        : _lifetime(lifetime), _fraction(fraction), _jitter(jitter), _early(early),
+          _random(seed) {
+        // never plan at or past the lifetime, nor before the registration
+        if (_fraction > MAX_FRACTION) {
+            _fraction = MAX_FRACTION;
+        }
+        if (_jitter > _fraction) {
+            _jitter = _fraction;
+        }
+        if (_fraction + _jitter > MAX_FRACTION) {
+            _jitter = MAX_FRACTION - _fraction;
+        }
+    }
+
+    uint32_t lifetime() const {
+        return _lifetime;
+    }
+
+    // restarts the random sequence, for when the node identity is known late
+    void seed(uint32_t seed) {
+        _random.seed(seed);
+    }
+
+    /*
+    * Milliseconds from a successful registration or update until the next
+    * update, a new random draw on every call
+    */
+    uint32_t next_delay() {
+        uint64_t period = (uint64_t)_lifetime * 1000;
+        int32_t offset = (int32_t)_random.below_or_equal(2 * (uint32_t)_jitter) - _jitter;
+        return (period * (uint32_t)((int32_t)_fraction + offset)) >> 15;
+    }
+
+    /*
+    * Whether an update may ride along with other traffic, `elapsed` ms after
+    * the last successful registration or update
+    */
+    bool piggyback(uint32_t elapsed) const {
+        return elapsed >= (((uint64_t)_lifetime * 1000 * _early) >> 15);
+    }
+
+private:
+    static const uint32_t MAX_FRACTION = 31130;    // 0.95
+
+    uint32_t    _lifetime;
+    uint16_t    _fraction;
+    uint16_t    _jitter;
+    uint16_t    _early;
+    Xorshift32  _random;
+};
+
+#endif // __KNOCK_CORE_REGISTRATION_SCHEDULER_H__
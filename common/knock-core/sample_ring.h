@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) 2016 ARM Limited. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __KNOCK_CORE_SAMPLE_RING_H__
+#define __KNOCK_CORE_SAMPLE_RING_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Fixed size ring buffer that keeps the newest N values.
+ *
+ * When the ring is full, a push overwrites the oldest value and bumps the
+ * overrun counter, so a slow consumer loses history instead of blocking the
+ * producer. Both sides must run in the same context (e.g. the minar event
+ * loop), there is no locking.
+ */
+template <typename T, size_t N>
+class SampleRing {
+    static_assert(N > 0 && (N & (N - 1)) == 0, "SampleRing size must be a power of two");
+
+public:
+    SampleRing() {
+        clear();
+    }
+
+    void push(const T &value) {
+        _buffer[_head] = value;
+        _head = (_head + 1) & (N - 1);
+        if (_count < N) {
+            _count++;
+        } else {
+            _overruns++;
+        }
+    }
+
+    /*
+    * Takes the oldest value out of the ring, returns false if it was empty
+    */
+    bool pop(T &value) {
+        if (_count == 0) {
+            return false;
+        }
+        value = _buffer[(_head - _count) & (N - 1)];
+        _count--;
+        return true;
+    }
+
+    /*
+    * Access without consuming, 0 is the oldest value in the ring
+    */
+    const T &at(size_t index) const {
+        return _buffer[(_head - _count + index) & (N - 1)];
+    }
+
+    void clear() {
+        _head = 0;
+        _count = 0;
+        _overruns = 0;
+    }
+
+    size_t size() const {
+        return _count;
+    }
+
+    bool empty() const {
+        return _count == 0;
+    }
+
+    static size_t capacity() {
+        return N;
+    }
+
+    // number of values that were overwritten before they were consumed
+    uint32_t overruns() const {
+        return _overruns;
+    }
+
+private:
+    T        _buffer[N];
+    size_t   _head;
+    size_t   _count;
+    uint32_t _overruns;
+};
+
+#endif // __KNOCK_CORE_SAMPLE_RING_H__
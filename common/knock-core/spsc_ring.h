@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) 2016 ARM Limited. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __KNOCK_CORE_SPSC_RING_H__
+#define __KNOCK_CORE_SPSC_RING_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+/*
+ * Lock-free single producer / single consumer queue with a fixed capacity.
+ *
+ * Meant to hand events from an interrupt handler (producer) to the minar
+ * event loop (consumer) without allocating or masking interrupts. Exactly
+ * one context may call push() and exactly one other context may call pop().
+ *
+ * Unlike SampleRing, a full queue rejects new values: the producer can not
+ * safely move the consumer's index. Rejected pushes are counted in dropped().
+ */
+template <typename T, size_t N>
+class SpscRing {
+    static_assert(N > 0 && (N & (N - 1)) == 0, "SpscRing size must be a power of two");
+
+public:
+    SpscRing() : _head(0), _tail(0), _pushed(0), _dropped(0) {
+    }
+
+    /*
+    * Producer side, returns false (and counts a drop) when full
+    */
+    bool push(const T &value) {
+        uint32_t head = _head.load(std::memory_order_relaxed);
+        if (head - _tail.load(std::memory_order_acquire) == N) {
+            _dropped.store(_dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            return false;
+        }
+        _buffer[head & (N - 1)] = value;
+        _head.store(head + 1, std::memory_order_release);
+        _pushed.store(_pushed.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    /*
+    * Consumer side, returns false when empty
+    */
+    bool pop(T &value) {
+        uint32_t tail = _tail.load(std::memory_order_relaxed);
+        if (tail == _head.load(std::memory_order_acquire)) {
+            return false;
+        }
+        value = _buffer[tail & (N - 1)];
+        _tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // approximate when called from the producer side
+    size_t size() const {
+        return _head.load(std::memory_order_acquire) - _tail.load(std::memory_order_acquire);
+    }
+
+    static size_t capacity() {
+        return N;
+    }
+
+    // values accepted by push()
+    uint32_t pushed() const {
+        return _pushed.load(std::memory_order_relaxed);
+    }
+
+    // values rejected by push() because the queue was full
+    uint32_t dropped() const {
+        return _dropped.load(std::memory_order_relaxed);
+    }
+
+private:
+    T                       _buffer[N];
+    std::atomic<uint32_t>   _head;      // written by the producer only
+    std::atomic<uint32_t>   _tail;      // written by the consumer only
+    std::atomic<uint32_t>   _pushed;
+    std::atomic<uint32_t>   _dropped;
+};
+
+#endif // __KNOCK_CORE_SPSC_RING_H__
@@ -0,0 +1,119 @@
+/*
+ * Copyright (c) 2016 ARM Limited. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __KNOCK_CORE_STATIC_ARENA_H__
+#define __KNOCK_CORE_STATIC_ARENA_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <new>
+#include <utility>
+
+/*
+ * Bump allocator over a fixed buffer, for the objects the application
+ * creates once in app_start() and keeps until reset. Nothing is ever freed,
+ * so the arena can not fragment and the heap never sees these objects.
+ *
+ * The objects are constructed on demand rather than being globals, because
+ * their constructors talk to the sensor and post minar callbacks, which is
+ * not possible before app_start().
+ */
+class Arena {
+public:
+    // every object starts at a multiple of this
+    static const size_t ALIGN = 8;
+
+    /*
+    * Constructs a T in the arena, NULL when it does not fit. The object is
+    * never destroyed.
+    */
+    template <typename T, typename... Args>
+    T *create(Args&&... args) {
+        static_assert(alignof(T) <= ALIGN, "Arena::ALIGN is too small for this type");
+        void *memory = allocate(sizeof(T));
+        if (!memory) {
+            return NULL;
+        }
+        return new (memory) T(std::forward<Args>(args)...);
+    }
+
+    size_t used() const {
+        return _used;
+    }
+
+    size_t capacity() const {
+        return _capacity;
+    }
+
+    // create() calls that did not fit
+    uint32_t failures() const {
+        return _failures;
+    }
+
+protected:
+    Arena(uint8_t *buffer, size_t capacity)
+        : _buffer(buffer), _capacity(capacity), _used(0), _failures(0) {
+    }
+
+private:
+    void *allocate(size_t size) {
+        size = (size + ALIGN - 1) & ~(ALIGN - 1);
+        if (size > _capacity - _used) {
+            _failures++;
+            return NULL;
+        }
+        void *memory = _buffer + _used;
+        _used += size;
+        return memory;
+    }
+
+    uint8_t *_buffer;
+    size_t   _capacity;
+    size_t   _used;
+    uint32_t _failures;
+};
+
+/*
+ * Space for exactly one of each of Types, so the arena is sized by the
+ * compiler:
+ *
+ *     StaticArena<ArenaSize<ButtonResource, AccelerometerResource>::value> arena;
+ */
+template <typename... Types>
+struct ArenaSize;
+
+template <>
+struct ArenaSize<> {
+    static const size_t value = 0;
+};
+
+template <typename T, typename... Rest>
+struct ArenaSize<T, Rest...> {
+    static const size_t value = ((sizeof(T) + Arena::ALIGN - 1) & ~(Arena::ALIGN - 1)) + ArenaSize<Rest...>::value;
+};
+
+template <size_t Size>
+class StaticArena : public Arena {
+public:
+    StaticArena()
+        : Arena(_storage, Size) {
+    }
+
+private:
+    alignas(Arena::ALIGN) uint8_t _storage[Size];
+};
+
+#endif // __KNOCK_CORE_STATIC_ARENA_H__
@@ -0,0 +1,88 @@
+/*
+ * Copyright (c) 2016 ARM Limited. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __KNOCK_CORE_STORAGE_FLASH_H__
+#define __KNOCK_CORE_STORAGE_FLASH_H__
+
+#include <stdint.h>
+#include "storage-abstraction/Driver_Storage.h"
+
+/*
+ * A region of the flash behind a CMSIS storage driver, e.g.
+ * ARM_Driver_Storage_MTD_K64F for the internal flash of the K64F, as the
+ * Flash of KnockJournal.
+ *
+ * Only synchronous operation is supported: init() fails on a driver that
+ * completes its operations through the callback. On the K64F the region
+ * should sit in the upper program flash block, so the code keeps running
+ * from the lower one while a sector is erased.
+ */
+class StorageFlash {
+public:
+    StorageFlash(ARM_DRIVER_STORAGE &driver, uint64_t base, uint32_t size)
+        : _driver(driver), _base(base), _size(size), _sector_size(0), _program_size(0) {
+    }
+
+    // Initializes the driver and reads the geometry of the region
+    bool init() {
+        ARM_STORAGE_CAPABILITIES capabilities = _driver.GetCapabilities();
+        if (capabilities.asynchronous_ops || _driver.Initialize(NULL) < ARM_DRIVER_OK) {
+            return false;
+        }
+        ARM_STORAGE_INFO info;
+        ARM_STORAGE_BLOCK block;
+        if (_driver.GetInfo(&info) < ARM_DRIVER_OK || _driver.GetBlock(_base, &block) < ARM_DRIVER_OK ||
+            !block.attributes.erasable || _base + _size > block.addr + block.size) {
+            return false;
+        }
+        _sector_size = block.attributes.erase_unit;
+        _program_size = info.program_unit;
+        return _sector_size && _base % _sector_size == 0 && _size % _sector_size == 0;
+    }
+
+    uint32_t size() const {
+        return _size;
+    }
+
+    uint32_t sector_size() const {
+        return _sector_size;
+    }
+
+    uint32_t program_size() const {
+        return _program_size;
+    }
+
+    bool read(uint32_t address, void *data, uint32_t length) {
+        return address + length <= _size && _driver.ReadData(_base + address, data, length) == (int32_t)length;
+    }
+
+    bool program(uint32_t address, const void *data, uint32_t length) {
+        return address + length <= _size && _driver.ProgramData(_base + address, data, length) == (int32_t)length;
+    }
+
+    bool erase(uint32_t address) {
+        return address < _size && _driver.Erase(_base + address, _sector_size) == (int32_t)_sector_size;
+    }
+
+private:
+    ARM_DRIVER_STORAGE  &_driver;
+    uint64_t            _base;
+    uint32_t            _size;
+    uint32_t            _sector_size;
+    uint32_t            _program_size;
+};
+
+#endif // __KNOCK_CORE_STORAGE_FLASH_H__
@@ -0,0 +1,378 @@
+/*
+ * Copyright (c) 2016 ARM Limited. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __KNOCK_CORE_TRACE_FORMAT_H__
+#define __KNOCK_CORE_TRACE_FORMAT_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include "knock-core/accel_sample.h"
+#include "knock-core/crc16.h"
+
+/*
+ * Binary accelerometer trace, version 1. The firmware writes it to the
+ * serial port and a recording is just the captured bytes, so the stream
+ * survives printf output in between: a reader looks for the sync bytes and
+ * drops frames whose CRC does not match.
+ *
+ *     u8      sync            0xA5
+ *     u8      sync            0x5A
+ *     u8      type
+ *     u8      length          of the payload, at most MAX_PAYLOAD
+ *     length  payload
+ *     u16     crc             CRC-16/CCITT-FALSE of type, length and payload
+ *
+ * Payloads:
+ *
+ *     START       u8 version, u16 counts per g
+ *     SAMPLES     u32 timestamp of the first sample, u16 sample period in us,
+ *                 first sample as 3 s16, then per sample 3 varint deltas
+ *                 to the previous one, zigzag encoded (0, -1, 1, -2, ...)
+ *     INTERRUPT   u32 timestamp, u8 INT_SOURCE
+ *
+ * Timestamps are us_ticker_read() and wrap at 2^32. Multi-byte fields are
+ * big endian, varints are LEB128 like in knock_batch.h. A sample at rest
+ * takes 3 bytes instead of 6.
+ */
+enum TraceFrameType {
+    TRACE_START         = 1,
+    TRACE_SAMPLES       = 2,
+    TRACE_INTERRUPT     = 3
+};
+
+const uint8_t TRACE_VERSION = 1;
+const uint8_t TRACE_SYNC[2] = { 0xA5, 0x5A };
+
+/*
+ * Builds one frame at a time.
+ *
+ *     frame.begin_samples(timestamp, period);
+ *     for each sample:
+ *         if (!frame.add_sample(sample)) {
+ *             send(frame.finish(), frame.length());
+ *             frame.begin_samples(timestamp of this sample, period);
+ *             frame.add_sample(sample);
+ *         }
+ *     send(frame.finish(), frame.length());
+ */
+class TraceFrame {
+public:
+    enum {
+        HEADER_SIZE     = 4,
+        CRC_SIZE        = 2,
+        MAX_PAYLOAD     = 250,
+        MAX_SIZE        = HEADER_SIZE + MAX_PAYLOAD + CRC_SIZE
+    };
+
+    TraceFrame() : _length(0), _samples(0) {
+    }
+
+    const uint8_t *start(uint16_t counts_per_g) {
+        begin(TRACE_START);
+        put8(TRACE_VERSION);
+        put16(counts_per_g);
+        return finish();
+    }
+
+    const uint8_t *interrupt(uint32_t timestamp, uint8_t sources) {
+        begin(TRACE_INTERRUPT);
+        put32(timestamp);
+        put8(sources);
+        return finish();
+    }
+
+    void begin_samples(uint32_t timestamp, uint16_t period) {
+        begin(TRACE_SAMPLES);
+        put32(timestamp);
+        put16(period);
+    }
+
+    /*
+    * Returns false when the sample does not fit anymore, the frame is left
+    * as it was
+    */
+    bool add_sample(const AccelSample &sample) {
+        if (_samples == 0) {
+            if (_length + 6 > HEADER_SIZE + MAX_PAYLOAD) {
+                return false;
+            }
+            put16(sample.x);
+            put16(sample.y);
+            put16(sample.z);
+        } else {
+            uint32_t dx = zigzag(sample.x - _previous.x);
+            uint32_t dy = zigzag(sample.y - _previous.y);
+            uint32_t dz = zigzag(sample.z - _previous.z);
+            if (_length + varint_size(dx) + varint_size(dy) + varint_size(dz) > HEADER_SIZE + MAX_PAYLOAD) {
+                return false;
+            }
+            put_varint(dx);
+            put_varint(dy);
+            put_varint(dz);
+        }
+        _previous = sample;
+        _samples++;
+        return true;
+    }
+
+    // samples in the current SAMPLES frame
+    size_t samples() const {
+        return _samples;
+    }
+
+    // fills in the length and CRC, returns the frame
+    const uint8_t *finish() {
+        _buffer[3] = _length - HEADER_SIZE;
+        uint16_t crc = crc16_ccitt(_buffer + 2, _length - 2);
+        _buffer[_length] = crc >> 8;
+        _buffer[_length + 1] = crc;
+        return _buffer;
+    }
+
+    // size of the finished frame in bytes
+    size_t length() const {
+        return _length + CRC_SIZE;
+    }
+
+private:
+    static uint32_t zigzag(int32_t value) {
+        return value < 0 ? ~((uint32_t)value << 1) : (uint32_t)value << 1;
+    }
+
+    static size_t varint_size(uint32_t value) {
+        size_t size = 1;
+        while (value >>= 7) {
+            size++;
+        }
+        return size;
+    }
+
+    void begin(uint8_t type) {
+        _buffer[0] = TRACE_SYNC[0];
+        _buffer[1] = TRACE_SYNC[1];
+        _buffer[2] = type;
+        _length = HEADER_SIZE;
+        _samples = 0;
+    }
+
+    void put8(uint8_t value) {
+        _buffer[_length++] = value;
+    }
+
+    void put16(uint16_t value) {
+        put8(value >> 8);
+        put8(value);
+    }
+
+    void put32(uint32_t value) {
+        put16(value >> 16);
+        put16(value);
+    }
+
+    void put_varint(uint32_t value) {
+        do {
+            uint8_t byte = value & 0x7F;
+            value >>= 7;
+            put8(value ? byte | 0x80 : byte);
+        } while (value);
+    }
+
+    uint8_t     _buffer[MAX_SIZE];
+    size_t      _length;
+    size_t      _samples;
+    AccelSample _previous;
+};
+
+/*
+ * One sample or interrupt marker out of a trace
+ */
+struct TraceRecord {
+    uint8_t     type;           // TRACE_SAMPLES or TRACE_INTERRUPT
+    uint32_t    timestamp;
+    AccelSample sample;         // TRACE_SAMPLES only
+    uint8_t     sources;        // TRACE_INTERRUPT only
+};
+
+/*
+ * Walks a trace in memory, e.g. a memory mapped recording, without copying
+ * it. Frames before the first START are read as the current version;
+ * after a START with another version everything is skipped until the next
+ * START this reader understands.
+ */
+class TraceReader {
+public:
+    TraceReader(const uint8_t *data, size_t length)
+        : _data(data), _length(length), _next(0), _position(0), _payload_end(0), _in_samples(false),
+          _supported(true), _counts_per_g(0), _period(0), _frames(0), _bad_frames(0), _skipped(0) {
+    }
+
+    bool next(TraceRecord &record) {
+        for (;;) {
+            if (_in_samples && next_sample(record)) {
+                return true;
+            }
+            _in_samples = false;
+            if (!next_frame()) {
+                return false;
+            }
+
+            uint8_t type = _data[_frame + 2];
+            _position = _frame + TraceFrame::HEADER_SIZE;
+            if (type == TRACE_START && _payload_end - _position >= 3) {
+                _supported = _data[_position] == TRACE_VERSION;
+                _counts_per_g = get16(_position + 1);
+            } else if (!_supported) {
+                // not ours to decode
+            } else if (type == TRACE_SAMPLES && _payload_end - _position >= 6 + 6) {
+                _timestamp = get32(_position);
+                _period = get16(_position + 4);
+                _position += 6;
+                _index = 0;
+                _in_samples = true;
+            } else if (type == TRACE_INTERRUPT && _payload_end - _position >= 5) {
+                record.type = TRACE_INTERRUPT;
+                record.timestamp = get32(_position);
+                record.sources = _data[_position + 4];
+                return true;
+            }
+        }
+    }
+
+    // counts per g from the last START, 0 if there was none
+    uint16_t counts_per_g() const {
+        return _counts_per_g;
+    }
+
+    // sample period of the last SAMPLES frame, in us
+    uint16_t period() const {
+        return _period;
+    }
+
+    // frames with a valid CRC
+    uint32_t frames() const {
+        return _frames;
+    }
+
+    // frames that had the sync bytes but a bad CRC
+    uint32_t bad_frames() const {
+        return _bad_frames;
+    }
+
+    // bytes outside of valid frames
+    size_t skipped() const {
+        return _skipped;
+    }
+
+private:
+    bool next_sample(TraceRecord &record) {
+        if (_position >= _payload_end) {
+            return false;
+        }
+        if (_index == 0) {
+            _previous.x = get16(_position);
+            _previous.y = get16(_position + 2);
+            _previous.z = get16(_position + 4);
+            _position += 6;
+        } else {
+            uint32_t dx, dy, dz;
+            if (!get_varint(dx) || !get_varint(dy) || !get_varint(dz)) {
+                _position = _payload_end;
+                return false;
+            }
+            _previous.x += unzigzag(dx);
+            _previous.y += unzigzag(dy);
+            _previous.z += unzigzag(dz);
+        }
+        record.type = TRACE_SAMPLES;
+        record.timestamp = _timestamp + _index * _period;
+        record.sample = _previous;
+        _index++;
+        return true;
+    }
+
+    /*
+    * Moves to the next frame with a valid CRC and sets _frame and
+    * _payload_end, returns false at the end of the data
+    */
+    bool next_frame() {
+        size_t position = _next;
+        while (position + TraceFrame::HEADER_SIZE + TraceFrame::CRC_SIZE <= _length) {
+            if (_data[position] != TRACE_SYNC[0] || _data[position + 1] != TRACE_SYNC[1]) {
+                position++;
+                _skipped++;
+                continue;
+            }
+            size_t end = position + TraceFrame::HEADER_SIZE + _data[position + 3];
+            if (_data[position + 3] <= TraceFrame::MAX_PAYLOAD && end + TraceFrame::CRC_SIZE <= _length &&
+                crc16_ccitt(_data + position + 2, end - position - 2) == get16(end)) {
+                _frame = position;
+                _payload_end = end;
+                _next = end + TraceFrame::CRC_SIZE;
+                _frames++;
+                return true;
+            }
+            _bad_frames++;
+            position++;
+            _skipped++;
+        }
+        _skipped += _length - position;
+        _next = _length;
+        return false;
+    }
+
+    static int16_t unzigzag(uint32_t value) {
+        return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+    }
+
+    bool get_varint(uint32_t &value) {
+        value = 0;
+        for (int shift = 0; shift < 32 && _position < _payload_end; shift += 7) {
+            uint8_t byte = _data[_position++];
+            value |= (uint32_t)(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    uint16_t get16(size_t position) const {
+        return (uint16_t)_data[position] << 8 | _data[position + 1];
+    }
+
+    uint32_t get32(size_t position) const {
+        return (uint32_t)get16(position) << 16 | get16(position + 2);
+    }
+
+    const uint8_t   *_data;
+    size_t          _length;
+    size_t          _next;          // where to look for the next frame
+    size_t          _position;
+    size_t          _frame;
+    size_t          _payload_end;
+    bool            _in_samples;
+    bool            _supported;
+    uint16_t        _counts_per_g;
+    uint16_t        _period;
+    uint32_t        _timestamp;
+    uint32_t        _index;
+    AccelSample     _previous;
+    uint32_t        _frames;
+    uint32_t        _bad_frames;
+    size_t          _skipped;
+};
+
+#endif // __KNOCK_CORE_TRACE_FORMAT_H__
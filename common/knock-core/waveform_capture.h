@@ -0,0 +1,328 @@
+/*
+ * Copyright (c) 2016 ARM Limited. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __KNOCK_CORE_WAVEFORM_CAPTURE_H__
+#define __KNOCK_CORE_WAVEFORM_CAPTURE_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include "knock-core/accel_sample.h"
+#include "knock-core/sample_ring.h"
+
+/*
+ * Raw samples around a knock, delta compressed. Layout, version 1:
+ *
+ *     u8      version         1
+ *     u8      pre             samples before the onset
+ *     u16     count           samples in the snapshot
+ *     u16     period          sample period in us
+ *     u16     counts per g
+ *     u32     timestamp       of the onset in us, wrapping at 2^32
+ *     u32     rtc             RTC seconds at the trigger
+ *     u32     sequence        1 for the first snapshot since boot
+ *     3 s16   first sample
+ *     count - 1 times:
+ *       3 varint              deltas to the previous sample, zigzag encoded
+ *
+ * Multi-byte fields are big endian, deltas are encoded like the SAMPLES
+ * frames of trace_format.h. A sample at rest takes 3 bytes instead of 6.
+ */
+enum {
+    WAVEFORM_VERSION        = 1,
+    WAVEFORM_HEADER_SIZE    = 20
+};
+
+/*
+ * Keeps the last complete snapshot of `Pre` samples before a knock and
+ * `Post` from its onset on. The samples before the trigger come out of the
+ * SampleRing the application already keeps, the rest are fed in with add()
+ * as they arrive, so there is no separate pre-trigger buffer.
+ *
+ * Each of the `Slots` slots is sized for the raw samples, so RAM does not
+ * depend on the signal; a window that compresses worse than raw, which
+ * takes a sustained full scale swing, is cut short. A knock while a
+ * capture is running is in that capture already and starts none. The
+ * published snapshot stays untouched until Slots - 1 newer ones are
+ * complete, so a block-wise read of it survives at least one more knock.
+ */
+template <size_t Pre, size_t Post, size_t Slots = 2>
+class WaveformCapture {
+    static_assert(Post > 0 && Pre + Post <= 0xFFFF, "the sample count is 16 bits");
+    static_assert(Pre <= 255, "the pre-trigger count is a single byte");
+    static_assert(Slots >= 2, "one slot to fill and one to read");
+
+public:
+    enum {
+        SLOT_SIZE   = WAVEFORM_HEADER_SIZE + (Pre + Post) * 6
+    };
+
+    WaveformCapture(uint16_t period_us, uint16_t counts_per_g)
+        : _period(period_us), _counts_per_g(counts_per_g), _filling(-1), _published(-1),
+          _sequence(0), _truncated(0) {
+    }
+
+    /*
+    * Starts a snapshot for a knock whose onset is at `onset` in `ring`,
+    * `current` being the newest sample already there. Returns false when a
+    * capture is running or the onset is not in the ring. When the ring
+    * already holds the whole window the snapshot is complete on return.
+    */
+    template <size_t N>
+    bool trigger(const SampleRing<AccelSample, N> &ring, size_t onset, size_t current,
+                 uint32_t timestamp, uint32_t rtc) {
+        if (_filling >= 0 || onset > current || current >= ring.size()) {
+            return false;
+        }
+        size_t pre = onset < Pre ? onset : Pre;
+
+        _filling = _published < 0 ? 0 : (_published + 1) % Slots;
+        Slot &slot = _slots[_filling];
+        slot.length = WAVEFORM_HEADER_SIZE;
+        slot.count = 0;
+        slot.remaining = pre + Post;
+        put8(slot, 0, WAVEFORM_VERSION);
+        put8(slot, 1, pre);
+        put16(slot, 4, _period);
+        put16(slot, 6, _counts_per_g);
+        put32(slot, 8, timestamp);
+        put32(slot, 12, rtc);
+
+        for (size_t i = onset - pre; i <= current && _filling >= 0; i++) {
+            add(ring.at(i));
+        }
+        return true;
+    }
+
+    /*
+    * Appends the next sample to a running capture. Returns true when that
+    * completed the snapshot.
+    */
+    bool add(const AccelSample &sample) {
+        if (_filling < 0) {
+            return false;
+        }
+        Slot &slot = _slots[_filling];
+        if (slot.count == 0) {
+            put16(slot, slot.length, sample.x);
+            put16(slot, slot.length + 2, sample.y);
+            put16(slot, slot.length + 4, sample.z);
+            slot.length += 6;
+        } else {
+            uint32_t dx = zigzag(sample.x - _previous.x);
+            uint32_t dy = zigzag(sample.y - _previous.y);
+            uint32_t dz = zigzag(sample.z - _previous.z);
+            if (slot.length + varint_size(dx) + varint_size(dy) + varint_size(dz) > SLOT_SIZE) {
+                _truncated++;
+                return finish();
+            }
+            put_varint(slot, dx);
+            put_varint(slot, dy);
+            put_varint(slot, dz);
+        }
+        _previous = sample;
+        slot.count++;
+        if (--slot.remaining == 0) {
+            return finish();
+        }
+        return false;
+    }
+
+    bool capturing() const {
+        return _filling >= 0;
+    }
+
+    // the last complete snapshot, NULL before the first
+    const uint8_t *snapshot() const {
+        return _published < 0 ? NULL : _slots[_published].buffer;
+    }
+
+    size_t snapshot_length() const {
+        return _published < 0 ? 0 : _slots[_published].length;
+    }
+
+    // snapshots completed so far, also the sequence of the last one
+    uint32_t sequence() const {
+        return _sequence;
+    }
+
+    // snapshots cut short because they did not fit their slot
+    uint32_t truncated() const {
+        return _truncated;
+    }
+
+private:
+    struct Slot {
+        uint8_t     buffer[SLOT_SIZE];
+        size_t      length;
+        size_t      count;
+        size_t      remaining;
+    };
+
+    bool finish() {
+        Slot &slot = _slots[_filling];
+        put16(slot, 2, slot.count);
+        put32(slot, 16, ++_sequence);
+        _published = _filling;
+        _filling = -1;
+        return true;
+    }
+
+    static uint32_t zigzag(int32_t value) {
+        return value < 0 ? ~((uint32_t)value << 1) : (uint32_t)value << 1;
+    }
+
+    static size_t varint_size(uint32_t value) {
+        size_t size = 1;
+        while (value >>= 7) {
+            size++;
+        }
+        return size;
+    }
+
+    static void put8(Slot &slot, size_t position, uint8_t value) {
+        slot.buffer[position] = value;
+    }
+
+    static void put16(Slot &slot, size_t position, uint16_t value) {
+        slot.buffer[position] = value >> 8;
+        slot.buffer[position + 1] = value;
+    }
+
+    static void put32(Slot &slot, size_t position, uint32_t value) {
+        put16(slot, position, value >> 16);
+        put16(slot, position + 2, value);
+    }
+
+    static void put_varint(Slot &slot, uint32_t value) {
+        do {
+            uint8_t byte = value & 0x7F;
+            value >>= 7;
+            slot.buffer[slot.length++] = value ? byte | 0x80 : byte;
+        } while (value);
+    }
+
+    uint16_t    _period;
+    uint16_t    _counts_per_g;
+    Slot        _slots[Slots];
+    int         _filling;       // slot being captured, -1 when idle
+    int         _published;     // slot of snapshot(), -1 before the first
+    AccelSample _previous;
+    uint32_t    _sequence;
+    uint32_t    _truncated;
+};
+
+/*
+ * Decodes a snapshot, e.g. one reassembled from a block-wise GET
+ */
+class WaveformReader {
+public:
+    WaveformReader(const uint8_t *data, size_t length)
+        : _data(data), _length(length), _position(WAVEFORM_HEADER_SIZE), _index(0) {
+    }
+
+    // false when the header is missing or of another version
+    bool valid() const {
+        return _length >= WAVEFORM_HEADER_SIZE + 6 && _data[0] == WAVEFORM_VERSION;
+    }
+
+    uint8_t pre() const {
+        return _data[1];
+    }
+
+    uint16_t count() const {
+        return get16(2);
+    }
+
+    uint16_t period() const {
+        return get16(4);
+    }
+
+    uint16_t counts_per_g() const {
+        return get16(6);
+    }
+
+    uint32_t timestamp() const {
+        return get32(8);
+    }
+
+    uint32_t rtc() const {
+        return get32(12);
+    }
+
+    uint32_t sequence() const {
+        return get32(16);
+    }
+
+    /*
+    * The next sample, false after the last one or when the data ends early
+    */
+    bool next(AccelSample &sample) {
+        if (!valid() || _index >= count()) {
+            return false;
+        }
+        if (_index == 0) {
+            _previous.x = get16(_position);
+            _previous.y = get16(_position + 2);
+            _previous.z = get16(_position + 4);
+            _position += 6;
+        } else {
+            uint32_t dx, dy, dz;
+            if (!get_varint(dx) || !get_varint(dy) || !get_varint(dz)) {
+                _index = count();
+                return false;
+            }
+            _previous.x += unzigzag(dx);
+            _previous.y += unzigzag(dy);
+            _previous.z += unzigzag(dz);
+        }
+        _index++;
+        sample = _previous;
+        return true;
+    }
+
+private:
+    static int16_t unzigzag(uint32_t value) {
+        return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+    }
+
+    bool get_varint(uint32_t &value) {
+        value = 0;
+        for (int shift = 0; shift < 32 && _position < _length; shift += 7) {
+            uint8_t byte = _data[_position++];
+            value |= (uint32_t)(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    uint16_t get16(size_t position) const {
+        return (uint16_t)_data[position] << 8 | _data[position + 1];
+    }
+
+    uint32_t get32(size_t position) const {
+        return (uint32_t)get16(position) << 16 | get16(position + 2);
+    }
+
+    const uint8_t   *_data;
+    size_t          _length;
+    size_t          _position;
+    size_t          _index;
+    AccelSample     _previous;
+};
+
+#endif // __KNOCK_CORE_WAVEFORM_CAPTURE_H__
@@ -0,0 +1,57 @@
+/*
+ * Copyright (c) 2016 ARM Limited. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __KNOCK_CORE_XORSHIFT_H__
+#define __KNOCK_CORE_XORSHIFT_H__
+
+#include <stdint.h>
+
+/*
+ * xorshift32 pseudo random numbers, plenty for spreading timers across
+ * nodes. Seed it with something that differs per node, e.g. its MAC
+ * address; rand() seeded from the RTC is the same on every node at boot.
+ */
+class Xorshift32 {
+public:
+    Xorshift32(uint32_t seed = 1) {
+        this->seed(seed);
+    }
+
+    void seed(uint32_t seed) {
+        // 0 is the one state xorshift never leaves
+        _state = seed ? seed : 1;
+    }
+
+    uint32_t next() {
+        _state ^= _state << 13;
+        _state ^= _state >> 17;
+        _state ^= _state << 5;
+        return _state;
+    }
+
+    // uniform in [0, limit]
+    uint32_t below_or_equal(uint32_t limit) {
+        if (limit == UINT32_MAX) {
+            return next();
+        }
+        return next() % (limit + 1);
+    }
+
+private:
+    uint32_t _state;
+};
+
+#endif // __KNOCK_CORE_XORSHIFT_H__
@@ -14,8 +14,7 @@
  * limitations under the License.
  */
 
-#include <string>
-#include <sstream>
+#include <atomic>
 #include <vector>
 #include "mbed-drivers/mbed.h"
 #include "atmel-rf-driver/driverRFPhy.h"    // rf_device_register
@@ -23,7 +22,11 @@
 #include "mbed-mesh-api/MeshThread.h"
 #include "mbed-mesh-api/MeshInterfaceFactory.h"
 #include "mbed-drivers/test_env.h"
+#include "mbed-hal/lp_ticker_api.h"
 #include "mbed-hal/rtc_api.h"
+#include "mbed-hal/sleep_api.h"
+#include "mbed-hal/us_ticker_api.h"
+#include "storage-abstraction/Driver_Storage.h"
 #include "mbed-client/m2minterfacefactory.h"
 #include "mbed-client/m2mdevice.h"
 #include "mbed-client/m2minterfaceobserver.h"
@@ -33,6 +36,29 @@
 #include "mbed-mesh-api/AbstractMesh.h"
 #include "mbedclient.h"
 #include "fxos8700cq/fxos8700cq.h"
+#include "knock-core/accel_event.h"
+#include "knock-core/adaptive_rate.h"
+#include "knock-core/clock_sync.h"
+#include "knock-core/event_clock.h"
+#include "knock-core/fxos8700cq_acquisition.h"
+#include "knock-core/fxos8700cq_fifo.h"
+#include "knock-core/i2c_register_bus.h"
+#include "knock-core/heap_resource.h"
+#include "knock-core/int_format.h"
+#include "knock-core/knock_batch.h"
+#include "knock-core/knock_detector.h"
+#include "knock-core/knock_features.h"
+#include "knock-core/knock_journal.h"
+#include "knock-core/knock_pattern.h"
+#include "knock-core/perf_probe.h"
+#include "knock-core/perf_resource.h"
+#include "knock-core/power_manager.h"
+#include "knock-core/sample_ring.h"
+#include "knock-core/spsc_ring.h"
+#include "knock-core/static_arena.h"
+#include "knock-core/storage_flash.h"
+#include "knock-core/trace_format.h"
+#include "knock-core/waveform_capture.h"
 
 struct MbedClientDevice device = {
     "Manufacturer_String",      // Manufacturer
@@ -45,10 +71,209 @@ struct MbedClientDevice device = {
 // LED Output
 DigitalOut led1(LED1);
 
+// Console, also carries the sensor trace in APPL_ACCEL_TRACE_MODE
+static Serial &pc = get_stdio_serial();
+
+// Resource updates go through here, so they follow the notify policy
+static MbedClient *mbedclient;
+
 // Accelerometer config
 InterruptIn accel_interrupt_pin(PTC13);  // FRDM-K64F
 FXOS8700CQ accel(PTE25, PTE24, FXOS8700CQ_SLAVE_ADDR1); // FRDM-K64F
 
+// Interrupt edges are queued and picked up by the event loop at this rate
+const uint32_t ACCEL_EVENT_POLL_MS = 10;
+
+// Stream raw samples through the sensor FIFO and detect knocks in those,
+// comment out to count every motion interrupt as a knock
+#define APPL_ACCEL_FIFO_MODE
+
+// Read the sensor with asynchronous I2C transfers, moved by the eDMA,
+// instead of blocking calls, so neither the interrupt handler nor the event
+// loop waits on the bus. Comment out for the blocking reads.
+#define APPL_ACCEL_DMA
+
+// I2CRegisterBus::read_async() needs the asynchronous I2C of the HAL. So far
+// only the host shim has been built and measured with it; a HAL without it
+// gets the blocking reads.
+#if defined(APPL_ACCEL_DMA) && !DEVICE_I2C_ASYNCH
+#warning "no DEVICE_I2C_ASYNCH in this HAL, APPL_ACCEL_DMA falls back to the blocking reads"
+#undef APPL_ACCEL_DMA
+#endif
+
+#if defined(APPL_ACCEL_FIFO_MODE) || defined(APPL_ACCEL_DMA)
+I2CRegisterBus accel_bus(PTE25, PTE24, FXOS8700CQ_SLAVE_ADDR1);
+#endif
+
+#ifdef APPL_ACCEL_DMA
+typedef FXOS8700CQAcquisition<I2CRegisterBus> AccelAcquisition;
+AccelAcquisition accel_acquisition(accel_bus);
+#endif
+
+#ifdef APPL_ACCEL_FIFO_MODE
+typedef FXOS8700CQFifo<I2CRegisterBus> AccelFifo;
+
+// 24 samples at 400 Hz is one burst every 60 ms, which leaves 20 ms of
+// headroom in the 32 entry FIFO for the event loop to get to it
+const uint8_t ACCEL_FIFO_WATERMARK = 24;
+const AccelFifo::DataRate ACCEL_FIFO_RATE = AccelFifo::ODR_400HZ;
+const uint32_t ACCEL_SAMPLE_PERIOD_US = 2500;
+
+AccelFifo accel_fifo(accel_bus);
+#endif
+
+// Also write the raw samples and interrupt sources to the serial port in
+// the knock-core/trace_format.h format, to record traces for the host build
+//#define APPL_ACCEL_TRACE_MODE
+
+#ifdef APPL_ACCEL_TRACE_MODE
+#ifndef APPL_ACCEL_FIFO_MODE
+#error "APPL_ACCEL_TRACE_MODE needs APPL_ACCEL_FIFO_MODE"
+#endif
+#endif
+
+// Run the sensor at a low rate in its low power mode while nothing moves,
+// and at the FIFO rate again from the first motion interrupt on. The knock
+// that raised it is over by the time the FIFO rate is back; the detector
+// confirms it on its tail and it keeps the time of the interrupt. Comment
+// out for a fixed rate.
+#define APPL_ACCEL_ADAPTIVE_RATE
+
+#ifdef APPL_ACCEL_ADAPTIVE_RATE
+#ifndef APPL_ACCEL_FIFO_MODE
+#error "APPL_ACCEL_ADAPTIVE_RATE needs APPL_ACCEL_FIFO_MODE"
+#endif
+#ifdef APPL_ACCEL_TRACE_MODE
+#error "APPL_ACCEL_ADAPTIVE_RATE leaves gaps in the trace of APPL_ACCEL_TRACE_MODE"
+#endif
+
+// The motion detector only sees the samples taken at the idle rate, so it
+// is made more sensitive than the 0.25 g of FXOS8700CQ::config_feature() to
+// catch short knocks between them. Thresholds are in steps of 63 mg; see
+// knock-rate in host/README.md for what other settings cost.
+const AccelFifo::DataRate ACCEL_IDLE_RATE = AccelFifo::ODR_200HZ;
+const AccelFifo::PowerMode ACCEL_IDLE_MODE = AccelFifo::MODS_LOW_POWER;
+const uint8_t ACCEL_IDLE_MOTION_THRESHOLD = 1;
+const AccelFifo::PowerMode ACCEL_ACTIVE_MODE = AccelFifo::MODS_NORMAL;
+const uint8_t ACCEL_ACTIVE_MOTION_THRESHOLD = 4;
+
+// Down after 5 s without motion or knocks, waiting up to a minute when the
+// motion keeps coming back right after
+const AdaptiveRateConfig ACCEL_RATE_HYSTERESIS(5000, 60000);
+
+// The first knock the detector finds this soon after the interrupt that
+// brought the rate up is the one that raised it
+const uint32_t ACCEL_WAKE_ONSET_US = 100000;
+#endif
+
+// Sleep while nobody knocks and let the motion interrupt wake the board.
+// In FIFO mode the sensor keeps sampling into its FIFO meanwhile, so the
+// samples just before the wake-up still reach the detector. Requests from
+// the server are answered once the board is awake again.
+//#define APPL_LOW_POWER
+
+// Free-running microsecond counter of the event timestamps, read in the
+// interrupt handler. The us_ticker stops in deep sleep, the low power
+// ticker does not.
+struct EventCounter {
+#ifdef APPL_LOW_POWER
+    static uint32_t read_us() { return lp_ticker_read(); }
+#else
+    static uint32_t read_us() { return us_ticker_read(); }
+#endif
+};
+static MonotonicClock<EventCounter> event_clock;
+
+// Estimates the server time of event_clock through /time/0, so knocks
+// carry both
+typedef ClockSyncResource<MonotonicClock<EventCounter> > AppClockSync;
+static AppClockSync *clock_sync;
+
+#ifdef APPL_LOW_POWER
+#ifdef APPL_ACCEL_TRACE_MODE
+#error "APPL_LOW_POWER leaves gaps in the trace of APPL_ACCEL_TRACE_MODE"
+#endif
+
+// Start sleeping after this long without knocks
+const uint32_t LOW_POWER_IDLE_MS = 30000;
+
+struct BoardPower {
+    static uint32_t clock_us() { return lp_ticker_read(); }
+    // the network stack only runs while awake, so stay up for its replies
+    static bool deep_sleep_allowed() { return !mbedclient->awaiting_response() && !clock_sync->awaiting_pong(); }
+    static void sleep() { ::sleep(); }
+    static void deep_sleep() { ::deepsleep(); }
+};
+typedef PowerManager<BoardPower> AppPowerManager;
+static AppPowerManager *power_manager;
+#endif
+
+const uint16_t ACCEL_COUNTS_PER_G = 4096;   // +/-2g range
+
+#ifdef APPL_ACCEL_FIFO_MODE
+// Features of every knock are taken over a window that starts this many
+// samples before the onset, and published on /accelerometer/0/magnitude,
+// direction and centroid
+const uint32_t KNOCK_FEATURE_PRE = 4;
+
+// 250 ms before and after the onset of every knock are kept as a delta
+// compressed snapshot on /accelerometer/0/waveform, read with a block-wise
+// GET. /accelerometer/0/waveforms counts the snapshots.
+typedef WaveformCapture<100, 100> AccelWaveformCapture;
+#endif
+
+// After a knock is reported, further knocks are only counted for this long
+const uint32_t KNOCK_REFRACTORY_MS = 1000;
+
+// Block the event loop for 1 s with wait(1) after every reported knock, as
+// the knock handler did before the refractory window, to compare the two
+// on the host (knock-wait-ethernet, knock-wait-6lowpan)
+//#define APPL_KNOCK_BLOCKING_WAIT
+
+// Every knock also goes into a batch on /accelerometer/0/knocks, which is
+// sent when it holds this many knocks or when its first knock is this old
+const size_t KNOCK_BATCH_SIZE = 8;
+const uint32_t KNOCK_BATCH_LATENCY_MS = 2000;
+typedef KnockBatch<KNOCK_BATCH_SIZE> AccelKnockBatch;
+
+// Knocks while the client is not registered go into a journal in the last
+// 64 KB of the internal flash, in the upper program flash block and clear of
+// the firmware. Once registered again the journal is forwarded oldest first,
+// one batch every KNOCK_JOURNAL_DRAIN_MS, so a backlog does not flood the
+// link.
+const uint64_t KNOCK_JOURNAL_BASE = 0xF0000;
+const uint32_t KNOCK_JOURNAL_SIZE = 64 * 1024;
+const uint32_t KNOCK_JOURNAL_DRAIN_MS = 1000;
+static StorageFlash journal_flash(ARM_Driver_Storage_MTD_K64F, KNOCK_JOURNAL_BASE, KNOCK_JOURNAL_SIZE);
+typedef KnockJournal<StorageFlash> AppJournal;
+
+// Knock rhythms recognised on the device, as relative time between knocks.
+// The index of the one that matched is reported in /accelerometer/0/pattern.
+const uint16_t PATTERN_SHAVE_AND_A_HAIRCUT[] = { 2, 1, 1, 2, 4, 2 };
+const uint16_t PATTERN_THREE_KNOCKS[] = { 1, 1 };
+
+// A sequence is over after 1.5 s without knocks, and matches a pattern when
+// the intervals are off by less than a quarter of its length in total.
+const uint32_t PATTERN_GAP_US = 1500000;
+const uint32_t PATTERN_TOLERANCE = 8192;    // Q15
+
+// Stages of the knock hot path timed by the perf probes, published on /perf/0
+enum PerfStage {
+    PERF_ISR,               // interrupt() itself
+    PERF_IRQ_TO_DRAIN,      // interrupt edge until drain_events() picks it up
+    PERF_FIFO_CPU,          // event loop time for one FIFO batch: the blocking burst read, or with
+                            // APPL_ACCEL_DMA only unpacking what the transfer read off the CPU
+    PERF_DETECT,            // knock detector over one FIFO batch
+    PERF_SET_VALUE,         // updating last_knock, including the notification
+    PERF_IRQ_TO_KNOCK,      // interrupt edge until last_knock is updated
+    PERF_FEATURES,          // knock features of one knock
+    PERF_STAGES
+};
+const char *const PERF_STAGE_NAMES[PERF_STAGES] = {
+    "isr", "irq_to_drain", "fifo_cpu", "detect", "set_value", "irq_to_knock", "features"
+};
+static PerfCounters<PERF_STAGES> perf;
+
 /*
  * The button contains one property (click count).
  * When `handle_button_click` is executed, the counter updates.
@@ -87,10 +312,9 @@ public:
         printf("handle_button_click, new value of counter is %d\r\n", counter);
 
         // serialize the value of counter as a string, and tell connector
-        stringstream ss;
-        ss << counter;
-        std::string stringified = ss.str();
-        res->set_value((uint8_t*)stringified.c_str(), stringified.length());
+        char buffer[INT_FORMAT_SIZE];
+        size_t length = format_uint(buffer, counter);
+        mbedclient->set_value(res, (uint8_t*)buffer, length);
     }
 
 private:
@@ -100,13 +324,26 @@ private:
 
 class AccelerometerResource {
 public:
-    AccelerometerResource() {
+    AccelerometerResource() : patterns(PATTERN_GAP_US, PATTERN_TOLERANCE) {
         accel_interrupt_pin.fall(this, &AccelerometerResource::interrupt);
         accel_interrupt_pin.mode(PullUp);
 
         accel.config_int();      // enabled interrupts from accelerometer
         accel.config_feature();  // turn on motion detection
         accel.enable();          // enable accelerometer
+#ifdef APPL_ACCEL_FIFO_MODE
+        if (!accel_fifo.configure(ACCEL_FIFO_WATERMARK, ACCEL_FIFO_RATE)) {
+            printf("Failed to configure accelerometer FIFO\r\n");
+        }
+#endif
+#ifdef APPL_ACCEL_ADAPTIVE_RATE
+        accel_rate.start(event_clock.now());
+#endif
+#ifdef APPL_ACCEL_TRACE_MODE
+        trace_write(trace.start(ACCEL_COUNTS_PER_G));
+#endif
+
+        start_polling();
 
         accel_object = M2MInterfaceFactory::create_object("accelerometer");
         M2MObjectInstance* accel_inst = accel_object->create_object_instance();
@@ -114,66 +351,775 @@ public:
             M2MResourceInstance::INTEGER, true /* observable */);
         accel_res->set_operation(M2MBase::GET_ALLOWED);
         accel_res->set_value((uint8_t*)"0", 1);
+
+        count_res = accel_inst->create_dynamic_resource("knock_count", "KnockCount",
+            M2MResourceInstance::INTEGER, true /* observable */);
+        count_res->set_operation(M2MBase::GET_ALLOWED);
+        count_res->set_value((uint8_t*)"0", 1);
+
+        knocks_res = accel_inst->create_dynamic_resource("knocks", "KnockBatch",
+            M2MResourceInstance::OPAQUE, true /* observable */);
+        knocks_res->set_operation(M2MBase::GET_ALLOWED);
+        knocks_res->set_value(batch.data(), batch.length());
+
+        pattern_res = accel_inst->create_dynamic_resource("pattern", "KnockPattern",
+            M2MResourceInstance::INTEGER, true /* observable */);
+        pattern_res->set_operation(M2MBase::GET_ALLOWED);
+        pattern_res->set_value((uint8_t*)"-1", 2);
+
+#ifdef APPL_ACCEL_FIFO_MODE
+        magnitude_res = accel_inst->create_dynamic_resource("magnitude", "KnockMagnitude",
+            M2MResourceInstance::INTEGER, true /* observable */);
+        magnitude_res->set_operation(M2MBase::GET_ALLOWED);
+        magnitude_res->set_value((uint8_t*)"0", 1);
+
+        direction_res = accel_inst->create_dynamic_resource("direction", "KnockDirection",
+            M2MResourceInstance::STRING, true /* observable */);
+        direction_res->set_operation(M2MBase::GET_ALLOWED);
+        direction_res->set_value((uint8_t*)"", 0);
+
+        centroid_res = accel_inst->create_dynamic_resource("centroid", "KnockCentroid",
+            M2MResourceInstance::INTEGER, true /* observable */);
+        centroid_res->set_operation(M2MBase::GET_ALLOWED);
+        centroid_res->set_value((uint8_t*)"0", 1);
+
+        waveform_res = accel_inst->create_dynamic_resource("waveform", "KnockWaveform",
+            M2MResourceInstance::OPAQUE, false /* observable */);
+        waveform_res->set_operation(M2MBase::GET_ALLOWED);
+        waveform_res->set_outgoing_block_message_callback(
+            outgoing_block_message_callback(this, &AccelerometerResource::read_waveform));
+
+        waveforms_res = accel_inst->create_dynamic_resource("waveforms", "KnockWaveforms",
+            M2MResourceInstance::INTEGER, true /* observable */);
+        waveforms_res->set_operation(M2MBase::GET_ALLOWED);
+        waveforms_res->set_value((uint8_t*)"0", 1);
+#endif
+
+        patterns.add_template(PATTERN_SHAVE_AND_A_HAIRCUT, sizeof(PATTERN_SHAVE_AND_A_HAIRCUT) / sizeof(uint16_t));
+        patterns.add_template(PATTERN_THREE_KNOCKS, sizeof(PATTERN_THREE_KNOCKS) / sizeof(uint16_t));
+
+        if (!journal_flash.init() || !journal.mount()) {
+            printf("Failed to mount the knock journal, knocks while offline are lost\r\n");
+        } else if (journal.pending()) {
+            printf("knock journal: %lu knocks to forward\r\n", (unsigned long)journal.pending());
+        }
     }
 
     M2MObject* get_object() {
         return accel_object;
     }
 
-private:
-    void led_off(void) {
-        led1 = 1;
+    /*
+     * Called on every registration, starts forwarding the journal when
+     * there is something in it
+     */
+    void client_registered(void) {
+        if (journal.pending() && !drain_timer) {
+            drain_timer = minar::Scheduler::postCallback(mbed::util::FunctionPointer(this, &AccelerometerResource::drain_journal).bind())
+                .delay(minar::milliseconds(KNOCK_JOURNAL_DRAIN_MS))
+                .getHandle();
+        }
     }
 
-    void motion_detected(void) {
+private:
+    /*
+     * `timestamp` is when the knock happened in microseconds, wrapping at 2^32,
+     * for the pattern matcher; `local` is the same on event_clock.
+     * `peak` and `axis` come from the detector, they are 0 and
+     * AccelKnockBatch::AXIS_UNKNOWN for knocks from the motion interrupt.
+     *
+     * The first knock is reported right away and opens a refractory window
+     * in which the LED stays on. Knocks that arrive while the window is open
+     * are counted, and the count goes out once when the window closes.
+     */
+    void motion_detected(uint32_t timestamp, uint64_t local, int32_t peak, uint8_t axis) {
+#ifdef APPL_LOW_POWER
+        power_manager->activity();
+#endif
+#ifdef APPL_ACCEL_ADAPTIVE_RATE
+        accel_rate.motion(local);
+#endif
+        patterns.knock(timestamp);
+        knock_count++;
+
+        // nobody to send it to, or older knocks are still waiting in the
+        // journal and this one has to go after them
+        uint64_t server = clock_sync->server_us(local);
+        bool journaled = (!mbedclient->registered() || journal.pending()) &&
+                         journal.append(local, server, peak, axis);
+        if (!journaled) {
+            if (!batch.add(local, server, peak, axis)) {
+                // too long after the knock before, the batch can not time it
+                flush_batch();
+                batch.add(local, server, peak, axis);
+            }
+            if (batch.full()) {
+                flush_batch();
+            } else if (batch.count() == 1) {
+                batch_timer = minar::Scheduler::postCallback(mbed::util::FunctionPointer(this, &AccelerometerResource::batch_timeout).bind())
+                    .delay(minar::milliseconds(KNOCK_BATCH_LATENCY_MS))
+                    .getHandle();
+            }
+        }
+
+        if (refractory) {
+            return;
+        }
+        refractory = true;
+
         printf("motion_detected\r\n");
         // update in connector
-        stringstream ss;
-        ss << rtc_read();
-        std::string stringified = ss.str();
-        accel_res->set_value((uint8_t*)stringified.c_str(), stringified.length());
+        char buffer[INT_FORMAT_SIZE];
+        size_t length = format_uint(buffer, rtc_read());
+        uint32_t start = perf_ticks();
+        mbedclient->set_value(accel_res, (uint8_t*)buffer, length);
+        perf.record_since(PERF_SET_VALUE, start);
+        perf.record_since(PERF_IRQ_TO_KNOCK, irq_ticks);
 
-        minar::Scheduler::postCallback(mbed::util::FunctionPointer(this, &AccelerometerResource::led_off).bind()).delay(minar::milliseconds(1000));
+        uint32_t latency = EventCounter::read_us() - irq_timestamp;
+        if (latency > max_latency) {
+            max_latency = latency;
+        }
+        printf("knock reported %lu us after the interrupt (max %lu us)\r\n",
+               (unsigned long)latency, (unsigned long)max_latency);
 
+#ifdef APPL_KNOCK_BLOCKING_WAIT
         wait(1);
-        led1 = 1;
+#endif
+        minar::Scheduler::postCallback(mbed::util::FunctionPointer(this, &AccelerometerResource::end_refractory).bind())
+            .delay(minar::milliseconds(KNOCK_REFRACTORY_MS));
+    }
+
+    void end_refractory(void) {
+        led1 = 1;  // turn led off
+        refractory = false;
+
+        if (knock_count == reported_count) {
+            return;
+        }
+        reported_count = knock_count;
+
+        char buffer[INT_FORMAT_SIZE];
+        size_t length = format_uint(buffer, knock_count);
+        mbedclient->set_value(count_res, (uint8_t*)buffer, length);
+    }
+
+    void batch_timeout(void) {
+        batch_timer = NULL;
+        flush_batch();
+    }
+
+    void flush_batch(void) {
+        if (batch_timer) {
+            minar::Scheduler::cancelCallback(batch_timer);
+            batch_timer = NULL;
+        }
+        if (batch.count() == 0) {
+            return;
+        }
+        // not through the notify policy, coalescing would drop the knocks
+        // of the batch it replaces; batching already limits the rate
+        knocks_res->set_value(batch.data(), batch.length());
+        batch.clear();
+    }
+
+    /*
+     * Forwards one batch of the oldest knocks in the journal, and comes back
+     * for the next until the journal is empty or the registration is lost
+     * again. A batch ends early where the batch can not time a knock from
+     * the one before: the local time went back after a reset, or the gap
+     * is over AccelKnockBatch::MAX_DELTA. The next batch starts there, with
+     * the knock's own local and server time in its header.
+     */
+    void drain_journal(void) {
+        drain_timer = NULL;
+        if (!mbedclient->registered()) {
+            // client_registered() starts over
+            return;
+        }
+
+        flush_batch();
+        JournalKnock knocks[KNOCK_BATCH_SIZE];
+        size_t count = journal.peek(knocks, KNOCK_BATCH_SIZE);
+        for (size_t i = 0; i < count; i++) {
+            if (!batch.add(knocks[i].local, knocks[i].server, knocks[i].peak, knocks[i].axis)) {
+                count = i;
+                break;
+            }
+        }
+        flush_batch();
+        if (count && !journal.forwarded(knocks[count - 1].sequence)) {
+            printf("knock journal: failed to mark a batch as forwarded\r\n");
+        }
+
+        if (journal.pending()) {
+            client_registered();
+        } else if (journal.dropped() != reported_journal_drops) {
+            printf("knock journal: %lu knocks dropped while offline\r\n",
+                   (unsigned long)(journal.dropped() - reported_journal_drops));
+            reported_journal_drops = journal.dropped();
+        }
+    }
+
+    /*
+     * Reports the pattern once a knock sequence is over
+     */
+    void check_pattern(uint32_t now) {
+        PatternMatch match;
+        if (!patterns.poll(now, match) || match.index < 0) {
+            return;
+        }
+
+        printf("pattern %d matched, %d knocks\r\n", match.index, match.knocks);
+        char buffer[INT_FORMAT_SIZE];
+        size_t length = format_int(buffer, match.index);
+        mbedclient->set_value(pattern_res, (uint8_t*)buffer, length);
+    }
+
+#ifdef APPL_ACCEL_FIFO_MODE
+    /*
+     * FIFO watermark and motion detection share the interrupt line, so check
+     * INT_SOURCE to see which one(s) fired. Runs from the event loop because
+     * the FIFO burst takes a few milliseconds on the bus.
+     */
+    void service_interrupt(void) {
+        uint8_t sources;
+        // bounded, in case the sensor keeps the line asserted
+        for (int i = 0; i < 4 && accel_fifo.read_sources(sources) && sources; i++) {
+#ifdef APPL_ACCEL_TRACE_MODE
+            trace_write(trace.interrupt(irq_timestamp, sources));
+#endif
+            if (sources & AccelFifo::SRC_FIFO) {
+                uint32_t start = perf_ticks();
+                int count = accel_fifo.drain(samples);
+                perf.record_since(PERF_FIFO_CPU, start);
+                if (count < 0) {
+                    printf("Failed to drain accelerometer FIFO\r\n");
+                } else {
+#ifdef APPL_ACCEL_TRACE_MODE
+                    trace_samples(count);
+#endif
+                    anchor_samples(count, i == 0 && sources == AccelFifo::SRC_FIFO);
+                    detect(count);
+                }
+            }
+            if (sources & AccelFifo::SRC_FFMT) {
+                // the motion block fires on any movement, knocks are
+                // confirmed by the detector instead
+                accel.clear_int();
+#ifdef APPL_ACCEL_ADAPTIVE_RATE
+                accel_rate.motion(event_clock.widen(irq_timestamp));
+#endif
+            }
+        }
+    }
+
+#ifdef APPL_ACCEL_DMA
+    /*
+     * Starts reading the sensor for the edges drain_events() just picked up.
+     * The reads run on the bus while the event loop goes on, acquired()
+     * handles what they found. Edges during a round get a round of their own
+     * after it.
+     */
+    void acquire(void) {
+        if (accel_acquisition.busy()) {
+            acquire_again = true;
+            return;
+        }
+        acquire_rounds = 0;
+        start_acquisition();
+    }
+
+    void start_acquisition(void) {
+        acquire_again = false;
+        if (!accel_acquisition.start(ACCEL_FIFO_WATERMARK,
+                                     mbed::util::FunctionPointer(this, &AccelerometerResource::acquisition_done))) {
+            printf("Failed to read the accelerometer\r\n");
+        }
+    }
+
+    // from the I2C interrupt
+    void acquisition_done(void) {
+        minar::Scheduler::postCallback(mbed::util::FunctionPointer(this, &AccelerometerResource::acquired).bind());
+    }
+
+    /*
+     * One pass of service_interrupt() on what a round read. Starts the next
+     * round while the sensor still reports a source, bounded the same way.
+     */
+    void acquired(void) {
+        uint8_t sources = accel_acquisition.sources();
+        if (accel_acquisition.failed()) {
+            printf("Failed to read the accelerometer\r\n");
+        }
+#ifdef APPL_ACCEL_TRACE_MODE
+        trace_write(trace.interrupt(irq_timestamp, sources));
+#endif
+        uint32_t start = perf_ticks();
+        int count = accel_acquisition.take(samples);
+        if (sources & AccelFifo::SRC_FIFO) {
+            perf.record_since(PERF_FIFO_CPU, start);
+        }
+#ifdef APPL_ACCEL_ADAPTIVE_RATE
+        if (sources & AccelFifo::SRC_FFMT) {
+            accel_rate.motion(event_clock.widen(irq_timestamp));
+        }
+#endif
+        if (count > 0) {
+#ifdef APPL_ACCEL_TRACE_MODE
+            trace_samples(count);
+#endif
+            anchor_samples(count, acquire_rounds == 0 && sources == AccelFifo::SRC_FIFO);
+            detect(count);
+        }
+
+        if (sources && ++acquire_rounds < 4) {
+            start_acquisition();
+        } else if (acquire_again) {
+            acquire_rounds = 0;
+            start_acquisition();
+        }
+    }
+#endif
+
+    /*
+     * Pins the `count` samples just drained to event_clock. When the watermark
+     * alone raised the interrupt, the sample that reached it was taken at the
+     * edge; otherwise, e.g. after a wake-up with a full FIFO, the newest one is
+     * at most a sample period old.
+     */
+    void anchor_samples(size_t count, bool watermark_edge) {
+        uint32_t first = detector.samples();
+        if (watermark_edge && count >= ACCEL_FIFO_WATERMARK && count < AccelFifo::CAPACITY) {
+            sample_clock.anchor(first + ACCEL_FIFO_WATERMARK - 1, event_clock.widen(irq_timestamp));
+        } else if (count > 0) {
+            sample_clock.anchor(first + count - 1, event_clock.now());
+        }
+    }
+
+    /*
+     * Runs the newest `count` samples through the knock detector
+     */
+    void detect(size_t count) {
+        KnockOnset knock;
+        uint32_t busy = 0;  // without the knock handling
+        for (size_t i = samples.size() - count; i < samples.size(); i++) {
+            waveform.add(samples.at(i));
+            uint32_t start = perf_ticks();
+            bool found = detector.process(samples.at(i), knock);
+            busy += perf_ticks() - start;
+            if (found) {
+                led1 = 0;  // turn led on
+                uint64_t local = sample_clock.local_us(knock.sample);
+#ifdef APPL_ACCEL_ADAPTIVE_RATE
+                local = onset_time(local);
+#endif
+                motion_detected((uint32_t)local, local, knock.peak, knock.axis);
+                publish_features(knock, i);
+                capture_waveform(knock, i);
+            }
+        }
+        perf.record(PERF_DETECT, busy);
+
+        if (waveform.sequence() != reported_waveforms) {
+            reported_waveforms = waveform.sequence();
+            char buffer[INT_FORMAT_SIZE];
+            size_t length = format_uint(buffer, reported_waveforms);
+            mbedclient->set_value(waveforms_res, (uint8_t*)buffer, length);
+        }
+    }
+
+    /*
+     * `current` is the position in `samples` of the sample that completed
+     * `knock`. The window is moved back when the knock was short, and
+     * skipped when the ring does not go back far enough yet.
+     */
+    void publish_features(const KnockOnset &knock, size_t current) {
+        const size_t window = KnockFeatureExtractor<>::WINDOW;
+        size_t age = detector.samples() - 1 - knock.sample;
+        if (age + KNOCK_FEATURE_PRE > current || current + 1 < window) {
+            return;
+        }
+        size_t first = current - age - KNOCK_FEATURE_PRE;
+        if (first + window > current + 1) {
+            first = current + 1 - window;
+        }
+
+        uint32_t start = perf_ticks();
+        KnockFeatures features;
+        feature_extractor.extract(samples, first, features);
+        perf.record_since(PERF_FEATURES, start);
+
+        char buffer[INT_FORMAT_SIZE];
+        size_t length = format_uint(buffer, (uint32_t)features.magnitude * 1000 / ACCEL_COUNTS_PER_G);
+        mbedclient->set_value(magnitude_res, (uint8_t*)buffer, length);
+
+        char direction[2] = { features.sign < 0 ? '-' : '+', (char)('x' + features.axis) };
+        mbedclient->set_value(direction_res, (uint8_t*)direction, sizeof(direction));
+
+        length = format_uint(buffer, KnockFeatureExtractor<>::centroid_hz(features, 1000000 / ACCEL_SAMPLE_PERIOD_US));
+        mbedclient->set_value(centroid_res, (uint8_t*)buffer, length);
+    }
+
+    /*
+     * Starts a snapshot around `knock`, `current` as for publish_features().
+     * The samples after the ones already in the ring follow from detect().
+     */
+    void capture_waveform(const KnockOnset &knock, size_t current) {
+        size_t age = detector.samples() - 1 - knock.sample;
+        if (age <= current) {
+            waveform.trigger(samples, current - age, current, knock.sample * ACCEL_SAMPLE_PERIOD_US, rtc_read());
+        }
+    }
+
+    /*
+     * A GET on /accelerometer/0/waveform goes out in blocks straight from
+     * the snapshot slot, without a copy on the heap
+     */
+    void read_waveform(const String &/*name*/, uint8_t *&buffer, uint32_t &length) {
+        buffer = (uint8_t*)waveform.snapshot();
+        length = waveform.snapshot_length();
+    }
+#endif
+
+#ifdef APPL_ACCEL_TRACE_MODE
+    /*
+     * Writes the newest `count` samples to the serial port. The newest one
+     * is at most one sample period old, the others are counted back from it.
+     */
+    void trace_samples(size_t count) {
+        if (count == 0) {
+            return;
+        }
+        size_t first = samples.size() - count;
+        uint32_t timestamp = us_ticker_read() - (count - 1) * ACCEL_SAMPLE_PERIOD_US;
+        trace.begin_samples(timestamp, ACCEL_SAMPLE_PERIOD_US);
+        for (size_t i = first; i < samples.size(); i++) {
+            if (!trace.add_sample(samples.at(i))) {
+                trace_write(trace.finish());
+                trace.begin_samples(timestamp + (i - first) * ACCEL_SAMPLE_PERIOD_US, ACCEL_SAMPLE_PERIOD_US);
+                trace.add_sample(samples.at(i));
+            }
+        }
+        trace_write(trace.finish());
+    }
+
+    /*
+     * Blocks until the frame is out. A watermark of samples at rest is
+     * about 100 bytes, 9 ms at 115200 baud, well within the 60 ms between
+     * two watermark interrupts.
+     */
+    void trace_write(const uint8_t *frame) {
+        for (size_t i = 0; i < trace.length(); i++) {
+            pc.putc(frame[i]);
+        }
+    }
+#endif
+
+#ifdef APPL_ACCEL_ADAPTIVE_RATE
+    /*
+     * Only the motion interrupt is on at the idle rate, so this edge is
+     * motion, and the first knock of a visitor or a door being opened. Its
+     * time is the onset of that knock, should the detector confirm one.
+     */
+    void motion_while_idle(uint32_t timestamp) {
+        wake_local = event_clock.widen(timestamp);
+        wake_onset = true;
+        accel_rate.motion(wake_local);
+    }
+
+    // `local` of a knock, or the interrupt that raised the rate for it
+    uint64_t onset_time(uint64_t local) {
+        bool woke = wake_onset && local < wake_local + ACCEL_WAKE_ONSET_US;
+        wake_onset = false;
+        return woke ? wake_local : local;
+    }
+
+    /*
+     * Puts the sensor in the mode accel_rate is in. The watermark interrupt
+     * is only on at the FIFO rate. When the bus is taken or a write fails,
+     * the next pass of drain_events() tries again.
+     */
+    void update_rate(void) {
+        bool active = accel_rate.mode() == AdaptiveRate::ACTIVE;
+        if (active == rate_active) {
+            return;
+        }
+#ifdef APPL_ACCEL_DMA
+        if (accel_acquisition.busy()) {
+            return;
+        }
+#endif
+        bool ok = active ? accel_fifo.set_rate(ACCEL_FIFO_RATE, ACCEL_ACTIVE_MODE, ACCEL_ACTIVE_MOTION_THRESHOLD) &&
+                           accel_fifo.set_watermark_interrupt(true)
+                         : accel_fifo.set_watermark_interrupt(false) &&
+                           accel_fifo.set_rate(ACCEL_IDLE_RATE, ACCEL_IDLE_MODE, ACCEL_IDLE_MOTION_THRESHOLD);
+        if (!ok) {
+            printf("Failed to change the accelerometer rate\r\n");
+            return;
+        }
+        if (active) {
+            // the high-pass starts over after the gap at the idle rate
+            detector.resume();
+        }
+        rate_active = active;
+    }
+#endif
+
+    void start_polling(void) {
+        poll_timer = minar::Scheduler::postCallback(mbed::util::FunctionPointer(this, &AccelerometerResource::drain_events).bind())
+            .period(minar::milliseconds(ACCEL_EVENT_POLL_MS))
+            .getHandle();
+    }
+
+#ifdef APPL_LOW_POWER
+    /*
+     * Once the power manager says it has been quiet for long enough, the
+     * polling stops and only the motion interrupt is left to wake the board.
+     * The FIFO keeps filling in circular mode without interrupting.
+     */
+    void sleep_when_quiet(void) {
+        if (!power_manager->idle() || refractory || batch.count()) {
+            return;
+        }
+#ifdef APPL_ACCEL_ADAPTIVE_RATE
+        // the idle rate comes first, and turns the watermark interrupt off
+        if (rate_active) {
+            return;
+        }
+#endif
+#ifdef APPL_ACCEL_DMA
+        // the watermark interrupt is turned off over the bus
+        if (accel_acquisition.busy()) {
+            return;
+        }
+#endif
+        minar::Scheduler::cancelCallback(poll_timer);
+        poll_timer = NULL;
+#if defined(APPL_ACCEL_FIFO_MODE) && !defined(APPL_ACCEL_ADAPTIVE_RATE)
+        accel_fifo.set_watermark_interrupt(false);
+#endif
+        power_manager->doze();
+    }
+
+    /*
+     * Posted by interrupt() when the motion interrupt ends a doze. The edge
+     * that woke the board is already queued, so drain_events() picks up the
+     * FIFO right away, including the samples from before the wake-up.
+     */
+    void wake_up(void) {
+#if defined(APPL_ACCEL_FIFO_MODE) && !defined(APPL_ACCEL_ADAPTIVE_RATE)
+        accel_fifo.set_watermark_interrupt(true);
+#endif
+        power_manager->activity();
+        // a registration update that is due soon goes out now, while awake
+        mbedclient->align_update();
+        start_polling();
+        drain_events();
+    }
+#endif
+
+    /*
+     * Single consumer for the edges queued by interrupt(), so a burst of
+     * interrupts costs one pass here instead of one scheduler callback each.
+     */
+    void drain_events(void) {
+#ifdef APPL_ACCEL_ADAPTIVE_RATE
+        // at the idle rate, an edge from here on posts another pass
+        wake_pending.store(accel_rate.mode() == AdaptiveRate::ACTIVE);
+#endif
+        AccelEvent event;
+        uint32_t count = 0;
+        while (events.pop(event)) {
+            perf.record_since(PERF_IRQ_TO_DRAIN, event.ticks);
+            irq_timestamp = event.timestamp;
+            irq_ticks = event.ticks;
+#ifdef APPL_ACCEL_ADAPTIVE_RATE
+            if (accel_rate.mode() == AdaptiveRate::IDLE) {
+                motion_while_idle(event.timestamp);
+            }
+#endif
+            count++;
+        }
+
+        check_pattern((uint32_t)event_clock.now());
+#ifdef APPL_ACCEL_ADAPTIVE_RATE
+        accel_rate.quiet(event_clock.now());
+        update_rate();
+#endif
+
+        if (count == 0) {
+#ifdef APPL_LOW_POWER
+            sleep_when_quiet();
+#endif
+            return;
+        }
+
+        if (events.dropped() != reported_drops) {
+            printf("accelerometer: %lu interrupt(s) dropped\r\n",
+                   (unsigned long)(events.dropped() - reported_drops));
+            reported_drops = events.dropped();
+        }
+
+#if defined(APPL_ACCEL_FIFO_MODE) && defined(APPL_ACCEL_DMA)
+        acquire();
+#elif defined(APPL_ACCEL_FIFO_MODE)
+        service_interrupt();
+#else
+        motion_detected(event.timestamp, event_clock.widen(event.timestamp), 0, AccelKnockBatch::AXIS_UNKNOWN);
+#endif
     }
 
     void interrupt(void) {
+        uint32_t start = perf_ticks();
+#ifndef APPL_ACCEL_FIFO_MODE
         led1 = 0;  // turn led on
+#ifdef APPL_ACCEL_DMA
+        // only starts the read, the line is released after the handler returned
+        accel_acquisition.clear_motion();
+#else
         accel.clear_int();
-        minar::Scheduler::postCallback(mbed::util::FunctionPointer(this, &AccelerometerResource::motion_detected).bind());
+#endif
+#endif
+        AccelEvent event = { EventCounter::read_us(), start };
+        events.push(event);
+#ifdef APPL_ACCEL_ADAPTIVE_RATE
+        // raise the rate without waiting for the next poll; only the first
+        // edge after drain_events() cleared the flag posts, and at the FIFO
+        // rate the event loop keeps it set
+        if (!wake_pending.exchange(true)) {
+            minar::Scheduler::postCallback(mbed::util::FunctionPointer(this, &AccelerometerResource::drain_events).bind());
+        }
+#endif
+#ifdef APPL_LOW_POWER
+        if (power_manager->dozing()) {
+            power_manager->wake();
+            minar::Scheduler::postCallback(mbed::util::FunctionPointer(this, &AccelerometerResource::wake_up).bind());
+        }
+#endif
+        perf.record_since(PERF_ISR, start);
     }
 
     M2MObject* accel_object;
     M2MResource* accel_res;
+    M2MResource* count_res;
+    M2MResource* knocks_res;
+    M2MResource* pattern_res;
+    minar::callback_handle_t poll_timer = NULL;
+    KnockPatternMatcher<8, 4> patterns;
+    SpscRing<AccelEvent, 16> events;
+    uint32_t reported_drops = 0;
+    uint32_t irq_timestamp = 0;     // last interrupt picked up by drain_events()
+    uint32_t irq_ticks = 0;         // perf_ticks() of that interrupt
+    uint32_t max_latency = 0;       // interrupt to last_knock update, in us
+    bool refractory = false;
+    uint32_t knock_count = 0;
+    uint32_t reported_count = 0;
+    AccelKnockBatch batch;
+    minar::callback_handle_t batch_timer = NULL;
+    AppJournal journal{journal_flash};
+    minar::callback_handle_t drain_timer = NULL;
+    uint32_t reported_journal_drops = 0;
+#ifdef APPL_ACCEL_FIFO_MODE
+    // last ~0.6 s of raw samples at 400 Hz
+    SampleRing<AccelSample, 256> samples;
+    // default tuning is for the 400 Hz FIFO rate
+    KnockDetector detector;
+    KnockFeatureExtractor<> feature_extractor;
+    SampleClock sample_clock{ACCEL_SAMPLE_PERIOD_US};
+    M2MResource* magnitude_res;
+    M2MResource* direction_res;
+    M2MResource* centroid_res;
+    AccelWaveformCapture waveform{ACCEL_SAMPLE_PERIOD_US, ACCEL_COUNTS_PER_G};
+    uint32_t reported_waveforms = 0;
+    M2MResource* waveform_res;
+    M2MResource* waveforms_res;
+#ifdef APPL_ACCEL_DMA
+    uint32_t acquire_rounds = 0;    // of the interrupt being serviced
+    bool acquire_again = false;     // edges came in during a round
+#endif
+#ifdef APPL_ACCEL_ADAPTIVE_RATE
+    AdaptiveRate accel_rate{ACCEL_RATE_HYSTERESIS};
+    bool rate_active = true;        // the sensor runs at ACCEL_FIFO_RATE
+    uint64_t wake_local = 0;        // interrupt that last raised the rate
+    bool wake_onset = false;        // its knock is not confirmed yet
+    std::atomic<bool> wake_pending{true};   // set by interrupt(), a drain is posted or not needed
+#endif
+#endif
+#ifdef APPL_ACCEL_TRACE_MODE
+    TraceFrame trace;
+#endif
 };
 
 // Set bootstrap mode to be Thread, otherwise 6LOWPAN_ND is used
 //#define APPL_BOOTSTRAP_MODE_THREAD
 
-static MbedClient *mbedclient;
 static InterruptIn obs_button(SW2);
 static InterruptIn unreg_button(SW3);
-static Serial &pc = get_stdio_serial();
 static uint8_t mac_addr[8];
 
+// The objects app_start() creates, in an arena sized for exactly them
+typedef PerfResource<PERF_STAGES> AppPerfResource;
+#ifdef APPL_LOW_POWER
+typedef PowerResource<BoardPower> AppPowerResource;
+static StaticArena<ArenaSize<MbedClient, AppClockSync, AppPowerManager, AppPowerResource, AccelerometerResource, AppPerfResource, HeapResource>::value> app_arena;
+#else
+static StaticArena<ArenaSize<MbedClient, AppClockSync, AccelerometerResource, AppPerfResource, HeapResource>::value> app_arena;
+#endif
+
+static AccelerometerResource *accel_resource;
+
+// Every accepted registration, the first one and each after a reconnect
+static void client_registered() {
+    // the server may be one that answers clock pings now
+    clock_sync->client_registered();
+    // forwards the knocks journaled while offline
+    accel_resource->client_registered();
+}
+
 uint8_t *get_mac_address(){
     return mac_addr;
 }
 
+//Handler for mesh network status events
+static void mesh_network_handler(mesh_connection_status_t status)
+{
+    printf("mesh_network_handler() %d\r\n", status);
+    if (status == MESH_CONNECTED) {
+        mbedclient->network_connected();
+    }
+}
+
 void app_start(int, char **)
 {
 	pc.baud(115200);  //Setting the Baud-Rate for trace output
     printf("Start mbed-client-example-6lowpan\r\n");
 
+    perf_clock_init();
+
     // Instantiate the class which implements
     // LWM2M Client API
-    mbedclient = new MbedClient(device);
+    mbedclient = app_arena.create<MbedClient>(device);
+
+    // before the accelerometer, which timestamps its knocks with it
+    clock_sync = app_arena.create<AppClockSync>(event_clock);
+    mbedclient->object_list_push(clock_sync->get_object());
+
+#ifdef APPL_LOW_POWER
+    // before the accelerometer, whose interrupt may wake it
+    power_manager = app_arena.create<AppPowerManager>(LOW_POWER_IDLE_MS);
+    auto power_resource = app_arena.create<AppPowerResource>(*power_manager);
+    mbedclient->object_list_push(power_resource->get_object());
+#endif
 
-    auto accel_resource = new AccelerometerResource();
+    accel_resource = app_arena.create<AccelerometerResource>();
+    auto perf_resource = app_arena.create<AppPerfResource>(perf, PERF_STAGE_NAMES);
+    auto heap_resource = app_arena.create<HeapResource>(app_arena);
     // auto button_resource = new ButtonResource();
     mbedclient->object_list_push(accel_resource->get_object());
+    mbedclient->on_registered(mbed::util::FunctionPointer(&client_registered));
+    mbedclient->object_list_push(perf_resource->get_object());
+    mbedclient->object_list_push(heap_resource->get_object());
     // mbedclient->object_list_push(button_resource->get_object());
 
     // This sets up the network interface configuration which will be used
@@ -187,10 +1133,10 @@ void app_start(int, char **)
     // Read mac address after registering the device.
     rf_read_mac_address(&eui64[0]);
     char *pskd = (char *)"Secret password";
-    status = ((MeshThread *)mesh_api)->init(rf_device_id, AbstractMesh::mesh_network_handler_t(mbedclient, &MbedClient::mesh_network_handler), eui64, pskd);
+    status = ((MeshThread *)mesh_api)->init(rf_device_id, AbstractMesh::mesh_network_handler_t(&mesh_network_handler), eui64, pskd);
 #else /* APPL_BOOTSTRAP_MODE_THREAD */
     mesh_api = (Mesh6LoWPAN_ND *)MeshInterfaceFactory::createInterface(MESH_TYPE_6LOWPAN_ND);
-    status = ((Mesh6LoWPAN_ND *)mesh_api)->init(rf_device_register(), AbstractMesh::mesh_network_handler_t(mbedclient, &MbedClient::mesh_network_handler));
+    status = ((Mesh6LoWPAN_ND *)mesh_api)->init(rf_device_register(), AbstractMesh::mesh_network_handler_t(&mesh_network_handler));
 #endif /* APPL_BOOTSTRAP_MODE */
 
     if (status != MESH_ERROR_NONE) {
@@ -16,103 +16,32 @@
 #ifndef __MBEDCLIENT_H__
 #define __MBEDCLIENT_H__
 
-#include "mbed-client/m2minterfaceobserver.h"
-#include "mbed-drivers/DigitalOut.h"
-#include "mbed-mesh-api/mesh_interface_types.h"
-#include "minar/minar.h"
+#include "mbed-client/m2minterface.h"
+#include "knock-core/mbed_client.h"
 
-struct MbedClientDevice {
-    const char* Manufacturer;
-    const char* Type;
-    const char* ModelNumber;
-    const char* SerialNumber;
-    const char* DeviceType;
-};
-
-
-class M2MDevice;
 class M2MSecurity;
-class M2MObject;
-
 
 uint8_t *get_mac_address();
 
-class MbedClient : public M2MInterfaceObserver
-{
-public:
-    MbedClient(MbedClientDevice device);
-
-    ~MbedClient();
-
-    bool create_interface();
-
-    M2MSecurity *create_register_object();
-
-    M2MDevice *create_device_object();
-
-    void execute_function(void *argument);
-
-    M2MObject *create_generic_object();
-
-    void update_resource();
-
-    void send_registration();
-
-    void set_register_object(M2MSecurity *&register_object);
-
-    void test_unregister();
-
-    //Callback from mbed client stack when the bootstrap
-    // is successful, it returns the mbed Device Server object
-    // which will be used for registering the resources to
-    // mbed Device server.
-    void bootstrap_done(M2MSecurity *server_object);
-
-    //Callback from mbed client stack when the registration
-    // is successful, it returns the mbed Device Server object
-    // to which the resources are registered and registered objects.
-    void object_registered(M2MSecurity */*security_object*/, const M2MServer &/*server_object*/);
-
-    //Callback from mbed client stack when the unregistration
-    // is successful, it returns the mbed Device Server object
-    // to which the resources were unregistered.
-    void object_unregistered(M2MSecurity */*server_object*/);
-
-    void registration_updated(M2MSecurity */*security_object*/, const M2MServer & /*server_object*/);
-
-    void update_registration(void);
-
-    //Callback from mbed client stack if any error is encountered
-    // during any of the LWM2M operations. Error type is passed in
-    // the callback.
-    void error(M2MInterface::Error error);
-
-    //Callback from mbed client stack if any value has changed
-    // during PUT operation. Object and its type is passed in
-    // the callback.
-    void value_updated(M2MBase *base, M2MBase::BaseType type);
-
-    //Handler for mesh network status events
-    void mesh_network_handler(mesh_connection_status_t status);
+/*
+ * mbed Device Connector over the Nanostack mesh, see mbedclient.cpp. The
+ * lifetime and update policy come from the "knock-detector" section in
+ * config.json through MbedClientConfig.
+ */
+struct MeshTransport {
+    static const M2MInterface::BindingMode BINDING = M2MInterface::UDP;
+    static const M2MInterface::NetworkStack STACK = M2MInterface::Nanostack_IPv6;
+
+    static const char *server_uri();
+    static const char *domain();
+    static const char *endpoint_name();
+    // radio channel, band and MAC
+    static String endpoint_type();
+    // the MAC tells nodes apart, so it spreads their timers
+    static uint32_t seed(const String &endpoint_name);
+    static void set_credentials(M2MSecurity *security);
+};
 
-    void object_list_push(M2MObject* obj) {
-        _object_list.push_back(obj);
-    }
+typedef MbedClientCore<MeshTransport> MbedClient;
 
-private:
-    void wait();
-    void idle();
-    mbed::DigitalOut    _led;
-    M2MInterface        *_interface;
-    M2MSecurity         *_register_security;
-    M2MDevice           *_device;
-    M2MObject           *_object;
-    minar::callback_handle_t   _update_timer_handle;
-    M2MObjectList       _object_list;
-    bool                _registered;
-    bool                _registering;
-    bool                _updating;
-    int                 _value;
-    MbedClientDevice    _deviceInfo;
-};
 #endif //__MBEDCLIENT_H__
@@ -19,302 +19,60 @@
 
 #include "sockets/UDPSocket.h"
 #include "EthernetInterface.h"
-#include "mbed-drivers/test_env.h"
-#include "mbed-client/m2minterfacefactory.h"
-#include "mbed-client/m2mdevice.h"
-#include "mbed-client/m2minterfaceobserver.h"
 #include "mbed-client/m2minterface.h"
-#include "mbed-client/m2mobject.h"
-#include "mbed-client/m2mobjectinstance.h"
-#include "mbed-client/m2mresource.h"
-#include "minar/minar.h"
+#include "mbed-client/m2msecurity.h"
 #include "security.h"
-
-
-//Select binding mode: UDP or TCP
-M2MInterface::BindingMode SOCKET_MODE = M2MInterface::UDP;
-
-// This is address to mbed Device Connector
-const String &MBED_SERVER_ADDRESS = "coap://api.connector.mbed.com:5684";
-
-// These come from the security.h file copied from connector.mbed.com
-const String &MBED_USER_NAME_DOMAIN = MBED_DOMAIN;
-const String &ENDPOINT_NAME = MBED_ENDPOINT_NAME;
-
-struct MbedClientDevice {
-    const char* Manufacturer;
-    const char* Type;
-    const char* ModelNumber;
-    const char* SerialNumber;
-};
+#include "knock-core/mbed_client.h"
 
 /*
-* Wrapper for mbed client stack that handles all callbacks, error handling, and
-* other schenanigans to make the mbed client stack easier to use.
-*
-* The end user should only have to care about configuring the parameters at the
-* top of this file and making sure they add the security.h file correctly.
-* To add resources you can copy the _TODO__ function and add as many instances as
-* you want.
-*
-*/
-class MbedClient: public M2MInterfaceObserver {
-public:
-
-    // constructor for MbedClient object, initialize private variables
-    MbedClient(struct MbedClientDevice device) {
-        _interface = NULL;
-        _bootstrapped = false;
-        _error = false;
-        _registered = false;
-        _unregistered = false;
-        _register_security = NULL;
-        _value = 0;
-        _object = NULL;
-        _device = device;
-    }
-
-    // de-constructor for MbedClient object, you can ignore this
-    ~MbedClient() {
-        if(_interface) {
-            delete _interface;
-        }
-        if(_register_security){
-            delete _register_security;
-        }
-    }
-
-    // debug printf function
-    void trace_printer(const char* str) {
-        printf("\r\n%s\r\n", str);
-    }
-
-    /*
-    *  Creates M2MInterface using which endpoint can
-    *  setup its name, resource type, life time, connection mode,
-    *  Currently only LwIPv4 is supported.
-    */
-    void create_interface() {
-	// Randomizing listening port for Certificate mode connectivity
-	srand(time(NULL));
-	uint16_t port = rand() % 65535 + 12345;
-
-    // create mDS interface object, this is the base object everything else attaches to
-    _interface = M2MInterfaceFactory::create_interface(*this,
-                                                      ENDPOINT_NAME,            // endpoint name string
-                                                      "knock-sensor",           // endpoint type string
-                                                      100,                      // lifetime
-                                                      port,                     // listen port
-                                                      MBED_USER_NAME_DOMAIN,    // domain string
-                                                      SOCKET_MODE,              // binding mode
-                                                      M2MInterface::LwIP_IPv4,  // network stack
-                                                      "");                      // context address string
-    }
-
-    /*
-    *  check private variable to see if the registration was sucessful or not
-    */
-    bool register_successful() {
-        return _registered;
-    }
-
-    /*
-    *  check private variable to see if un-registration was sucessful or not
-    */
-    bool unregister_successful() {
-        return _unregistered;
-    }
-
-    /*
-    *  Creates register server object with mbed device server address and other parameters
-    *  required for client to connect to mbed device server.
-    */
-    M2MSecurity* create_register_object() {
-        // create security object using the interface factory.
-        // this will generate a security ObjectID and ObjectInstance
-        M2MSecurity *security = M2MInterfaceFactory::create_security(M2MSecurity::M2MServer);
-
-        // make sure security ObjectID/ObjectInstance was created successfully
-        if(security) {
-            // Add ResourceID's and values to the security ObjectID/ObjectInstance
-            security->set_resource_value(M2MSecurity::M2MServerUri, MBED_SERVER_ADDRESS);
-            security->set_resource_value(M2MSecurity::SecurityMode, M2MSecurity::Certificate);
-            security->set_resource_value(M2MSecurity::ServerPublicKey, SERVER_CERT, sizeof(SERVER_CERT));
-            security->set_resource_value(M2MSecurity::PublicKey, CERT, sizeof(CERT));
-            security->set_resource_value(M2MSecurity::Secretkey, KEY, sizeof(KEY));
-        }
-        return security;
-    }
-
-    /*
-    * Creates device object which contains mandatory resources linked with
-    * device endpoint.
-    */
-    M2MDevice* create_device_object() {
-        // create device objectID/ObjectInstance
-        M2MDevice *device = M2MInterfaceFactory::create_device();
-        // make sure device object was created successfully
-        if(device) {
-            // add resourceID's to device objectID/ObjectInstance
-            device->create_resource(M2MDevice::Manufacturer, _device.Manufacturer);
-            device->create_resource(M2MDevice::DeviceType, _device.Type);
-            device->create_resource(M2MDevice::ModelNumber, _device.ModelNumber);
-            device->create_resource(M2MDevice::SerialNumber, _device.SerialNumber);
-        }
-        return device;
-    }
-
-    /*
-    * register an object
-    */
-    void test_register(M2MSecurity *register_object, M2MObjectList object_list){
-        if(_interface) {
-            // Register function
-            _interface->register_object(register_object, object_list);
-        }
-    }
-
-    /*
-    * unregister all objects
-    */
-    void test_unregister() {
-        if(_interface) {
-            // Unregister function
-            _interface->unregister_object(NULL); // NULL will unregister all objects
-        }
-    }
+ * mbed Device Connector over LwIP. The endpoint name and domain come from the
+ * security.h file copied from connector.mbed.com.
+ */
+struct EthernetTransport {
+    //Select binding mode: UDP or TCP
+    static const M2MInterface::BindingMode BINDING = M2MInterface::UDP;
+    static const M2MInterface::NetworkStack STACK = M2MInterface::LwIP_IPv4;
 
-    //Callback from mbed client stack when the bootstrap
-    // is successful, it returns the mbed Device Server object
-    // which will be used for registering the resources to
-    // mbed Device server.
-    void bootstrap_done(M2MSecurity *server_object){
-        if(server_object) {
-            _bootstrapped = true;
-            _error = false;
-            trace_printer("Bootstrapped");
-        }
+    // This is address to mbed Device Connector
+    static const char *server_uri() {
+        return "coap://api.connector.mbed.com:5684";
     }
 
-    //Callback from mbed client stack when the registration
-    // is successful, it returns the mbed Device Server object
-    // to which the resources are registered and registered objects.
-    void object_registered(M2MSecurity */*security_object*/, const M2MServer &/*server_object*/){
-        _registered = true;
-        _unregistered = false;
-        trace_printer("Registered object successfully!");
+    static const char *domain() {
+        return MBED_DOMAIN;
     }
 
-    //Callback from mbed client stack when the unregistration
-    // is successful, it returns the mbed Device Server object
-    // to which the resources were unregistered.
-    void object_unregistered(M2MSecurity */*server_object*/){
-        _unregistered = true;
-        _registered = false;
-        notify_completion(_unregistered);
-        minar::Scheduler::stop();
-        trace_printer("Unregistered Object Successfully");
+    static const char *endpoint_name() {
+        return MBED_ENDPOINT_NAME;
     }
 
-    /*
-    * Callback from mbed client stack when registration is updated
-    */
-    void registration_updated(M2MSecurity */*security_object*/, const M2MServer & /*server_object*/){
-        /* The registration is updated automatically and frequently by the
-        *  mbed client stack. This print statement is turned off because it
-        *  tends to happen alot.
-        */
-        //trace_printer("\r\nRegistration Updated\r\n");
+    static String endpoint_type() {
+        return "knock-sensor";
     }
 
-    // Callback from mbed client stack if any error is encountered
-    // during any of the LWM2M operations. Error type is passed in
-    // the callback.
-    void error(M2MInterface::Error error){
-        _error = true;
-        switch(error){
-            case M2MInterface::AlreadyExists:
-                trace_printer("[ERROR:] M2MInterface::AlreadyExist");
-                break;
-            case M2MInterface::BootstrapFailed:
-                trace_printer("[ERROR:] M2MInterface::BootstrapFailed");
-                break;
-            case M2MInterface::InvalidParameters:
-                trace_printer("[ERROR:] M2MInterface::InvalidParameters");
-                break;
-            case M2MInterface::NotRegistered:
-                trace_printer("[ERROR:] M2MInterface::NotRegistered");
-                break;
-            case M2MInterface::Timeout:
-                trace_printer("[ERROR:] M2MInterface::Timeout");
-                break;
-            case M2MInterface::NetworkError:
-                trace_printer("[ERROR:] M2MInterface::NetworkError");
-                break;
-            case M2MInterface::ResponseParseFailed:
-                trace_printer("[ERROR:] M2MInterface::ResponseParseFailed");
-                break;
-            case M2MInterface::UnknownError:
-                trace_printer("[ERROR:] M2MInterface::UnknownError");
-                break;
-            case M2MInterface::MemoryFail:
-                trace_printer("[ERROR:] M2MInterface::MemoryFail");
-                break;
-            case M2MInterface::NotAllowed:
-                trace_printer("[ERROR:] M2MInterface::NotAllowed");
-                break;
-            default:
-                break;
+    // FNV-1a of the endpoint name, it is unique per device
+    static uint32_t seed(const String &endpoint_name) {
+        uint32_t hash = 2166136261u;
+        const char *name = endpoint_name.c_str();
+        for (size_t i = 0; i < endpoint_name.size(); i++) {
+            hash = (hash ^ (uint8_t)name[i]) * 16777619u;
         }
+        return hash;
     }
 
-    /* Callback from mbed client stack if any value has changed
-    *  during PUT operation. Object and its type is passed in
-    *  the callback.
-    *  BaseType enum from m2mbase.h
-    *       Object = 0x0, Resource = 0x1, ObjectInstance = 0x2, ResourceInstance = 0x3
-    */
-    void value_updated(M2MBase *base, M2MBase::BaseType type) {
-        printf("\r\nPUT Request Received!");
-        printf("\r\nName :'%s', \r\nType : '%d' (0 for Object, 1 for Resource), \r\nType : '%s'\r\n",
-               base->name().c_str(),
-               type,
-               base->resource_type().c_str()
-               );
-    }
-
-    /*
-    * update the registration period
-    */
-    void test_update_register() {
-        if (_registered) {
-            _interface->update_registration(_register_security, 100);
-        }
+    static void set_credentials(M2MSecurity *security) {
+        security->set_resource_value(M2MSecurity::ServerPublicKey, SERVER_CERT, sizeof(SERVER_CERT));
+        security->set_resource_value(M2MSecurity::PublicKey, CERT, sizeof(CERT));
+        security->set_resource_value(M2MSecurity::Secretkey, KEY, sizeof(KEY));
     }
+};
 
-    /*
-    * manually configure the security object private variable
-    */
-   void set_register_object(M2MSecurity *register_object) {
-        if (_register_security == NULL) {
-            _register_security = register_object;
-        }
-    }
-
-private:
-
-    /*
-    *  Private variables used in class
-    */
-    M2MInterface    	     *_interface;
-    M2MSecurity              *_register_security;
-    M2MObject                *_object;
-    volatile bool            _bootstrapped;
-    volatile bool            _error;
-    volatile bool            _registered;
-    volatile bool            _unregistered;
-    int                      _value;
-    struct MbedClientDevice  _device;
+// Registration lifetime in seconds, short to keep NAT bindings open. The rest
+// of the policy is the default from MbedClientConfig.
+struct EthernetClientConfig : MbedClientConfig {
+    static const uint32_t LIFETIME = 100;
 };
 
+typedef MbedClientCore<EthernetTransport, EthernetClientConfig> MbedClient;
+
 #endif // __SIMPLECLIENT_H__
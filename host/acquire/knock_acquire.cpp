@@ -0,0 +1,513 @@
+/*
+ * Copyright (c) 2016 ARM Limited. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <deque>
+#include "knock-core/fxos8700cq_acquisition.h"
+#include "knock-core/fxos8700cq_fifo.h"
+
+/*
+ * Runs the asynchronous FXOS8700CQ acquisition against a mock of the sensor
+ * registers, next to the blocking FXOS8700CQFifo::drain() on the same
+ * sensor state, and checks:
+ *
+ *     match       for every FIFO fill, with and without a motion event, a
+ *                 round reads the same sources and samples as the blocking
+ *                 path and releases the motion interrupt
+ *     errors      a read that fails or does not start at any step ends the
+ *                 round, keeps the samples read before it, and the next
+ *                 round works
+ *     busy        no round starts while one runs or was not taken, and
+ *                 clear_motion() does not start during a round
+ *
+ * once with a bus that completes inside read_async(), like the host I2C,
+ * and once with one that completes later, like the I2C interrupt on the
+ * board. Then prints how long the CPU waits on the bus per interrupt with
+ * blocking reads, which the asynchronous reads leave to the DMA. Exits
+ * with 1 when a check fails.
+ */
+namespace {
+
+struct AcquireOptions {
+    uint8_t     watermark;
+    uint32_t    hz;             // I2C clock
+    bool        verbose;
+};
+
+AcquireOptions acquire_options;
+
+/*
+ * The registers of the FXOS8700CQ the acquisition reads: INT_SOURCE,
+ * F_STATUS with the FIFO behind OUT_X_MSB..OUT_Z_LSB, and the latched
+ * FF_MT_SRC. Samples are the 6 bytes the sensor sends.
+ */
+class MockSensor {
+public:
+    struct Raw {
+        uint8_t bytes[6];
+    };
+
+    MockSensor()
+        : _watermark(0), _overflow(false), _motion(false), _pointer(0), _byte(0), _next(1) {
+    }
+
+    void reset(uint8_t watermark, int samples, bool motion, bool overflow) {
+        _watermark = watermark;
+        _fifo.clear();
+        _next = 1;
+        for (int i = 0; i < samples; i++) {
+            Raw raw;
+            for (int b = 0; b < 6; b++) {
+                raw.bytes[b] = (uint8_t)(_next * 7 + b * 31);
+            }
+            _next++;
+            _fifo.push_back(raw);
+        }
+        _motion = motion;
+        _overflow = overflow;
+    }
+
+    bool motion() const {
+        return _motion;
+    }
+
+    void read(uint8_t reg, uint8_t *data, int length) {
+        _pointer = reg;
+        _byte = 0;
+        for (int i = 0; i < length; i++) {
+            data[i] = read_next();
+        }
+    }
+
+private:
+    enum {
+        REG_STATUS      = 0x00,
+        REG_OUT_X_MSB   = 0x01,
+        REG_OUT_Z_LSB   = 0x06,
+        REG_INT_SOURCE  = 0x0C,
+        REG_FF_MT_SRC   = 0x16
+    };
+
+    uint8_t read_next() {
+        uint8_t value = 0;
+        if (_pointer == REG_STATUS) {
+            value = (_overflow ? 0x80 : 0) | (uint8_t)_fifo.size();
+            _overflow = false;
+            _pointer = REG_OUT_X_MSB;
+            return value;
+        }
+        if (_pointer >= REG_OUT_X_MSB && _pointer <= REG_OUT_Z_LSB) {
+            // the burst wraps within the accelerometer block, a sample leaves
+            // the FIFO once all its bytes are read
+            value = _fifo.empty() ? 0 : _fifo.front().bytes[_byte];
+            if (++_byte == 6) {
+                _byte = 0;
+                if (!_fifo.empty()) {
+                    _fifo.pop_front();
+                }
+            }
+            _pointer = _pointer == REG_OUT_Z_LSB ? REG_OUT_X_MSB : _pointer + 1;
+            return value;
+        }
+        if (_pointer == REG_INT_SOURCE) {
+            value = (_watermark && _fifo.size() >= _watermark ? 0x40 : 0) | (_motion ? 0x04 : 0);
+        } else if (_pointer == REG_FF_MT_SRC) {
+            value = _motion ? 0x80 : 0;
+            _motion = false;
+        }
+        _pointer++;
+        return value;
+    }
+
+    std::deque<Raw> _fifo;
+    uint8_t         _watermark;
+    bool            _overflow;
+    bool            _motion;
+    uint8_t         _pointer;
+    int             _byte;          // into the sample at the front
+    uint32_t        _next;          // makes the samples of a fill differ
+};
+
+/*
+ * The Bus of both: blocking reads, and reads that complete inside
+ * read_async() or when complete() is called. Can fail the n-th
+ * asynchronous read, or refuse to start it.
+ */
+class MockBus {
+public:
+    explicit MockBus(MockSensor &sensor)
+        : _sensor(sensor), _deferred(false), _pending(false), _ok(false), _reads(0), _fail_at(0),
+          _refuse(false), _bytes(0) {
+    }
+
+    void set_deferred(bool deferred) {
+        _deferred = deferred;
+    }
+
+    // the n-th read_async() from now fails, 0 for none
+    void fail_at(uint32_t n, bool refuse) {
+        _reads = 0;
+        _fail_at = n;
+        _refuse = refuse;
+    }
+
+    bool read(uint8_t reg, uint8_t *data, int length) {
+        if (_pending) {
+            return false;
+        }
+        _sensor.read(reg, data, length);
+        // address and register, then address and data
+        _bytes += 2 + 1 + length;
+        return true;
+    }
+
+    bool write(uint8_t reg, uint8_t value) {
+        (void)reg;
+        (void)value;
+        return !_pending;
+    }
+
+    bool read_async(uint8_t reg, uint8_t *data, int length, const mbed::util::FunctionPointer1<void, bool> &done) {
+        if (_pending) {
+            return false;
+        }
+        bool fail = ++_reads == _fail_at;
+        if (fail && _refuse) {
+            return false;
+        }
+        if (!fail) {
+            _sensor.read(reg, data, length);
+        }
+        if (_deferred) {
+            _done = done;
+            _ok = !fail;
+            _pending = true;
+        } else {
+            done.call(!fail);
+        }
+        return true;
+    }
+
+    bool pending() const {
+        return _pending;
+    }
+
+    // the I2C interrupt of a deferred read
+    void complete() {
+        if (_pending) {
+            _pending = false;
+            mbed::util::FunctionPointer1<void, bool> done = _done;
+            done.call(_ok);
+        }
+    }
+
+    // bytes of the blocking reads so far, address bytes included
+    uint64_t bytes() const {
+        return _bytes;
+    }
+
+private:
+    MockSensor                                  &_sensor;
+    bool                                        _deferred;
+    bool                                        _pending;
+    bool                                        _ok;
+    mbed::util::FunctionPointer1<void, bool>    _done;
+    uint32_t                                    _reads;
+    uint32_t                                    _fail_at;
+    bool                                        _refuse;
+    uint64_t                                    _bytes;
+};
+
+typedef FXOS8700CQFifo<MockBus> Fifo;
+typedef FXOS8700CQAcquisition<MockBus> Acquisition;
+typedef SampleRing<AccelSample, 256> Ring;
+
+uint32_t rounds_done = 0;
+
+void round_done() {
+    rounds_done++;
+}
+
+// runs a started round to its end
+void finish(MockBus &bus) {
+    while (bus.pending()) {
+        bus.complete();
+    }
+}
+
+bool same(const Ring &a, const Ring &b) {
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < a.size(); i++) {
+        if (a.at(i).x != b.at(i).x || a.at(i).y != b.at(i).y || a.at(i).z != b.at(i).z) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool check_match(bool deferred) {
+    const char *mode = deferred ? "deferred" : "immediate";
+    MockSensor sensor;
+    MockBus bus(sensor);
+    bus.set_deferred(deferred);
+    Fifo fifo(bus);
+    Acquisition acquisition(bus);
+    fifo.configure(acquire_options.watermark, Fifo::ODR_400HZ);
+
+    uint32_t cases = 0;
+    for (int fill = 0; fill <= Fifo::CAPACITY; fill++) {
+        for (int motion = 0; motion < 2; motion++) {
+            // the blocking path, as service_interrupt() runs it
+            sensor.reset(acquire_options.watermark, fill, motion, fill == Fifo::CAPACITY);
+            Ring expected;
+            uint8_t expected_sources = 0;
+            fifo.read_sources(expected_sources);
+            if (expected_sources & Fifo::SRC_FIFO) {
+                fifo.drain(expected);
+            }
+
+            // the same sensor state through the acquisition
+            sensor.reset(acquire_options.watermark, fill, motion, fill == Fifo::CAPACITY);
+            Ring got;
+            uint32_t before = rounds_done;
+            if (!acquisition.start(acquire_options.watermark, mbed::util::FunctionPointer0<void>(round_done))) {
+                printf("match (%s): fill %d: round did not start\n", mode, fill);
+                return false;
+            }
+            finish(bus);
+            if (rounds_done != before + 1 || !acquisition.done()) {
+                printf("match (%s): fill %d: round did not finish once\n", mode, fill);
+                return false;
+            }
+            uint8_t sources = acquisition.sources();
+            int count = acquisition.take(got);
+            if (sources != expected_sources || acquisition.failed() || count != (int)got.size() ||
+                !same(got, expected)) {
+                printf("match (%s): fill %d, motion %d: sources 0x%02x and %zu samples, blocking 0x%02x "
+                       "and %zu samples\n", mode, fill, motion, sources, got.size(), expected_sources,
+                       expected.size());
+                return false;
+            }
+            if (sensor.motion()) {
+                printf("match (%s): fill %d: motion interrupt not released\n", mode, fill);
+                return false;
+            }
+            if (acquire_options.verbose) {
+                printf("match (%s): fill %d, motion %d: sources 0x%02x, %d samples\n", mode, fill, motion,
+                       sources, count);
+            }
+            cases++;
+        }
+    }
+    if (acquisition.overflows() != fifo.overflows() || acquisition.bursts() != fifo.bursts()) {
+        printf("match (%s): %u overflows in %u bursts, blocking %u in %u\n", mode, acquisition.overflows(),
+               acquisition.bursts(), fifo.overflows(), fifo.bursts());
+        return false;
+    }
+    printf("match (%s): %u cases, every fill with and without motion, same sources and samples as the "
+           "blocking drain\n", mode, cases);
+    return true;
+}
+
+bool check_errors(bool deferred) {
+    const char *mode = deferred ? "deferred" : "immediate";
+    MockSensor sensor;
+    MockBus bus(sensor);
+    bus.set_deferred(deferred);
+    Acquisition acquisition(bus);
+    uint8_t watermark = acquire_options.watermark;
+
+    // a full FIFO with motion takes all four reads
+    uint32_t cases = 0;
+    for (uint32_t step = 1; step <= 4; step++) {
+        for (int refuse = 0; refuse < 2; refuse++) {
+            sensor.reset(watermark, Fifo::CAPACITY, true, false);
+            bus.fail_at(step, refuse);
+            uint32_t errors = acquisition.errors();
+            bool started = acquisition.start(watermark, mbed::util::FunctionPointer0<void>(round_done));
+            finish(bus);
+            if (step == 1 && refuse) {
+                // the first read not starting means no round
+                if (started || acquisition.busy()) {
+                    printf("errors (%s): round started without its first read\n", mode);
+                    return false;
+                }
+            } else {
+                Ring ring;
+                int count = acquisition.take(ring);
+                // the burst is step 2, the rest of the FIFO step 3
+                int kept = step <= 2 ? 0 : step == 3 ? watermark : Fifo::CAPACITY;
+                if (!started || !acquisition.failed() || count != kept) {
+                    printf("errors (%s): read %u %s: %d samples kept, expected %d\n", mode, step,
+                           refuse ? "not started" : "failed", count, kept);
+                    return false;
+                }
+            }
+            if (acquisition.errors() != errors + 1) {
+                printf("errors (%s): read %u: error not counted\n", mode, step);
+                return false;
+            }
+
+            // and the next round goes through
+            bus.fail_at(0, false);
+            sensor.reset(watermark, watermark, false, false);
+            Ring ring;
+            if (!acquisition.start(watermark, mbed::util::FunctionPointer0<void>(round_done))) {
+                printf("errors (%s): no round after a failed read %u\n", mode, step);
+                return false;
+            }
+            finish(bus);
+            if (acquisition.take(ring) != watermark || acquisition.failed()) {
+                printf("errors (%s): round after a failed read %u is short\n", mode, step);
+                return false;
+            }
+            cases++;
+        }
+    }
+    printf("errors (%s): a failed or refused read at each of the %u steps ends the round, the next one works\n",
+           mode, cases / 2);
+    return true;
+}
+
+bool check_busy() {
+    MockSensor sensor;
+    MockBus bus(sensor);
+    bus.set_deferred(true);
+    Acquisition acquisition(bus);
+    uint8_t watermark = acquire_options.watermark;
+    mbed::util::FunctionPointer0<void> done(round_done);
+
+    sensor.reset(watermark, watermark, true, false);
+    if (!acquisition.start(watermark, done) || acquisition.start(watermark, done) ||
+        acquisition.clear_motion()) {
+        printf("busy: a second round or a clear started during a round\n");
+        return false;
+    }
+    finish(bus);
+    if (!acquisition.done() || acquisition.start(watermark, done)) {
+        printf("busy: a round started before the last one was taken\n");
+        return false;
+    }
+    Ring ring;
+    acquisition.take(ring);
+    if (acquisition.busy() || acquisition.take(ring) != -1) {
+        printf("busy: a round was taken twice\n");
+        return false;
+    }
+
+    // the motion only firmware clears from its interrupt handler
+    sensor.reset(0, 0, true, false);
+    if (!acquisition.clear_motion() || acquisition.clear_motion() || acquisition.start(0, done)) {
+        printf("busy: clears overlap\n");
+        return false;
+    }
+    finish(bus);
+    if (acquisition.busy() || sensor.motion()) {
+        printf("busy: clear_motion() did not release the motion interrupt\n");
+        return false;
+    }
+    printf("busy: no overlapping rounds or clears\n");
+    return true;
+}
+
+/*
+ * What a watermark interrupt costs the CPU on the bus with blocking reads:
+ * INT_SOURCE twice (the second finds nothing), the burst, and FF_MT_SRC
+ * for a motion interrupt
+ */
+void report_bus_time() {
+    MockSensor sensor;
+    MockBus bus(sensor);
+    Fifo fifo(bus);
+    uint8_t watermark = acquire_options.watermark;
+
+    fifo.configure(watermark, Fifo::ODR_400HZ);
+    sensor.reset(watermark, watermark, false, false);
+    uint8_t sources;
+    Ring ring;
+    uint64_t before = bus.bytes();
+    fifo.read_sources(sources);
+    fifo.drain(ring);
+    fifo.read_sources(sources);
+    uint64_t bytes = bus.bytes() - before;
+    double us = bytes * 9 * 1e6 / acquire_options.hz;
+    // FXOS8700CQ::clear_int() at the 100 kHz of the driver
+    double clear_us = 4 * 9 * 1e6 / 100000;
+    printf("bus: %u samples per watermark interrupt, %llu bytes, %.0f us the CPU waits at %u kHz with blocking "
+           "reads, 0 with DMA\n", watermark, (unsigned long long)bytes, us, acquire_options.hz / 1000);
+    printf("bus: clearing the motion interrupt in the handler blocks it for %.0f us, starting the DMA read "
+           "does not wait\n", clear_us);
+}
+
+void usage(const char *name) {
+    fprintf(stderr,
+            "usage: %s [options]\n"
+            "  -w, --watermark N     FIFO watermark (default 24)\n"
+            "      --hz N            I2C clock (default 400000)\n"
+            "  -v, --verbose         print every case\n",
+            name);
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    static const struct option long_options[] = {
+        { "watermark", required_argument, 0, 'w' },
+        { "hz", required_argument, 0, 'z' },
+        { "verbose", no_argument, 0, 'v' },
+        { "help", no_argument, 0, 'h' },
+        { 0, 0, 0, 0 }
+    };
+
+    acquire_options.watermark = 24;
+    acquire_options.hz = 400000;
+    acquire_options.verbose = false;
+
+    int c;
+    while ((c = getopt_long(argc, argv, "w:vh", long_options, NULL)) != -1) {
+        switch (c) {
+            case 'w':
+                acquire_options.watermark = strtoul(optarg, NULL, 10);
+                break;
+            case 'z':
+                acquire_options.hz = strtoul(optarg, NULL, 10);
+                break;
+            case 'v':
+                acquire_options.verbose = true;
+                break;
+            default:
+                usage(argv[0]);
+                return 2;
+        }
+    }
+    if (acquire_options.watermark == 0 || acquire_options.watermark >= Fifo::CAPACITY || acquire_options.hz == 0) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    bool passed = true;
+    for (int deferred = 0; deferred < 2; deferred++) {
+        passed = check_match(deferred) && passed;
+        passed = check_errors(deferred) && passed;
+    }
+    passed = check_busy() && passed;
+    report_bus_time();
+    return passed ? 0 : 1;
+}
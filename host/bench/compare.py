@@ -0,0 +1,81 @@
+#!/usr/bin/env python3
+"""
+Compares two knock-bench JSON results and fails when a benchmark got slower.
+
+    knock-bench --benchmark_repetitions=5 --benchmark_out=base.json
+    ... change the firmware ...
+    knock-bench --benchmark_repetitions=5 --benchmark_out=new.json
+    compare.py base.json new.json --threshold 0.10
+
+With repetitions the fastest run of each benchmark is compared, which is
+the least disturbed by other load on the machine; --statistic median
+compares the medians instead. Exits with 1 when any benchmark is slower than the baseline by
+more than the threshold, 0 otherwise.
+"""
+import argparse
+import json
+import sys
+
+
+def load(path, metric, statistic):
+    with open(path) as f:
+        data = json.load(f)
+
+    runs = {}
+    medians = {}
+    for b in data['benchmarks']:
+        if b.get('error_occurred'):
+            continue
+        name = b.get('run_name', b['name'])
+        if b.get('run_type') == 'aggregate':
+            if b.get('aggregate_name') == 'median':
+                medians[name] = b[metric]
+        else:
+            runs.setdefault(name, []).append(b[metric])
+    if statistic == 'median':
+        return dict((name, medians.get(name, min(times))) for name, times in runs.items())
+    return dict((name, min(times)) for name, times in runs.items())
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Compare two knock-bench results')
+    parser.add_argument('baseline')
+    parser.add_argument('contender')
+    parser.add_argument('--threshold', type=float, default=0.10,
+                        help='allowed slowdown, 0.10 = 10%% (default)')
+    parser.add_argument('--metric', default='cpu_time', choices=['cpu_time', 'real_time'])
+    parser.add_argument('--statistic', default='min', choices=['min', 'median'],
+                        help='which repetition to compare (default: the fastest)')
+    args = parser.parse_args()
+
+    baseline = load(args.baseline, args.metric, args.statistic)
+    contender = load(args.contender, args.metric, args.statistic)
+
+    regressions = 0
+    width = max([len(name) for name in baseline] + [len('benchmark')])
+    print('%-*s %12s %12s %8s' % (width, 'benchmark', 'baseline', 'contender', 'change'))
+    for name in baseline:
+        if name not in contender:
+            print('%-*s %12.1f %12s %8s' % (width, name, baseline[name], '-', 'gone'))
+            continue
+        old = baseline[name]
+        new = contender[name]
+        change = (new - old) / old if old else 0.0
+        flag = ''
+        if change > args.threshold:
+            flag = '  REGRESSION'
+            regressions += 1
+        print('%-*s %12.1f %12.1f %+7.1f%%%s' % (width, name, old, new, change * 100, flag))
+    for name in contender:
+        if name not in baseline:
+            print('%-*s %12s %12.1f %8s' % (width, name, '-', contender[name], 'new'))
+
+    if regressions:
+        print('%d benchmark(s) slower than the baseline by more than %.0f%%'
+              % (regressions, args.threshold * 100))
+        return 1
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
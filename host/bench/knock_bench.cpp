@@ -0,0 +1,384 @@
+/*
+ * Copyright (c) 2016 ARM Limited. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdlib.h>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <benchmark/benchmark.h>
+#include "coap.h"
+#include "file_flash.h"
+#include "knock-core/accel_event.h"
+#include "knock-core/int_format.h"
+#include "knock-core/knock_batch.h"
+#include "knock-core/knock_detector.h"
+#include "knock-core/knock_features.h"
+#include "knock-core/knock_journal.h"
+#include "knock-core/knock_pattern.h"
+#include "knock-core/notify_policy.h"
+#include "knock-core/perf_probe.h"
+#include "knock-core/spsc_ring.h"
+
+/*
+ * Benchmarks for the code on the knock event path in AccelerometerResource,
+ * from the interrupt handler to the notification payload. Times are host
+ * CPU time; compare runs on the same machine with compare.py.
+ *
+ * Knock rates are in knocks per minute, sample data is 400 Hz like the
+ * firmware FIFO mode.
+ */
+namespace {
+
+const uint32_t SAMPLE_RATE = 400;
+const uint32_t SAMPLE_PERIOD_US = 1000000 / SAMPLE_RATE;
+
+/*
+ * Ten seconds of a board lying flat with a little sensor noise, and a
+ * knock every 60 / `per_minute` s
+ */
+std::vector<AccelSample> make_samples(int per_minute) {
+    std::vector<AccelSample> samples(10 * SAMPLE_RATE);
+    static const int16_t KNOCK[] = { 3000, -2500, 1800, -1000, 500, -200 };
+    uint32_t seed = 1;
+    for (size_t i = 0; i < samples.size(); i++) {
+        seed = seed * 1103515245 + 12345;
+        samples[i].x = (int16_t)((seed >> 16) % 41) - 20;
+        samples[i].y = (int16_t)((seed >> 8) % 41) - 20;
+        samples[i].z = 4096 + (int16_t)(seed % 41) - 20;
+    }
+    if (per_minute > 0) {
+        size_t spacing = 60 * SAMPLE_RATE / per_minute;
+        for (size_t start = SAMPLE_RATE / 2; start < samples.size(); start += spacing) {
+            for (size_t k = 0; k < sizeof(KNOCK) / sizeof(KNOCK[0]) && start + k < samples.size(); k++) {
+                samples[start + k].z += KNOCK[k];
+            }
+        }
+    }
+    return samples;
+}
+
+/*
+ * interrupt() and drain_events(): `batch` edges are queued before the event
+ * loop gets to them
+ */
+void BM_IsrEnqueue(benchmark::State &state) {
+    const int batch = state.range(0);
+    SpscRing<AccelEvent, 16> events;
+    uint32_t timestamp = 0;
+    for (auto _ : state) {
+        for (int i = 0; i < batch; i++) {
+            AccelEvent event = { timestamp += SAMPLE_PERIOD_US, perf_ticks() };
+            events.push(event);
+        }
+        AccelEvent event;
+        while (events.pop(event)) {
+            benchmark::DoNotOptimize(event);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * batch);
+}
+BENCHMARK(BM_IsrEnqueue)->ArgName("batch")->Arg(1)->Arg(4)->Arg(15);
+
+/*
+ * Serializing last_knock (an RTC value) and knock_count for set_value()
+ */
+void BM_FormatValue(benchmark::State &state) {
+    uint32_t value = state.range(0);
+    char buffer[INT_FORMAT_SIZE];
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(value);
+        size_t length = format_uint(buffer, value);
+        benchmark::DoNotOptimize(length);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_FormatValue)->ArgName("value")->Arg(7)->Arg(1234)->Arg(1466000000);
+
+/*
+ * The same with the stringstream and std::string the firmware used before,
+ * as the baseline for BM_FormatValue
+ */
+void BM_FormatValueStringstream(benchmark::State &state) {
+    uint32_t value = state.range(0);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(value);
+        std::stringstream ss;
+        ss << value;
+        std::string stringified = ss.str();
+        benchmark::DoNotOptimize(stringified.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_FormatValueStringstream)->ArgName("value")->Arg(7)->Arg(1234)->Arg(1466000000);
+
+/*
+ * Resource update decision: knocks arrive at `knocks_per_minute` and each
+ * updates a value that goes through the 6LoWPAN client's notify policy
+ */
+void BM_ResourceUpdate(benchmark::State &state) {
+    const uint32_t interval_ms = 60000 / state.range(0);
+    NotifyPolicy policy(NotifyPolicyConfig(1000, 60000, 0, state.range(1), 2000));
+    uint32_t now = 0;
+    int32_t value = 0;
+    uint64_t sent = 0;
+    for (auto _ : state) {
+        now += interval_ms;
+        value++;
+        if (policy.offer(now, true, value) == 0) {
+            policy.sent(now, true, value);
+            sent++;
+        } else {
+            policy.superseded();
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.counters["sent_ratio"] = state.iterations() ? (double)sent / state.iterations() : 0;
+}
+BENCHMARK(BM_ResourceUpdate)->ArgNames({ "knocks_per_minute", "burst" })
+    ->ArgsProduct({ { 6, 60, 600 }, { 0, 5 } });
+
+/*
+ * Size of the confirmable CoAP notification carrying `payload`, with a
+ * token of 4 bytes like the ones of Device Connector. UDP and IP headers
+ * come on top.
+ */
+size_t notification_size(const uint8_t *payload, size_t length, bool opaque) {
+    host::coap::Message message;
+    message.code = host::coap::CONTENT;
+    message.id = 0x1234;
+    message.token = "\x01\x02\x03\x04";
+    message.add_uint_option(host::coap::OBSERVE, 0x1234);
+    message.add_uint_option(host::coap::CONTENT_FORMAT, opaque ? host::coap::OCTET_STREAM : host::coap::TEXT_PLAIN);
+    message.payload.assign((const char *)payload, length);
+    return host::coap::encode(message).size();
+}
+
+/*
+ * Notification encoding: `batch` knocks packed into the
+ * /accelerometer/0/knocks payload. Reports the CoAP bytes per knock next to
+ * those of one last_knock notification per knock, the ASCII RTC value the
+ * firmware sent before knocks were batched.
+ */
+void BM_NotificationEncode(benchmark::State &state) {
+    const int batch = state.range(0);
+    const uint32_t interval_us = 60000000 / state.range(1);
+    KnockBatch<32> knocks;
+    uint64_t timestamp = 0;
+    size_t bytes = 0;
+    for (auto _ : state) {
+        knocks.clear();
+        for (int i = 0; i < batch; i++) {
+            timestamp += interval_us;
+            knocks.add(timestamp, 1466000000000000ULL + timestamp, 3400, 2);
+        }
+        benchmark::DoNotOptimize(knocks.data());
+        bytes = knocks.length();
+    }
+    state.SetItemsProcessed(state.iterations() * batch);
+
+    char rtc[INT_FORMAT_SIZE];
+    size_t unbatched = notification_size((const uint8_t *)rtc, format_uint(rtc, 1466000000), false);
+    double per_knock = (double)notification_size(knocks.data(), bytes, true) / batch;
+    state.counters["payload"] = bytes;
+    state.counters["bytes_per_knock"] = per_knock;
+    state.counters["unbatched"] = unbatched;
+    if (batch >= 8 && per_knock >= unbatched) {
+        state.SkipWithError("a batch takes more bytes per knock than single notifications");
+    }
+}
+BENCHMARK(BM_NotificationEncode)->ArgNames({ "batch", "knocks_per_minute" })
+    ->ArgsProduct({ { 1, 8, 32 }, { 60, 600 } });
+
+/*
+ * Knock detector cost per sample, fed in FIFO watermark batches
+ */
+void BM_DetectorPerSample(benchmark::State &state) {
+    const std::vector<AccelSample> samples = make_samples(state.range(0));
+    const size_t batch = state.range(1);
+    KnockDetector detector;
+    KnockOnset knock;
+    size_t position = 0;
+    uint64_t knocks = 0;
+    for (auto _ : state) {
+        for (size_t i = 0; i < batch; i++) {
+            if (detector.process(samples[position], knock)) {
+                knocks++;
+            }
+            if (++position == samples.size()) {
+                position = 0;
+            }
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * batch);
+    state.counters["knocks_per_minute_seen"] =
+        (double)knocks * 60 * SAMPLE_RATE / (state.iterations() * batch);
+}
+BENCHMARK(BM_DetectorPerSample)->ArgNames({ "knocks_per_minute", "batch" })
+    ->ArgsProduct({ { 0, 60, 600 }, { 1, 24 } });
+
+/*
+ * Pattern matching against `templates` templates: a sequence of `knocks`
+ * knocks, then the poll that closes it. Every template has as many knocks
+ * as the sequence, so all of them are scored, and the sequence plays the
+ * rhythm of the last one.
+ */
+void BM_PatternMatch(benchmark::State &state) {
+    const int templates = state.range(0);
+    const int knocks = state.range(1);
+    KnockPatternMatcher<8, 256> patterns(1500000, 8192);
+    uint16_t intervals[256][7];
+    uint32_t seed = 3;
+    for (int t = 0; t < templates; t++) {
+        for (int i = 0; i < knocks - 1; i++) {
+            seed = seed * 1103515245 + 12345;
+            intervals[t][i] = 1 + (seed >> 16) % 4;
+        }
+        patterns.add_template(intervals[t], knocks - 1);
+    }
+    const uint16_t *rhythm = intervals[templates - 1];
+    uint32_t now = 0;
+    benchmark::IterationCount matched = 0;
+    PatternMatch match;
+    for (auto _ : state) {
+        patterns.knock(now);
+        for (int i = 0; i < knocks - 1; i++) {
+            now += rhythm[i] * 125000;
+            patterns.knock(now);
+        }
+        now += 2000000;
+        bool polled = patterns.poll(now, match);
+        benchmark::DoNotOptimize(polled);
+        if (polled && match.score == 0) {
+            matched++;
+        }
+    }
+    if (matched != state.iterations()) {
+        state.SkipWithError("the sequence did not match its template");
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.counters["templates_per_second"] = benchmark::Counter(
+        (double)state.iterations() * templates, benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_PatternMatch)->ArgNames({ "templates", "knocks" })
+    ->ArgsProduct({ { 1, 16, 256 }, { 3, 7 } });
+
+/*
+ * Knock features over one window, per backend, on knock samples followed by
+ * full scale noise. knock-features checks that the backends agree.
+ */
+template <typename Kernels>
+void BM_KnockFeatures(benchmark::State &state) {
+    if (!Kernels::supported()) {
+        state.SkipWithError("not supported by this CPU");
+        return;
+    }
+    typedef KnockFeatureExtractor<Kernels> Extractor;
+    std::vector<AccelSample> samples = make_samples(state.range(0));
+    uint32_t seed = 7;
+    for (size_t i = 0; i < 4 * Extractor::WINDOW; i++) {
+        AccelSample sample;
+        seed = seed * 1103515245 + 12345;
+        sample.x = (int16_t)((seed >> 2) & 0x3fff) - 8192;
+        sample.y = (int16_t)((seed >> 9) & 0x3fff) - 8192;
+        sample.z = (int16_t)((seed >> 16) & 0x3fff) - 8192;
+        samples.push_back(sample);
+    }
+
+    Extractor extractor;
+    size_t first = 0;
+    KnockFeatures features;
+    for (auto _ : state) {
+        extractor.extract(samples, first, features);
+        benchmark::DoNotOptimize(features);
+        first = (first + 7) % (samples.size() - Extractor::WINDOW);
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.SetLabel(Kernels::name());
+}
+BENCHMARK_TEMPLATE(BM_KnockFeatures, KnockFeatureScalar)->ArgName("knocks_per_minute")->Arg(600);
+#ifdef KNOCK_FEATURES_X86
+BENCHMARK_TEMPLATE(BM_KnockFeatures, KnockFeatureSse2)->ArgName("knocks_per_minute")->Arg(600);
+BENCHMARK_TEMPLATE(BM_KnockFeatures, KnockFeatureAvx2)->ArgName("knocks_per_minute")->Arg(600);
+#endif
+
+/*
+ * Journaling a knock while offline, into 16 sectors of K64F geometry in a
+ * temporary file, so the time is mostly the file I/O of the host. The ring
+ * fills up and wraps. Counts the bytes programmed per byte of knock record
+ * and the sector erases per knock.
+ */
+void BM_JournalAppend(benchmark::State &state) {
+    host::FileFlash flash(16 * 4096, 4096, 8);
+    KnockJournal<host::FileFlash> journal(flash);
+    if (!flash.open(NULL) || !journal.mount()) {
+        state.SkipWithError("can not mount the journal");
+        return;
+    }
+    uint64_t timestamp = 0;
+    for (auto _ : state) {
+        timestamp += SAMPLE_PERIOD_US;
+        benchmark::DoNotOptimize(journal.append(timestamp, 1466000000000000ULL + timestamp, 3400, 2));
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.counters["write_amplification"] = state.iterations() ?
+        (double)flash.programmed() / (state.iterations() * KnockJournal<host::FileFlash>::SLOT_SIZE) : 0;
+    state.counters["erases_per_knock"] = state.iterations() ? (double)flash.erases() / state.iterations() : 0;
+}
+BENCHMARK(BM_JournalAppend);
+
+/*
+ * Forwarding the journal after an outage: peek() and forwarded() for
+ * `batch` knocks at a time, like drain_journal(). A full journal is
+ * appended again, untimed, whenever it runs empty.
+ */
+void BM_JournalReplay(benchmark::State &state) {
+    const int batch = state.range(0);
+    host::FileFlash flash(16 * 4096, 4096, 8);
+    KnockJournal<host::FileFlash> journal(flash);
+    if (!flash.open(NULL) || !journal.mount()) {
+        state.SkipWithError("can not mount the journal");
+        return;
+    }
+    std::vector<JournalKnock> knocks(batch);
+    uint64_t timestamp = 0;
+    uint64_t forwarded = 0;
+    uint64_t appended = 0;     // bytes programmed by the untimed appends
+    for (auto _ : state) {
+        if (journal.pending() == 0) {
+            state.PauseTiming();
+            uint64_t before = flash.programmed();
+            while (journal.pending() < journal.capacity()) {
+                timestamp += SAMPLE_PERIOD_US;
+                journal.append(timestamp, 1466000000000000ULL + timestamp, 3400, 2);
+            }
+            appended += flash.programmed() - before;
+            state.ResumeTiming();
+        }
+        size_t count = journal.peek(&knocks[0], batch);
+        journal.forwarded(knocks[count - 1].sequence);
+        forwarded += count;
+    }
+    state.SetItemsProcessed(forwarded);
+    state.counters["bytes_per_batch"] = state.iterations() ?
+        (double)(flash.programmed() - appended) / state.iterations() : 0;
+}
+BENCHMARK(BM_JournalReplay)->ArgName("batch")->Arg(1)->Arg(8);
+
+} // namespace
+
+BENCHMARK_MAIN();
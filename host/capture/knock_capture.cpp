@@ -0,0 +1,258 @@
+/*
+ * Copyright (c) 2016 ARM Limited. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include "trace_file.h"
+#include "knock-core/knock_detector.h"
+#include "knock-core/sample_ring.h"
+#include "knock-core/waveform_capture.h"
+
+/*
+ * Replays traces through the waveform capture the way the firmware runs it:
+ * FIFO bursts into the sample ring, then per sample the capture and the
+ * detector. Every snapshot is decoded and compared with the trace sample
+ * for sample, and the capture has to fit the RAM budget. Exits with 1 when
+ * either check fails.
+ *
+ * Besides the traces it runs a synthetic worst case for the delta encoding,
+ * where the snapshot is cut short and only what it holds is compared.
+ */
+namespace {
+
+// as in both main.cpp
+typedef WaveformCapture<100, 100> Capture;
+typedef SampleRing<AccelSample, 256> Ring;
+
+struct CaptureOptions {
+    size_t      watermark;      // samples per FIFO burst
+    size_t      ram_budget;     // bytes
+    bool        verbose;
+};
+
+CaptureOptions capture_options;
+
+struct Totals {
+    uint32_t    knocks;
+    uint32_t    snapshots;
+    uint32_t    uncovered;      // knocks neither captured nor inside a capture
+    uint32_t    mismatches;     // snapshots that differ from the trace
+    uint32_t    truncated;
+    uint64_t    bytes;
+    size_t      largest;
+    uint64_t    samples;        // in the snapshots
+};
+
+/*
+ * Decodes the snapshot of the knock at `onset` and compares it with
+ * `samples`. Returns false on the first difference.
+ */
+bool verify(const Capture &capture, const std::vector<AccelSample> &samples, size_t onset, uint32_t period,
+            Totals &totals) {
+    WaveformReader reader(capture.snapshot(), capture.snapshot_length());
+    if (!reader.valid() || reader.sequence() != capture.sequence() || reader.period() != period ||
+        reader.timestamp() != onset * period || reader.pre() > onset) {
+        printf("snapshot %u: bad header\n", (unsigned)capture.sequence());
+        return false;
+    }
+    size_t first = onset - reader.pre();
+    size_t index = 0;
+    AccelSample sample;
+    while (reader.next(sample)) {
+        const AccelSample &expected = samples[first + index];
+        if (sample.x != expected.x || sample.y != expected.y || sample.z != expected.z) {
+            printf("snapshot %u: sample %zu is %d %d %d, the trace has %d %d %d\n",
+                   (unsigned)capture.sequence(), index, sample.x, sample.y, sample.z,
+                   expected.x, expected.y, expected.z);
+            return false;
+        }
+        index++;
+    }
+    if (index != reader.count()) {
+        printf("snapshot %u: %zu of %u samples decoded\n", (unsigned)capture.sequence(), index,
+               (unsigned)reader.count());
+        return false;
+    }
+
+    totals.samples += index;
+    totals.bytes += capture.snapshot_length();
+    if (capture.snapshot_length() > totals.largest) {
+        totals.largest = capture.snapshot_length();
+    }
+    if (capture_options.verbose) {
+        printf("snapshot %u: knock at %.3f s, %u + %u samples in %zu bytes\n", (unsigned)capture.sequence(),
+               onset * period / 1e6, (unsigned)reader.pre(), (unsigned)(reader.count() - reader.pre()),
+               capture.snapshot_length());
+    }
+    return true;
+}
+
+void replay(const std::vector<AccelSample> &samples, uint32_t period, Totals &totals) {
+    Ring ring;
+    KnockDetector detector;
+    KnockOnset knock;
+    Capture capture(period, host::TRACE_COUNTS_PER_G);
+    uint32_t sequence = 0;
+    size_t onset = 0;           // of the running capture, as a trace index
+
+    for (size_t position = 0; position < samples.size(); position += capture_options.watermark) {
+        size_t count = samples.size() - position;
+        if (count > capture_options.watermark) {
+            count = capture_options.watermark;
+        }
+        for (size_t i = 0; i < count; i++) {
+            ring.push(samples[position + i]);
+        }
+
+        for (size_t i = ring.size() - count; i < ring.size(); i++) {
+            capture.add(ring.at(i));
+            if (detector.process(ring.at(i), knock)) {
+                totals.knocks++;
+                size_t age = detector.samples() - 1 - knock.sample;
+                if (!capture.capturing()) {
+                    if (age <= i && capture.trigger(ring, i - age, i, knock.sample * period, 0)) {
+                        onset = knock.sample;
+                    } else {
+                        totals.uncovered++;
+                    }
+                }
+            }
+            if (capture.sequence() != sequence) {
+                sequence = capture.sequence();
+                totals.snapshots++;
+                if (!verify(capture, samples, onset, period, totals)) {
+                    totals.mismatches++;
+                }
+            }
+        }
+    }
+    totals.truncated += capture.truncated();
+}
+
+void report(const char *name, const Totals &totals) {
+    printf("%s: %u knocks, %u snapshots, %u knocks not captured, %u truncated, %u mismatches",
+           name, (unsigned)totals.knocks, (unsigned)totals.snapshots, (unsigned)totals.uncovered,
+           (unsigned)totals.truncated, (unsigned)totals.mismatches);
+    if (totals.snapshots) {
+        printf(", %.0f bytes on average (%.2f per sample, raw 6), at most %zu",
+               (double)totals.bytes / totals.snapshots, (double)totals.bytes / totals.samples, totals.largest);
+    }
+    printf("\n");
+}
+
+/*
+ * A short knock between two long runs of full scale swings on every axis,
+ * which the detector takes for slams. Every swing is a 3 byte delta per
+ * axis, so the window around the knock does not fit its slot.
+ */
+std::vector<AccelSample> full_scale() {
+    static const struct {
+        size_t  samples;
+        bool    swing;
+    } parts[] = {
+        { 400, false }, { 200, true }, { 60, false }, { 8, true }, { 20, false }, { 200, true }, { 400, false }
+    };
+    std::vector<AccelSample> samples;
+    for (size_t p = 0; p < sizeof(parts) / sizeof(parts[0]); p++) {
+        for (size_t i = 0; i < parts[p].samples; i++) {
+            AccelSample sample = { 0, 0, 4096 };
+            if (parts[p].swing) {
+                int16_t value = i % 2 ? 8191 : -8192;
+                sample.x = sample.y = sample.z = value;
+            }
+            samples.push_back(sample);
+        }
+    }
+    return samples;
+}
+
+void usage(const char *name) {
+    fprintf(stderr,
+            "usage: %s [options] [TRACE...]\n"
+            "  -w, --watermark N     samples per FIFO burst (default 24)\n"
+            "      --ram-budget B    bytes the capture may take (default 4096)\n"
+            "  -v, --verbose         print every snapshot\n",
+            name);
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    static const struct option long_options[] = {
+        { "watermark", required_argument, 0, 'w' },
+        { "ram-budget", required_argument, 0, 'B' },
+        { "verbose", no_argument, 0, 'v' },
+        { "help", no_argument, 0, 'h' },
+        { 0, 0, 0, 0 }
+    };
+
+    capture_options.watermark = 24;
+    capture_options.ram_budget = 4096;
+    capture_options.verbose = false;
+
+    int c;
+    while ((c = getopt_long(argc, argv, "w:vh", long_options, NULL)) != -1) {
+        switch (c) {
+            case 'w':
+                capture_options.watermark = strtoul(optarg, NULL, 10);
+                break;
+            case 'B':
+                capture_options.ram_budget = strtoul(optarg, NULL, 10);
+                break;
+            case 'v':
+                capture_options.verbose = true;
+                break;
+            default:
+                usage(argv[0]);
+                return 2;
+        }
+    }
+    if (capture_options.watermark == 0 || capture_options.watermark >= Ring::capacity()) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    bool failed = false;
+    for (int i = optind; i < argc; i++) {
+        host::Trace trace;
+        if (!host::load_trace(argv[i], trace)) {
+            return 1;
+        }
+        Totals totals = Totals();
+        replay(trace.samples, trace.period, totals);
+        report(argv[i], totals);
+        failed |= totals.mismatches > 0 || totals.uncovered > 0;
+    }
+
+    Totals totals = Totals();
+    replay(full_scale(), host::TEXT_TRACE_PERIOD_US, totals);
+    report("full scale swings", totals);
+    failed |= totals.mismatches > 0 || totals.truncated == 0;
+
+    printf("capture: %zu bytes of RAM with slots of %u bytes, budget %zu\n", sizeof(Capture),
+           (unsigned)Capture::SLOT_SIZE, capture_options.ram_budget);
+    if (sizeof(Capture) > capture_options.ram_budget) {
+        printf("capture: FAILED, over the RAM budget\n");
+        failed = true;
+    } else if (failed) {
+        printf("capture: FAILED\n");
+    } else {
+        printf("capture: all snapshots match\n");
+    }
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,309 @@
+/*
+ * Copyright (c) 2016 ARM Limited. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <random>
+#include <vector>
+#include "knock-core/clock_sync.h"
+
+/*
+ * Runs the clock alignment of /time/0 against a simulated server: a device
+ * crystal off by --drift, which changes by --step half way through, and a
+ * network with a fixed delay, exponentially distributed queueing on top in
+ * each direction, and lost datagrams that come again after a CoAP
+ * retransmission. Pings go out like ClockSyncResource sends them.
+ *
+ * Every second of the run the estimated server time of the device clock is
+ * compared with the true one. The same exchanges also go to an estimator
+ * that takes the latest exchange as it is, for comparison. Exits with 1
+ * when the 99th percentile of the error is over --max-error.
+ */
+namespace {
+
+struct ClockOptions {
+    double      hours;
+    double      drift_ppm;
+    double      step_ppm;       // drift change half way through
+    double      delay_ms;       // one way, fixed
+    double      jitter_ms;      // one way, mean of the queueing on top
+    double      loss;           // per datagram
+    uint32_t    period_s;
+    uint32_t    burst;
+    uint32_t    max_error_us;   // 99th percentile of the filtered estimate
+    uint32_t    seed;
+    bool        verbose;
+};
+
+ClockOptions clock_options;
+
+// as in ClockSyncResource and host/source/coap.h
+const uint64_t BURST_SPACING_US = 2000000;
+const uint64_t FIRST_RETRY_US = 15000000;
+const uint64_t RETRANSMIT_US = 2500000;
+const uint64_t SERVER_TIME_US = 200;
+
+// the server clock, us since the epoch at the start
+const uint64_t SERVER_EPOCH_US = 1466000000000000ULL;
+
+std::mt19937 random_engine;
+
+/*
+ * The device crystal, true time in, local time out. Runs at 1 + drift
+ * until half way, then at 1 + drift + step.
+ */
+uint64_t local_us(uint64_t t) {
+    uint64_t half = (uint64_t)(clock_options.hours * 1800e6);
+    double first = 1 + clock_options.drift_ppm * 1e-6;
+    if (t < half) {
+        return (uint64_t)(t * first);
+    }
+    double second = first + clock_options.step_ppm * 1e-6;
+    return (uint64_t)(half * first + (t - half) * second);
+}
+
+uint64_t server_us(uint64_t t) {
+    return SERVER_EPOCH_US + t;
+}
+
+// one way through the network, a lost datagram comes again after a retransmission
+uint64_t one_way_us() {
+    std::exponential_distribution<double> queueing(1.0 / (clock_options.jitter_ms * 1000));
+    std::uniform_real_distribution<double> uniform(0, 1);
+    uint64_t delay = (uint64_t)(clock_options.delay_ms * 1000 + queueing(random_engine));
+    if (uniform(random_engine) < clock_options.loss) {
+        delay += RETRANSMIT_US;
+    }
+    return delay;
+}
+
+struct Errors {
+    std::vector<uint64_t>   magnitudes;     // |estimated - true|, us
+    uint64_t                outside;        // more than the uncertainty off
+};
+
+template <size_t Window>
+void measure(const ClockSync<Window> &sync, uint64_t t, Errors &errors) {
+    if (!sync.synced()) {
+        return;
+    }
+    uint64_t local = local_us(t);
+    int64_t error = (int64_t)(sync.server_us(local) - server_us(t));
+    uint64_t magnitude = error < 0 ? -error : error;
+    errors.magnitudes.push_back(magnitude);
+    if (magnitude > sync.uncertainty_us(local)) {
+        errors.outside++;
+    }
+}
+
+uint64_t percentile(const std::vector<uint64_t> &sorted, double p) {
+    if (sorted.empty()) {
+        return 0;
+    }
+    size_t index = (size_t)(p * (sorted.size() - 1) + 0.5);
+    return sorted[index];
+}
+
+template <size_t Window>
+uint64_t report(const char *name, const ClockSync<Window> &sync, Errors &errors) {
+    std::sort(errors.magnitudes.begin(), errors.magnitudes.end());
+    uint64_t p99 = percentile(errors.magnitudes, 0.99);
+    printf("%s: error p50 %llu us, p99 %llu us, max %llu us, %.1f%% outside the uncertainty, drift %.1f ppm\n",
+           name, (unsigned long long)percentile(errors.magnitudes, 0.5), (unsigned long long)p99,
+           (unsigned long long)percentile(errors.magnitudes, 1.0),
+           errors.magnitudes.empty() ? 0.0 : 100.0 * errors.outside / errors.magnitudes.size(),
+           -sync.skew_ppb() / 1000.0);
+    return p99;
+}
+
+int simulate() {
+    ClockSync<8> filtered;
+    ClockSync<1> latest;
+    Errors filtered_errors = Errors();
+    Errors latest_errors = Errors();
+
+    const uint64_t end = (uint64_t)(clock_options.hours * 3600e6);
+    uint64_t next_ping = FIRST_RETRY_US;
+    uint64_t next_measure = 1000000;
+    uint64_t retry = FIRST_RETRY_US;
+    uint32_t pings_left = clock_options.burst;
+    uint32_t pings = 0, exchanges = 0, late = 0;
+
+    // the one ping out, and when its pong comes back
+    bool outstanding = false;
+    uint64_t t1 = 0, t2 = 0, t3 = 0, arrival = 0;
+
+    while (next_measure < end) {
+        if (outstanding && arrival <= next_ping && arrival <= next_measure) {
+            outstanding = false;
+            uint64_t t4 = local_us(arrival);
+            filtered.add(t1, t2, t3, t4);
+            latest.add(t1, t2, t3, t4);
+            exchanges++;
+            if (clock_options.verbose) {
+                printf("%.3f s: rtt %llu us, offset %lld us\n", arrival / 1e6,
+                       (unsigned long long)((t4 - t1) - (t3 - t2)),
+                       (long long)((int64_t)(t2 - t1) + (int64_t)(t3 - t4)) / 2);
+            }
+        } else if (next_ping <= next_measure) {
+            uint64_t t = next_ping;
+            if (outstanding) {
+                // the answer to the one before comes too late
+                late++;
+            }
+            uint64_t received = t + one_way_us();
+            t1 = local_us(t);
+            t2 = server_us(received);
+            t3 = t2 + SERVER_TIME_US;
+            arrival = received + SERVER_TIME_US + one_way_us();
+            outstanding = true;
+            pings++;
+
+            if (--pings_left) {
+                next_ping = t + BURST_SPACING_US;
+            } else {
+                pings_left = clock_options.burst;
+                if (filtered.synced()) {
+                    next_ping = t + clock_options.period_s * 1000000ULL;
+                } else {
+                    next_ping = t + retry;
+                    retry = std::min<uint64_t>(retry * 2, clock_options.period_s * 1000000ULL);
+                }
+            }
+        } else {
+            measure(filtered, next_measure, filtered_errors);
+            measure(latest, next_measure, latest_errors);
+            next_measure += 1000000;
+        }
+    }
+
+    printf("clock: %.1f h, drift %.1f ppm then %.1f ppm, one way %.1f ms + %.1f ms queueing on average, "
+           "%.1f%% loss\n", clock_options.hours, clock_options.drift_ppm,
+           clock_options.drift_ppm + clock_options.step_ppm, clock_options.delay_ms, clock_options.jitter_ms,
+           clock_options.loss * 100);
+    printf("clock: %u pings in bursts of %u every %u s, %u exchanges, %u answered too late\n", pings,
+           clock_options.burst, clock_options.period_s, exchanges, late);
+    uint64_t p99 = report("min-RTT filter", filtered, filtered_errors);
+    report("latest exchange", latest, latest_errors);
+
+    if (filtered_errors.magnitudes.empty() || p99 > clock_options.max_error_us) {
+        printf("clock: FAILED, the 99th percentile is over %u us\n", clock_options.max_error_us);
+        return 1;
+    }
+    printf("clock: 99th percentile within %u us\n", clock_options.max_error_us);
+    return 0;
+}
+
+void usage(const char *name) {
+    fprintf(stderr,
+            "usage: %s [options]\n"
+            "  -d, --hours H         how long to simulate (default 24)\n"
+            "      --drift PPM       device clock faster than the server's (default 40)\n"
+            "      --step PPM        drift change half way through (default -10)\n"
+            "      --delay MS        one way delay (default 15)\n"
+            "      --jitter MS       mean queueing on top, each way (default 10)\n"
+            "      --loss PERCENT    lost datagrams (default 2)\n"
+            "      --period S        between bursts of pings (default 300)\n"
+            "      --burst N         pings per burst (default 4)\n"
+            "      --max-error US    99th percentile to pass (default 12000)\n"
+            "      --seed N          random seed (default 1)\n"
+            "  -v, --verbose         print every exchange\n",
+            name);
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    static const struct option long_options[] = {
+        { "hours", required_argument, 0, 'd' },
+        { "drift", required_argument, 0, 'D' },
+        { "step", required_argument, 0, 'S' },
+        { "delay", required_argument, 0, 'L' },
+        { "jitter", required_argument, 0, 'J' },
+        { "loss", required_argument, 0, 'l' },
+        { "period", required_argument, 0, 'p' },
+        { "burst", required_argument, 0, 'b' },
+        { "max-error", required_argument, 0, 'm' },
+        { "seed", required_argument, 0, 's' },
+        { "verbose", no_argument, 0, 'v' },
+        { "help", no_argument, 0, 'h' },
+        { 0, 0, 0, 0 }
+    };
+
+    clock_options.hours = 24;
+    clock_options.drift_ppm = 40;
+    clock_options.step_ppm = -10;
+    clock_options.delay_ms = 15;
+    clock_options.jitter_ms = 10;
+    clock_options.loss = 0.02;
+    clock_options.period_s = 300;
+    clock_options.burst = 4;
+    clock_options.max_error_us = 12000;
+    clock_options.seed = 1;
+    clock_options.verbose = false;
+
+    int c;
+    while ((c = getopt_long(argc, argv, "d:vh", long_options, NULL)) != -1) {
+        switch (c) {
+            case 'd':
+                clock_options.hours = strtod(optarg, NULL);
+                break;
+            case 'D':
+                clock_options.drift_ppm = strtod(optarg, NULL);
+                break;
+            case 'S':
+                clock_options.step_ppm = strtod(optarg, NULL);
+                break;
+            case 'L':
+                clock_options.delay_ms = strtod(optarg, NULL);
+                break;
+            case 'J':
+                clock_options.jitter_ms = strtod(optarg, NULL);
+                break;
+            case 'l':
+                clock_options.loss = strtod(optarg, NULL) / 100;
+                break;
+            case 'p':
+                clock_options.period_s = strtoul(optarg, NULL, 10);
+                break;
+            case 'b':
+                clock_options.burst = strtoul(optarg, NULL, 10);
+                break;
+            case 'm':
+                clock_options.max_error_us = strtoul(optarg, NULL, 10);
+                break;
+            case 's':
+                clock_options.seed = strtoul(optarg, NULL, 10);
+                break;
+            case 'v':
+                clock_options.verbose = true;
+                break;
+            default:
+                usage(argv[0]);
+                return 2;
+        }
+    }
+    if (clock_options.hours <= 0 || clock_options.jitter_ms <= 0 || clock_options.period_s == 0 ||
+        clock_options.burst == 0) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    random_engine.seed(clock_options.seed);
+    return simulate();
+}
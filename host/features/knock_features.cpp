@@ -0,0 +1,228 @@
+/*
+ * Copyright (c) 2016 ARM Limited. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include "knock-core/knock_features.h"
+#include "knock-core/xorshift.h"
+
+/*
+ * Checks the SSE2 and AVX2 kernels of knock_features.h against the scalar
+ * ones, bit for bit:
+ *
+ *     dot         random operands and the extremes +/-16383, every length
+ *                 from 0 to 4 windows, so all the tail paths run
+ *     magnitude   the same for max_magnitude2()
+ *     extract     whole KnockFeatures of knock-like windows, of full scale
+ *                 noise and of clipped samples, which the extractor clamps
+ *
+ * A backend the CPU does not have is skipped. The CMSIS backend needs
+ * CMSIS-DSP for the Cortex-M4 and is not built on the host, so it is not
+ * checked here. Exits with 1 when anything differs.
+ */
+namespace {
+
+struct FeaturesOptions {
+    uint32_t    rounds;         // random inputs per length and per window kind
+    bool        verbose;
+};
+
+FeaturesOptions features_options;
+
+const int16_t LIMIT = 16383;
+
+// uniform in [-LIMIT, LIMIT], the extremes now and then
+int16_t operand(Xorshift32 &random) {
+    uint32_t pick = random.next();
+    if (pick % 16 == 0) {
+        return pick & 16 ? LIMIT : -LIMIT;
+    }
+    return (int16_t)random.below_or_equal(2 * LIMIT) - LIMIT;
+}
+
+template <typename Kernels>
+bool check_kernels() {
+    typedef KnockFeatureExtractor<KnockFeatureScalar> Extractor;
+    const size_t longest = 4 * Extractor::WINDOW;
+    Xorshift32 random(1);
+    std::vector<int16_t> a(longest), b(longest), c(longest);
+    uint64_t checked = 0;
+    for (size_t count = 0; count <= longest; count++) {
+        for (uint32_t round = 0; round < features_options.rounds; round++) {
+            for (size_t i = 0; i < count; i++) {
+                a[i] = operand(random);
+                b[i] = operand(random);
+                c[i] = operand(random);
+            }
+            int64_t got = Kernels::dot(a.data(), b.data(), count);
+            int64_t want = KnockFeatureScalar::dot(a.data(), b.data(), count);
+            if (got != want) {
+                printf("%s dot: FAILED, %zu samples gave %lld, scalar %lld\n", Kernels::name(), count,
+                       (long long)got, (long long)want);
+                return false;
+            }
+            int32_t got2 = Kernels::max_magnitude2(a.data(), b.data(), c.data(), count);
+            int32_t want2 = KnockFeatureScalar::max_magnitude2(a.data(), b.data(), c.data(), count);
+            if (got2 != want2) {
+                printf("%s magnitude: FAILED, %zu samples gave %ld, scalar %ld\n", Kernels::name(), count,
+                       (long)got2, (long)want2);
+                return false;
+            }
+            checked++;
+        }
+    }
+    // all operands at the same extreme, the largest sums there are
+    for (int sign = -1; sign <= 1; sign += 2) {
+        for (size_t i = 0; i < longest; i++) {
+            a[i] = b[i] = c[i] = sign * LIMIT;
+        }
+        if (Kernels::dot(a.data(), b.data(), longest) != KnockFeatureScalar::dot(a.data(), b.data(), longest) ||
+            Kernels::max_magnitude2(a.data(), b.data(), c.data(), longest) !=
+                KnockFeatureScalar::max_magnitude2(a.data(), b.data(), c.data(), longest)) {
+            printf("%s dot: FAILED at %d\n", Kernels::name(), sign * LIMIT);
+            return false;
+        }
+    }
+    printf("%s dot, magnitude: %llu inputs of 0 to %zu samples same as scalar\n", Kernels::name(),
+           (unsigned long long)checked, longest);
+    return true;
+}
+
+bool same(const KnockFeatures &got, const KnockFeatures &want) {
+    return got.magnitude == want.magnitude && got.axis == want.axis && got.sign == want.sign &&
+           got.centroid == want.centroid && got.energy[0] == want.energy[0] &&
+           got.energy[1] == want.energy[1] && got.energy[2] == want.energy[2];
+}
+
+// a decaying knock on a random axis over gravity, full scale noise, or
+// samples clipped at the ends of the 14 bit range
+void make_window(Xorshift32 &random, uint32_t kind, std::vector<AccelSample> &window) {
+    uint8_t axis = random.below_or_equal(2);
+    int32_t amplitude = 200 + random.below_or_equal(7800);
+    for (size_t i = 0; i < window.size(); i++) {
+        int16_t *values[3] = { &window[i].x, &window[i].y, &window[i].z };
+        for (int j = 0; j < 3; j++) {
+            if (kind == 0) {
+                int32_t value = (j == 2 ? 4096 : 0) + (int32_t)random.below_or_equal(40) - 20;
+                if (j == axis && i >= 4) {
+                    int32_t decay = amplitude >> ((i - 4) / 4);
+                    value += (i & 1) ? decay : -decay;
+                }
+                *values[j] = (int16_t)value;
+            } else if (kind == 1) {
+                *values[j] = (int16_t)random.below_or_equal(16383) - 8192;
+            } else {
+                *values[j] = random.next() & 1 ? 8191 : -8192;
+            }
+        }
+    }
+}
+
+template <typename Kernels>
+bool check_extract() {
+    typedef KnockFeatureExtractor<Kernels> Extractor;
+    Extractor extractor;
+    KnockFeatureExtractor<KnockFeatureScalar> reference;
+    static const char *const KINDS[] = { "knocks", "noise", "clipped" };
+    Xorshift32 random(2);
+    std::vector<AccelSample> window(Extractor::WINDOW);
+    uint64_t checked = 0;
+    for (uint32_t kind = 0; kind < 3; kind++) {
+        for (uint32_t round = 0; round < 64 * features_options.rounds; round++) {
+            make_window(random, kind, window);
+            KnockFeatures got, want;
+            extractor.extract(window, 0, got);
+            reference.extract(window, 0, want);
+            if (!same(got, want)) {
+                printf("%s extract: FAILED, %s window %u: magnitude %u axis %u%c centroid %u, "
+                       "scalar magnitude %u axis %u%c centroid %u\n", Kernels::name(), KINDS[kind],
+                       (unsigned)round, (unsigned)got.magnitude, (unsigned)got.axis, got.sign < 0 ? '-' : '+',
+                       (unsigned)got.centroid, (unsigned)want.magnitude, (unsigned)want.axis,
+                       want.sign < 0 ? '-' : '+', (unsigned)want.centroid);
+                return false;
+            }
+            checked++;
+        }
+    }
+    printf("%s extract: %llu windows of knocks, noise and clipped samples same as scalar\n", Kernels::name(),
+           (unsigned long long)checked);
+    return true;
+}
+
+template <typename Kernels>
+bool check_backend() {
+    if (!Kernels::supported()) {
+        printf("%s: skipped, not supported by this CPU\n", Kernels::name());
+        return true;
+    }
+    bool passed = check_kernels<Kernels>();
+    return check_extract<Kernels>() && passed;
+}
+
+void usage(const char *name) {
+    fprintf(stderr,
+            "usage: %s [options]\n"
+            "  -n, --rounds N        random inputs per length, 64 times that per window kind (default 100)\n"
+            "  -v, --verbose         print the default backend\n",
+            name);
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    static const struct option long_options[] = {
+        { "rounds", required_argument, 0, 'n' },
+        { "verbose", no_argument, 0, 'v' },
+        { "help", no_argument, 0, 'h' },
+        { 0, 0, 0, 0 }
+    };
+
+    features_options.rounds = 100;
+    features_options.verbose = false;
+
+    int c;
+    while ((c = getopt_long(argc, argv, "n:vh", long_options, NULL)) != -1) {
+        switch (c) {
+            case 'n':
+                features_options.rounds = strtoul(optarg, NULL, 10);
+                break;
+            case 'v':
+                features_options.verbose = true;
+                break;
+            default:
+                usage(argv[0]);
+                return 2;
+        }
+    }
+    if (features_options.rounds == 0) {
+        usage(argv[0]);
+        return 2;
+    }
+    if (features_options.verbose) {
+        printf("default backend: %s\n", KnockFeatureDefault::name());
+    }
+
+    bool passed = true;
+#ifdef KNOCK_FEATURES_X86
+    passed = check_backend<KnockFeatureSse2>() && passed;
+    passed = check_backend<KnockFeatureAvx2>() && passed;
+#else
+    printf("no SIMD backend for this CPU, nothing to check\n");
+#endif
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,569 @@
+/*
+ * Copyright (c) 2016 ARM Limited. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <deque>
+#include "knock-core/fxos8700cq_fifo.h"
+
+/*
+ * Runs FXOS8700CQFifo against a mock of the FXOS8700CQ register map and
+ * checks:
+ *
+ *     configure   the FIFO, its watermark and the interrupt routing are set
+ *                 in standby, and the sensor is active afterwards
+ *     watermark   a FIFO at its watermark is drained in one burst, with
+ *                 the 14 bit samples decoded to the values put in
+ *     partial     fewer samples than the watermark, e.g. after a read that
+ *                 raced the interrupt, are read in one burst and no more
+ *     rest        samples queued past the watermark come in a second burst
+ *                 behind the first, in order
+ *     overflow    a FIFO that wrapped is drained whole and counted
+ *     ring        a drain into a full sample ring keeps the newest samples
+ *                 and counts the ones it overwrote
+ *     errors      a failed read makes drain() return -1
+ *     rate        set_rate() and set_watermark_interrupt() only touch their
+ *                 bits, in standby where the sensor needs it
+ *
+ * Exits with 1 when a check fails.
+ */
+namespace {
+
+struct FifoOptions {
+    uint8_t     watermark;
+    bool        verbose;
+};
+
+FifoOptions fifo_options;
+
+enum {
+    REG_STATUS      = 0x00,
+    REG_OUT_X_MSB   = 0x01,
+    REG_OUT_Z_LSB   = 0x06,
+    REG_F_SETUP     = 0x09,
+    REG_INT_SOURCE  = 0x0C,
+    REG_FF_MT_THS   = 0x17,
+    REG_CTRL_REG1   = 0x2A,
+    REG_CTRL_REG2   = 0x2B,
+    REG_CTRL_REG4   = 0x2D,
+    REG_CTRL_REG5   = 0x2E,
+    REG_M_CTRL_REG1 = 0x5B,
+    REG_M_CTRL_REG2 = 0x5C
+};
+
+/*
+ * The register map of the FXOS8700CQ as FXOS8700CQFifo sees it: a byte per
+ * register, the FIFO behind F_STATUS and OUT_X_MSB..OUT_Z_LSB, and the
+ * auto-increment of a burst. Writes to the control registers the sensor
+ * only takes in standby are ignored while it is active, and counted.
+ */
+class MockRegisters {
+public:
+    MockRegisters()
+        : _overflow(false), _pointer(0), _byte(0), _reads(0), _fail_at(0), _bursts(0), _active_writes(0) {
+        memset(_regs, 0, sizeof(_regs));
+        // what FXOS8700CQ::enable() and config_feature() leave behind: hybrid
+        // mode with auto-increment, 0.25 g motion on INT1, active
+        _regs[REG_M_CTRL_REG1] = 0x1F;
+        _regs[REG_M_CTRL_REG2] = 0x20;
+        _regs[REG_FF_MT_THS] = 0x84;
+        _regs[REG_CTRL_REG4] = 0x04;
+        _regs[REG_CTRL_REG5] = 0x04;
+        _regs[REG_CTRL_REG1] = 0x0D;
+    }
+
+    uint8_t reg(uint8_t address) const {
+        return _regs[address];
+    }
+
+    // queues a sample, as 14 bit left justified big endian
+    void queue(int16_t x, int16_t y, int16_t z) {
+        Raw raw;
+        int16_t values[3] = { x, y, z };
+        for (int axis = 0; axis < 3; axis++) {
+            uint16_t left = (uint16_t)(values[axis] << 2);
+            raw.bytes[axis * 2] = left >> 8;
+            raw.bytes[axis * 2 + 1] = left & 0xFF;
+        }
+        if (_fifo.size() == 32) {
+            _fifo.pop_front();
+            _overflow = true;
+        }
+        _fifo.push_back(raw);
+    }
+
+    size_t queued() const {
+        return _fifo.size();
+    }
+
+    // the n-th read from now fails, 0 for none
+    void fail_at(uint32_t n) {
+        _reads = 0;
+        _fail_at = n;
+    }
+
+    // reads, one per I2C transaction
+    uint32_t bursts() const {
+        return _bursts;
+    }
+
+    // writes the sensor ignored because it was active
+    uint32_t active_writes() const {
+        return _active_writes;
+    }
+
+    bool read(uint8_t reg, uint8_t *data, int length) {
+        if (++_reads == _fail_at) {
+            return false;
+        }
+        _bursts++;
+        _pointer = reg;
+        _byte = 0;
+        for (int i = 0; i < length; i++) {
+            data[i] = read_next();
+        }
+        return true;
+    }
+
+    bool write(uint8_t reg, uint8_t value) {
+        bool active = _regs[REG_CTRL_REG1] & 0x01;
+        bool standby_only = reg == REG_CTRL_REG2 || reg == REG_CTRL_REG5 || reg == REG_FF_MT_THS ||
+                            reg == REG_M_CTRL_REG1 || reg == REG_M_CTRL_REG2 ||
+                            (reg == REG_CTRL_REG1 && ((value ^ _regs[reg]) & 0x38));
+        if (active && standby_only) {
+            _active_writes++;
+            return true;
+        }
+        _regs[reg] = value;
+        if (reg == REG_F_SETUP && (value & 0xC0) == 0) {
+            // FIFO off empties it
+            _fifo.clear();
+            _overflow = false;
+        }
+        return true;
+    }
+
+private:
+    struct Raw {
+        uint8_t bytes[6];
+    };
+
+    uint8_t read_next() {
+        uint8_t value = 0;
+        if (_pointer == REG_STATUS) {
+            value = (_overflow ? 0x80 : 0) | (uint8_t)_fifo.size();
+            _overflow = false;
+            _pointer = REG_OUT_X_MSB;
+            return value;
+        }
+        if (_pointer >= REG_OUT_X_MSB && _pointer <= REG_OUT_Z_LSB) {
+            // accelerometer only: the burst wraps from OUT_Z_LSB back to
+            // OUT_X_MSB, a sample leaves the FIFO once all its bytes are read
+            value = _fifo.empty() ? 0 : _fifo.front().bytes[_byte];
+            if (++_byte == 6) {
+                _byte = 0;
+                if (!_fifo.empty()) {
+                    _fifo.pop_front();
+                }
+            }
+            _pointer = _pointer == REG_OUT_Z_LSB ? REG_OUT_X_MSB : _pointer + 1;
+            return value;
+        }
+        if (_pointer == REG_INT_SOURCE) {
+            uint8_t watermark = _regs[REG_F_SETUP] & 0x3F;
+            value = (watermark && _fifo.size() >= watermark ? 0x40 : 0);
+        } else {
+            value = _regs[_pointer];
+        }
+        _pointer++;
+        return value;
+    }
+
+    uint8_t         _regs[0x80];
+    std::deque<Raw> _fifo;
+    bool            _overflow;
+    uint8_t         _pointer;
+    int             _byte;          // into the sample at the front
+    uint32_t        _reads;
+    uint32_t        _fail_at;
+    uint32_t        _bursts;
+    uint32_t        _active_writes;
+};
+
+typedef FXOS8700CQFifo<MockRegisters> Fifo;
+typedef SampleRing<AccelSample, 64> Ring;
+
+bool fail(const char *check, const char *what, long value, long expected) {
+    printf("%s: FAILED, %s %ld, expected %ld\n", check, what, value, expected);
+    return false;
+}
+
+// sample n of a fill, spread over the 14 bit range with both signs
+AccelSample sample_at(uint32_t n) {
+    AccelSample sample;
+    sample.x = (int16_t)((n * 1237) % 16384) - 8192;
+    sample.y = (int16_t)(8191 - (n * 613) % 16384);
+    sample.z = (int16_t)(n % 2 ? -4096 - (int)n : 4096 + (int)n);
+    return sample;
+}
+
+void queue_samples(MockRegisters &regs, uint32_t first, uint32_t count) {
+    for (uint32_t n = first; n < first + count; n++) {
+        AccelSample sample = sample_at(n);
+        regs.queue(sample.x, sample.y, sample.z);
+    }
+}
+
+// the ring holds samples first, first + 1, ...
+bool check_samples(const char *check, const Ring &ring, uint32_t first) {
+    for (size_t i = 0; i < ring.size(); i++) {
+        AccelSample expected = sample_at(first + i);
+        const AccelSample &got = ring.at(i);
+        if (got.x != expected.x || got.y != expected.y || got.z != expected.z) {
+            printf("%s: FAILED, sample %zu is %d %d %d, expected %d %d %d\n", check, i, got.x, got.y, got.z,
+                   expected.x, expected.y, expected.z);
+            return false;
+        }
+    }
+    return true;
+}
+
+// a FIFO configured like the firmware does
+bool setup(Fifo &fifo) {
+    return fifo.configure(fifo_options.watermark, Fifo::ODR_400HZ);
+}
+
+bool check_configure() {
+    MockRegisters regs;
+    Fifo fifo(regs);
+    if (fifo.configure(0, Fifo::ODR_400HZ) || fifo.configure(Fifo::CAPACITY, Fifo::ODR_400HZ) ||
+        fifo.watermark() != 0) {
+        printf("configure: FAILED, took a watermark of 0 or %u\n", Fifo::CAPACITY);
+        return false;
+    }
+    if (!setup(fifo)) {
+        printf("configure: FAILED\n");
+        return false;
+    }
+    if (regs.reg(REG_F_SETUP) != (0x40 | fifo_options.watermark)) {
+        return fail("configure", "F_SETUP", regs.reg(REG_F_SETUP), 0x40 | fifo_options.watermark);
+    }
+    if ((regs.reg(REG_CTRL_REG4) & 0x44) != 0x44) {
+        return fail("configure", "CTRL_REG4", regs.reg(REG_CTRL_REG4), 0x44);
+    }
+    if ((regs.reg(REG_CTRL_REG5) & 0x44) != 0x44) {
+        return fail("configure", "CTRL_REG5, FIFO and motion on INT1", regs.reg(REG_CTRL_REG5), 0x44);
+    }
+    if ((regs.reg(REG_M_CTRL_REG1) & 0x03) != 0 || (regs.reg(REG_M_CTRL_REG2) & 0x20) != 0) {
+        return fail("configure", "hybrid mode", regs.reg(REG_M_CTRL_REG1) & 0x03, 0);
+    }
+    if ((regs.reg(REG_CTRL_REG1) & 0x39) != ((Fifo::ODR_400HZ << 3) | 0x01)) {
+        return fail("configure", "CTRL_REG1", regs.reg(REG_CTRL_REG1) & 0x39, (Fifo::ODR_400HZ << 3) | 0x01);
+    }
+    if (regs.active_writes() != 0) {
+        return fail("configure", "writes while active", regs.active_writes(), 0);
+    }
+    printf("configure: watermark %u, FIFO interrupt on INT1 next to motion, accelerometer only, all in standby\n",
+           fifo_options.watermark);
+    return true;
+}
+
+bool check_watermark() {
+    MockRegisters regs;
+    Fifo fifo(regs);
+    setup(fifo);
+    uint8_t watermark = fifo_options.watermark;
+    uint32_t first = 0;
+    for (int round = 0; round < 4; round++) {
+        queue_samples(regs, first, watermark);
+        uint8_t sources = 0;
+        fifo.read_sources(sources);
+        if (!(sources & Fifo::SRC_FIFO)) {
+            return fail("watermark", "INT_SOURCE", sources, Fifo::SRC_FIFO);
+        }
+        Ring ring;
+        uint32_t bursts = regs.bursts();
+        int count = fifo.drain(ring);
+        if (count != watermark || ring.size() != watermark) {
+            return fail("watermark", "samples", count, watermark);
+        }
+        if (regs.bursts() - bursts != 1) {
+            return fail("watermark", "bursts", regs.bursts() - bursts, 1);
+        }
+        if (!check_samples("watermark", ring, first) || regs.queued() != 0) {
+            return false;
+        }
+        first += watermark;
+    }
+    if (fifo.bursts() != 4 || fifo.overflows() != 0) {
+        return fail("watermark", "bursts counted", fifo.bursts(), 4);
+    }
+    printf("watermark: %u samples in one burst of %u bytes, decoded over the 14 bit range\n", watermark,
+           1 + watermark * 6);
+    return true;
+}
+
+bool check_partial() {
+    uint8_t watermark = fifo_options.watermark;
+    for (uint8_t fill = 0; fill < watermark; fill++) {
+        MockRegisters regs;
+        Fifo fifo(regs);
+        setup(fifo);
+        queue_samples(regs, 100, fill);
+        Ring ring;
+        uint32_t bursts = regs.bursts();
+        int count = fifo.drain(ring);
+        if (count != fill || ring.size() != fill) {
+            return fail("partial", "samples", count, fill);
+        }
+        if (regs.bursts() - bursts != 1) {
+            return fail("partial", "bursts", regs.bursts() - bursts, 1);
+        }
+        if (!check_samples("partial", ring, 100)) {
+            return false;
+        }
+        if (fifo_options.verbose) {
+            printf("partial: %u of %u queued, one burst\n", fill, watermark);
+        }
+    }
+    printf("partial: 0 to %u samples below the watermark, each read in one burst without padding\n",
+           watermark - 1);
+    return true;
+}
+
+bool check_rest() {
+    uint8_t watermark = fifo_options.watermark;
+    for (uint8_t fill = watermark + 1; fill < Fifo::CAPACITY; fill++) {
+        MockRegisters regs;
+        Fifo fifo(regs);
+        setup(fifo);
+        queue_samples(regs, 200, fill);
+        Ring ring;
+        uint32_t bursts = regs.bursts();
+        int count = fifo.drain(ring);
+        if (count != fill || ring.size() != fill) {
+            return fail("rest", "samples", count, fill);
+        }
+        if (regs.bursts() - bursts != 2) {
+            return fail("rest", "bursts", regs.bursts() - bursts, 2);
+        }
+        if (!check_samples("rest", ring, 200) || regs.queued() != 0) {
+            return false;
+        }
+    }
+    if (watermark + 1 < Fifo::CAPACITY) {
+        printf("rest: %u to %u samples read in two bursts, in order\n", watermark + 1, Fifo::CAPACITY - 1);
+    } else {
+        printf("rest: no room past a watermark of %u\n", watermark);
+    }
+    return true;
+}
+
+bool check_overflow() {
+    MockRegisters regs;
+    Fifo fifo(regs);
+    setup(fifo);
+    // 40 samples into 32 entries, the first 8 are gone
+    queue_samples(regs, 300, 40);
+    Ring ring;
+    int count = fifo.drain(ring);
+    if (count != Fifo::CAPACITY) {
+        return fail("overflow", "samples", count, Fifo::CAPACITY);
+    }
+    if (fifo.overflows() != 1) {
+        return fail("overflow", "overflows", fifo.overflows(), 1);
+    }
+    if (!check_samples("overflow", ring, 308)) {
+        return false;
+    }
+
+    // F_STATUS[OVF] clears once read
+    queue_samples(regs, 400, fifo_options.watermark);
+    ring.clear();
+    fifo.drain(ring);
+    if (fifo.overflows() != 1) {
+        return fail("overflow", "overflows after the next drain", fifo.overflows(), 1);
+    }
+    printf("overflow: a wrapped FIFO is drained whole, newest %u samples, counted once\n", Fifo::CAPACITY);
+    return true;
+}
+
+bool check_ring() {
+    MockRegisters regs;
+    Fifo fifo(regs);
+    setup(fifo);
+    Ring ring;
+    uint32_t drained = 0;
+    // fill the ring past its capacity without consuming
+    while (drained < Ring::capacity() + Fifo::CAPACITY) {
+        queue_samples(regs, 500 + drained, Fifo::CAPACITY);
+        drained += fifo.drain(ring);
+    }
+    uint32_t lost = drained - Ring::capacity();
+    if (ring.size() != Ring::capacity() || ring.overruns() != lost) {
+        return fail("ring", "overruns", ring.overruns(), lost);
+    }
+    if (!check_samples("ring", ring, 500 + lost)) {
+        return false;
+    }
+
+    // and a consumer takes them out oldest first
+    AccelSample sample;
+    uint32_t popped = 0;
+    while (ring.pop(sample)) {
+        AccelSample expected = sample_at(500 + lost + popped);
+        if (sample.x != expected.x || sample.y != expected.y || sample.z != expected.z) {
+            return fail("ring", "popped sample", popped, popped);
+        }
+        popped++;
+    }
+    if (popped != Ring::capacity()) {
+        return fail("ring", "popped", popped, Ring::capacity());
+    }
+    printf("ring: %u samples drained into %zu, the newest kept, %u overruns counted\n", drained,
+           Ring::capacity(), lost);
+    return true;
+}
+
+bool check_errors() {
+    uint8_t watermark = fifo_options.watermark;
+    // the first burst, then the second one of a FIFO past its watermark
+    for (uint32_t step = 1; step <= 2; step++) {
+        MockRegisters regs;
+        Fifo fifo(regs);
+        setup(fifo);
+        queue_samples(regs, 0, Fifo::CAPACITY);
+        Ring ring;
+        regs.fail_at(step);
+        if (fifo.drain(ring) != -1) {
+            return fail("errors", "drain() with a failed read", 0, -1);
+        }
+        // the next drain picks up what is still queued
+        regs.fail_at(0);
+        ring.clear();
+        size_t queued = regs.queued();
+        if (fifo.drain(ring) != (int)queued) {
+            return fail("errors", "samples after the failed read", ring.size(), queued);
+        }
+    }
+
+    MockRegisters regs;
+    Fifo unconfigured(regs);
+    Ring ring;
+    if (unconfigured.drain(ring) != -1) {
+        return fail("errors", "drain() before configure()", 0, -1);
+    }
+    printf("errors: a failed first or second burst, and a drain before configure(), return -1 (watermark %u)\n",
+           watermark);
+    return true;
+}
+
+bool check_rate() {
+    MockRegisters regs;
+    Fifo fifo(regs);
+    if (fifo.set_rate(Fifo::ODR_200HZ, Fifo::MODS_LOW_POWER, 1)) {
+        printf("rate: FAILED, set_rate() before configure()\n");
+        return false;
+    }
+    setup(fifo);
+    queue_samples(regs, 0, 10);
+    uint8_t ctrl4 = regs.reg(REG_CTRL_REG4);
+    if (!fifo.set_rate(Fifo::ODR_200HZ, Fifo::MODS_LOW_POWER, 1)) {
+        printf("rate: FAILED\n");
+        return false;
+    }
+    // the low noise bit stays
+    if (regs.reg(REG_CTRL_REG1) != ((Fifo::ODR_200HZ << 3) | 0x05)) {
+        return fail("rate", "CTRL_REG1", regs.reg(REG_CTRL_REG1), (Fifo::ODR_200HZ << 3) | 0x05);
+    }
+    if ((regs.reg(REG_CTRL_REG2) & 0x03) != Fifo::MODS_LOW_POWER) {
+        return fail("rate", "CTRL_REG2[MODS]", regs.reg(REG_CTRL_REG2) & 0x03, Fifo::MODS_LOW_POWER);
+    }
+    // the debounce mode bit of FF_MT_THS stays
+    if (regs.reg(REG_FF_MT_THS) != 0x81) {
+        return fail("rate", "FF_MT_THS", regs.reg(REG_FF_MT_THS), 0x81);
+    }
+    if (regs.reg(REG_F_SETUP) != (0x40 | fifo_options.watermark) || regs.queued() != 0) {
+        return fail("rate", "samples left from the old rate", regs.queued(), 0);
+    }
+    if (regs.reg(REG_CTRL_REG4) != ctrl4 || regs.active_writes() != 0) {
+        return fail("rate", "writes while active", regs.active_writes(), 0);
+    }
+
+    // the watermark interrupt goes off and on in place, the FIFO stays
+    queue_samples(regs, 0, 5);
+    if (!fifo.set_watermark_interrupt(false) || (regs.reg(REG_CTRL_REG4) & 0x40) ||
+        !(regs.reg(REG_CTRL_REG4) & 0x04) || regs.queued() != 5 ||
+        !fifo.set_watermark_interrupt(true) || regs.reg(REG_CTRL_REG4) != ctrl4) {
+        return fail("rate", "CTRL_REG4", regs.reg(REG_CTRL_REG4), ctrl4);
+    }
+    printf("rate: data rate, power mode and motion threshold changed in standby, the FIFO emptied; "
+           "the watermark interrupt toggled in place\n");
+    return true;
+}
+
+void usage(const char *name) {
+    fprintf(stderr,
+            "usage: %s [options]\n"
+            "  -w, --watermark N     FIFO watermark (default 24)\n"
+            "  -v, --verbose         print every case\n",
+            name);
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    static const struct option long_options[] = {
+        { "watermark", required_argument, 0, 'w' },
+        { "verbose", no_argument, 0, 'v' },
+        { "help", no_argument, 0, 'h' },
+        { 0, 0, 0, 0 }
+    };
+
+    fifo_options.watermark = 24;
+    fifo_options.verbose = false;
+
+    int c;
+    while ((c = getopt_long(argc, argv, "w:vh", long_options, NULL)) != -1) {
+        switch (c) {
+            case 'w':
+                fifo_options.watermark = strtoul(optarg, NULL, 10);
+                break;
+            case 'v':
+                fifo_options.verbose = true;
+                break;
+            default:
+                usage(argv[0]);
+                return 2;
+        }
+    }
+    if (fifo_options.watermark == 0 || fifo_options.watermark >= Fifo::CAPACITY) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    bool passed = check_configure();
+    passed = check_watermark() && passed;
+    passed = check_partial() && passed;
+    passed = check_rest() && passed;
+    passed = check_overflow() && passed;
+    passed = check_ring() && passed;
+    passed = check_errors() && passed;
+    passed = check_rate() && passed;
+    return passed ? 0 : 1;
+}
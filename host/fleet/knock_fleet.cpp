@@ -0,0 +1,355 @@
+/*
+ * Copyright (c) 2016 ARM Limited. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <functional>
+#include <map>
+#include <queue>
+#include <vector>
+#include "knock-core/reconnect_backoff.h"
+#include "knock-core/registration_scheduler.h"
+
+/*
+ * Fleet simulation of the registration updates planned by
+ * RegistrationScheduler. All nodes register in the same second, then each
+ * updates its registration when the scheduler says so, or earlier together
+ * with a notification once the piggyback point has passed, like
+ * MbedClient::align_update(). Every node sends a notification every
+ * --notify-every seconds, starting at a random point.
+ *
+ * The server answers every update at once. Reports the updates per hour,
+ * how many of them went out with a notification and the most in any one
+ * second, next to the fixed poll the clients used before. Exits with 1
+ * when the registration of a node ran out.
+ *
+ * With --storm it simulates a reconnect storm instead: every node loses the
+ * server at the same moment and registers again after the delays of
+ * ReconnectBackoff, against a server that accepts only so many
+ * registrations per second and lets the others fail after a timeout. The
+ * same fleet then runs again with the flat 5 s retry the clients had
+ * before. Reports when the last node got back, the attempts and the most
+ * attempts in one second for both. Exits with 1 when a node with backoff
+ * did not get back within --hours.
+ *
+ * Time is in ms and only moves from event to event, so 1000 nodes over a
+ * day take well under a second.
+ */
+namespace {
+
+struct FleetOptions {
+    uint32_t    nodes;
+    uint32_t    hours;
+    uint32_t    lifetime;       // s
+    uint32_t    notify_every;   // s
+    uint32_t    poll;           // s, the fixed poll to compare with
+    bool        storm;
+    uint32_t    accept;         // registrations the server takes per second
+    uint32_t    fail_after;     // ms until a refused registration fails
+    uint32_t    flat;           // ms, the flat retry to compare with
+    BackoffStrategy backoff;
+};
+
+FleetOptions fleet;
+
+// Q15 fractions of the 6LoWPAN client, see config.json
+const uint16_t UPDATE_FRACTION = 75 * 32768 / 100;
+const uint16_t UPDATE_JITTER = 10 * 32768 / 100;
+const uint16_t PIGGYBACK = 50 * 32768 / 100;
+
+struct Event {
+    uint64_t    at;             // ms
+    uint32_t    node;
+    uint32_t    generation;     // of the planned update, stale ones are skipped
+    bool        notify;         // with --storm: a refused attempt failed
+
+    bool operator>(const Event &other) const {
+        return at > other.at;
+    }
+};
+
+typedef std::priority_queue<Event, std::vector<Event>, std::greater<Event> > EventQueue;
+
+struct Node {
+    Node(uint32_t lifetime, uint32_t seed)
+        : registration(lifetime, UPDATE_FRACTION, UPDATE_JITTER, PIGGYBACK, seed),
+          last_refresh(0), generation(0) {
+    }
+
+    RegistrationScheduler   registration;
+    uint64_t                last_refresh;   // ms
+    uint32_t                generation;
+};
+
+bool simulate_updates() {
+    const uint64_t end = (uint64_t)fleet.hours * 3600 * 1000;
+    std::vector<Node> nodes;
+    EventQueue events;
+    Xorshift32 random(1);
+    for (uint32_t i = 0; i < fleet.nodes; i++) {
+        // per node seeds like the MACs of the firmware
+        nodes.push_back(Node(fleet.lifetime, (i + 1) * 2654435761u));
+        Event update = { nodes[i].registration.next_delay(), i, 0, false };
+        events.push(update);
+        Event notify = { random.below_or_equal(fleet.notify_every * 1000 - 1), i, 0, true };
+        events.push(notify);
+    }
+
+    uint64_t updates = 0;
+    uint64_t piggybacked = 0;
+    uint64_t longest_gap = 0;
+    std::map<uint64_t, uint32_t> per_second;
+    while (!events.empty() && events.top().at < end) {
+        Event event = events.top();
+        events.pop();
+        Node &node = nodes[event.node];
+        if (event.notify) {
+            Event next = event;
+            next.at += fleet.notify_every * 1000;
+            events.push(next);
+            if (!node.registration.piggyback(event.at - node.last_refresh)) {
+                continue;
+            }
+            piggybacked++;
+        } else if (event.generation != node.generation) {
+            continue;
+        }
+
+        updates++;
+        per_second[event.at / 1000]++;
+        if (event.at - node.last_refresh > longest_gap) {
+            longest_gap = event.at - node.last_refresh;
+        }
+        node.last_refresh = event.at;
+        Event update = { event.at + node.registration.next_delay(), event.node, ++node.generation, false };
+        events.push(update);
+    }
+
+    uint32_t peak = 0;
+    for (std::map<uint64_t, uint32_t>::const_iterator it = per_second.begin(); it != per_second.end(); ++it) {
+        if (it->second > peak) {
+            peak = it->second;
+        }
+    }
+    printf("fleet: %u nodes for %u h, lifetime %u s, a notification every %u s per node\n", fleet.nodes,
+           fleet.hours, fleet.lifetime, fleet.notify_every);
+    printf("fleet: %llu updates per hour, %llu of them with a notification, at most %u in one second\n",
+           (unsigned long long)(updates / fleet.hours), (unsigned long long)(piggybacked / fleet.hours), peak);
+    printf("fleet: a fixed poll every %u s: %llu updates per hour\n", fleet.poll,
+           (unsigned long long)fleet.nodes * 3600 / fleet.poll);
+    printf("fleet: registrations refreshed at most %llu s apart\n", (unsigned long long)(longest_gap / 1000));
+    if (longest_gap >= (uint64_t)fleet.lifetime * 1000) {
+        printf("fleet: FAILED, a registration ran out\n");
+        return false;
+    }
+    return true;
+}
+
+struct StormResult {
+    uint64_t    recovered;      // ms until the last node registered, 0 never
+    uint64_t    attempts;
+    uint32_t    peak;           // attempts in one second
+};
+
+/*
+ * Every node lost the server at 0. `delay` gives the wait before the next
+ * attempt of a node, and `registered` is called when one got through.
+ */
+StormResult simulate_storm(const std::function<uint32_t(uint32_t)> &delay,
+                           const std::function<void(uint32_t)> &registered) {
+    const uint64_t end = (uint64_t)fleet.hours * 3600 * 1000;
+    EventQueue events;
+    for (uint32_t i = 0; i < fleet.nodes; i++) {
+        Event attempt = { delay(i), i, 0, false };
+        events.push(attempt);
+    }
+
+    StormResult result = { 0, 0, 0 };
+    std::map<uint64_t, uint32_t> attempts;      // per second
+    std::map<uint64_t, uint32_t> accepted;      // per second
+    uint32_t missing = fleet.nodes;
+    while (!events.empty() && events.top().at < end) {
+        Event event = events.top();
+        events.pop();
+        if (event.notify) {
+            // the refused attempt failed, wait for the next one
+            event.at += delay(event.node);
+            event.notify = false;
+            events.push(event);
+            continue;
+        }
+
+        result.attempts++;
+        uint32_t &second = attempts[event.at / 1000];
+        second++;
+        if (second > result.peak) {
+            result.peak = second;
+        }
+        uint32_t &taken = accepted[event.at / 1000];
+        if (taken < fleet.accept) {
+            taken++;
+            registered(event.node);
+            if (--missing == 0) {
+                result.recovered = event.at;
+                break;
+            }
+            continue;
+        }
+        event.at += fleet.fail_after;
+        event.notify = true;
+        events.push(event);
+    }
+    return result;
+}
+
+void print_storm(const char *name, const StormResult &result) {
+    if (result.recovered) {
+        printf("fleet: %s: all back after %llu s, %llu attempts, at most %u in one second\n", name,
+               (unsigned long long)(result.recovered / 1000), (unsigned long long)result.attempts, result.peak);
+    } else {
+        printf("fleet: %s: not all back after %u h, %llu attempts, at most %u in one second\n", name,
+               fleet.hours, (unsigned long long)result.attempts, result.peak);
+    }
+}
+
+bool simulate_storms() {
+    printf("fleet: %u nodes lose the server at once, it accepts %u registrations per second, "
+           "refused ones fail after %u ms\n", fleet.nodes, fleet.accept, fleet.fail_after);
+
+    std::vector<ReconnectBackoff> backoff;
+    for (uint32_t i = 0; i < fleet.nodes; i++) {
+        backoff.push_back(ReconnectBackoff(fleet.backoff, fleet.backoff, (i + 1) * 2654435761u));
+    }
+    StormResult jittered = simulate_storm(
+        [&backoff](uint32_t node) { return backoff[node].next_delay(ReconnectBackoff::NETWORK); },
+        [&backoff](uint32_t node) { backoff[node].reset(); });
+    StormResult flat = simulate_storm(
+        [](uint32_t) { return fleet.flat; },
+        [](uint32_t) {});
+
+    char name[64];
+    snprintf(name, sizeof(name), "backoff %u ms to %u s", fleet.backoff.base, fleet.backoff.cap / 1000);
+    print_storm(name, jittered);
+    snprintf(name, sizeof(name), "flat %u ms", fleet.flat);
+    print_storm(name, flat);
+    if (!jittered.recovered) {
+        printf("fleet: FAILED, nodes with backoff did not get back\n");
+        return false;
+    }
+    return true;
+}
+
+void usage(const char *name) {
+    fprintf(stderr,
+            "usage: %s [options]\n"
+            "  -n, --nodes N         nodes in the fleet (default 1000)\n"
+            "      --hours N         simulated time (default 24)\n"
+            "      --lifetime S      registration lifetime (default 3600)\n"
+            "      --notify-every S  time between the notifications of a node (default 600)\n"
+            "      --poll S          the fixed poll to compare with (default 30)\n"
+            "      --storm           simulate a reconnect storm instead\n"
+            "      --accept N        registrations the server accepts per second (default 20)\n"
+            "      --fail-after MS   a refused registration fails after MS (default 2000)\n"
+            "      --base MS         first backoff bound (default 5000)\n"
+            "      --cap MS          largest backoff bound (default 300000)\n"
+            "      --flat MS         the flat retry to compare with (default 5000)\n",
+            name);
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    static const struct option long_options[] = {
+        { "nodes", required_argument, 0, 'n' },
+        { "hours", required_argument, 0, 'H' },
+        { "lifetime", required_argument, 0, 'L' },
+        { "notify-every", required_argument, 0, 'N' },
+        { "poll", required_argument, 0, 'P' },
+        { "storm", no_argument, 0, 'S' },
+        { "accept", required_argument, 0, 'A' },
+        { "fail-after", required_argument, 0, 'F' },
+        { "base", required_argument, 0, 'B' },
+        { "cap", required_argument, 0, 'C' },
+        { "flat", required_argument, 0, 'f' },
+        { "help", no_argument, 0, 'h' },
+        { 0, 0, 0, 0 }
+    };
+
+    fleet.nodes = 1000;
+    fleet.hours = 24;
+    fleet.lifetime = 3600;
+    fleet.notify_every = 600;
+    fleet.poll = 30;
+    fleet.storm = false;
+    fleet.accept = 20;
+    fleet.fail_after = 2000;
+    fleet.flat = 5000;
+    fleet.backoff.base = 5000;
+    fleet.backoff.cap = 300000;
+
+    int c;
+    while ((c = getopt_long(argc, argv, "n:h", long_options, NULL)) != -1) {
+        switch (c) {
+            case 'n':
+                fleet.nodes = strtoul(optarg, NULL, 10);
+                break;
+            case 'H':
+                fleet.hours = strtoul(optarg, NULL, 10);
+                break;
+            case 'L':
+                fleet.lifetime = strtoul(optarg, NULL, 10);
+                break;
+            case 'N':
+                fleet.notify_every = strtoul(optarg, NULL, 10);
+                break;
+            case 'P':
+                fleet.poll = strtoul(optarg, NULL, 10);
+                break;
+            case 'S':
+                fleet.storm = true;
+                break;
+            case 'A':
+                fleet.accept = strtoul(optarg, NULL, 10);
+                break;
+            case 'F':
+                fleet.fail_after = strtoul(optarg, NULL, 10);
+                break;
+            case 'B':
+                fleet.backoff.base = strtoul(optarg, NULL, 10);
+                break;
+            case 'C':
+                fleet.backoff.cap = strtoul(optarg, NULL, 10);
+                break;
+            case 'f':
+                fleet.flat = strtoul(optarg, NULL, 10);
+                break;
+            default:
+                usage(argv[0]);
+                return 2;
+        }
+    }
+    if (!fleet.nodes || !fleet.hours || !fleet.lifetime || !fleet.notify_every || !fleet.poll ||
+        !fleet.accept || !fleet.backoff.base || fleet.backoff.cap < fleet.backoff.base) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    if (fleet.storm) {
+        return simulate_storms() ? 0 : 1;
+    }
+    return simulate_updates() ? 0 : 1;
+}
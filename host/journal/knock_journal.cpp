@@ -0,0 +1,442 @@
+/*
+ * Copyright (c) 2016 ARM Limited. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <vector>
+#include "file_flash.h"
+#include "knock-core/knock_batch.h"
+#include "knock-core/knock_journal.h"
+
+/*
+ * Runs the knock journal on a file backed flash with the geometry of the
+ * K64F, 4 KB sectors programmed in 8 byte phrases, and checks what the
+ * firmware relies on:
+ *
+ *     outage      knocks journaled while offline come back in order after a
+ *                 reset, and are forwarded exactly once without one
+ *     overflow    a ring that fills up drops the oldest knocks and keeps
+ *                 the newest, and counts the ones it dropped
+ *     power cut   the power goes at every point of a record and of a sector
+ *                 change; after the reset no record is corrupt, nothing
+ *                 that was written is lost, and appending goes on
+ *     wear        over many turns of the ring no sector is erased more than
+ *                 once more often than another
+ *     gap         knocks forwarded in knock batches like the firmware does
+ *                 decode to the times they were journaled with, across a
+ *                 gap longer than a batch can time and across a reset
+ *
+ * and reports the bytes programmed and the sectors erased per knock. Exits
+ * with 1 when a check fails.
+ */
+namespace {
+
+typedef KnockJournal<host::FileFlash> Journal;
+
+const uint32_t SECTOR_SIZE = 4096;
+const uint32_t PHRASE_SIZE = 8;
+
+struct JournalOptions {
+    uint32_t    sectors;
+    uint32_t    knocks;         // for the wear check
+    uint32_t    batch;          // knocks forwarded at a time, KNOCK_BATCH_SIZE
+    bool        verbose;
+};
+
+JournalOptions journal_options;
+
+// knocks get their index as local time, so order and loss show
+bool append(Journal &journal, uint32_t index) {
+    return journal.append(index, 1466000000000000ULL + index, index % 2000, index % 3);
+}
+
+bool fail(const char *check, const char *what, unsigned long value, unsigned long expected) {
+    printf("%s: FAILED, %s %lu, expected %lu\n", check, what, value, expected);
+    return false;
+}
+
+/*
+ * Forwards everything pending like the firmware, a batch at a time, and
+ * checks that the knocks come out as first, first + 1, ... Returns the
+ * count, or -1 on a gap.
+ */
+long forward_all(Journal &journal, uint32_t first) {
+    std::vector<JournalKnock> knocks(journal_options.batch);
+    uint32_t expected = first;
+    size_t count;
+    while ((count = journal.peek(&knocks[0], knocks.size())) > 0) {
+        for (size_t i = 0; i < count; i++) {
+            if (knocks[i].local != expected || knocks[i].server != 1466000000000000ULL + expected) {
+                printf("forward: knock %lu where %lu was expected\n", (unsigned long)knocks[i].local,
+                       (unsigned long)expected);
+                return -1;
+            }
+            expected++;
+        }
+        if (!journal.forwarded(knocks[count - 1].sequence)) {
+            return -1;
+        }
+    }
+    return expected - first;
+}
+
+bool check_outage() {
+    host::FileFlash flash(journal_options.sectors * SECTOR_SIZE, SECTOR_SIZE, PHRASE_SIZE);
+    Journal journal(flash);
+    if (!flash.open(NULL) || !journal.mount()) {
+        return fail("outage", "mount of a blank flash", 0, 1);
+    }
+    uint32_t knocks = journal.capacity() / 2;
+    for (uint32_t i = 0; i < knocks; i++) {
+        append(journal, i);
+    }
+
+    // the reset
+    Journal after(flash);
+    if (!after.mount() || after.pending() != knocks) {
+        return fail("outage", "knocks pending after the reset", after.pending(), knocks);
+    }
+    long forwarded = forward_all(after, 0);
+    if (forwarded != (long)knocks) {
+        return fail("outage", "knocks forwarded", forwarded, knocks);
+    }
+
+    // and nothing comes again after the next one
+    Journal again(flash);
+    if (!again.mount() || again.pending() != 0) {
+        return fail("outage", "knocks pending after forwarding and a reset", again.pending(), 0);
+    }
+    printf("outage: %u knocks journaled, all forwarded in order after a reset\n", knocks);
+    return true;
+}
+
+bool check_overflow() {
+    host::FileFlash flash(journal_options.sectors * SECTOR_SIZE, SECTOR_SIZE, PHRASE_SIZE);
+    Journal journal(flash);
+    if (!flash.open(NULL) || !journal.mount()) {
+        return fail("overflow", "mount of a blank flash", 0, 1);
+    }
+    uint32_t knocks = journal.capacity() * 3 + journal.capacity() / 3;
+    for (uint32_t i = 0; i < knocks; i++) {
+        if (!append(journal, i)) {
+            return fail("overflow", "failed append of knock", i, knocks);
+        }
+    }
+    if (journal.pending() + journal.dropped() != knocks) {
+        return fail("overflow", "knocks pending and dropped", journal.pending() + journal.dropped(), knocks);
+    }
+    if (journal.pending() < journal.capacity()) {
+        return fail("overflow", "knocks pending", journal.pending(), journal.capacity());
+    }
+
+    Journal after(flash);
+    if (!after.mount() || after.pending() != journal.pending()) {
+        return fail("overflow", "knocks pending after a reset", after.pending(), journal.pending());
+    }
+    uint32_t first = knocks - journal.pending();
+    long forwarded = forward_all(after, first);
+    if (forwarded != (long)journal.pending()) {
+        return fail("overflow", "knocks forwarded", forwarded, journal.pending());
+    }
+    printf("overflow: %u knocks into room for %u, the newest %u kept, %u dropped\n", knocks,
+           journal.capacity(), journal.pending(), journal.dropped());
+    return true;
+}
+
+/*
+ * Appends knocks with the power going after `units` phrases, resets, and
+ * checks what the journal finds. `forward_every` knocks are marked
+ * forwarded before the cut, to tear FORWARDED records too.
+ */
+bool cut_power(uint32_t units, uint32_t forward_every) {
+    host::FileFlash flash(2 * SECTOR_SIZE, SECTOR_SIZE, PHRASE_SIZE);
+    Journal journal(flash);
+    if (!flash.open(NULL) || !journal.mount()) {
+        return fail("power cut", "mount of a blank flash", 0, 1);
+    }
+    // fill the first turn, so the cut lands on a full ring
+    uint32_t index = 0;
+    for (; index < journal.capacity(); index++) {
+        append(journal, index);
+    }
+    forward_all(journal, 0);
+
+    flash.cut_power_after(units);
+    uint32_t first = index;
+    uint32_t written = 0;
+    uint32_t forwarded = 0;
+    for (;; index++) {
+        if (!append(journal, index)) {
+            break;
+        }
+        written++;
+        if (forward_every && written % forward_every == 0) {
+            std::vector<JournalKnock> knocks(written - forwarded);
+            size_t count = journal.peek(&knocks[0], knocks.size());
+            if (count == 0 || !journal.forwarded(knocks[count - 1].sequence)) {
+                break;
+            }
+            forwarded = written;
+        }
+    }
+    flash.restore_power();
+
+    Journal after(flash);
+    if (!after.mount()) {
+        return fail("power cut", "mount after a cut at phrase", units, 0);
+    }
+    // a torn FORWARDED record only sends its batch again
+    uint32_t pending = after.pending();
+    if (pending < written - forwarded || pending > written) {
+        printf("power cut: after %u phrases, %u knocks pending of %u written, %u forwarded\n", units,
+               pending, written, forwarded);
+        return false;
+    }
+    long out = forward_all(after, first + written - pending);
+    if (out != (long)pending) {
+        return fail("power cut", "knocks forwarded after a cut at phrase", units, pending);
+    }
+
+    // and the journal goes on
+    for (uint32_t i = 0; i < journal.capacity(); i++) {
+        if (!append(after, index + i)) {
+            return fail("power cut", "failed append after a cut at phrase", units, 0);
+        }
+    }
+    if (forward_all(after, index) != (long)journal.capacity()) {
+        return fail("power cut", "knocks forwarded after recovering from a cut at phrase", units, 0);
+    }
+    return true;
+}
+
+bool check_power_cut() {
+    // a sector change comes after (slots - 1) knocks, past it by a few records
+    uint32_t slots = SECTOR_SIZE / Journal::SLOT_SIZE;
+    uint32_t phrases = Journal::SLOT_SIZE / PHRASE_SIZE;
+    uint32_t cuts = 0;
+    for (uint32_t forward_every = 0; forward_every <= 4; forward_every += 4) {
+        for (uint32_t units = 0; units < (slots + 4) * phrases; units++) {
+            if (!cut_power(units, forward_every)) {
+                return false;
+            }
+            cuts++;
+        }
+    }
+    printf("power cut: %u cuts at every phrase of a sector and its change, no corrupt or lost record\n",
+           cuts);
+    return true;
+}
+
+bool check_wear() {
+    host::FileFlash flash(journal_options.sectors * SECTOR_SIZE, SECTOR_SIZE, PHRASE_SIZE);
+    Journal journal(flash);
+    if (!flash.open(NULL) || !journal.mount()) {
+        return fail("wear", "mount of a blank flash", 0, 1);
+    }
+    // offline for a while, then forwarded, with a reset now and then
+    uint32_t index = 0;
+    uint32_t outage = journal.capacity() / 5 + 1;
+    uint32_t outages = 0;
+    while (index < journal_options.knocks) {
+        for (uint32_t i = 0; i < outage && index < journal_options.knocks; i++) {
+            if (!append(journal, index++)) {
+                return fail("wear", "failed append of knock", index - 1, 0);
+            }
+        }
+        if (++outages % 7 == 0 && !journal.mount()) {
+            return fail("wear", "mount after outage", outages, 0);
+        }
+        if (forward_all(journal, index - journal.pending()) < 0) {
+            return fail("wear", "gap in outage", outages, 0);
+        }
+    }
+
+    const std::vector<uint32_t> &erases = flash.sector_erases();
+    uint32_t least = *std::min_element(erases.begin(), erases.end());
+    uint32_t most = *std::max_element(erases.begin(), erases.end());
+    double amplification = (double)flash.programmed() / ((double)journal_options.knocks * Journal::SLOT_SIZE);
+    printf("wear: %u knocks in %u outages over %u sectors, each erased %u to %u times\n",
+           journal_options.knocks, outages, journal_options.sectors, least, most);
+    printf("wear: %llu bytes programmed, %.3f per knock byte, %.2f knocks per sector erase\n",
+           (unsigned long long)flash.programmed(), amplification,
+           flash.erases() ? (double)journal_options.knocks / flash.erases() : 0.0);
+    if (journal_options.verbose) {
+        for (size_t i = 0; i < erases.size(); i++) {
+            printf("sector %zu: %u erases\n", i, erases[i]);
+        }
+    }
+    if (most - least > 1) {
+        return fail("wear", "difference in erases between sectors", most - least, 1);
+    }
+    return true;
+}
+
+// the local and server times of the knocks in an encoded KnockBatch
+bool decode(const uint8_t *data, size_t length, std::vector<uint64_t> &local, std::vector<uint64_t> &server) {
+    if (length < 18 || data[0] != 2) {
+        return false;
+    }
+    uint64_t time = 0;
+    uint64_t server_time = 0;
+    for (int i = 0; i < 8; i++) {
+        time = time << 8 | data[2 + i];
+        server_time = server_time << 8 | data[10 + i];
+    }
+    size_t offset = 18;
+    for (uint8_t i = 0; i < data[1]; i++) {
+        uint64_t value = 0;
+        int shift = 0;
+        do {
+            if (offset >= length) {
+                return false;
+            }
+            value |= (uint64_t)(data[offset] & 0x7F) << shift;
+            shift += 7;
+        } while (data[offset++] & 0x80);
+        if (offset++ >= length) {
+            return false;
+        }
+        time += value >> 2;
+        server_time += value >> 2;
+        local.push_back(time);
+        server.push_back(server_time);
+    }
+    return true;
+}
+
+bool check_gap() {
+    typedef KnockBatch<255> Batch;
+    host::FileFlash flash(journal_options.sectors * SECTOR_SIZE, SECTOR_SIZE, PHRASE_SIZE);
+    Journal journal(flash);
+    if (!flash.open(NULL) || !journal.mount()) {
+        return fail("gap", "mount of a blank flash", 0, 1);
+    }
+    // a batch can just time the third knock, not the fourth; the sixth is
+    // after a reset
+    const uint64_t times[] = {
+        10000000, 11000000, 11000000 + Batch::MAX_DELTA, 12000000 + 2ULL * Batch::MAX_DELTA + 1,
+        13000000 + 2ULL * Batch::MAX_DELTA + 1, 5000000, 6000000
+    };
+    const size_t knocks = sizeof(times) / sizeof(times[0]);
+    for (size_t i = 0; i < knocks; i++) {
+        if (!journal.append(times[i], 1466000000000000ULL + times[i], 1000, i % 3)) {
+            return fail("gap", "failed append of knock", i, knocks);
+        }
+    }
+
+    // drain_journal() of the firmware
+    std::vector<JournalKnock> pending(journal_options.batch);
+    std::vector<uint64_t> local;
+    std::vector<uint64_t> server;
+    uint32_t batches = 0;
+    size_t count;
+    while ((count = journal.peek(&pending[0], pending.size())) > 0) {
+        Batch batch;
+        for (size_t i = 0; i < count; i++) {
+            if (!batch.add(pending[i].local, pending[i].server, pending[i].peak, pending[i].axis)) {
+                count = i;
+                break;
+            }
+        }
+        if (!decode(batch.data(), batch.length(), local, server)) {
+            return fail("gap", "undecodable batch", batches, 0);
+        }
+        batches++;
+        if (!journal.forwarded(pending[count - 1].sequence)) {
+            return fail("gap", "failed forward of batch", batches, 0);
+        }
+    }
+
+    if (local.size() != knocks) {
+        return fail("gap", "knocks decoded", local.size(), knocks);
+    }
+    for (size_t i = 0; i < knocks; i++) {
+        if (local[i] != times[i] || server[i] != 1466000000000000ULL + times[i]) {
+            printf("gap: FAILED, knock %zu decoded at %llu us, journaled at %llu us\n", i,
+                   (unsigned long long)local[i], (unsigned long long)times[i]);
+            return false;
+        }
+    }
+    uint32_t expected = journal_options.batch >= 3 ? 3 : 0;
+    if (expected && batches != expected) {
+        return fail("gap", "batches", batches, expected);
+    }
+    printf("gap: %zu knocks across a %.0f minute gap and a reset, in %u batches, all at their times\n",
+           knocks, (Batch::MAX_DELTA + 1000000) / 60e6, batches);
+    return true;
+}
+
+void usage(const char *name) {
+    fprintf(stderr,
+            "usage: %s [options]\n"
+            "  -s, --sectors N       4 KB sectors in the journal (default 16)\n"
+            "  -n, --knocks N        knocks for the wear check (default 200000)\n"
+            "  -b, --batch N         knocks forwarded at a time (default 8)\n"
+            "  -v, --verbose         print the erases of every sector\n",
+            name);
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    static const struct option long_options[] = {
+        { "sectors", required_argument, 0, 's' },
+        { "knocks", required_argument, 0, 'n' },
+        { "batch", required_argument, 0, 'b' },
+        { "verbose", no_argument, 0, 'v' },
+        { "help", no_argument, 0, 'h' },
+        { 0, 0, 0, 0 }
+    };
+
+    journal_options.sectors = 16;
+    journal_options.knocks = 200000;
+    journal_options.batch = 8;
+    journal_options.verbose = false;
+
+    int c;
+    while ((c = getopt_long(argc, argv, "s:n:b:vh", long_options, NULL)) != -1) {
+        switch (c) {
+            case 's':
+                journal_options.sectors = strtoul(optarg, NULL, 10);
+                break;
+            case 'n':
+                journal_options.knocks = strtoul(optarg, NULL, 10);
+                break;
+            case 'b':
+                journal_options.batch = strtoul(optarg, NULL, 10);
+                break;
+            case 'v':
+                journal_options.verbose = true;
+                break;
+            default:
+                usage(argv[0]);
+                return 2;
+        }
+    }
+    if (journal_options.sectors < 2 || journal_options.batch == 0) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    bool passed = check_outage();
+    passed = check_overflow() && passed;
+    passed = check_power_cut() && passed;
+    passed = check_wear() && passed;
+    passed = check_gap() && passed;
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,296 @@
+/*
+ * Copyright (c) 2016 ARM Limited. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <getopt.h>
+#include <math.h>
+#include <stdlib.h>
+#include <sys/resource.h>
+#include <algorithm>
+#include <vector>
+#include "host.h"
+#include "simpleclient.h"
+#include "knock-core/xorshift.h"
+
+/*
+ * Emulates many knock sensors in one process, to load an LWM2M server.
+ *
+ * Every endpoint is the MbedClient of firmware-ethernet with an
+ * accelerometer object of its own (last_knock and knock_count, both
+ * observable) on the host M2MInterface, so each has its own CoAP socket.
+ * Knocks come at random, as a Poisson process with the given rate, and go
+ * through the notify policy of the client like on the board. All endpoints
+ * share the one event loop.
+ */
+namespace {
+
+struct LoadOptions {
+    uint32_t    endpoints;
+    double      knocks_per_minute;
+    uint32_t    ramp;               // registrations started per second
+    const char  *prefix;            // endpoint names are <prefix>-<n>
+};
+
+LoadOptions load;
+
+MbedClientDevice device_info() {
+    // no endpoint type of its own, the transport's
+    MbedClientDevice info = { "Manufacturer_String", "Type_String", "ModelNumber_String", "SerialNumber_String",
+                              NULL };
+    return info;
+}
+
+class Endpoint {
+public:
+    Endpoint(uint32_t index, const String &name)
+        : _client(device_info(), name), _knocks(0),
+          // xorshift starts out small from small seeds, spread them
+          _random((index + 1) * 2654435761u) {
+        _object = M2MInterfaceFactory::create_object("accelerometer");
+        M2MObjectInstance *inst = _object->create_object_instance();
+        _last_knock = inst->create_dynamic_resource("last_knock", "Knock",
+            M2MResourceInstance::INTEGER, true /* observable */);
+        _last_knock->set_operation(M2MBase::GET_ALLOWED);
+        _last_knock->set_value((uint8_t *)"0", 1);
+        _knock_count = inst->create_dynamic_resource("knock_count", "KnockCount",
+            M2MResourceInstance::INTEGER, true /* observable */);
+        _knock_count->set_operation(M2MBase::GET_ALLOWED);
+        _knock_count->set_value((uint8_t *)"0", 1);
+        _client.object_list_push(_object);
+    }
+
+    void start() {
+        _client.network_connected();
+        schedule_knock();
+    }
+
+private:
+    // exponential gaps make the knocks of one endpoint a Poisson process
+    void schedule_knock() {
+        if (load.knocks_per_minute <= 0) {
+            return;
+        }
+        double uniform = (_random.next() + 1.0) / 4294967296.0;
+        double gap_ms = -log(uniform) * 60000.0 / load.knocks_per_minute;
+        minar::Scheduler::postCallback(mbed::util::FunctionPointer(this, &Endpoint::knock).bind())
+            .delay(minar::milliseconds(gap_ms < 1 ? 1 : (uint32_t)gap_ms));
+    }
+
+    void knock() {
+        char buffer[16];
+        int size = snprintf(buffer, sizeof(buffer), "%u", (unsigned)(host::now_us() / 1000));
+        _client.set_value(_last_knock, (uint8_t *)buffer, size);
+        size = snprintf(buffer, sizeof(buffer), "%u", (unsigned)++_knocks);
+        _client.set_value(_knock_count, (uint8_t *)buffer, size);
+        schedule_knock();
+    }
+
+    MbedClient  _client;
+    M2MObject   *_object;
+    M2MResource *_last_knock;
+    M2MResource *_knock_count;
+    uint32_t    _knocks;
+    Xorshift32  _random;
+};
+
+std::vector<Endpoint *> endpoints;
+uint32_t started = 0;
+uint64_t first_start_us = 0;
+uint64_t last_registered_us = 0;
+uint64_t last_registered = 0;
+
+void start_next() {
+    if (!started) {
+        first_start_us = host::now_us();
+    }
+    endpoints[started++]->start();
+}
+
+// notes when the last registration went through, for the registration rate
+void watch_registrations() {
+    uint64_t registered = host::client_stats().registered;
+    if (registered != last_registered) {
+        last_registered = registered;
+        last_registered_us = host::now_us();
+    }
+}
+
+uint32_t percentile(std::vector<uint32_t> values, unsigned p) {
+    if (values.empty()) {
+        return 0;
+    }
+    size_t index = (values.size() - 1) * p / 100;
+    std::nth_element(values.begin(), values.begin() + index, values.end());
+    return values[index];
+}
+
+void report(FILE *out) {
+    const host::ClientStats &stats = host::client_stats();
+    double registering = last_registered_us > first_start_us ? (last_registered_us - first_start_us) / 1e6 : 0;
+    double running = host::now_us() / 1e6;
+
+    fprintf(out, "loadgen: %u endpoints, %u started, %llu registered\n",
+            (unsigned)endpoints.size(), (unsigned)started, (unsigned long long)stats.registered);
+    fprintf(out, "loadgen: registrations %.1f/s, latency p50 %.2f ms p99 %.2f ms\n",
+            registering > 0 ? stats.registered / registering : 0.0,
+            percentile(stats.registration_latency, 50) / 1e3,
+            percentile(stats.registration_latency, 99) / 1e3);
+    fprintf(out, "loadgen: notifications %.1f/s sent, %.1f/s acknowledged, latency p50 %.2f ms p99 %.2f ms\n",
+            running > 0 ? stats.notifications / running : 0.0,
+            running > 0 ? stats.acknowledged / running : 0.0,
+            percentile(stats.notification_latency, 50) / 1e3,
+            percentile(stats.notification_latency, 99) / 1e3);
+}
+
+// every endpoint has a socket of its own
+void raise_file_limit(uint32_t needed) {
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) != 0) {
+        return;
+    }
+    if (limit.rlim_cur < limit.rlim_max) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+    if (limit.rlim_cur < needed) {
+        fprintf(stderr, "loadgen: only %llu file descriptors for %u endpoints, raise ulimit -n\n",
+                (unsigned long long)limit.rlim_cur, (unsigned)needed);
+    }
+}
+
+void usage(const char *name) {
+    fprintf(stderr,
+            "usage: %s [options]\n"
+            "  -n, --endpoints N     emulate N knock sensors (default 100)\n"
+            "  -k, --knocks R        knocks per minute per endpoint (default 6)\n"
+            "  -s, --server H:P      LWM2M server (CoAP), without it the server is simulated\n"
+            "  -d, --duration MS     run this long (default 60000)\n"
+            "      --ramp R          start R registrations per second (default 100)\n"
+            "      --prefix NAME     endpoint names are NAME-<n> (default knock-load)\n"
+            "      --rtt MS          round trip of the simulated server (default 50)\n"
+            "  -v, --verbose         firmware output and every notification\n",
+            name);
+}
+
+bool parse_options(int argc, char *argv[], host::Options &options) {
+    static const struct option long_options[] = {
+        { "endpoints", required_argument, 0, 'n' },
+        { "knocks", required_argument, 0, 'k' },
+        { "server", required_argument, 0, 's' },
+        { "duration", required_argument, 0, 'd' },
+        { "ramp", required_argument, 0, 'R' },
+        { "prefix", required_argument, 0, 'P' },
+        { "rtt", required_argument, 0, 'T' },
+        { "verbose", no_argument, 0, 'v' },
+        { "help", no_argument, 0, 'h' },
+        { 0, 0, 0, 0 }
+    };
+
+    options.trace = NULL;
+    options.server = NULL;
+    options.realtime = false;
+    options.verbose = false;
+    options.duration_ms = 60000;
+    options.tail_ms = 0;
+    options.rtt_ms = 50;
+    options.flash = NULL;
+    options.outage_start_ms = 0;
+    options.outage_ms = 0;
+
+    load.endpoints = 100;
+    load.knocks_per_minute = 6;
+    load.ramp = 100;
+    load.prefix = "knock-load";
+
+    int c;
+    while ((c = getopt_long(argc, argv, "n:k:s:d:vh", long_options, NULL)) != -1) {
+        switch (c) {
+            case 'n':
+                load.endpoints = strtoul(optarg, NULL, 10);
+                break;
+            case 'k':
+                load.knocks_per_minute = strtod(optarg, NULL);
+                break;
+            case 's':
+                options.server = optarg;
+                break;
+            case 'd':
+                options.duration_ms = strtoul(optarg, NULL, 10);
+                break;
+            case 'R':
+                load.ramp = strtoul(optarg, NULL, 10);
+                break;
+            case 'P':
+                load.prefix = optarg;
+                break;
+            case 'T':
+                options.rtt_ms = strtoul(optarg, NULL, 10);
+                break;
+            case 'v':
+                options.verbose = true;
+                break;
+            default:
+                usage(argv[0]);
+                return false;
+        }
+    }
+    if (!load.endpoints || !load.ramp) {
+        usage(argv[0]);
+        return false;
+    }
+    if (options.server) {
+        // a real server answers in real time
+        options.realtime = true;
+    }
+    return true;
+}
+
+} // namespace
+
+#ifdef KNOCK_HOST_SANITIZE
+// the endpoints live until exit, like the firmware objects they stand for
+extern "C" const char *__asan_default_options() {
+    return "detect_leaks=0";
+}
+#endif
+
+int main(int argc, char *argv[]) {
+    host::Options options;
+    if (!parse_options(argc, argv, options)) {
+        return 2;
+    }
+    host::init(options);
+    raise_file_limit(load.endpoints + 16);
+
+    if (!options.verbose) {
+        // thousands of "Registered object successfully!"
+        if (!freopen("/dev/null", "w", stdout)) {
+            fprintf(stderr, "loadgen: can not silence the firmware output\n");
+        }
+    }
+
+    char name[64];
+    for (uint32_t i = 0; i < load.endpoints; i++) {
+        snprintf(name, sizeof(name), "%s-%u", load.prefix, (unsigned)i);
+        endpoints.push_back(new Endpoint(i, name));
+        minar::Scheduler::postCallback(mbed::util::FunctionPointer(&start_next).bind())
+            .delay(minar::milliseconds((uint64_t)i * 1000 / load.ramp));
+    }
+    minar::Scheduler::postCallback(mbed::util::FunctionPointer(&watch_registrations).bind())
+        .period(minar::milliseconds(10));
+
+    host::add_report(report);
+    return host::run();
+}
@@ -0,0 +1,284 @@
+/*
+ * Copyright (c) 2016 ARM Limited. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <getopt.h>
+#include <stdlib.h>
+#include <string>
+#include "host.h"
+#include "mbedclient.h"
+#include "trace_file.h"
+#include "knock-core/int_format.h"
+#include "knock-core/knock_detector.h"
+#include "mbed-client/m2minterfacefactory.h"
+
+/*
+ * Replays the knocks of a trace into the MbedClient of firmware-6lowpan
+ * and counts the notifications that come out. Every knock KnockDetector
+ * finds updates last_knock and knock_count through MbedClient::set_value,
+ * with no refractory time in front, like a noisy sensor would. The notify
+ * policy is the default of config.json. Checks, per resource:
+ *
+ *     interval    no two notifications closer than the minimum interval
+ *     bucket      no more notifications in a row than the bucket allows
+ *     latest      the last value set is the last one notified
+ *
+ * The server is simulated and time is virtual. Exits with 1 when a check
+ * fails.
+ */
+namespace {
+
+struct NotifyOptions {
+    const char  *trace;
+    uint32_t    tail_ms;        // keep running after the last knock
+};
+
+// one resource the knocks update
+struct Counted {
+    const char      *name;
+    M2MResource     *resource;
+    uint32_t        offered;        // set_value() calls
+    uint32_t        sent;
+    uint64_t        last_sent_us;
+    uint32_t        closest_ms;     // between two notifications
+    std::string     last_offered;
+    std::string     last_sent;
+};
+
+NotifyOptions notify_options;
+MbedClient *client;
+std::vector<uint64_t> knocks;   // us from the start of the trace
+size_t next_knock = 0;
+uint64_t start_us = 0;          // when the client registered
+Counted counted[2] = {
+    { "last_knock", NULL, 0, 0, 0, UINT32_MAX, "", "" },
+    { "knock_count", NULL, 0, 0, 0, UINT32_MAX, "", "" },
+};
+bool failed = false;
+
+MbedClientDevice device = {
+    "Manufacturer_String",
+    "Type_String",
+    "ModelNumber_String",
+    "SerialNumber_String",
+    "knock-notify"
+};
+uint8_t mac_addr[8] = { 0x02, 0, 0, 0, 0, 0, 0, 0x01 };
+
+void offer(Counted &counted, uint32_t value) {
+    char buffer[INT_FORMAT_SIZE];
+    size_t length = format_uint(buffer, value);
+    counted.offered++;
+    counted.last_offered.assign(buffer, length);
+    client->set_value(counted.resource, (uint8_t *)buffer, length);
+}
+
+void finish() {
+    minar::Scheduler::stop();
+}
+
+// the knocks due now, then waits for the next one
+void knock() {
+    uint64_t now = host::now_us();
+    while (next_knock < knocks.size() && start_us + knocks[next_knock] <= now) {
+        offer(counted[0], (uint32_t)(knocks[next_knock] / 1000));
+        next_knock++;
+        offer(counted[1], next_knock);
+    }
+    if (next_knock < knocks.size()) {
+        minar::Scheduler::postCallback(mbed::util::FunctionPointer(&knock).bind())
+            .delay(minar::milliseconds((start_us + knocks[next_knock] - now + 999) / 1000));
+    } else {
+        minar::Scheduler::postCallback(mbed::util::FunctionPointer(&finish).bind())
+            .delay(minar::milliseconds(notify_options.tail_ms));
+    }
+}
+
+void registered() {
+    if (start_us) {
+        return;
+    }
+    start_us = host::now_us();
+    knock();
+}
+
+void notified(const M2MResourceInstance &res) {
+    for (size_t i = 0; i < 2; i++) {
+        Counted &c = counted[i];
+        if (&res != c.resource) {
+            continue;
+        }
+        uint64_t now = host::now_us();
+        if (c.sent && (now - c.last_sent_us) / 1000 < c.closest_ms) {
+            c.closest_ms = (now - c.last_sent_us) / 1000;
+        }
+        c.sent++;
+        c.last_sent_us = now;
+        c.last_sent.assign((const char *)res.value(), res.value_length());
+    }
+}
+
+void report(FILE *out) {
+    const NotifyPolicyConfig policy(MbedClientConfig::NOTIFY_MIN_INTERVAL, MbedClientConfig::NOTIFY_MAX_INTERVAL,
+                                    MbedClientConfig::NOTIFY_STEP, MbedClientConfig::NOTIFY_BURST,
+                                    MbedClientConfig::NOTIFY_REFILL);
+    uint64_t span_ms = knocks.empty() ? 0 : (knocks.back() - knocks.front()) / 1000;
+    fprintf(out, "notify: %zu knocks in %.1f s, min interval %u ms, burst %u, refill %u ms\n", knocks.size(),
+            span_ms / 1000.0, (unsigned)policy.min_interval, (unsigned)policy.burst, (unsigned)policy.refill);
+
+    // tokens the bucket holds at the start plus those it earns back, and at
+    // most one notification per minimum interval
+    uint64_t allowed = span_ms / (policy.min_interval ? policy.min_interval : 1) + 1;
+    if (policy.burst) {
+        uint64_t bucket = policy.burst + span_ms / (policy.refill ? policy.refill : 1);
+        allowed = bucket < allowed ? bucket : allowed;
+    }
+    // the value held back when the knocks stopped goes out after them
+    allowed++;
+
+    for (size_t i = 0; i < 2; i++) {
+        const Counted &c = counted[i];
+        fprintf(out, "notify: %s: %u values, %u notifications (%.0f%%)", c.name, (unsigned)c.offered,
+                (unsigned)c.sent, c.offered ? 100.0 * c.sent / c.offered : 0.0);
+        if (c.sent > 1) {
+            fprintf(out, ", at least %u ms apart", (unsigned)c.closest_ms);
+        }
+        fputc('\n', out);
+        if (c.sent > 1 && c.closest_ms < policy.min_interval) {
+            fprintf(out, "notify: FAILED, %s notified %u ms apart\n", c.name, (unsigned)c.closest_ms);
+            failed = true;
+        } else if (c.sent > allowed) {
+            fprintf(out, "notify: FAILED, %s notified %u times, the bucket allows %u\n", c.name,
+                    (unsigned)c.sent, (unsigned)allowed);
+            failed = true;
+        } else if (c.last_sent != c.last_offered) {
+            fprintf(out, "notify: FAILED, %s ended at %s, the server last got %s\n", c.name,
+                    c.last_offered.c_str(), c.last_sent.empty() ? "nothing" : c.last_sent.c_str());
+            failed = true;
+        }
+    }
+    if (!failed) {
+        fprintf(out, "notify: rate limited, latest values delivered\n");
+    }
+}
+
+void usage(const char *name) {
+    fprintf(stderr,
+            "usage: %s [options] TRACE\n"
+            "      --tail MS         keep running MS after the last knock (default 5000)\n"
+            "  -v, --verbose         firmware output and every notification\n",
+            name);
+}
+
+bool parse_options(int argc, char *argv[], host::Options &options) {
+    static const struct option long_options[] = {
+        { "tail", required_argument, 0, 'T' },
+        { "verbose", no_argument, 0, 'v' },
+        { "help", no_argument, 0, 'h' },
+        { 0, 0, 0, 0 }
+    };
+
+    options.trace = NULL;
+    options.server = NULL;
+    options.realtime = false;
+    options.verbose = false;
+    options.duration_ms = 0;
+    options.tail_ms = 0;
+    options.rtt_ms = 50;
+    options.flash = NULL;
+    options.outage_start_ms = 0;
+    options.outage_ms = 0;
+
+    notify_options.tail_ms = 5000;
+
+    int c;
+    while ((c = getopt_long(argc, argv, "vh", long_options, NULL)) != -1) {
+        switch (c) {
+            case 'T':
+                notify_options.tail_ms = strtoul(optarg, NULL, 10);
+                break;
+            case 'v':
+                options.verbose = true;
+                break;
+            default:
+                usage(argv[0]);
+                return false;
+        }
+    }
+    if (optind != argc - 1) {
+        usage(argv[0]);
+        return false;
+    }
+    notify_options.trace = argv[optind];
+    return true;
+}
+
+} // namespace
+
+uint8_t *get_mac_address() {
+    return mac_addr;
+}
+
+#ifdef KNOCK_HOST_SANITIZE
+// the client lives until exit, like on the board
+extern "C" const char *__asan_default_options() {
+    return "detect_leaks=0";
+}
+#endif
+
+int main(int argc, char *argv[]) {
+    host::Options options;
+    if (!parse_options(argc, argv, options)) {
+        return 2;
+    }
+
+    host::Trace trace;
+    if (!host::load_trace(notify_options.trace, trace)) {
+        return 1;
+    }
+    KnockDetector detector;
+    KnockOnset onset;
+    for (size_t i = 0; i < trace.samples.size(); i++) {
+        if (detector.process(trace.samples[i], onset)) {
+            knocks.push_back(trace.timestamps[onset.sample] - trace.timestamps[0]);
+        }
+    }
+
+    host::init(options);
+    if (!options.verbose) {
+        if (!freopen("/dev/null", "w", stdout)) {
+            fprintf(stderr, "notify: can not silence the firmware output\n");
+        }
+    }
+
+    M2MObject *object = M2MInterfaceFactory::create_object("accelerometer");
+    M2MObjectInstance *instance = object->create_object_instance();
+    for (size_t i = 0; i < 2; i++) {
+        counted[i].resource = instance->create_dynamic_resource(counted[i].name, "Knock",
+            M2MResourceInstance::INTEGER, true /* observable */);
+        counted[i].resource->set_operation(M2MBase::GET_ALLOWED);
+        counted[i].resource->set_value((uint8_t *)"0", 1);
+    }
+
+    client = new MbedClient(device);
+    client->object_list_push(object);
+    client->on_registered(mbed::util::FunctionPointer0<void>(&registered));
+    client->network_connected();
+    host::on_notification(notified);
+
+    host::add_report(report);
+    host::run();
+    return failed ? 1 : 0;
+}
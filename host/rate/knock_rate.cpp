@@ -0,0 +1,542 @@
+/*
+ * Copyright (c) 2016 ARM Limited. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <getopt.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+#include "accel_current.h"
+#include "knock-core/adaptive_rate.h"
+#include "knock-core/knock_detector.h"
+#include "knock-core/xorshift.h"
+
+/*
+ * Plays a synthetic day at a door through the knock detector twice: once
+ * at the fixed 400 Hz of the firmware, and once the way
+ * APPL_ACCEL_ADAPTIVE_RATE runs the sensor. There, at the idle rate only
+ * the motion detector looks at the samples it takes, and its interrupt
+ * brings the 400 Hz back after `--latency`. The samples in between are not
+ * taken, and the detector confirms the knock that raised the rate on what
+ * is left of it.
+ *
+ * Visitors come at random times and knock one to three rounds of two to
+ * five knocks, each knock a ringing decay on x or y of random strength,
+ * pitch and length. Half of them open the door afterwards, a slow swing
+ * that the motion detector sees and the knock detector has to reject.
+ *
+ * Reports the knocks each run detected, what the adaptive one lost against
+ * the fixed one, how late its onsets are, and the supply current of the
+ * sensor after accel_current.h. Exits with 1 when it lost more than
+ * `--max-loss` or does not draw less.
+ */
+namespace {
+
+const uint32_t SAMPLE_RATE = 400;
+const uint32_t SAMPLE_PERIOD_US = 1000000 / SAMPLE_RATE;
+const uint8_t ACTIVE_RATE = 1;                  // CTRL_REG1[DR] of 400 Hz
+const uint8_t ACTIVE_MODE = 0;                  // normal
+const int32_t COUNTS_PER_G = 4096;
+
+// FF_MT_THS at the active rate, as FXOS8700CQ::config_feature() sets it
+const uint8_t ACTIVE_MOTION_THRESHOLD = 4;
+
+// drain_events() polls at this rate
+const uint32_t POLL_US = 10000;
+
+// ACCEL_WAKE_ONSET_US of the firmware
+const uint64_t WAKE_ONSET_US = 100000;
+
+// a detection this close to a knock is that knock
+const uint64_t MATCH_US = 50000;
+
+struct RateOptions {
+    double      hours;
+    uint32_t    visits;
+    uint32_t    seed;
+    uint8_t     idle_rate;      // CTRL_REG1[DR]
+    uint8_t     idle_mode;      // CTRL_REG2[MODS]
+    uint8_t     idle_threshold; // FF_MT_THS
+    AdaptiveRateConfig hysteresis;
+    uint32_t    latency_us;     // motion interrupt until the samples come at 400 Hz again
+    double      max_loss;       // percent of the knocks the fixed rate detects
+    bool        verbose;
+};
+
+RateOptions rate_options;
+
+const char *const MODE_NAMES[] = { "normal", "low-noise", "high-res", "low-power" };
+
+/*
+ * Something that moves the board, from sample `start` on
+ */
+struct Event {
+    uint64_t    start;
+    uint64_t    end;
+    bool        knock;          // or a door swing
+    uint8_t     axis;
+    double      amplitude;      // counts
+    double      hz;
+    double      tau;            // s, knock decay or swing length
+    double      phase;
+};
+
+bool by_start(const Event &a, const Event &b) {
+    return a.start < b.start;
+}
+
+double uniform(Xorshift32 &random, double low, double high) {
+    return low + (high - low) * (random.next() / 4294967296.0);
+}
+
+std::vector<Event> make_day(uint64_t samples) {
+    Xorshift32 random(rate_options.seed);
+    std::vector<Event> events;
+    for (uint32_t visit = 0; visit < rate_options.visits; visit++) {
+        double at = uniform(random, 1, samples / (double)SAMPLE_RATE - 60);
+        uint32_t rounds = 1 + random.below_or_equal(2);
+        for (uint32_t round = 0; round < rounds; round++) {
+            uint32_t knocks = 2 + random.below_or_equal(3);
+            for (uint32_t k = 0; k < knocks; k++) {
+                Event knock;
+                knock.knock = true;
+                knock.axis = random.below_or_equal(3) ? 0 : 1;
+                knock.amplitude = uniform(random, 0.3, 1.0) * COUNTS_PER_G;
+                knock.hz = uniform(random, 60, 180);
+                knock.tau = uniform(random, 0.004, 0.015);
+                knock.phase = uniform(random, 0.5, 2.5);
+                knock.start = (uint64_t)(at * SAMPLE_RATE);
+                knock.end = knock.start + (uint64_t)(6 * knock.tau * SAMPLE_RATE) + 1;
+                events.push_back(knock);
+                at += uniform(random, 0.15, 0.4);
+            }
+            at += uniform(random, 3, 10);
+        }
+        if (random.below_or_equal(1)) {
+            Event swing;
+            swing.knock = false;
+            swing.axis = 1;
+            swing.amplitude = uniform(random, 0.3, 0.6) * COUNTS_PER_G;
+            swing.hz = 0;
+            swing.tau = uniform(random, 1, 2);
+            swing.phase = 0;
+            swing.start = (uint64_t)((at - uniform(random, 1, 5)) * SAMPLE_RATE);
+            swing.end = swing.start + (uint64_t)(swing.tau * SAMPLE_RATE);
+            events.push_back(swing);
+        }
+    }
+    std::sort(events.begin(), events.end(), by_start);
+    return events;
+}
+
+double contribution(const Event &event, uint64_t n) {
+    double t = (n - event.start) / (double)SAMPLE_RATE;
+    if (event.knock) {
+        return event.amplitude * exp(-t / event.tau) * sin(2 * M_PI * event.hz * t + event.phase);
+    }
+    // the door opens and swings back, once
+    return event.amplitude * sin(2 * M_PI * t / event.tau);
+}
+
+/*
+ * The samples of the day, at 400 Hz, a board lying flat with sensor noise
+ */
+class Day {
+public:
+    Day(const std::vector<Event> &events)
+        : _events(events), _next(0), _noise(rate_options.seed + 1) {
+    }
+
+    AccelSample sample(uint64_t n) {
+        while (_next < _events.size() && _events[_next].start <= n) {
+            _active.push_back(_next++);
+        }
+        double axes[3] = { 0, 0, (double)COUNTS_PER_G };
+        for (size_t i = 0; i < _active.size();) {
+            const Event &event = _events[_active[i]];
+            if (n >= event.end) {
+                _active[i] = _active.back();
+                _active.pop_back();
+                continue;
+            }
+            axes[event.axis] += contribution(event, n);
+            i++;
+        }
+        AccelSample sample;
+        sample.x = clamp(axes[0] + noise());
+        sample.y = clamp(axes[1] + noise());
+        sample.z = clamp(axes[2] + noise());
+        return sample;
+    }
+
+private:
+    int16_t clamp(double value) {
+        // 14 bit, +/-2g
+        return (int16_t)std::max(-8192.0, std::min(8191.0, value));
+    }
+
+    double noise() {
+        return (int32_t)_noise.below_or_equal(40) - 20;
+    }
+
+    const std::vector<Event>    &_events;
+    size_t                      _next;
+    std::vector<size_t>         _active;
+    Xorshift32                  _noise;
+};
+
+// the motion detector as the FXOS8700CQ driver sets it up, X or Y above `threshold`
+bool motion(const AccelSample &sample, uint8_t threshold) {
+    int32_t counts = threshold * 63 * COUNTS_PER_G / 1000;
+    return abs(sample.x) > counts || abs(sample.y) > counts;
+}
+
+/*
+ * Detections against the knocks of the day: `detected` are the knocks with
+ * a detection within MATCH_US, `false_knocks` the detections without one.
+ */
+struct Score {
+    std::vector<bool>   detected;
+    uint32_t            count;
+    uint32_t            false_knocks;
+};
+
+Score score(const std::vector<Event> &events, const std::vector<uint64_t> &onsets) {
+    std::vector<uint64_t> knocks;
+    for (size_t i = 0; i < events.size(); i++) {
+        if (events[i].knock) {
+            knocks.push_back(events[i].start * SAMPLE_PERIOD_US);
+        }
+    }
+    Score result;
+    result.detected.assign(knocks.size(), false);
+    result.count = 0;
+    result.false_knocks = 0;
+    for (size_t i = 0; i < onsets.size(); i++) {
+        std::vector<uint64_t>::iterator next = std::lower_bound(knocks.begin(), knocks.end(), onsets[i]);
+        size_t best = knocks.size();
+        uint64_t distance = MATCH_US + 1;
+        if (next != knocks.end() && *next - onsets[i] < distance) {
+            best = next - knocks.begin();
+            distance = *next - onsets[i];
+        }
+        if (next != knocks.begin() && onsets[i] - *(next - 1) < distance) {
+            best = next - 1 - knocks.begin();
+            distance = onsets[i] - *(next - 1);
+        }
+        if (best == knocks.size() || result.detected[best]) {
+            result.false_knocks++;
+        } else {
+            result.detected[best] = true;
+            result.count++;
+        }
+    }
+    return result;
+}
+
+// the knock closest to `time`, in `events`
+const Event *knock_at(const std::vector<Event> &events, uint64_t time) {
+    const Event *best = NULL;
+    uint64_t distance = UINT64_MAX;
+    for (size_t i = 0; i < events.size(); i++) {
+        uint64_t start = events[i].start * SAMPLE_PERIOD_US;
+        uint64_t d = start > time ? start - time : time - start;
+        if (events[i].knock && d < distance) {
+            best = &events[i];
+            distance = d;
+        }
+    }
+    return best;
+}
+
+void print_knock(const char *what, const Event &event) {
+    uint64_t ms = event.start * 1000 / SAMPLE_RATE;
+    printf("  %s %02u:%02u:%02u.%03u on %c, %.2f g, %.0f Hz, %.1f ms decay\n", what,
+           (unsigned)(ms / 3600000), (unsigned)(ms / 60000 % 60), (unsigned)(ms / 1000 % 60), (unsigned)(ms % 1000),
+           'x' + event.axis, event.amplitude / COUNTS_PER_G, event.hz, event.tau * 1000);
+}
+
+bool run() {
+    uint64_t samples = (uint64_t)(rate_options.hours * 3600 * SAMPLE_RATE);
+    std::vector<Event> events = make_day(samples);
+    uint32_t knocks = 0;
+    for (size_t i = 0; i < events.size(); i++) {
+        knocks += events[i].knock;
+    }
+
+    KnockDetector fixed;
+    KnockDetector adaptive;
+    AdaptiveRate rate(rate_options.hysteresis);
+    std::vector<uint64_t> fixed_onsets;
+    std::vector<uint64_t> adaptive_onsets;
+
+    // samples fed to the adaptive detector, by their index there
+    std::vector<uint64_t> fed(256);
+    uint32_t decimation = (uint32_t)(host::accel_rate_hz(ACTIVE_RATE) / host::accel_rate_hz(rate_options.idle_rate));
+    if (decimation == 0) {
+        decimation = 1;
+    }
+    bool sensor_active = true;
+    uint64_t active_since = 0;
+    uint64_t resume = 0;            // 400 Hz samples are taken again from here
+    uint64_t idle_since = 0;
+    uint64_t active_us = 0;
+    uint64_t wake = 0;
+    bool wake_onset = false;
+    uint32_t confirmed = 0;
+    uint64_t late_us = 0;
+    uint64_t latest_us = 0;
+
+    Day day(events);
+    rate.start(0);
+    for (uint64_t n = 0; n < samples; n++) {
+        AccelSample sample = day.sample(n);
+        uint64_t now = n * SAMPLE_PERIOD_US;
+        KnockOnset knock;
+
+        if (fixed.process(sample, knock)) {
+            fixed_onsets.push_back((uint64_t)knock.sample * SAMPLE_PERIOD_US);
+        }
+
+        if (now % POLL_US == 0 && sensor_active && rate.quiet(now)) {
+            sensor_active = false;
+            idle_since = n;
+            active_us += now - active_since;
+        }
+
+        if (!sensor_active) {
+            if ((n - idle_since) % decimation == 0 && motion(sample, rate_options.idle_threshold)) {
+                rate.motion(now);
+                sensor_active = true;
+                active_since = now;
+                wake = now;
+                wake_onset = true;
+                resume = now + rate_options.latency_us;
+                adaptive.resume();
+            }
+            continue;
+        }
+        if (now < resume) {
+            continue;
+        }
+        if (motion(sample, ACTIVE_MOTION_THRESHOLD)) {
+            rate.motion(now);
+        }
+        fed[adaptive.samples() % fed.size()] = now;
+        if (adaptive.process(sample, knock)) {
+            uint64_t local = fed[knock.sample % fed.size()];
+            if (wake_onset && local < wake + WAKE_ONSET_US) {
+                const Event *event = knock_at(events, wake);
+                uint64_t late = event ? wake - std::min(wake, event->start * SAMPLE_PERIOD_US) : 0;
+                late_us += late;
+                latest_us = std::max(latest_us, late);
+                confirmed++;
+                local = wake;
+            }
+            wake_onset = false;
+            adaptive_onsets.push_back(local);
+            rate.motion(local);
+        }
+    }
+    if (sensor_active) {
+        active_us += samples * SAMPLE_PERIOD_US - active_since;
+    }
+
+    Score fixed_score = score(events, fixed_onsets);
+    Score adaptive_score = score(events, adaptive_onsets);
+    uint32_t lost = 0;
+    uint32_t missed = 0;
+    size_t k = 0;
+    for (size_t i = 0; i < events.size(); i++) {
+        if (!events[i].knock) {
+            continue;
+        }
+        if (fixed_score.detected[k] && !adaptive_score.detected[k]) {
+            lost++;
+            if (rate_options.verbose) {
+                print_knock("lost", events[i]);
+            }
+        } else if (!fixed_score.detected[k] && rate_options.verbose) {
+            print_knock("missed at 400 Hz", events[i]);
+        }
+        missed += !fixed_score.detected[k];
+        k++;
+    }
+
+    uint64_t total_us = samples * SAMPLE_PERIOD_US;
+    double fixed_ua = host::accel_current_ua(true, ACTIVE_RATE, ACTIVE_MODE);
+    double idle_ua = host::accel_current_ua(true, rate_options.idle_rate, rate_options.idle_mode);
+    double adaptive_ua = (fixed_ua * active_us + idle_ua * (total_us - active_us)) / total_us;
+    double loss = fixed_score.count ? 100.0 * lost / fixed_score.count : 0;
+
+    printf("day: %.1f h, %u visits, %u knocks, %zu door swings\n", rate_options.hours, rate_options.visits,
+           knocks, events.size() - knocks);
+    printf("fixed: 400 Hz normal, %u knocks detected, %u missed, %u false, %.1f uA\n",
+           fixed_score.count, missed, fixed_score.false_knocks, fixed_ua);
+    printf("adaptive: %g Hz %s and %u mg when idle, %u knocks detected, %u lost against the fixed rate (%.2f%%), %u false\n",
+           host::accel_rate_hz(rate_options.idle_rate), MODE_NAMES[rate_options.idle_mode],
+           rate_options.idle_threshold * 63, adaptive_score.count,
+           lost, loss, adaptive_score.false_knocks);
+    printf("adaptive: %u wake-ups, %u of them confirmed as a knock, onsets %.1f ms late on average, %.1f ms at most\n",
+           rate.wakeups(), confirmed, confirmed ? late_us / 1000.0 / confirmed : 0.0, latest_us / 1000.0);
+    printf("adaptive: %.2f%% of the time at 400 Hz, %.1f uA, %.1fx less than fixed\n",
+           100.0 * active_us / total_us, adaptive_ua, fixed_ua / adaptive_ua);
+
+    bool passed = true;
+    if (loss > rate_options.max_loss) {
+        printf("loss: FAILED, %.2f%% of the knocks lost, at most %.2f%% allowed\n", loss, rate_options.max_loss);
+        passed = false;
+    }
+    if (adaptive_ua >= fixed_ua) {
+        printf("current: FAILED, the adaptive rate does not draw less\n");
+        passed = false;
+    }
+    return passed;
+}
+
+// CTRL_REG1[DR] of a rate in Hz, -1 when the sensor does not have it
+int parse_rate(const char *text) {
+    double hz = strtod(text, NULL);
+    for (uint8_t dr = 0; dr < 8; dr++) {
+        if (fabs(host::accel_rate_hz(dr) - hz) < 0.1) {
+            return dr;
+        }
+    }
+    return -1;
+}
+
+int parse_mode(const char *text) {
+    for (int mode = 0; mode < 4; mode++) {
+        if (strcmp(text, MODE_NAMES[mode]) == 0) {
+            return mode;
+        }
+    }
+    return -1;
+}
+
+void usage(const char *name) {
+    fprintf(stderr,
+            "usage: %s [options]\n"
+            "  -d, --hours H             length of the day (default 24)\n"
+            "  -k, --visits N            visitors in that time (default 50)\n"
+            "      --seed N              of the random day (default 1)\n"
+            "  -r, --idle-rate HZ        800, 400, 200, 100, 50, 12.5, 6.25 or 1.56 (default 200)\n"
+            "  -m, --idle-mode MODE      normal, low-noise, high-res or low-power (default low-power)\n"
+            "  -t, --idle-threshold N    motion threshold in 63 mg steps (default 1)\n"
+            "  -i, --idle-after MS       without motion for this long the rate goes down (default 5000)\n"
+            "      --max-idle-after MS   longest wait when it keeps coming back (default 60000)\n"
+            "      --latency US          motion interrupt until 400 Hz are back (default 2000)\n"
+            "      --max-loss PERCENT    knocks the adaptive rate may lose (default 1)\n"
+            "  -v, --verbose             print every knock lost or missed\n",
+            name);
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    enum {
+        OPT_SEED = 256,
+        OPT_MAX_IDLE_AFTER,
+        OPT_LATENCY,
+        OPT_MAX_LOSS
+    };
+    static const struct option long_options[] = {
+        { "hours", required_argument, 0, 'd' },
+        { "visits", required_argument, 0, 'k' },
+        { "seed", required_argument, 0, OPT_SEED },
+        { "idle-rate", required_argument, 0, 'r' },
+        { "idle-mode", required_argument, 0, 'm' },
+        { "idle-threshold", required_argument, 0, 't' },
+        { "idle-after", required_argument, 0, 'i' },
+        { "max-idle-after", required_argument, 0, OPT_MAX_IDLE_AFTER },
+        { "latency", required_argument, 0, OPT_LATENCY },
+        { "max-loss", required_argument, 0, OPT_MAX_LOSS },
+        { "verbose", no_argument, 0, 'v' },
+        { "help", no_argument, 0, 'h' },
+        { 0, 0, 0, 0 }
+    };
+
+    rate_options.hours = 24;
+    rate_options.visits = 50;
+    rate_options.seed = 1;
+    rate_options.idle_rate = 2;
+    rate_options.idle_mode = 3;
+    rate_options.idle_threshold = 1;
+    rate_options.latency_us = 2000;
+    rate_options.max_loss = 1;
+    rate_options.verbose = false;
+
+    int c;
+    int value;
+    while ((c = getopt_long(argc, argv, "d:k:r:m:t:i:vh", long_options, NULL)) != -1) {
+        switch (c) {
+            case 'd':
+                rate_options.hours = strtod(optarg, NULL);
+                break;
+            case 'k':
+                rate_options.visits = strtoul(optarg, NULL, 10);
+                break;
+            case OPT_SEED:
+                rate_options.seed = strtoul(optarg, NULL, 10);
+                break;
+            case 'r':
+                if ((value = parse_rate(optarg)) < 0) {
+                    usage(argv[0]);
+                    return 2;
+                }
+                rate_options.idle_rate = value;
+                break;
+            case 'm':
+                if ((value = parse_mode(optarg)) < 0) {
+                    usage(argv[0]);
+                    return 2;
+                }
+                rate_options.idle_mode = value;
+                break;
+            case 't':
+                rate_options.idle_threshold = strtoul(optarg, NULL, 10);
+                break;
+            case 'i':
+                rate_options.hysteresis.idle_after = strtoul(optarg, NULL, 10);
+                break;
+            case OPT_MAX_IDLE_AFTER:
+                rate_options.hysteresis.max_idle_after = strtoul(optarg, NULL, 10);
+                break;
+            case OPT_LATENCY:
+                rate_options.latency_us = strtoul(optarg, NULL, 10);
+                break;
+            case OPT_MAX_LOSS:
+                rate_options.max_loss = strtod(optarg, NULL);
+                break;
+            case 'v':
+                rate_options.verbose = true;
+                break;
+            default:
+                usage(argv[0]);
+                return 2;
+        }
+    }
+    // the day has to fit a visit
+    if (rate_options.hours < 0.1 || rate_options.idle_threshold == 0 || rate_options.idle_threshold > 127 ||
+        rate_options.hysteresis.max_idle_after < rate_options.hysteresis.idle_after) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    return run() ? 0 : 1;
+}
@@ -0,0 +1,332 @@
+/*
+ * Copyright (c) 2016 ARM Limited. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <ctype.h>
+#include <netdb.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "http.h"
+
+namespace host {
+namespace server {
+
+namespace {
+
+// no request or response of ours comes close
+const size_t MAX_HEADER = 16 * 1024;
+const size_t MAX_BODY = 16 * 1024 * 1024;
+
+std::string lower(std::string text) {
+    for (size_t i = 0; i < text.size(); i++) {
+        text[i] = tolower((unsigned char)text[i]);
+    }
+    return text;
+}
+
+std::string trim(const std::string &text) {
+    size_t start = text.find_first_not_of(" \t");
+    size_t end = text.find_last_not_of(" \t");
+    return start == std::string::npos ? std::string() : text.substr(start, end - start + 1);
+}
+
+const char *reason(int status) {
+    switch (status) {
+        case 200: return "OK";
+        case 202: return "Accepted";
+        case 204: return "No Content";
+        case 400: return "Bad Request";
+        case 401: return "Unauthorized";
+        case 404: return "Not Found";
+        case 405: return "Method Not Allowed";
+        case 410: return "Gone";
+        case 502: return "Bad Gateway";
+        case 504: return "Gateway Timeout";
+        default: return "Unknown";
+    }
+}
+
+} // namespace
+
+std::string HttpMessage::header(const std::string &name) const {
+    std::map<std::string, std::string>::const_iterator it = headers.find(name);
+    return it == headers.end() ? std::string() : it->second;
+}
+
+bool HttpMessage::keep_alive() const {
+    return lower(header("connection")) != "close";
+}
+
+bool HttpConnection::read_request(HttpMessage &request) {
+    return read_message(request, true);
+}
+
+bool HttpConnection::read_response(HttpMessage &response) {
+    return read_message(response, false);
+}
+
+bool HttpConnection::read_message(HttpMessage &message, bool request) {
+    std::string line;
+    if (!read_line(line)) {
+        return false;
+    }
+    message.headers.clear();
+    message.body.clear();
+
+    size_t first = line.find(' ');
+    size_t second = line.find(' ', first + 1);
+    if (first == std::string::npos) {
+        return false;
+    }
+    if (request) {
+        std::string target = line.substr(first + 1, second == std::string::npos ? std::string::npos
+                                                                              : second - first - 1);
+        size_t question = target.find('?');
+        message.method = line.substr(0, first);
+        message.path = target.substr(0, question);
+        message.query = question == std::string::npos ? std::string() : target.substr(question + 1);
+    } else {
+        message.status = atoi(line.c_str() + first + 1);
+    }
+
+    while (true) {
+        if (!read_line(line)) {
+            return false;
+        }
+        if (line.empty()) {
+            break;
+        }
+        size_t colon = line.find(':');
+        if (colon != std::string::npos) {
+            message.headers[lower(trim(line.substr(0, colon)))] = trim(line.substr(colon + 1));
+        }
+    }
+
+    if (lower(message.header("transfer-encoding")) == "chunked") {
+        while (true) {
+            if (!read_line(line)) {
+                return false;
+            }
+            size_t size = strtoul(line.c_str(), NULL, 16);
+            if (size == 0) {
+                // the trailer, usually empty
+                while (read_line(line) && !line.empty()) {
+                }
+                return true;
+            }
+            if (message.body.size() + size > MAX_BODY || !read_bytes(size, message.body) || !read_line(line)) {
+                return false;
+            }
+        }
+    }
+
+    std::string length = message.header("content-length");
+    if (!length.empty()) {
+        size_t size = strtoul(length.c_str(), NULL, 10);
+        return size <= MAX_BODY && read_bytes(size, message.body);
+    }
+    if (!request && !message.keep_alive() && message.status != 204) {
+        // the body runs until the connection closes
+        while (fill()) {
+        }
+        message.body.swap(_buffer);
+    }
+    return true;
+}
+
+bool HttpConnection::read_line(std::string &line) {
+    size_t end;
+    while ((end = _buffer.find("\r\n")) == std::string::npos) {
+        if (_buffer.size() > MAX_HEADER || !fill()) {
+            return false;
+        }
+    }
+    line = _buffer.substr(0, end);
+    _buffer.erase(0, end + 2);
+    return true;
+}
+
+bool HttpConnection::read_bytes(size_t count, std::string &out) {
+    while (_buffer.size() < count) {
+        if (!fill()) {
+            return false;
+        }
+    }
+    out.append(_buffer, 0, count);
+    _buffer.erase(0, count);
+    return true;
+}
+
+bool HttpConnection::fill() {
+    char chunk[8192];
+    ssize_t length = recv(_fd, chunk, sizeof(chunk), 0);
+    if (length <= 0) {
+        return false;
+    }
+    _buffer.append(chunk, length);
+    return true;
+}
+
+bool HttpConnection::write_all(const std::string &data) {
+    size_t sent = 0;
+    while (sent < data.size()) {
+        ssize_t length = ::send(_fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (length <= 0) {
+            return false;
+        }
+        sent += length;
+    }
+    return true;
+}
+
+bool HttpConnection::write_request(const std::string &method, const std::string &host, const std::string &path,
+                                   const std::string &content_type, const std::string &body) {
+    std::string head = method + " " + path + " HTTP/1.1\r\n"
+                       "Host: " + host + "\r\n"
+                       "Content-Type: " + content_type + "\r\n"
+                       "Content-Length: " + std::to_string(body.size()) + "\r\n"
+                       "\r\n";
+    return write_all(head + body);
+}
+
+bool HttpConnection::write_response(int status, const std::string &content_type, const std::string &body,
+                                    bool keep_alive) {
+    std::string head = "HTTP/1.1 " + std::to_string(status) + " " + reason(status) + "\r\n";
+    if (!content_type.empty()) {
+        head += "Content-Type: " + content_type + "\r\n";
+    }
+    head += "Content-Length: " + std::to_string(body.size()) + "\r\n";
+    head += keep_alive ? "Connection: keep-alive\r\n" : "Connection: close\r\n";
+    head += "\r\n";
+    return write_all(head + body);
+}
+
+bool parse_url(const std::string &text, Url &url) {
+    const std::string scheme = "http://";
+    if (lower(text.substr(0, scheme.size())) != scheme) {
+        return false;
+    }
+    size_t slash = text.find('/', scheme.size());
+    std::string authority = text.substr(scheme.size(), slash == std::string::npos ? std::string::npos
+                                                                                  : slash - scheme.size());
+    url.path = slash == std::string::npos ? "/" : text.substr(slash);
+
+    size_t colon = authority.rfind(':');
+    size_t bracket = authority.rfind(']');
+    if (colon != std::string::npos && (bracket == std::string::npos || colon > bracket)) {
+        url.host = authority.substr(0, colon);
+        url.port = authority.substr(colon + 1);
+    } else {
+        url.host = authority;
+        url.port = "80";
+    }
+    if (url.host.size() > 2 && url.host[0] == '[') {
+        url.host = url.host.substr(1, url.host.size() - 2);
+    }
+    return !url.host.empty();
+}
+
+int connect_to(const Url &url, uint32_t timeout_ms) {
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    struct addrinfo *result;
+    if (getaddrinfo(url.host.c_str(), url.port.c_str(), &hints, &result) != 0) {
+        return -1;
+    }
+    int fd = -1;
+    for (struct addrinfo *ai = result; ai && fd < 0; ai = ai->ai_next) {
+        fd = socket(ai->ai_family, ai->ai_socktype | SOCK_CLOEXEC, ai->ai_protocol);
+        if (fd < 0) {
+            continue;
+        }
+        struct timeval timeout = { (time_t)(timeout_ms / 1000), (suseconds_t)(timeout_ms % 1000 * 1000) };
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+        if (connect(fd, ai->ai_addr, ai->ai_addrlen) != 0) {
+            close(fd);
+            fd = -1;
+        }
+    }
+    freeaddrinfo(result);
+    return fd;
+}
+
+std::string base64_encode(const std::string &data) {
+    static const char ALPHABET[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string out;
+    out.reserve((data.size() + 2) / 3 * 4);
+    for (size_t i = 0; i < data.size(); i += 3) {
+        uint32_t group = (uint8_t)data[i] << 16;
+        if (i + 1 < data.size()) {
+            group |= (uint8_t)data[i + 1] << 8;
+        }
+        if (i + 2 < data.size()) {
+            group |= (uint8_t)data[i + 2];
+        }
+        out += ALPHABET[group >> 18 & 0x3F];
+        out += ALPHABET[group >> 12 & 0x3F];
+        out += i + 1 < data.size() ? ALPHABET[group >> 6 & 0x3F] : '=';
+        out += i + 2 < data.size() ? ALPHABET[group & 0x3F] : '=';
+    }
+    return out;
+}
+
+std::string json_string(const std::string &text) {
+    std::string out = "\"";
+    for (size_t i = 0; i < text.size(); i++) {
+        unsigned char c = text[i];
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if (c < 0x20) {
+            char escape[8];
+            snprintf(escape, sizeof(escape), "\\u%04x", c);
+            out += escape;
+        } else {
+            out += c;
+        }
+    }
+    return out + "\"";
+}
+
+bool json_field(const std::string &json, const std::string &name, std::string &value) {
+    size_t key = json.find(json_string(name));
+    if (key == std::string::npos) {
+        return false;
+    }
+    size_t colon = json.find(':', key);
+    size_t quote = colon == std::string::npos ? colon : json.find('"', colon);
+    if (quote == std::string::npos) {
+        return false;
+    }
+    value.clear();
+    for (size_t i = quote + 1; i < json.size(); i++) {
+        if (json[i] == '"') {
+            return true;
+        }
+        if (json[i] == '\\' && i + 1 < json.size()) {
+            i++;
+        }
+        value += json[i];
+    }
+    return false;
+}
+
+} // namespace server
+} // namespace host
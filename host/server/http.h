@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) 2016 ARM Limited. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef __HOST_SERVER_HTTP_H__
+#define __HOST_SERVER_HTTP_H__
+
+#include <stdint.h>
+#include <map>
+#include <string>
+
+/*
+ * Just enough HTTP/1.1 for the REST API and the callback push: requests
+ * and responses with Content-Length or chunked bodies, keep-alive, no TLS.
+ */
+namespace host {
+namespace server {
+
+struct HttpMessage {
+    std::string                         method;     // requests
+    std::string                         path;       // requests, without the query
+    std::string                         query;      // requests, after the '?'
+    int                                 status;     // responses
+    std::map<std::string, std::string>  headers;    // names in lower case
+    std::string                         body;
+
+    std::string header(const std::string &name) const;
+    bool keep_alive() const;
+};
+
+// a connected socket, either side
+class HttpConnection {
+public:
+    explicit HttpConnection(int fd)
+        : _fd(fd) {
+    }
+
+    // false on EOF, a timeout or a malformed message
+    bool read_request(HttpMessage &request);
+    bool read_response(HttpMessage &response);
+
+    bool write_request(const std::string &method, const std::string &host, const std::string &path,
+                       const std::string &content_type, const std::string &body);
+    bool write_response(int status, const std::string &content_type, const std::string &body,
+                        bool keep_alive);
+
+private:
+    bool read_message(HttpMessage &message, bool request);
+    bool read_line(std::string &line);
+    bool read_bytes(size_t count, std::string &out);
+    bool fill();
+    bool write_all(const std::string &data);
+
+    int         _fd;
+    std::string _buffer;
+};
+
+// http://host[:port]/path
+struct Url {
+    std::string host;
+    std::string port;
+    std::string path;
+};
+
+bool parse_url(const std::string &text, Url &url);
+
+// connects to `url`, with a timeout on every read and write; -1 on failure
+int connect_to(const Url &url, uint32_t timeout_ms);
+
+std::string base64_encode(const std::string &data);
+
+// `text` as a quoted JSON string
+std::string json_string(const std::string &text);
+
+// the string value of `name` in a flat JSON object, like {"url": "http://..."}
+bool json_field(const std::string &json, const std::string &name, std::string &value);
+
+} // namespace server
+} // namespace host
+
+#endif // __HOST_SERVER_HTTP_H__
@@ -0,0 +1,229 @@
+/*
+ * Copyright (c) 2016 ARM Limited. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <getopt.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <chrono>
+#include <thread>
+#include "registry.h"
+#include "rest.h"
+
+namespace host {
+namespace server {
+
+Counters &counters() {
+    static Counters instance;
+    return instance;
+}
+
+uint64_t now_ms() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+uint64_t wall_us() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+} // namespace server
+} // namespace host
+
+namespace {
+
+using namespace host::server;
+
+struct ServerOptions {
+    const char  *address;       // NULL for all interfaces, IPv6 and IPv4
+    uint16_t    coap_port;
+    uint16_t    http_port;
+    unsigned    threads;
+    const char  *token;         // required as "Authorization: Bearer", NULL for none
+    const char  *callback;      // callback URL to start with
+    uint32_t    timeout_ms;     // REST requests waiting for an endpoint
+    uint32_t    stats_s;        // 0 = no stats line
+    bool        verbose;
+};
+
+volatile sig_atomic_t stopping = 0;
+
+void stop(int /*signal*/) {
+    stopping = 1;
+}
+
+// one line of rates since the last one
+void print_stats(Registry &registry, double seconds) {
+    static uint64_t last[6];
+    Counters &c = counters();
+    uint64_t now[6] = {
+        c.registrations, c.updates, c.notifications, c.pushed_events, c.pushes, c.http_requests
+    };
+    double rate[6];
+    for (int i = 0; i < 6; i++) {
+        rate[i] = (now[i] - last[i]) / seconds;
+        last[i] = now[i];
+    }
+    fprintf(stderr, "server: %zu endpoints, %.1f registrations/s, %.1f updates/s, %.1f notifications/s, "
+            "%.1f events/s pushed in %.1f PUTs/s, %.1f HTTP requests/s\n",
+            registry.size(), rate[0], rate[1], rate[2], rate[3], rate[4], rate[5]);
+}
+
+void print_totals(Registry &registry) {
+    Counters &c = counters();
+    fprintf(stderr, "server: %zu endpoints at exit\n"
+            "coap: %llu registrations, %llu updates, %llu deregistrations, %llu expired, "
+            "%llu notifications, %llu requests, %llu retransmissions, %llu timeouts, %llu duplicates, "
+            "%llu clock pings, %llu datagrams in, %llu out\n"
+            "http: %llu requests, %llu events pushed in %llu PUTs, %llu failed PUTs, %llu events dropped\n",
+            registry.size(),
+            (unsigned long long)c.registrations, (unsigned long long)c.updates,
+            (unsigned long long)c.deregistrations, (unsigned long long)c.expirations,
+            (unsigned long long)c.notifications, (unsigned long long)c.requests,
+            (unsigned long long)c.retransmissions, (unsigned long long)c.timeouts,
+            (unsigned long long)c.duplicates, (unsigned long long)c.clock_pings,
+            (unsigned long long)c.datagrams_in, (unsigned long long)c.datagrams_out,
+            (unsigned long long)c.http_requests,
+            (unsigned long long)c.pushed_events, (unsigned long long)c.pushes,
+            (unsigned long long)c.push_failures, (unsigned long long)c.dropped_events);
+}
+
+void usage(const char *name) {
+    fprintf(stderr,
+            "usage: %s [options]\n"
+            "  -c, --coap-port PORT  LWM2M over CoAP, UDP (default 5683)\n"
+            "  -p, --http-port PORT  REST API (default 8080)\n"
+            "  -b, --bind ADDRESS    listen on ADDRESS only (default all)\n"
+            "  -t, --threads N       CoAP threads (default one per CPU)\n"
+            "      --token TOKEN     require \"Authorization: Bearer TOKEN\"\n"
+            "      --callback URL    push notifications to URL from the start\n"
+            "      --timeout MS      how long REST requests wait for an endpoint (default 10000)\n"
+            "      --stats S         print rates every S seconds, 0 for never (default 10)\n"
+            "  -v, --verbose         log every registration\n",
+            name);
+}
+
+bool parse_options(int argc, char *argv[], ServerOptions &options) {
+    static const struct option long_options[] = {
+        { "coap-port", required_argument, 0, 'c' },
+        { "http-port", required_argument, 0, 'p' },
+        { "bind", required_argument, 0, 'b' },
+        { "threads", required_argument, 0, 't' },
+        { "token", required_argument, 0, 'T' },
+        { "callback", required_argument, 0, 'C' },
+        { "timeout", required_argument, 0, 'W' },
+        { "stats", required_argument, 0, 'S' },
+        { "verbose", no_argument, 0, 'v' },
+        { "help", no_argument, 0, 'h' },
+        { 0, 0, 0, 0 }
+    };
+
+    options.address = NULL;
+    options.coap_port = 5683;
+    options.http_port = 8080;
+    options.threads = std::thread::hardware_concurrency();
+    options.token = NULL;
+    options.callback = NULL;
+    options.timeout_ms = 10000;
+    options.stats_s = 10;
+    options.verbose = false;
+
+    int c;
+    while ((c = getopt_long(argc, argv, "c:p:b:t:vh", long_options, NULL)) != -1) {
+        switch (c) {
+            case 'c':
+                options.coap_port = strtoul(optarg, NULL, 10);
+                break;
+            case 'p':
+                options.http_port = strtoul(optarg, NULL, 10);
+                break;
+            case 'b':
+                options.address = optarg;
+                break;
+            case 't':
+                options.threads = strtoul(optarg, NULL, 10);
+                break;
+            case 'T':
+                options.token = optarg;
+                break;
+            case 'C':
+                options.callback = optarg;
+                break;
+            case 'W':
+                options.timeout_ms = strtoul(optarg, NULL, 10);
+                break;
+            case 'S':
+                options.stats_s = strtoul(optarg, NULL, 10);
+                break;
+            case 'v':
+                options.verbose = true;
+                break;
+            default:
+                usage(argv[0]);
+                return false;
+        }
+    }
+    if (!options.threads) {
+        options.threads = 1;
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    ServerOptions options;
+    if (!parse_options(argc, argv, options)) {
+        return 2;
+    }
+
+    CallbackPusher pusher;
+    if (options.callback && !pusher.set_url(options.callback)) {
+        fprintf(stderr, "server: --callback needs an http:// URL\n");
+        return 2;
+    }
+    Registry registry(pusher, options.verbose);
+    RestApi api(registry, pusher, options.token ? options.token : "", options.timeout_ms);
+
+    signal(SIGINT, stop);
+    signal(SIGTERM, stop);
+    signal(SIGPIPE, SIG_IGN);
+
+    pusher.start();
+    if (!registry.start(options.address, options.coap_port, options.threads) ||
+        !api.start(options.address, options.http_port)) {
+        return 1;
+    }
+    fprintf(stderr, "server: CoAP on UDP port %u with %u threads, REST API on http://%s:%u\n",
+            (unsigned)options.coap_port, options.threads, options.address ? options.address : "localhost",
+            (unsigned)options.http_port);
+
+    uint64_t last = now_ms();
+    while (!stopping) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        uint64_t now = now_ms();
+        if (options.stats_s && now - last >= options.stats_s * 1000) {
+            print_stats(registry, (now - last) / 1e3);
+            last = now;
+        }
+    }
+
+    api.stop();
+    registry.stop();
+    pusher.stop();
+    print_totals(registry);
+    return 0;
+}
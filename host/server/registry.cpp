@@ -0,0 +1,758 @@
+/*
+ * Copyright (c) 2016 ARM Limited. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <errno.h>
+#include <netdb.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "registry.h"
+
+namespace host {
+namespace server {
+
+using namespace coap;
+
+namespace {
+
+// RFC 7252 section 4.8.2, how long a retransmitted CON can still arrive
+const uint64_t EXCHANGE_LIFETIME_MS = 247000;
+
+// how long to wait for a separate response after an empty ACK
+const uint32_t SEPARATE_RESPONSE_MS = 10000;
+
+const uint32_t DEFAULT_LIFETIME = 86400;
+
+// clock alignment of the endpoints, see knock-core/clock_sync.h
+const char *const CLOCK_PING = "time/0/ping";
+const char *const CLOCK_PONG = "time/0/pong";
+
+// the registration, e.g. </3/0/0>,</accelerometer/0/last_knock>;obs;rt="Knock"
+std::vector<Resource> parse_links(const std::string &payload) {
+    std::vector<Resource> resources;
+    size_t start = 0;
+    while (start < payload.size()) {
+        size_t end = payload.find(",<", start);
+        if (end == std::string::npos) {
+            end = payload.size();
+        }
+        std::string link = payload.substr(start, end - start);
+        start = end + 1;
+
+        size_t open = link.find('<');
+        size_t close = link.find('>');
+        if (open == std::string::npos || close == std::string::npos || close < open) {
+            continue;
+        }
+        Resource resource;
+        resource.path = link.substr(open + 1, close - open - 1);
+        if (!resource.path.empty() && resource.path[0] == '/') {
+            resource.path.erase(0, 1);
+        }
+        resource.observable = false;
+
+        size_t attribute = link.find(';', close);
+        while (attribute != std::string::npos) {
+            size_t next = link.find(';', attribute + 1);
+            std::string value = link.substr(attribute + 1, next == std::string::npos ? std::string::npos
+                                                                                  : next - attribute - 1);
+            if (value == "obs") {
+                resource.observable = true;
+            } else if (value.compare(0, 3, "rt=") == 0) {
+                resource.type = value.substr(3);
+                if (resource.type.size() >= 2 && resource.type[0] == '"') {
+                    resource.type = resource.type.substr(1, resource.type.size() - 2);
+                }
+            }
+            attribute = next;
+        }
+        resources.push_back(resource);
+    }
+    return resources;
+}
+
+// peer address and message id, the key for duplicate detection
+std::string exchange_key(const struct sockaddr_storage &address, socklen_t length, uint16_t id) {
+    std::string key((const char *)&address, length);
+    key += (char)(id >> 8);
+    key += (char)id;
+    return key;
+}
+
+template <typename C>
+void complete(const std::shared_ptr<C> &completion, uint8_t code, const std::string &payload,
+              uint16_t content_format, uint32_t block2 = 0) {
+    std::lock_guard<std::mutex> lock(completion->mutex);
+    completion->done = true;
+    completion->reply.code = code;
+    completion->reply.payload = payload;
+    completion->reply.content_format = content_format;
+    completion->reply.block2 = block2;
+    completion->ready.notify_all();
+}
+
+uint16_t content_format(const Message &message) {
+    uint32_t format = TEXT_PLAIN;
+    message.uint_option(CONTENT_FORMAT, format);
+    return format;
+}
+
+uint32_t block2(const Message &message) {
+    uint32_t value = 0;
+    message.uint_option(BLOCK2, value);
+    return value;
+}
+
+} // namespace
+
+Registry::Registry(EventSink &sink, bool verbose)
+    : _sink(sink), _verbose(verbose), _stopping(false), _next_location(1),
+      _random(std::random_device()()) {
+    _next_id = _random();
+    _next_token = (uint64_t)_random() << 32 | _random();
+}
+
+Registry::~Registry() {
+    stop();
+}
+
+bool Registry::start(const char *address, uint16_t port, unsigned threads) {
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = address ? AF_UNSPEC : AF_INET6;
+    hints.ai_socktype = SOCK_DGRAM;
+    hints.ai_flags = AI_PASSIVE;
+    std::string service = std::to_string(port);
+    struct addrinfo *result;
+    if (getaddrinfo(address, service.c_str(), &hints, &result) != 0) {
+        fprintf(stderr, "server: can not resolve %s\n", address);
+        return false;
+    }
+
+    for (unsigned i = 0; i < threads; i++) {
+        int fd = socket(result->ai_family, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+        int on = 1, off = 0;
+        int buffer = 4 << 20;
+        // wake up now and then to see whether to stop
+        struct timeval timeout = { 0, 100000 };
+        if (fd < 0 ||
+            (result->ai_family == AF_INET6 && setsockopt(fd, IPPROTO_IPV6, IPV6_V6ONLY, &off, sizeof(off)) != 0) ||
+            setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on)) != 0 ||
+            setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)) != 0 ||
+            bind(fd, result->ai_addr, result->ai_addrlen) != 0) {
+            fprintf(stderr, "server: can not listen on UDP port %u: %s\n", (unsigned)port, strerror(errno));
+            if (fd >= 0) {
+                close(fd);
+            }
+            freeaddrinfo(result);
+            stop();
+            return false;
+        }
+        // bursts of registrations, best effort
+        setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &buffer, sizeof(buffer));
+        _sockets.push_back(fd);
+    }
+    freeaddrinfo(result);
+
+    for (size_t i = 0; i < _sockets.size(); i++) {
+        _threads.push_back(std::thread(&Registry::serve, this, _sockets[i]));
+    }
+    _threads.push_back(std::thread(&Registry::housekeeping, this));
+    return true;
+}
+
+void Registry::stop() {
+    _stopping = true;
+    for (size_t i = 0; i < _threads.size(); i++) {
+        _threads[i].join();
+    }
+    _threads.clear();
+    for (size_t i = 0; i < _sockets.size(); i++) {
+        close(_sockets[i]);
+    }
+    _sockets.clear();
+}
+
+std::vector<Registry::EndpointInfo> Registry::endpoints() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    std::vector<EndpointInfo> result;
+    for (std::map<std::string, Endpoint>::const_iterator it = _endpoints.begin(); it != _endpoints.end(); ++it) {
+        EndpointInfo info = { it->second.name, it->second.type };
+        result.push_back(info);
+    }
+    return result;
+}
+
+bool Registry::resources(const std::string &endpoint, std::vector<Resource> &resources) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    std::map<std::string, Endpoint>::const_iterator it = _endpoints.find(endpoint);
+    if (it == _endpoints.end()) {
+        return false;
+    }
+    resources = it->second.resources;
+    return true;
+}
+
+size_t Registry::size() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _endpoints.size();
+}
+
+Registry::Status Registry::request(const std::string &endpoint, uint8_t code, const std::string &path,
+                                   const std::string &payload, bool observe, uint32_t timeout_ms,
+                                   Reply &reply) {
+    Status status = exchange(endpoint, code, path, payload, observe, 0, timeout_ms, reply);
+    if (status != DONE || reply.code != CONTENT || !(reply.block2 & 0x08)) {
+        return status;
+    }
+
+    // RFC 7959, the rest of a large answer is asked for block by block
+    std::string whole;
+    Block block = Block::from(reply.block2);
+    while (status == DONE && reply.code == CONTENT && block.more) {
+        whole += reply.payload;
+        block.num++;
+        block.more = false;
+        status = exchange(endpoint, GET, path, std::string(), false, block.value(), timeout_ms, reply);
+        Block answer = Block::from(reply.block2);
+        if (status == DONE && reply.code == CONTENT && answer.num * answer.size() != block.num * block.size()) {
+            // the endpoint started over with other blocks
+            reply.code = INTERNAL_ERROR;
+        }
+        block = answer;
+    }
+    if (status != DONE || reply.code != CONTENT) {
+        return status;
+    }
+    reply.payload = whole + reply.payload;
+    reply.block2 = 0;
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    std::map<std::string, Endpoint>::iterator ep = _endpoints.find(endpoint);
+    if (ep != _endpoints.end()) {
+        ep->second.values[path] = reply;
+    }
+    return status;
+}
+
+Registry::Status Registry::exchange(const std::string &endpoint, uint8_t code, const std::string &path,
+                                    const std::string &payload, bool observe, uint32_t block2,
+                                    uint32_t timeout_ms, Reply &reply) {
+    std::shared_ptr<Completion> completion = send_request(endpoint, code, path, payload, observe, block2);
+    if (!completion) {
+        return NO_ENDPOINT;
+    }
+
+    std::unique_lock<std::mutex> lock(completion->mutex);
+    if (!completion->ready.wait_for(lock, std::chrono::milliseconds(timeout_ms),
+                                    [&completion]() { return completion->done; })) {
+        return TIMEOUT;
+    }
+    reply = completion->reply;
+    return reply.code ? DONE : TIMEOUT;
+}
+
+std::shared_ptr<Registry::Completion> Registry::send_request(const std::string &endpoint, uint8_t code,
+                                                             const std::string &path, const std::string &payload,
+                                                             bool observe, uint32_t block2) {
+    std::shared_ptr<Completion> completion = std::make_shared<Completion>();
+    Peer peer;
+    std::string datagram;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        std::map<std::string, Endpoint>::iterator it = _endpoints.find(endpoint);
+        if (it == _endpoints.end()) {
+            return std::shared_ptr<Completion>();
+        }
+        Endpoint &ep = it->second;
+
+        Message message;
+        message.type = CON;
+        message.code = code;
+        message.id = _next_id++;
+        uint64_t token = _next_token++;
+        message.token.assign((const char *)&token, sizeof(token));
+        if (observe) {
+            message.add_uint_option(OBSERVE, 0);
+        }
+        message.add_path(URI_PATH, path);
+        if (block2) {
+            message.add_uint_option(BLOCK2, block2);
+        }
+        if (!payload.empty()) {
+            message.add_uint_option(CONTENT_FORMAT, TEXT_PLAIN);
+            message.payload = payload;
+        }
+
+        if (observe) {
+            // a new observation replaces the one before
+            std::map<std::string, std::string>::iterator old = ep.observations.find(path);
+            if (old != ep.observations.end()) {
+                _tokens.erase(old->second);
+            }
+            ep.observations[path] = message.token;
+            _tokens[message.token] = std::make_pair(ep.name, path);
+        }
+
+        Pending &pending = _pending[message.id];
+        pending.endpoint = ep.name;
+        pending.path = path;
+        pending.token = message.token;
+        pending.observe = observe;
+        pending.datagram = encode(message);
+        pending.peer = ep.peer;
+        pending.timeout = ACK_TIMEOUT + _random() % (ACK_TIMEOUT / 2 + 1);
+        pending.due = now_ms() + pending.timeout;
+        pending.retransmissions = 0;
+        pending.acknowledged = false;
+        pending.completion = completion;
+        peer = pending.peer;
+        datagram = pending.datagram;
+    }
+    counters().requests++;
+    send(peer, datagram);
+    return completion;
+}
+
+bool Registry::cancel_observation(const std::string &endpoint, const std::string &path) {
+    Peer peer;
+    Message message;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        std::map<std::string, Endpoint>::iterator it = _endpoints.find(endpoint);
+        if (it == _endpoints.end()) {
+            return false;
+        }
+        std::map<std::string, std::string>::iterator observation = it->second.observations.find(path);
+        if (observation == it->second.observations.end()) {
+            return false;
+        }
+        // RFC 7641 section 3.6, a GET with Observe 1 and the same token
+        message.type = NON;
+        message.code = GET;
+        message.id = _next_id++;
+        message.token = observation->second;
+        message.add_uint_option(OBSERVE, 1);
+        message.add_path(URI_PATH, path);
+        _tokens.erase(observation->second);
+        it->second.observations.erase(observation);
+        peer = it->second.peer;
+    }
+    send(peer, encode(message));
+    return true;
+}
+
+bool Registry::observed(const std::string &endpoint, const std::string &path) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    std::map<std::string, Endpoint>::const_iterator it = _endpoints.find(endpoint);
+    return it != _endpoints.end() && it->second.observations.count(path);
+}
+
+bool Registry::cached(const std::string &endpoint, const std::string &path, Reply &reply) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    std::map<std::string, Endpoint>::const_iterator it = _endpoints.find(endpoint);
+    if (it == _endpoints.end()) {
+        return false;
+    }
+    std::map<std::string, Reply>::const_iterator value = it->second.values.find(path);
+    if (value == it->second.values.end()) {
+        return false;
+    }
+    reply = value->second;
+    return true;
+}
+
+void Registry::serve(int fd) {
+    uint8_t buffer[1500];
+    while (!_stopping) {
+        Peer peer;
+        peer.length = sizeof(peer.address);
+        peer.fd = fd;
+        ssize_t length = recvfrom(fd, buffer, sizeof(buffer), 0, (struct sockaddr *)&peer.address, &peer.length);
+        if (length >= 0) {
+            received(peer, buffer, length);
+        }
+    }
+}
+
+void Registry::received(const Peer &peer, const uint8_t *data, size_t length) {
+    counters().datagrams_in++;
+    Message message;
+    if (!decode(data, length, message)) {
+        return;
+    }
+    if (message.is_request()) {
+        handle_request(peer, message);
+    } else if (message.type == ACK || message.type == RST) {
+        handle_ack(message);
+    } else if (message.code != EMPTY) {
+        handle_response(peer, message);
+    } else if (message.type == CON) {
+        // CoAP ping
+        Message reset;
+        reset.type = RST;
+        reset.id = message.id;
+        send(peer, encode(reset));
+    }
+}
+
+void Registry::handle_request(const Peer &peer, const Message &request) {
+    std::string key;
+    if (request.type == CON) {
+        key = exchange_key(peer.address, peer.length, request.id);
+        std::string datagram;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            std::unordered_map<std::string, Answered>::const_iterator it = _answered.find(key);
+            if (it != _answered.end()) {
+                datagram = it->second.datagram;
+            }
+        }
+        if (!datagram.empty()) {
+            // our answer got lost, the endpoint asks again
+            counters().duplicates++;
+            send(peer, datagram);
+            return;
+        }
+    }
+
+    Message reply;
+    reply.type = request.type == CON ? ACK : NON;
+    reply.token = request.token;
+    reply.code = NOT_FOUND;
+    std::vector<Event> events;
+    std::string path = request.path();
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        reply.id = request.type == CON ? request.id : _next_id++;
+
+        if (path == "rd") {
+            if (request.code == POST) {
+                register_endpoint(peer, request, reply, events);
+            } else {
+                reply.code = METHOD_NOT_ALLOWED;
+            }
+        } else if (_locations.count(path)) {
+            Endpoint &ep = _endpoints[_locations[path]];
+            Event event;
+            event.endpoint = ep.name;
+            event.type = ep.type;
+            if (request.code == POST) {
+                // registration update
+                std::string lifetime;
+                if (request.query("lt", lifetime)) {
+                    ep.lifetime = strtoul(lifetime.c_str(), NULL, 10);
+                }
+                ep.expires = now_ms() + (uint64_t)ep.lifetime * 1000;
+                ep.peer = peer;
+                if (!request.payload.empty()) {
+                    ep.resources = parse_links(request.payload);
+                }
+                event.kind = Event::REG_UPDATE;
+                event.resources = ep.resources;
+                reply.code = CHANGED;
+                counters().updates++;
+            } else if (request.code == DELETE) {
+                event.kind = Event::DEREGISTRATION;
+                forget_observations(ep);
+                _locations.erase(path);
+                _endpoints.erase(event.endpoint);
+                reply.code = DELETED;
+                counters().deregistrations++;
+            } else {
+                reply.code = METHOD_NOT_ALLOWED;
+            }
+            if (reply.code != METHOD_NOT_ALLOWED) {
+                events.push_back(event);
+            }
+        }
+
+        if (request.type == CON) {
+            Answered &answered = _answered[key];
+            answered.datagram = encode(reply);
+            answered.expires = now_ms() + EXCHANGE_LIFETIME_MS;
+        }
+    }
+
+    if (_verbose) {
+        printf("server: %s /%s -> %s\n", code_name(request.code).c_str(), path.c_str(),
+               code_name(reply.code).c_str());
+    }
+    send(peer, encode(reply));
+    push(events);
+    observe_clock(events);
+}
+
+// with _mutex held
+void Registry::register_endpoint(const Peer &peer, const Message &request, Message &reply,
+                                 std::vector<Event> &events) {
+    std::string name;
+    if (!request.query("ep", name) || name.empty()) {
+        reply.code = BAD_REQUEST;
+        return;
+    }
+
+    std::map<std::string, Endpoint>::iterator old = _endpoints.find(name);
+    if (old != _endpoints.end()) {
+        // registering again replaces the old registration and its observations
+        forget_observations(old->second);
+        _locations.erase(old->second.location);
+        _endpoints.erase(old);
+    }
+
+    Endpoint &ep = _endpoints[name];
+    ep.name = name;
+    request.query("et", ep.type);
+    std::string lifetime;
+    ep.lifetime = request.query("lt", lifetime) ? strtoul(lifetime.c_str(), NULL, 10) : DEFAULT_LIFETIME;
+    ep.expires = now_ms() + (uint64_t)ep.lifetime * 1000;
+    ep.peer = peer;
+    ep.resources = parse_links(request.payload);
+    ep.location = "rd/" + std::to_string(_next_location++);
+    _locations[ep.location] = name;
+
+    reply.code = CREATED;
+    reply.add_path(LOCATION_PATH, ep.location);
+    counters().registrations++;
+
+    Event event;
+    event.kind = Event::REGISTRATION;
+    event.endpoint = name;
+    event.type = ep.type;
+    event.resources = ep.resources;
+    events.push_back(event);
+}
+
+// with _mutex held
+void Registry::forget_observations(Endpoint &endpoint) {
+    for (std::map<std::string, std::string>::const_iterator it = endpoint.observations.begin();
+         it != endpoint.observations.end(); ++it) {
+        _tokens.erase(it->second);
+    }
+    endpoint.observations.clear();
+}
+
+/*
+ * Starts observing the pings of the endpoints that registered, or updated
+ * their registration, with /time/0/ping. Nobody waits for the answer.
+ */
+void Registry::observe_clock(const std::vector<Event> &events) {
+    for (size_t i = 0; i < events.size(); i++) {
+        const Event &event = events[i];
+        if (event.kind != Event::REGISTRATION && event.kind != Event::REG_UPDATE) {
+            continue;
+        }
+        for (size_t j = 0; j < event.resources.size(); j++) {
+            if (event.resources[j].path == CLOCK_PING && event.resources[j].observable &&
+                !observed(event.endpoint, CLOCK_PING)) {
+                send_request(event.endpoint, GET, CLOCK_PING, std::string(), true, 0);
+            }
+        }
+    }
+}
+
+void Registry::handle_ack(const Message &message) {
+    std::shared_ptr<Completion> completion;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        std::map<uint16_t, Pending>::iterator it = _pending.find(message.id);
+        if (it == _pending.end()) {
+            return;
+        }
+        Pending &pending = it->second;
+        if (message.type == ACK && message.code == EMPTY) {
+            pending.acknowledged = true;
+            pending.due = now_ms() + SEPARATE_RESPONSE_MS;
+            return;
+        }
+
+        bool observing = message.type == ACK && message.code == CONTENT && message.has_option(OBSERVE);
+        std::map<std::string, Endpoint>::iterator ep = _endpoints.find(pending.endpoint);
+        if (pending.observe && !observing && _tokens.count(pending.token)) {
+            // the endpoint did not take the observation
+            _tokens.erase(pending.token);
+            if (ep != _endpoints.end()) {
+                ep->second.observations.erase(pending.path);
+            }
+        }
+        // a value in blocks is cached once request() has all of them
+        if (ep != _endpoints.end() && message.code == CONTENT && !message.has_option(BLOCK2)) {
+            Reply &value = ep->second.values[pending.path];
+            value.code = message.code;
+            value.payload = message.payload;
+            value.content_format = content_format(message);
+            value.block2 = 0;
+        }
+        completion = pending.completion;
+        _pending.erase(it);
+    }
+    // a reset has code 0, which request() takes as no answer
+    complete(completion, message.type == RST ? 0 : message.code, message.payload, content_format(message),
+             block2(message));
+}
+
+void Registry::handle_response(const Peer &peer, const Message &response) {
+    // as close to the arrival of a ping as it gets
+    uint64_t received = wall_us();
+    bool known = false;
+    std::shared_ptr<Completion> completion;
+    std::vector<Event> events;
+    std::string pong;           // endpoint to answer a ping of
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        std::unordered_map<std::string, std::pair<std::string, std::string> >::const_iterator observation =
+            _tokens.find(response.token);
+        std::map<std::string, Endpoint>::iterator ep =
+            observation == _tokens.end() ? _endpoints.end() : _endpoints.find(observation->second.first);
+        if (ep != _endpoints.end()) {
+            known = true;
+            Reply &value = ep->second.values[observation->second.second];
+            value.code = response.code;
+            value.payload = response.payload;
+            value.content_format = content_format(response);
+            value.block2 = 0;
+
+            if (observation->second.second == CLOCK_PING) {
+                pong = ep->first;
+            } else {
+                Event event;
+                event.kind = Event::NOTIFICATION;
+                event.endpoint = ep->first;
+                event.path = observation->second.second;
+                event.payload = response.payload;
+                event.content_format = value.content_format;
+                events.push_back(event);
+            }
+            counters().notifications++;
+        } else {
+            // a separate response to one of our requests
+            for (std::map<uint16_t, Pending>::iterator it = _pending.begin(); it != _pending.end(); ++it) {
+                if (it->second.token == response.token) {
+                    known = true;
+                    completion = it->second.completion;
+                    _pending.erase(it);
+                    break;
+                }
+            }
+        }
+    }
+
+    if (response.type == CON) {
+        // RFC 7641 section 3.6, a reset ends an observation nobody wants
+        Message answer;
+        answer.type = known ? ACK : RST;
+        answer.id = response.id;
+        send(peer, encode(answer));
+    }
+    if (!pong.empty()) {
+        // the ping as it came, when it came and now, as the PUT leaves
+        std::string payload = response.payload + " " + std::to_string(received) + " " + std::to_string(wall_us());
+        send_request(pong, PUT, CLOCK_PONG, payload, false, 0);
+        counters().clock_pings++;
+    }
+    if (completion) {
+        complete(completion, response.code, response.payload, content_format(response), block2(response));
+    }
+    push(events);
+}
+
+void Registry::housekeeping() {
+    uint64_t last_prune = 0;
+    while (!_stopping) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+        std::vector<std::pair<Peer, std::string> > resend;
+        std::vector<std::shared_ptr<Completion> > failed;
+        std::vector<Event> events;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            uint64_t now = now_ms();
+            for (std::map<uint16_t, Pending>::iterator it = _pending.begin(); it != _pending.end();) {
+                Pending &pending = it->second;
+                if (pending.due > now) {
+                    ++it;
+                } else if (pending.acknowledged || pending.retransmissions == MAX_RETRANSMIT) {
+                    counters().timeouts++;
+                    if (pending.observe && _tokens.count(pending.token)) {
+                        _tokens.erase(pending.token);
+                        std::map<std::string, Endpoint>::iterator ep = _endpoints.find(pending.endpoint);
+                        if (ep != _endpoints.end()) {
+                            ep->second.observations.erase(pending.path);
+                        }
+                    }
+                    failed.push_back(pending.completion);
+                    _pending.erase(it++);
+                } else {
+                    pending.retransmissions++;
+                    pending.timeout *= 2;
+                    pending.due = now + pending.timeout;
+                    counters().retransmissions++;
+                    resend.push_back(std::make_pair(pending.peer, pending.datagram));
+                    ++it;
+                }
+            }
+
+            if (now - last_prune >= 1000) {
+                last_prune = now;
+                for (std::map<std::string, Endpoint>::iterator it = _endpoints.begin(); it != _endpoints.end();) {
+                    if (it->second.expires > now) {
+                        ++it;
+                        continue;
+                    }
+                    Event event;
+                    event.kind = Event::EXPIRED;
+                    event.endpoint = it->first;
+                    events.push_back(event);
+                    counters().expirations++;
+                    forget_observations(it->second);
+                    _locations.erase(it->second.location);
+                    _endpoints.erase(it++);
+                }
+                for (std::unordered_map<std::string, Answered>::iterator it = _answered.begin(); it != _answered.end();) {
+                    if (it->second.expires <= now) {
+                        it = _answered.erase(it);
+                    } else {
+                        ++it;
+                    }
+                }
+            }
+        }
+
+        for (size_t i = 0; i < resend.size(); i++) {
+            send(resend[i].first, resend[i].second);
+        }
+        for (size_t i = 0; i < failed.size(); i++) {
+            complete(failed[i], 0, std::string(), TEXT_PLAIN);
+        }
+        push(events);
+    }
+}
+
+void Registry::send(const Peer &peer, const std::string &datagram) {
+    if (sendto(peer.fd, datagram.data(), datagram.size(), 0, (const struct sockaddr *)&peer.address,
+               peer.length) >= 0) {
+        counters().datagrams_out++;
+    }
+}
+
+void Registry::push(const std::vector<Event> &events) {
+    for (size_t i = 0; i < events.size(); i++) {
+        _sink.push(events[i]);
+    }
+}
+
+} // namespace server
+} // namespace host
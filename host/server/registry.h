@@ -0,0 +1,187 @@
+/*
+ * Copyright (c) 2016 ARM Limited. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef __HOST_SERVER_REGISTRY_H__
+#define __HOST_SERVER_REGISTRY_H__
+
+#include <netinet/in.h>
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <random>
+#include <vector>
+#include "coap.h"
+#include "server.h"
+
+namespace host {
+namespace server {
+
+/*
+ * The CoAP side: the LWM2M resource directory at /rd, requests from the
+ * REST API to the endpoints, observations and their notifications.
+ *
+ * Every worker thread has a UDP socket of its own on the same port
+ * (SO_REUSEPORT), so the kernel spreads the endpoints over them by address.
+ * All state is behind one mutex; the threads only hold it to look things
+ * up, never while sending or waiting.
+ *
+ * Endpoints with a /time/0/ping resource are observed from the start, and
+ * every ping is answered with a PUT of /time/0/pong that carries the server
+ * clock, see knock-core/clock_sync.h.
+ */
+class Registry {
+public:
+    enum Status {
+        DONE,
+        NO_ENDPOINT,
+        TIMEOUT
+    };
+
+    // the answer of an endpoint to a request
+    struct Reply {
+        uint8_t     code;
+        std::string payload;
+        uint16_t    content_format;
+        uint32_t    block2;         // Block2 option of the answer, 0 when there was none
+    };
+
+    struct EndpointInfo {
+        std::string name;
+        std::string type;
+    };
+
+    Registry(EventSink &sink, bool verbose);
+    ~Registry();
+
+    // binds `threads` sockets to `address`:`port` (IPv6 and IPv4) and starts
+    bool start(const char *address, uint16_t port, unsigned threads);
+    void stop();
+
+    std::vector<EndpointInfo> endpoints();
+    bool resources(const std::string &endpoint, std::vector<Resource> &resources);
+    size_t size();
+
+    /*
+    * Sends `code` (GET, PUT or POST) for `path` to `endpoint` and waits for
+    * the answer. A GET with `observe` also starts observing the resource;
+    * its notifications go to the EventSink. An answer in Block2 blocks is
+    * fetched to the end and returned whole.
+    */
+    Status request(const std::string &endpoint, uint8_t code, const std::string &path,
+                   const std::string &payload, bool observe, uint32_t timeout_ms, Reply &reply);
+
+    // stops observing, false when nobody did
+    bool cancel_observation(const std::string &endpoint, const std::string &path);
+    bool observed(const std::string &endpoint, const std::string &path);
+
+    // the last value notified or read, false when there is none
+    bool cached(const std::string &endpoint, const std::string &path, Reply &reply);
+
+private:
+    struct Peer {
+        struct sockaddr_storage address;
+        socklen_t               length;
+        int                     fd;         // the socket it last talked to
+    };
+
+    struct Endpoint {
+        std::string                         name;
+        std::string                         type;
+        std::string                         location;       // "rd/<n>"
+        uint32_t                            lifetime;       // s
+        uint64_t                            expires;        // now_ms()
+        Peer                                peer;
+        std::vector<Resource>               resources;
+        std::map<std::string, std::string>  observations;   // path to token
+        std::map<std::string, Reply>        values;         // path to the last value
+    };
+
+    struct Completion {
+        Completion() : done(false) {
+        }
+
+        std::mutex              mutex;
+        std::condition_variable ready;
+        bool                    done;
+        Reply                   reply;
+    };
+
+    // a request to an endpoint, retransmitted until it is acknowledged
+    struct Pending {
+        std::string                 endpoint;
+        std::string                 path;
+        std::string                 token;
+        bool                        observe;
+        std::string                 datagram;
+        Peer                        peer;
+        uint64_t                    due;            // next retransmission, now_ms()
+        uint32_t                    timeout;
+        uint32_t                    retransmissions;
+        bool                        acknowledged;   // empty ACK, the response comes separately
+        std::shared_ptr<Completion> completion;
+    };
+
+    // the answer to a CON request, for when it comes again
+    struct Answered {
+        std::string datagram;
+        uint64_t    expires;
+    };
+
+    // sends a request, its answer goes to the completion; NULL without the endpoint
+    std::shared_ptr<Completion> send_request(const std::string &endpoint, uint8_t code, const std::string &path,
+                                             const std::string &payload, bool observe, uint32_t block2);
+    // one request and its answer, `block2` is the Block2 option to send or 0
+    Status exchange(const std::string &endpoint, uint8_t code, const std::string &path,
+                    const std::string &payload, bool observe, uint32_t block2, uint32_t timeout_ms,
+                    Reply &reply);
+    void serve(int fd);
+    void housekeeping();
+    void received(const Peer &peer, const uint8_t *data, size_t length);
+    void handle_request(const Peer &peer, const coap::Message &request);
+    void handle_ack(const coap::Message &message);
+    void handle_response(const Peer &peer, const coap::Message &response);
+    void register_endpoint(const Peer &peer, const coap::Message &request, coap::Message &reply,
+                           std::vector<Event> &events);
+    void forget_observations(Endpoint &endpoint);
+    void observe_clock(const std::vector<Event> &events);
+    void send(const Peer &peer, const std::string &datagram);
+    void push(const std::vector<Event> &events);
+
+    EventSink                                       &_sink;
+    bool                                            _verbose;
+    std::vector<int>                                _sockets;
+    std::vector<std::thread>                        _threads;
+    std::atomic<bool>                               _stopping;
+
+    std::mutex                                      _mutex;
+    std::map<std::string, Endpoint>                 _endpoints;     // by name
+    std::map<std::string, std::string>              _locations;     // "rd/<n>" to name
+    std::unordered_map<std::string, std::pair<std::string, std::string> > _tokens;  // observation token to (name, path)
+    std::map<uint16_t, Pending>                     _pending;       // by message id
+    std::unordered_map<std::string, Answered>       _answered;      // by peer address and message id
+    uint32_t                                        _next_location;
+    uint16_t                                        _next_id;
+    uint64_t                                        _next_token;
+    std::mt19937                                    _random;
+};
+
+} // namespace server
+} // namespace host
+
+#endif // __HOST_SERVER_REGISTRY_H__
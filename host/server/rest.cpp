@@ -0,0 +1,518 @@
+/*
+ * Copyright (c) 2016 ARM Limited. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <errno.h>
+#include <netdb.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "rest.h"
+
+namespace host {
+namespace server {
+
+namespace {
+
+// events waiting for the callback, beyond this the oldest go
+const size_t MAX_QUEUE = 100000;
+
+const uint32_t PUSH_TIMEOUT_MS = 5000;
+
+std::string content_type_name(uint16_t format) {
+    switch (format) {
+        case coap::TEXT_PLAIN:
+            return "text/plain";
+        case coap::LINK_FORMAT:
+            return "application/link-format";
+        case coap::OCTET_STREAM:
+            return "application/octet-stream";
+        default:
+            return std::to_string(format);
+    }
+}
+
+// HTTP status for the CoAP response code of an endpoint
+int http_status(uint8_t code) {
+    switch (code) {
+        case coap::CREATED:
+        case coap::DELETED:
+        case coap::CHANGED:
+        case coap::CONTENT:
+            return 200;
+        case coap::BAD_REQUEST:
+            return 400;
+        case coap::NOT_FOUND:
+            return 404;
+        case coap::METHOD_NOT_ALLOWED:
+            return 405;
+        default:
+            return 502;
+    }
+}
+
+std::string resources_json(const std::vector<Resource> &resources, const char *path_key) {
+    std::string json = "[";
+    for (size_t i = 0; i < resources.size(); i++) {
+        if (i) {
+            json += ",";
+        }
+        json += "{\"" + std::string(path_key) + "\":" + json_string("/" + resources[i].path) +
+                ",\"rt\":" + json_string(resources[i].type) +
+                ",\"obs\":" + (resources[i].observable ? "true" : "false") +
+                ",\"type\":\"\"}";
+    }
+    return json + "]";
+}
+
+// the body of one callback PUT
+std::string events_json(const std::vector<Event> &events) {
+    static const char *KEYS[] = {
+        "notifications", "registrations", "reg-updates", "de-registrations", "registrations-expired"
+    };
+    std::string arrays[5];
+    for (size_t i = 0; i < events.size(); i++) {
+        const Event &event = events[i];
+        std::string &array = arrays[event.kind];
+        if (!array.empty()) {
+            array += ",";
+        }
+        switch (event.kind) {
+            case Event::NOTIFICATION:
+                array += "{\"ep\":" + json_string(event.endpoint) +
+                         ",\"path\":" + json_string("/" + event.path) +
+                         ",\"ct\":" + json_string(content_type_name(event.content_format)) +
+                         ",\"payload\":" + json_string(base64_encode(event.payload)) +
+                         ",\"max-age\":0}";
+                break;
+            case Event::REGISTRATION:
+            case Event::REG_UPDATE:
+                array += "{\"ep\":" + json_string(event.endpoint) +
+                         ",\"ept\":" + json_string(event.type) +
+                         ",\"q\":false,\"resources\":" + resources_json(event.resources, "path") + "}";
+                break;
+            case Event::DEREGISTRATION:
+            case Event::EXPIRED:
+                array += json_string(event.endpoint);
+                break;
+        }
+    }
+
+    std::string json = "{";
+    for (size_t i = 0; i < 5; i++) {
+        if (arrays[i].empty()) {
+            continue;
+        }
+        if (json.size() > 1) {
+            json += ",";
+        }
+        json += "\"" + std::string(KEYS[i]) + "\":[" + arrays[i] + "]";
+    }
+    return json + "}";
+}
+
+// "<ep>/<path>" after a prefix like "/endpoints/"
+bool split_target(const std::string &rest, std::string &endpoint, std::string &path) {
+    size_t slash = rest.find('/');
+    endpoint = rest.substr(0, slash);
+    path = slash == std::string::npos ? std::string() : rest.substr(slash + 1);
+    while (!path.empty() && path[path.size() - 1] == '/') {
+        path.erase(path.size() - 1);
+    }
+    return !endpoint.empty();
+}
+
+bool starts_with(const std::string &text, const std::string &prefix, std::string &rest) {
+    if (text.compare(0, prefix.size(), prefix) != 0) {
+        return false;
+    }
+    rest = text.substr(prefix.size());
+    return true;
+}
+
+} // namespace
+
+CallbackPusher::CallbackPusher()
+    : _stopping(false), _fd(-1) {
+}
+
+CallbackPusher::~CallbackPusher() {
+    stop();
+}
+
+void CallbackPusher::start() {
+    _thread = std::thread(&CallbackPusher::run, this);
+}
+
+void CallbackPusher::stop() {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stopping = true;
+        _queued.notify_all();
+    }
+    if (_thread.joinable()) {
+        _thread.join();
+    }
+    if (_fd >= 0) {
+        close(_fd);
+        _fd = -1;
+    }
+}
+
+void CallbackPusher::push(const Event &event) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_url.empty()) {
+        counters().dropped_events++;
+        return;
+    }
+    if (_queue.size() == MAX_QUEUE) {
+        _queue.pop_front();
+        counters().dropped_events++;
+    }
+    _queue.push_back(event);
+    if (_queue.size() == 1) {
+        _queued.notify_one();
+    }
+}
+
+bool CallbackPusher::set_url(const std::string &url) {
+    Url parsed;
+    if (!url.empty() && !parse_url(url, parsed)) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(_mutex);
+    _url = url;
+    return true;
+}
+
+std::string CallbackPusher::url() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _url;
+}
+
+void CallbackPusher::run() {
+    while (true) {
+        std::vector<Event> batch;
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _queued.wait(lock, [this]() { return _stopping || !_queue.empty(); });
+            if (_stopping) {
+                return;
+            }
+            batch.assign(_queue.begin(), _queue.end());
+            _queue.clear();
+        }
+
+        if (put(events_json(batch))) {
+            counters().pushes++;
+            counters().pushed_events += batch.size();
+        } else {
+            counters().push_failures++;
+            counters().dropped_events += batch.size();
+        }
+    }
+}
+
+bool CallbackPusher::put(const std::string &body) {
+    std::string url = this->url();
+    Url parsed;
+    if (url.empty() || !parse_url(url, parsed)) {
+        return false;
+    }
+    if (url != _connected_url && _fd >= 0) {
+        close(_fd);
+        _fd = -1;
+    }
+
+    // a kept-alive connection may have been closed meanwhile, then once more
+    for (int attempt = 0; attempt < 2; attempt++) {
+        if (_fd < 0) {
+            _fd = connect_to(parsed, PUSH_TIMEOUT_MS);
+            _connected_url = url;
+            if (_fd < 0) {
+                return false;
+            }
+        }
+        HttpConnection connection(_fd);
+        HttpMessage response;
+        if (connection.write_request("PUT", parsed.host + ":" + parsed.port, parsed.path,
+                                     "application/json", body) &&
+            connection.read_response(response)) {
+            if (!response.keep_alive()) {
+                close(_fd);
+                _fd = -1;
+            }
+            return response.status >= 200 && response.status < 300;
+        }
+        close(_fd);
+        _fd = -1;
+    }
+    return false;
+}
+
+RestApi::RestApi(Registry &registry, CallbackPusher &pusher, const std::string &token, uint32_t timeout_ms)
+    : _registry(registry), _pusher(pusher), _token(token), _timeout_ms(timeout_ms), _listener(-1),
+      _stopping(false) {
+}
+
+RestApi::~RestApi() {
+    stop();
+}
+
+bool RestApi::start(const char *address, uint16_t port) {
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = address ? AF_UNSPEC : AF_INET6;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_PASSIVE;
+    std::string service = std::to_string(port);
+    struct addrinfo *result;
+    if (getaddrinfo(address, service.c_str(), &hints, &result) != 0) {
+        fprintf(stderr, "server: can not resolve %s\n", address);
+        return false;
+    }
+    _listener = socket(result->ai_family, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    int on = 1, off = 0;
+    if (_listener < 0 ||
+        (result->ai_family == AF_INET6 && setsockopt(_listener, IPPROTO_IPV6, IPV6_V6ONLY, &off, sizeof(off)) != 0) ||
+        setsockopt(_listener, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on)) != 0 ||
+        bind(_listener, result->ai_addr, result->ai_addrlen) != 0 ||
+        listen(_listener, 128) != 0) {
+        fprintf(stderr, "server: can not listen on TCP port %u: %s\n", (unsigned)port, strerror(errno));
+        freeaddrinfo(result);
+        if (_listener >= 0) {
+            close(_listener);
+            _listener = -1;
+        }
+        return false;
+    }
+    freeaddrinfo(result);
+    _acceptor = std::thread(&RestApi::accept_loop, this);
+    return true;
+}
+
+void RestApi::stop() {
+    if (_listener < 0) {
+        return;
+    }
+    _stopping = true;
+    shutdown(_listener, SHUT_RDWR);
+    _acceptor.join();
+    close(_listener);
+    _listener = -1;
+
+    // wake up the connections and wait until their threads are gone
+    std::unique_lock<std::mutex> lock(_mutex);
+    for (std::set<int>::const_iterator it = _connections.begin(); it != _connections.end(); ++it) {
+        shutdown(*it, SHUT_RDWR);
+    }
+    _closed.wait(lock, [this]() { return _connections.empty(); });
+}
+
+void RestApi::accept_loop() {
+    while (!_stopping) {
+        int fd = accept4(_listener, NULL, NULL, SOCK_CLOEXEC);
+        if (fd < 0) {
+            continue;
+        }
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_stopping) {
+            close(fd);
+            break;
+        }
+        _connections.insert(fd);
+        std::thread(&RestApi::serve, this, fd).detach();
+    }
+}
+
+void RestApi::serve(int fd) {
+    HttpConnection connection(fd);
+    HttpMessage request;
+    while (!_stopping && connection.read_request(request)) {
+        counters().http_requests++;
+        int status = 404;
+        std::string content_type, body;
+        if (!_token.empty() && request.header("authorization") != "Bearer " + _token) {
+            status = 401;
+        } else {
+            handle(request, status, content_type, body);
+        }
+        if (!connection.write_response(status, content_type, body, request.keep_alive()) ||
+            !request.keep_alive()) {
+            break;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    close(fd);
+    _connections.erase(fd);
+    _closed.notify_all();
+}
+
+void RestApi::handle(const HttpMessage &request, int &status, std::string &content_type, std::string &body) {
+    std::string path = request.path;
+    std::string rest;
+    if (path.compare(0, 4, "/v2/") == 0) {
+        path.erase(0, 3);
+    }
+
+    std::string endpoint, resource_path;
+    if (path == "/endpoints" || path == "/endpoints/") {
+        if (request.method != "GET") {
+            status = 405;
+            return;
+        }
+        std::vector<Registry::EndpointInfo> endpoints = _registry.endpoints();
+        body = "[";
+        for (size_t i = 0; i < endpoints.size(); i++) {
+            if (i) {
+                body += ",";
+            }
+            body += "{\"name\":" + json_string(endpoints[i].name) +
+                    ",\"type\":" + json_string(endpoints[i].type) +
+                    ",\"status\":\"ACTIVE\",\"q\":false}";
+        }
+        body += "]";
+        status = 200;
+        content_type = "application/json";
+    } else if (starts_with(path, "/endpoints/", rest) && split_target(rest, endpoint, resource_path)) {
+        if (resource_path.empty()) {
+            std::vector<Resource> resources;
+            if (request.method != "GET") {
+                status = 405;
+            } else if (!_registry.resources(endpoint, resources)) {
+                status = 404;
+            } else {
+                status = 200;
+                content_type = "application/json";
+                body = resources_json(resources, "uri");
+            }
+        } else {
+            resource(request, endpoint, resource_path, status, content_type, body);
+        }
+    } else if (starts_with(path, "/subscriptions/", rest) && split_target(rest, endpoint, resource_path) &&
+               !resource_path.empty()) {
+        subscription(request, endpoint, resource_path, status, body);
+    } else if (path == "/notification/callback") {
+        callback(request, status, content_type, body);
+    } else if (path == "/stats") {
+        Counters &c = counters();
+        char json[1024];
+        snprintf(json, sizeof(json),
+                 "{\"endpoints\":%zu,\"registrations\":%llu,\"updates\":%llu,\"deregistrations\":%llu,"
+                 "\"expirations\":%llu,\"notifications\":%llu,\"requests\":%llu,\"retransmissions\":%llu,"
+                 "\"timeouts\":%llu,\"duplicates\":%llu,\"clock_pings\":%llu,\"datagrams_in\":%llu,"
+                 "\"datagrams_out\":%llu,\"http_requests\":%llu,\"pushes\":%llu,\"pushed_events\":%llu,"
+                 "\"push_failures\":%llu,\"dropped_events\":%llu}",
+                 _registry.size(),
+                 (unsigned long long)c.registrations, (unsigned long long)c.updates,
+                 (unsigned long long)c.deregistrations, (unsigned long long)c.expirations,
+                 (unsigned long long)c.notifications, (unsigned long long)c.requests,
+                 (unsigned long long)c.retransmissions, (unsigned long long)c.timeouts,
+                 (unsigned long long)c.duplicates, (unsigned long long)c.clock_pings,
+                 (unsigned long long)c.datagrams_in, (unsigned long long)c.datagrams_out,
+                 (unsigned long long)c.http_requests,
+                 (unsigned long long)c.pushes, (unsigned long long)c.pushed_events,
+                 (unsigned long long)c.push_failures, (unsigned long long)c.dropped_events);
+        status = 200;
+        content_type = "application/json";
+        body = json;
+    }
+}
+
+void RestApi::resource(const HttpMessage &request, const std::string &endpoint, const std::string &path,
+                       int &status, std::string &content_type, std::string &body) {
+    Registry::Reply reply;
+    Registry::Status result;
+    if (request.method == "GET" && request.query.find("cacheOnly=true") != std::string::npos) {
+        result = _registry.cached(endpoint, path, reply) ? Registry::DONE : Registry::NO_ENDPOINT;
+    } else if (request.method == "GET") {
+        result = _registry.request(endpoint, coap::GET, path, std::string(), false, _timeout_ms, reply);
+    } else if (request.method == "PUT") {
+        result = _registry.request(endpoint, coap::PUT, path, request.body, false, _timeout_ms, reply);
+    } else if (request.method == "POST") {
+        result = _registry.request(endpoint, coap::POST, path, request.body, false, _timeout_ms, reply);
+    } else {
+        status = 405;
+        return;
+    }
+
+    if (result == Registry::NO_ENDPOINT) {
+        status = 404;
+    } else if (result == Registry::TIMEOUT) {
+        status = 504;
+    } else {
+        status = http_status(reply.code);
+        if (status == 200 && request.method == "GET") {
+            content_type = content_type_name(reply.content_format);
+            body = reply.payload;
+        }
+    }
+}
+
+void RestApi::subscription(const HttpMessage &request, const std::string &endpoint, const std::string &path,
+                           int &status, std::string &body) {
+    if (request.method == "GET") {
+        status = _registry.observed(endpoint, path) ? 200 : 404;
+    } else if (request.method == "PUT") {
+        Registry::Reply reply;
+        Registry::Status result = _registry.request(endpoint, coap::GET, path, std::string(), true,
+                                                    _timeout_ms, reply);
+        if (result == Registry::NO_ENDPOINT) {
+            status = 404;
+        } else if (result == Registry::TIMEOUT) {
+            status = 504;
+        } else {
+            status = http_status(reply.code);
+        }
+    } else if (request.method == "DELETE") {
+        status = _registry.cancel_observation(endpoint, path) ? 204 : 404;
+    } else {
+        status = 405;
+    }
+    if (status == 504) {
+        body = "endpoint did not answer";
+    }
+}
+
+void RestApi::callback(const HttpMessage &request, int &status, std::string &content_type, std::string &body) {
+    if (request.method == "GET") {
+        std::string url = _pusher.url();
+        if (url.empty()) {
+            status = 404;
+        } else {
+            status = 200;
+            content_type = "application/json";
+            body = "{\"url\":" + json_string(url) + "}";
+        }
+    } else if (request.method == "PUT") {
+        std::string url;
+        if (!json_field(request.body, "url", url) || !_pusher.set_url(url)) {
+            status = 400;
+            body = "need {\"url\": \"http://...\"}";
+        } else {
+            status = 204;
+        }
+    } else if (request.method == "DELETE") {
+        _pusher.set_url(std::string());
+        status = 204;
+    } else {
+        status = 405;
+    }
+}
+
+} // namespace server
+} // namespace host
@@ -0,0 +1,124 @@
+/*
+ * Copyright (c) 2016 ARM Limited. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef __HOST_SERVER_REST_H__
+#define __HOST_SERVER_REST_H__
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include "http.h"
+#include "registry.h"
+#include "server.h"
+
+namespace host {
+namespace server {
+
+/*
+ * Sends the events to the callback URL the web tier set with
+ * PUT /notification/callback, as mbed Device Connector does: a PUT with a
+ * JSON object of "notifications", "registrations", "reg-updates",
+ * "de-registrations" and "registrations-expired" arrays. Whatever queued up
+ * during one PUT goes out in the next, so batches grow with the load.
+ */
+class CallbackPusher : public EventSink {
+public:
+    CallbackPusher();
+    ~CallbackPusher();
+
+    void start();
+    void stop();
+
+    void push(const Event &event);
+
+    // empty to stop pushing, false when `url` is no http:// URL
+    bool set_url(const std::string &url);
+    std::string url();
+
+private:
+    void run();
+    bool put(const std::string &body);
+
+    std::mutex              _mutex;
+    std::condition_variable _queued;
+    std::deque<Event>       _queue;
+    std::string             _url;
+    bool                    _stopping;
+    std::thread             _thread;
+
+    // only touched by the thread
+    int                     _fd;
+    std::string             _connected_url;
+};
+
+/*
+ * The mbed Device Connector REST API, the part the web tiers use, with or
+ * without the /v2 prefix:
+ *
+ *     GET    /endpoints                     registered endpoints
+ *     GET    /endpoints/<ep>                their resources
+ *     GET    /endpoints/<ep>/<path>         read, ?cacheOnly=true for the last value
+ *     PUT    /endpoints/<ep>/<path>         write
+ *     POST   /endpoints/<ep>/<path>         execute
+ *     GET    /subscriptions/<ep>/<path>     200 when subscribed
+ *     PUT    /subscriptions/<ep>/<path>     observe, notifications go to the callback
+ *     DELETE /subscriptions/<ep>/<path>
+ *     GET    /notification/callback
+ *     PUT    /notification/callback         {"url": "http://..."}
+ *     DELETE /notification/callback
+ *     GET    /stats                         the counters, not in the real API
+ *
+ * Reads wait for the endpoint instead of answering 202 with an
+ * async-response-id. One thread per HTTP connection.
+ */
+class RestApi {
+public:
+    RestApi(Registry &registry, CallbackPusher &pusher, const std::string &token, uint32_t timeout_ms);
+    ~RestApi();
+
+    bool start(const char *address, uint16_t port);
+    void stop();
+
+private:
+    void accept_loop();
+    void serve(int fd);
+    void handle(const HttpMessage &request, int &status, std::string &content_type, std::string &body);
+    void resource(const HttpMessage &request, const std::string &endpoint, const std::string &path,
+                  int &status, std::string &content_type, std::string &body);
+    void subscription(const HttpMessage &request, const std::string &endpoint, const std::string &path,
+                      int &status, std::string &body);
+    void callback(const HttpMessage &request, int &status, std::string &content_type, std::string &body);
+
+    Registry                &_registry;
+    CallbackPusher          &_pusher;
+    std::string             _token;
+    uint32_t                _timeout_ms;
+    int                     _listener;
+    std::thread             _acceptor;
+    std::atomic<bool>       _stopping;
+
+    std::mutex              _mutex;
+    std::condition_variable _closed;
+    std::set<int>           _connections;
+};
+
+} // namespace server
+} // namespace host
+
+#endif // __HOST_SERVER_REST_H__
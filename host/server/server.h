@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) 2016 ARM Limited. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef __HOST_SERVER_SERVER_H__
+#define __HOST_SERVER_SERVER_H__
+
+#include <stdint.h>
+#include <atomic>
+#include <string>
+#include <vector>
+
+/*
+ * Local stand-in for mbed Device Connector: the LWM2M server the firmware
+ * registers with over CoAP, and the REST API with the notification callback
+ * the web tiers use. See host/README.md.
+ */
+namespace host {
+namespace server {
+
+// everything counts up from the start, the stats line prints the rates
+struct Counters {
+    std::atomic<uint64_t> datagrams_in;
+    std::atomic<uint64_t> datagrams_out;
+    std::atomic<uint64_t> duplicates;           // retransmitted requests answered from the cache
+    std::atomic<uint64_t> registrations;
+    std::atomic<uint64_t> updates;
+    std::atomic<uint64_t> deregistrations;
+    std::atomic<uint64_t> expirations;
+    std::atomic<uint64_t> notifications;
+    std::atomic<uint64_t> requests;             // sent to endpoints for the REST API
+    std::atomic<uint64_t> retransmissions;
+    std::atomic<uint64_t> clock_pings;          // answered with a pong
+    std::atomic<uint64_t> timeouts;
+    std::atomic<uint64_t> http_requests;
+    std::atomic<uint64_t> pushes;               // PUTs to the callback URL
+    std::atomic<uint64_t> pushed_events;
+    std::atomic<uint64_t> push_failures;
+    std::atomic<uint64_t> dropped_events;       // no callback URL, or the queue was full
+};
+
+Counters &counters();
+
+struct Resource {
+    std::string path;           // without the leading '/'
+    std::string type;           // rt
+    bool        observable;
+};
+
+// what the callback URL hears about
+struct Event {
+    enum Kind {
+        NOTIFICATION,
+        REGISTRATION,
+        REG_UPDATE,
+        DEREGISTRATION,
+        EXPIRED
+    };
+
+    Kind                    kind;
+    std::string             endpoint;
+    std::string             type;           // endpoint type, registrations
+    std::vector<Resource>   resources;      // registrations
+    std::string             path;           // notifications
+    std::string             payload;
+    uint16_t                content_format;
+};
+
+class EventSink {
+public:
+    virtual ~EventSink() {
+    }
+
+    // called from the CoAP threads, must not block
+    virtual void push(const Event &event) = 0;
+};
+
+// milliseconds on the monotonic clock
+uint64_t now_ms();
+
+// microseconds since the Unix epoch, the server time endpoints align to
+uint64_t wall_us();
+
+} // namespace server
+} // namespace host
+
+#endif // __HOST_SERVER_SERVER_H__
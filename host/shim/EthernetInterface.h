@@ -0,0 +1,42 @@
+/*
+ * Copyright (c) 2016 ARM Limited. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __HOST_SHIM_ETHERNET_INTERFACE_H__
+#define __HOST_SHIM_ETHERNET_INTERFACE_H__
+
+#include "mbed-drivers/mbed.h"
+
+// The host network is always up
+class EthernetInterface {
+public:
+    int init() {
+        return 0;
+    }
+
+    int connect() {
+        return 0;
+    }
+
+    int disconnect() {
+        return 0;
+    }
+
+    const char *getIPAddress() {
+        return "127.0.0.1";
+    }
+};
+
+#endif // __HOST_SHIM_ETHERNET_INTERFACE_H__
@@ -0,0 +1,36 @@
+/*
+ * Copyright (c) 2016 ARM Limited. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __HOST_SHIM_DRIVER_RF_PHY_H__
+#define __HOST_SHIM_DRIVER_RF_PHY_H__
+
+#include <stdint.h>
+
+enum rf_trx_part_e {
+    ATMEL_UNKNOW_DEV = 0,
+    ATMEL_AT86RF212,
+    ATMEL_AT86RF231,
+    ATMEL_AT86RF233
+};
+
+int8_t rf_device_register(void);
+
+// derived from the endpoint name, so every host node has its own
+void rf_read_mac_address(uint8_t *ptr);
+
+rf_trx_part_e rf_radio_type_read(void);
+
+#endif // __HOST_SHIM_DRIVER_RF_PHY_H__
@@ -0,0 +1,192 @@
+/*
+ * Copyright (c) 2016 ARM Limited. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __HOST_SHIM_FUNCTION_POINTER_H__
+#define __HOST_SHIM_FUNCTION_POINTER_H__
+
+#include <functional>
+
+/*
+ * Host stand-in for core-util/FunctionPointer.h: the same class names and
+ * bind() interface, backed by std::function.
+ */
+namespace mbed {
+namespace util {
+
+// a call with all of its arguments bound, what minar queues
+template <typename R>
+class FunctionPointerBind {
+public:
+    FunctionPointerBind() {
+    }
+
+    explicit FunctionPointerBind(const std::function<R()> &function)
+        : _function(function) {
+    }
+
+    R call() const {
+        return _function();
+    }
+
+    R operator()() const {
+        return _function();
+    }
+
+    operator bool() const {
+        return (bool)_function;
+    }
+
+private:
+    std::function<R()> _function;
+};
+
+template <typename R>
+class FunctionPointer0 {
+public:
+    FunctionPointer0(R (*function)() = 0) {
+        if (function) {
+            _function = function;
+        }
+    }
+
+    template <typename T>
+    FunctionPointer0(T *object, R (T::*member)()) {
+        _function = [object, member]() { return (object->*member)(); };
+    }
+
+    R call() const {
+        return _function();
+    }
+
+    R operator()() const {
+        return _function();
+    }
+
+    operator bool() const {
+        return (bool)_function;
+    }
+
+    FunctionPointerBind<R> bind() const {
+        return FunctionPointerBind<R>(_function);
+    }
+
+private:
+    std::function<R()> _function;
+};
+
+template <typename R, typename A1>
+class FunctionPointer1 {
+public:
+    FunctionPointer1(R (*function)(A1) = 0) {
+        if (function) {
+            _function = function;
+        }
+    }
+
+    template <typename T>
+    FunctionPointer1(T *object, R (T::*member)(A1)) {
+        _function = [object, member](A1 a1) { return (object->*member)(a1); };
+    }
+
+    R call(A1 a1) const {
+        return _function(a1);
+    }
+
+    R operator()(A1 a1) const {
+        return _function(a1);
+    }
+
+    operator bool() const {
+        return (bool)_function;
+    }
+
+    FunctionPointerBind<R> bind(const A1 &a1) const {
+        std::function<R(A1)> function = _function;
+        return FunctionPointerBind<R>([function, a1]() { return function(a1); });
+    }
+
+private:
+    std::function<R(A1)> _function;
+};
+
+template <typename R, typename A1, typename A2>
+class FunctionPointer2 {
+public:
+    FunctionPointer2(R (*function)(A1, A2) = 0) {
+        if (function) {
+            _function = function;
+        }
+    }
+
+    template <typename T>
+    FunctionPointer2(T *object, R (T::*member)(A1, A2)) {
+        _function = [object, member](A1 a1, A2 a2) { return (object->*member)(a1, a2); };
+    }
+
+    R call(A1 a1, A2 a2) const {
+        return _function(a1, a2);
+    }
+
+    R operator()(A1 a1, A2 a2) const {
+        return _function(a1, a2);
+    }
+
+    FunctionPointerBind<R> bind(const A1 &a1, const A2 &a2) const {
+        std::function<R(A1, A2)> function = _function;
+        return FunctionPointerBind<R>([function, a1, a2]() { return function(a1, a2); });
+    }
+
+private:
+    std::function<R(A1, A2)> _function;
+};
+
+template <typename R, typename A1, typename A2, typename A3>
+class FunctionPointer3 {
+public:
+    FunctionPointer3(R (*function)(A1, A2, A3) = 0) {
+        if (function) {
+            _function = function;
+        }
+    }
+
+    template <typename T>
+    FunctionPointer3(T *object, R (T::*member)(A1, A2, A3)) {
+        _function = [object, member](A1 a1, A2 a2, A3 a3) { return (object->*member)(a1, a2, a3); };
+    }
+
+    R call(A1 a1, A2 a2, A3 a3) const {
+        return _function(a1, a2, a3);
+    }
+
+    R operator()(A1 a1, A2 a2, A3 a3) const {
+        return _function(a1, a2, a3);
+    }
+
+    operator bool() const {
+        return (bool)_function;
+    }
+
+private:
+    std::function<R(A1, A2, A3)> _function;
+};
+
+typedef FunctionPointer0<void> FunctionPointer;
+typedef FunctionPointerBind<void> Event;
+
+} // namespace util
+} // namespace mbed
+
+#endif // __HOST_SHIM_FUNCTION_POINTER_H__
@@ -0,0 +1,106 @@
+/*
+ * Copyright (c) 2016 ARM Limited. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __HOST_SHIM_FXOS8700CQ_H__
+#define __HOST_SHIM_FXOS8700CQ_H__
+
+#include "mbed-drivers/mbed.h"
+
+// 8 bit I2C addresses, as the mbed I2C driver takes them
+#define FXOS8700CQ_SLAVE_ADDR0 (0x1E << 1)
+#define FXOS8700CQ_SLAVE_ADDR1 (0x1D << 1)
+#define FXOS8700CQ_SLAVE_ADDR2 (0x1C << 1)
+#define FXOS8700CQ_SLAVE_ADDR3 (0x1F << 1)
+
+/*
+ * Host stand-in for the FXOS8700CQ driver. It does the same register writes
+ * as the real one, over the I2C shim, so the simulated sensor in
+ * host/source/sim_fxos8700cq.cpp ends up in the same state as the board.
+ */
+class FXOS8700CQ {
+public:
+    FXOS8700CQ(PinName sda, PinName scl, int address)
+        : _i2c(sda, scl), _address(address) {
+    }
+
+    // motion interrupt enabled and routed to INT1
+    void config_int(void) {
+        write_reg(REG_CTRL_REG4, 0x04);
+        write_reg(REG_CTRL_REG5, 0x04);
+    }
+
+    // latched motion detection on X or Y above ~0.25 g
+    void config_feature(void) {
+        write_reg(REG_FF_MT_CFG, 0xD8);
+        write_reg(REG_FF_MT_THS, 0x04);
+        write_reg(REG_FF_MT_COUNT, 0x01);
+    }
+
+    // hybrid accelerometer and magnetometer at 200 Hz, low noise, active
+    void enable(void) {
+        write_reg(REG_M_CTRL_REG1, 0x1F);
+        write_reg(REG_M_CTRL_REG2, 0x20);
+        write_reg(REG_XYZ_DATA_CFG, 0x00);
+        write_reg(REG_CTRL_REG1, 0x0D);
+    }
+
+    void disable(void) {
+        uint8_t value = read_reg(REG_CTRL_REG1);
+        write_reg(REG_CTRL_REG1, value & ~0x01);
+    }
+
+    // reading FF_MT_SRC releases the latched motion event
+    void clear_int(void) {
+        read_reg(REG_FF_MT_SRC);
+    }
+
+    uint8_t get_whoami(void) {
+        return read_reg(REG_WHO_AM_I);
+    }
+
+private:
+    enum {
+        REG_WHO_AM_I        = 0x0D,
+        REG_XYZ_DATA_CFG    = 0x0E,
+        REG_FF_MT_CFG       = 0x15,
+        REG_FF_MT_SRC       = 0x16,
+        REG_FF_MT_THS       = 0x17,
+        REG_FF_MT_COUNT     = 0x18,
+        REG_CTRL_REG1       = 0x2A,
+        REG_CTRL_REG4       = 0x2D,
+        REG_CTRL_REG5       = 0x2E,
+        REG_M_CTRL_REG1     = 0x5B,
+        REG_M_CTRL_REG2     = 0x5C
+    };
+
+    void write_reg(uint8_t reg, uint8_t value) {
+        char buffer[2] = { (char)reg, (char)value };
+        _i2c.write(_address, buffer, 2);
+    }
+
+    uint8_t read_reg(uint8_t reg) {
+        char r = reg;
+        char value = 0;
+        _i2c.write(_address, &r, 1, true);
+        _i2c.read(_address, &value, 1);
+        return value;
+    }
+
+    mbed::I2C   _i2c;
+    int         _address;
+};
+
+#endif // __HOST_SHIM_FXOS8700CQ_H__
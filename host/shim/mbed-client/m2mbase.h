@@ -0,0 +1,114 @@
+/*
+ * Copyright (c) 2016 ARM Limited. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __HOST_SHIM_M2M_BASE_H__
+#define __HOST_SHIM_M2M_BASE_H__
+
+#include <stdint.h>
+#include "core-util/FunctionPointer.h"
+#include "mbed-client/m2mstring.h"
+
+typedef mbed::util::FunctionPointer1<void, const char *> value_updated_callback;
+
+/*
+ * Host stand-ins for the mbed-client object model. Only what the knock
+ * firmware touches is here; values live in memory and changes to
+ * observable resources go to the host M2MInterface in host/source/m2m.cpp.
+ */
+class M2MBase {
+public:
+    enum BaseType {
+        Object = 0x0,
+        Resource = 0x1,
+        ObjectInstance = 0x2,
+        ResourceInstance = 0x3
+    };
+
+    enum Operation {
+        NOT_ALLOWED = 0x00,
+        GET_ALLOWED = 0x01,
+        PUT_ALLOWED = 0x02,
+        GET_PUT_ALLOWED = 0x03,
+        POST_ALLOWED = 0x04,
+        GET_POST_ALLOWED = 0x05,
+        PUT_POST_ALLOWED = 0x06,
+        GET_PUT_POST_ALLOWED = 0x07,
+        DELETE_ALLOWED = 0x08
+    };
+
+    M2MBase(BaseType type, const String &name, const String &resource_type, const String &path)
+        : _base_type(type), _name(name), _resource_type(resource_type), _path(path),
+          _operation(GET_ALLOWED), _observable(false) {
+    }
+
+    virtual ~M2MBase() {
+    }
+
+    BaseType base_type() const {
+        return _base_type;
+    }
+
+    const String &name() const {
+        return _name;
+    }
+
+    const String &resource_type() const {
+        return _resource_type;
+    }
+
+    // e.g. "accelerometer/0/last_knock"
+    const String &uri_path() const {
+        return _path;
+    }
+
+    void set_operation(Operation operation) {
+        _operation = operation;
+    }
+
+    Operation operation() const {
+        return _operation;
+    }
+
+    void set_observable(bool observable) {
+        _observable = observable;
+    }
+
+    bool is_observable() const {
+        return _observable;
+    }
+
+    // called with the name after a PUT from the server changed the value
+    void set_value_updated_function(value_updated_callback callback) {
+        _value_updated = callback;
+    }
+
+    void execute_value_updated(const String &name) {
+        if (_value_updated) {
+            _value_updated(name.c_str());
+        }
+    }
+
+private:
+    BaseType    _base_type;
+    String      _name;
+    String      _resource_type;
+    String      _path;
+    Operation   _operation;
+    bool        _observable;
+    value_updated_callback _value_updated;
+};
+
+#endif // __HOST_SHIM_M2M_BASE_H__
@@ -0,0 +1,57 @@
+/*
+ * Copyright (c) 2016 ARM Limited. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __HOST_SHIM_M2M_DEVICE_H__
+#define __HOST_SHIM_M2M_DEVICE_H__
+
+#include "mbed-client/m2mobject.h"
+
+class M2MDevice : public M2MObject {
+public:
+    enum DeviceResource {
+        Manufacturer,
+        DeviceType,
+        ModelNumber,
+        SerialNumber
+    };
+
+    static M2MDevice *get_instance();
+    static void delete_instance();
+
+    M2MResource *create_resource(DeviceResource resource, const String &value) {
+        M2MResource *res = object_instance()->create_static_resource(
+            resource_name(resource), "", M2MResourceInstance::STRING,
+            (const uint8_t *)value.c_str(), value.size());
+        return res;
+    }
+
+    bool is_resource_present(DeviceResource resource) const {
+        return object_instance()->resource(resource_name(resource)) != NULL;
+    }
+
+private:
+    static const char *resource_name(DeviceResource resource) {
+        static const char *names[] = { "0", "17", "1", "2" };
+        return names[resource];
+    }
+
+    M2MDevice()
+        : M2MObject("3") {
+        create_object_instance();
+    }
+};
+
+#endif // __HOST_SHIM_M2M_DEVICE_H__
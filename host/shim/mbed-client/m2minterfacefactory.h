@@ -0,0 +1,50 @@
+/*
+ * Copyright (c) 2016 ARM Limited. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __HOST_SHIM_M2M_INTERFACE_FACTORY_H__
+#define __HOST_SHIM_M2M_INTERFACE_FACTORY_H__
+
+#include "mbed-client/m2mdevice.h"
+#include "mbed-client/m2minterface.h"
+#include "mbed-client/m2minterfaceobserver.h"
+#include "mbed-client/m2msecurity.h"
+
+class M2MInterfaceFactory {
+public:
+    static M2MInterface *create_interface(M2MInterfaceObserver &observer,
+                                          const String &endpoint_name,
+                                          const String &endpoint_type = "",
+                                          const int32_t life_time = -1,
+                                          const uint16_t listen_port = 5683,
+                                          const String &domain = "",
+                                          M2MInterface::BindingMode mode = M2MInterface::NOT_SET,
+                                          M2MInterface::NetworkStack stack = M2MInterface::LwIP_IPv4,
+                                          const String &context_address = "");
+
+    static M2MSecurity *create_security(M2MSecurity::ServerType server_type) {
+        return new M2MSecurity(server_type);
+    }
+
+    static M2MDevice *create_device() {
+        return M2MDevice::get_instance();
+    }
+
+    static M2MObject *create_object(const String &name) {
+        return new M2MObject(name);
+    }
+};
+
+#endif // __HOST_SHIM_M2M_INTERFACE_FACTORY_H__
@@ -0,0 +1,36 @@
+/*
+ * Copyright (c) 2016 ARM Limited. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __HOST_SHIM_M2M_INTERFACE_OBSERVER_H__
+#define __HOST_SHIM_M2M_INTERFACE_OBSERVER_H__
+
+#include "mbed-client/m2mbase.h"
+#include "mbed-client/m2minterface.h"
+
+class M2MInterfaceObserver {
+public:
+    virtual ~M2MInterfaceObserver() {
+    }
+
+    virtual void bootstrap_done(M2MSecurity *server_object) = 0;
+    virtual void object_registered(M2MSecurity *security_object, const M2MServer &server_object) = 0;
+    virtual void object_unregistered(M2MSecurity *server_object) = 0;
+    virtual void registration_updated(M2MSecurity *security_object, const M2MServer &server_object) = 0;
+    virtual void error(M2MInterface::Error error) = 0;
+    virtual void value_updated(M2MBase *base, M2MBase::BaseType type) = 0;
+};
+
+#endif // __HOST_SHIM_M2M_INTERFACE_OBSERVER_H__
@@ -0,0 +1,70 @@
+/*
+ * Copyright (c) 2016 ARM Limited. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __HOST_SHIM_M2M_OBJECT_INSTANCE_H__
+#define __HOST_SHIM_M2M_OBJECT_INSTANCE_H__
+
+#include <vector>
+#include "mbed-client/m2mresource.h"
+
+class M2MObjectInstance : public M2MBase {
+public:
+    M2MObjectInstance(const String &name, const String &path)
+        : M2MBase(M2MBase::ObjectInstance, name, "", path) {
+    }
+
+    ~M2MObjectInstance() {
+        for (size_t i = 0; i < _resources.size(); i++) {
+            delete _resources[i];
+        }
+    }
+
+    M2MResource *create_dynamic_resource(const String &name, const String &resource_type,
+                                         M2MResourceInstance::ResourceType type,
+                                         bool observable, bool /*multiple_instance*/ = false) {
+        M2MResource *res = new M2MResource(name, resource_type, type, observable,
+                                           uri_path() + "/" + name);
+        _resources.push_back(res);
+        return res;
+    }
+
+    M2MResource *create_static_resource(const String &name, const String &resource_type,
+                                        M2MResourceInstance::ResourceType type,
+                                        const uint8_t *value, const uint8_t value_length,
+                                        bool /*multiple_instance*/ = false) {
+        M2MResource *res = create_dynamic_resource(name, resource_type, type, false);
+        res->set_value(value, value_length);
+        return res;
+    }
+
+    M2MResource *resource(const String &name) const {
+        for (size_t i = 0; i < _resources.size(); i++) {
+            if (_resources[i]->name() == name) {
+                return _resources[i];
+            }
+        }
+        return NULL;
+    }
+
+    const std::vector<M2MResource *> &resources() const {
+        return _resources;
+    }
+
+private:
+    std::vector<M2MResource *> _resources;
+};
+
+#endif // __HOST_SHIM_M2M_OBJECT_INSTANCE_H__
@@ -0,0 +1,30 @@
+/*
+ * Copyright (c) 2016 ARM Limited. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __HOST_SHIM_M2M_RESOURCE_H__
+#define __HOST_SHIM_M2M_RESOURCE_H__
+
+#include "mbed-client/m2mresourceinstance.h"
+
+class M2MResource : public M2MResourceInstance {
+public:
+    M2MResource(const String &name, const String &resource_type, ResourceType type,
+                bool observable, const String &path)
+        : M2MResourceInstance(name, resource_type, type, observable, path) {
+    }
+};
+
+#endif // __HOST_SHIM_M2M_RESOURCE_H__
@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) 2016 ARM Limited. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __HOST_SHIM_M2M_RESOURCE_INSTANCE_H__
+#define __HOST_SHIM_M2M_RESOURCE_INSTANCE_H__
+
+#include <vector>
+#include "core-util/FunctionPointer.h"
+#include "mbed-client/m2mbase.h"
+
+typedef mbed::util::FunctionPointer1<void, void *> execute_callback;
+typedef mbed::util::FunctionPointer3<void, const String &, uint8_t *&, uint32_t &> outgoing_block_message_callback;
+
+class M2MResourceInstance : public M2MBase {
+public:
+    enum ResourceType {
+        STRING,
+        INTEGER,
+        FLOAT,
+        BOOLEAN,
+        OPAQUE,
+        TIME,
+        OBJLINK
+    };
+
+    M2MResourceInstance(const String &name, const String &resource_type, ResourceType type,
+                        bool observable, const String &path)
+        : M2MBase(M2MBase::Resource, name, resource_type, path), _type(type) {
+        set_observable(observable);
+    }
+
+    ResourceType resource_instance_type() const {
+        return _type;
+    }
+
+    /*
+    * Stores the value. Like mbed-client, an observable resource only sends
+    * a notification when the value actually changed.
+    */
+    bool set_value(const uint8_t *value, const uint32_t length);
+
+    uint8_t *value() const {
+        return _value.empty() ? NULL : (uint8_t *)&_value[0];
+    }
+
+    uint32_t value_length() const {
+        return _value.size();
+    }
+
+    void set_execute_function(execute_callback callback) {
+        _execute = callback;
+    }
+
+    void execute(void *arguments) {
+        if (_execute) {
+            _execute(arguments);
+        }
+    }
+
+    /*
+    * For large values: a GET asks the callback for the value instead of
+    * reading the stored one, and it goes out in blocks (RFC 7959). The
+    * buffer stays with the application, it is read for every block.
+    */
+    void set_outgoing_block_message_callback(outgoing_block_message_callback callback) {
+        _outgoing_block = callback;
+    }
+
+    bool outgoing_block_message(uint8_t *&buffer, uint32_t &length) const {
+        if (!_outgoing_block) {
+            return false;
+        }
+        buffer = NULL;
+        length = 0;
+        _outgoing_block(name(), buffer, length);
+        return true;
+    }
+
+private:
+    ResourceType            _type;
+    std::vector<uint8_t>    _value;
+    execute_callback        _execute;
+    outgoing_block_message_callback _outgoing_block;
+};
+
+#endif // __HOST_SHIM_M2M_RESOURCE_INSTANCE_H__
@@ -0,0 +1,76 @@
+/*
+ * Copyright (c) 2016 ARM Limited. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __HOST_SHIM_M2M_SECURITY_H__
+#define __HOST_SHIM_M2M_SECURITY_H__
+
+#include "mbed-client/m2mobject.h"
+
+class M2MSecurity : public M2MObject {
+public:
+    enum ServerType {
+        Bootstrap = 0x0,
+        M2MServer = 0x1
+    };
+
+    enum SecurityResource {
+        M2MServerUri,
+        BootstrapServer,
+        SecurityMode,
+        PublicKey,
+        ServerPublicKey,
+        Secretkey
+    };
+
+    enum SecurityModeType {
+        Psk = 0,
+        Certificate = 2,
+        NoSecurity = 3
+    };
+
+    M2MSecurity(ServerType type)
+        : M2MObject("0"), _type(type) {
+    }
+
+    ServerType server_type() const {
+        return _type;
+    }
+
+    bool set_resource_value(SecurityResource resource, const String &value) {
+        if (resource == M2MServerUri) {
+            _uri = value;
+        }
+        return true;
+    }
+
+    bool set_resource_value(SecurityResource /*resource*/, uint32_t /*value*/) {
+        return true;
+    }
+
+    bool set_resource_value(SecurityResource /*resource*/, const uint8_t * /*value*/, const uint16_t /*length*/) {
+        return true;
+    }
+
+    const String &server_uri() const {
+        return _uri;
+    }
+
+private:
+    ServerType  _type;
+    String      _uri;
+};
+
+#endif // __HOST_SHIM_M2M_SECURITY_H__
@@ -0,0 +1,46 @@
+/*
+ * Copyright (c) 2016 ARM Limited. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __HOST_SHIM_M2M_STRING_H__
+#define __HOST_SHIM_M2M_STRING_H__
+
+#include <string>
+
+/*
+ * Host stand-in for mbed-client's own String class, which has the subset of
+ * the std::string interface the firmware uses
+ */
+namespace m2m {
+
+class String : public std::string {
+public:
+    String() {
+    }
+
+    String(const char *s)
+        : std::string(s ? s : "") {
+    }
+
+    String(const std::string &s)
+        : std::string(s) {
+    }
+};
+
+} // namespace m2m
+
+using m2m::String;
+
+#endif // __HOST_SHIM_M2M_STRING_H__
@@ -0,0 +1,187 @@
+/*
+ * Copyright (c) 2016 ARM Limited. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __HOST_SHIM_MBED_H__
+#define __HOST_SHIM_MBED_H__
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <vector>
+#include "core-util/FunctionPointer.h"
+#include "minar/minar.h"
+#include "mbed-hal/rtc_api.h"
+#include "mbed-hal/us_ticker_api.h"
+#include "mbed-drivers/wait_api.h"
+
+/*
+ * Host stand-in for the parts of mbed-drivers the knock firmware uses. Pins
+ * are only names here; host/source/drivers.cpp connects them to the
+ * simulated hardware.
+ */
+enum PinName {
+    PTC13,      // FXOS8700CQ INT1 on the FRDM-K64F
+    PTE24,
+    PTE25,
+    LED1,
+    LED2,
+    LED3,
+    SW2,
+    SW3,
+    USBTX,
+    USBRX,
+    NC = -1
+};
+
+enum PinMode {
+    PullNone,
+    PullUp,
+    PullDown
+};
+
+namespace mbed {
+
+class DigitalOut {
+public:
+    DigitalOut(PinName pin);
+
+    void write(int value);
+    int read();
+
+    DigitalOut &operator=(int value) {
+        write(value);
+        return *this;
+    }
+
+    operator int() {
+        return read();
+    }
+
+private:
+    PinName _pin;
+    int     _value;
+};
+
+class InterruptIn {
+public:
+    InterruptIn(PinName pin);
+    ~InterruptIn();
+
+    void fall(void (*function)()) {
+        _fall = mbed::util::FunctionPointer(function);
+    }
+
+    template <typename T>
+    void fall(T *object, void (T::*member)()) {
+        _fall = mbed::util::FunctionPointer(object, member);
+    }
+
+    void rise(void (*function)()) {
+        _rise = mbed::util::FunctionPointer(function);
+    }
+
+    template <typename T>
+    void rise(T *object, void (T::*member)()) {
+        _rise = mbed::util::FunctionPointer(object, member);
+    }
+
+    void mode(PinMode mode) {
+        _mode = mode;
+    }
+
+    PinName pin() const {
+        return _pin;
+    }
+
+    // called by the simulated hardware, in "interrupt context"
+    void edge(bool rising);
+
+private:
+    PinName                     _pin;
+    PinMode                     _mode;
+    mbed::util::FunctionPointer _fall;
+    mbed::util::FunctionPointer _rise;
+};
+
+class Serial {
+public:
+    Serial(PinName tx, PinName rx);
+
+    void baud(int baudrate);
+    int printf(const char *format, ...) __attribute__((format(printf, 2, 3)));
+    int putc(int c);
+    int write(const uint8_t *data, int length);
+
+private:
+    int _baud;
+};
+
+// asynchronous I2C, as in the mbed HAL of targets with DEVICE_I2C_ASYNCH
+#define DEVICE_I2C_ASYNCH               1
+
+#define I2C_EVENT_ERROR                 (1 << 1)
+#define I2C_EVENT_ERROR_NO_SLAVE        (1 << 2)
+#define I2C_EVENT_TRANSFER_COMPLETE     (1 << 3)
+#define I2C_EVENT_TRANSFER_EARLY_NACK   (1 << 4)
+#define I2C_EVENT_ALL                   (I2C_EVENT_ERROR | I2C_EVENT_TRANSFER_COMPLETE | \
+                                         I2C_EVENT_ERROR_NO_SLAVE | I2C_EVENT_TRANSFER_EARLY_NACK)
+
+enum DMAUsage {
+    DMA_USAGE_NEVER,
+    DMA_USAGE_OPPORTUNISTIC,
+    DMA_USAGE_ALWAYS,
+    DMA_USAGE_TEMPORARY_ALLOCATED,
+    DMA_USAGE_ALLOCATED
+};
+
+typedef mbed::util::FunctionPointer1<void, int> event_callback_t;
+
+/*
+ * Register level I2C, routed to whatever simulated device answers at the
+ * address. Returns 0 on ACK like the real driver.
+ *
+ * transfer() completes before it returns: the callback runs right away,
+ * as if the bus were infinitely fast. Blocking calls are counted as the
+ * time the CPU waits on the bus, transfers as bus time it does not.
+ */
+class I2C {
+public:
+    I2C(PinName sda, PinName scl);
+
+    void frequency(int hz);
+    int read(int address, char *data, int length, bool repeated = false);
+    int write(int address, const char *data, int length, bool repeated = false);
+
+    int transfer(int address, const char *tx_buffer, int tx_length, char *rx_buffer, int rx_length,
+                 const event_callback_t &callback, int event = I2C_EVENT_TRANSFER_COMPLETE,
+                 bool repeated = false);
+    void abort_transfer();
+    int set_dma_usage(DMAUsage usage);
+
+private:
+    int         _hz;
+    DMAUsage    _dma_usage;
+};
+
+} // namespace mbed
+
+using namespace mbed;
+
+mbed::Serial &get_stdio_serial();
+
+#endif // __HOST_SHIM_MBED_H__
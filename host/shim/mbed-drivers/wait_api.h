@@ -0,0 +1,28 @@
+/*
+ * Copyright (c) 2016 ARM Limited. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __HOST_SHIM_WAIT_API_H__
+#define __HOST_SHIM_WAIT_API_H__
+
+/*
+ * Busy waits: the clock moves on by the time given and it counts as busy,
+ * and no callback runs in between, like a spin on the board
+ */
+void wait(float s);
+void wait_ms(int ms);
+void wait_us(int us);
+
+#endif // __HOST_SHIM_WAIT_API_H__
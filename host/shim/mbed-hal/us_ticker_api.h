@@ -0,0 +1,26 @@
+/*
+ * Copyright (c) 2016 ARM Limited. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __HOST_SHIM_US_TICKER_API_H__
+#define __HOST_SHIM_US_TICKER_API_H__
+
+#include <stdint.h>
+
+// Virtual microseconds since start, wrapping at 2^32 like the hardware timer.
+// Stands still in deepsleep() like the K64F PIT, lp_ticker_read() does not.
+uint32_t us_ticker_read(void);
+
+#endif // __HOST_SHIM_US_TICKER_API_H__
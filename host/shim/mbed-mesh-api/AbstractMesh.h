@@ -0,0 +1,48 @@
+/*
+ * Copyright (c) 2016 ARM Limited. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __HOST_SHIM_ABSTRACT_MESH_H__
+#define __HOST_SHIM_ABSTRACT_MESH_H__
+
+#include "core-util/FunctionPointer.h"
+#include "mbed-mesh-api/mesh_interface_types.h"
+
+/*
+ * Host mesh: connect() reports MESH_CONNECTED from the event loop, there is
+ * no radio to wait for
+ */
+class AbstractMesh {
+public:
+    typedef mbed::util::FunctionPointer1<void, mesh_connection_status_t> mesh_network_handler_t;
+
+    virtual ~AbstractMesh() {
+    }
+
+    int8_t connect();
+    int8_t disconnect();
+
+protected:
+    int8_t init(int8_t registered_device_id, mesh_network_handler_t handler) {
+        _device_id = registered_device_id;
+        _handler = handler;
+        return MESH_ERROR_NONE;
+    }
+
+    int8_t                  _device_id;
+    mesh_network_handler_t  _handler;
+};
+
+#endif // __HOST_SHIM_ABSTRACT_MESH_H__
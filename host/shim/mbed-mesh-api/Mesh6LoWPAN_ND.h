@@ -0,0 +1,29 @@
+/*
+ * Copyright (c) 2016 ARM Limited. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __HOST_SHIM_MESH_6LOWPAN_ND_H__
+#define __HOST_SHIM_MESH_6LOWPAN_ND_H__
+
+#include "mbed-mesh-api/AbstractMesh.h"
+
+class Mesh6LoWPAN_ND : public AbstractMesh {
+public:
+    int8_t init(int8_t registered_device_id, mesh_network_handler_t handler) {
+        return AbstractMesh::init(registered_device_id, handler);
+    }
+};
+
+#endif // __HOST_SHIM_MESH_6LOWPAN_ND_H__
@@ -0,0 +1,33 @@
+/*
+ * Copyright (c) 2016 ARM Limited. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __HOST_SHIM_MESH_INTERFACE_FACTORY_H__
+#define __HOST_SHIM_MESH_INTERFACE_FACTORY_H__
+
+#include "mbed-mesh-api/Mesh6LoWPAN_ND.h"
+#include "mbed-mesh-api/MeshThread.h"
+
+class MeshInterfaceFactory {
+public:
+    static AbstractMesh *createInterface(mesh_network_type_t type) {
+        if (type == MESH_TYPE_THREAD) {
+            return new MeshThread();
+        }
+        return new Mesh6LoWPAN_ND();
+    }
+};
+
+#endif // __HOST_SHIM_MESH_INTERFACE_FACTORY_H__
@@ -0,0 +1,44 @@
+/*
+ * Copyright (c) 2016 ARM Limited. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __HOST_SHIM_MESH_INTERFACE_TYPES_H__
+#define __HOST_SHIM_MESH_INTERFACE_TYPES_H__
+
+#include <stdint.h>
+
+enum mesh_connection_status_t {
+    MESH_CONNECTED = 0,
+    MESH_CONNECTED_LOCAL,
+    MESH_CONNECTED_GLOBAL,
+    MESH_DISCONNECTED,
+    MESH_BOOTSTRAP_START_FAILED = -1,
+    MESH_BOOTSTRAP_FAILED = -2
+};
+
+enum mesh_network_type_t {
+    MESH_TYPE_THREAD,
+    MESH_TYPE_6LOWPAN_ND
+};
+
+enum mesh_error_t {
+    MESH_ERROR_NONE = 0,
+    MESH_ERROR_UNKNOWN = -1,
+    MESH_ERROR_PARAM = -2,
+    MESH_ERROR_MEMORY = -3,
+    MESH_ERROR_STATE = -4
+};
+
+#endif // __HOST_SHIM_MESH_INTERFACE_TYPES_H__
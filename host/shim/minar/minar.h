@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) 2016 ARM Limited. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __HOST_SHIM_MINAR_H__
+#define __HOST_SHIM_MINAR_H__
+
+#include <stdint.h>
+#include "core-util/FunctionPointer.h"
+
+/*
+ * Host stand-in for minar. Callbacks run on the host event loop in
+ * host/source/runtime.cpp, against the virtual clock. One tick is 1 ms.
+ */
+namespace minar {
+
+typedef uint32_t tick_t;
+typedef void *callback_handle_t;
+
+inline tick_t milliseconds(uint32_t ms) {
+    return ms;
+}
+
+/*
+ * Returned by postCallback(). The callback is queued when this goes out of
+ * scope or getHandle() is called, whichever comes first.
+ */
+class CallbackAdder {
+public:
+    explicit CallbackAdder(const mbed::util::Event &event);
+    CallbackAdder(const CallbackAdder &other);
+    ~CallbackAdder();
+
+    CallbackAdder &delay(tick_t delay);
+    CallbackAdder &period(tick_t period);
+    CallbackAdder &tolerance(tick_t tolerance);
+    callback_handle_t getHandle();
+
+private:
+    CallbackAdder &operator=(const CallbackAdder &);
+    callback_handle_t commit();
+
+    mbed::util::Event   _event;
+    tick_t              _delay;
+    tick_t              _period;
+    mutable bool        _pending;
+    callback_handle_t   _handle;
+};
+
+class Scheduler {
+public:
+    static CallbackAdder postCallback(const mbed::util::Event &event) {
+        return CallbackAdder(event);
+    }
+
+    static CallbackAdder postCallback(void (*function)()) {
+        return CallbackAdder(mbed::util::FunctionPointer(function).bind());
+    }
+
+    template <typename T>
+    static CallbackAdder postCallback(T *object, void (T::*member)()) {
+        return CallbackAdder(mbed::util::FunctionPointer(object, member).bind());
+    }
+
+    static int cancelCallback(callback_handle_t handle);
+
+    static int start();
+    static void stop();
+};
+
+} // namespace minar
+
+#endif // __HOST_SHIM_MINAR_H__
@@ -0,0 +1,36 @@
+/*
+ * Copyright (c) 2016 ARM Limited. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __HOST_SHIM_SECURITY_H__
+#define __HOST_SHIM_SECURITY_H__
+
+#include <stdint.h>
+
+/*
+ * Placeholder for the security.h from mbed Device Connector. The host
+ * client does no DTLS, so the keys are empty. The endpoint name comes from
+ * $KNOCK_HOST_ENDPOINT, so several host processes can run side by side.
+ */
+const char *host_endpoint_name();
+
+#define MBED_DOMAIN "host"
+#define MBED_ENDPOINT_NAME host_endpoint_name()
+
+const uint8_t SERVER_CERT[] = "";
+const uint8_t CERT[] = "";
+const uint8_t KEY[] = "";
+
+#endif // __HOST_SHIM_SECURITY_H__
@@ -0,0 +1,89 @@
+/*
+ * Copyright (c) 2016 ARM Limited. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __HOST_SHIM_DRIVER_STORAGE_H__
+#define __HOST_SHIM_DRIVER_STORAGE_H__
+
+#include <stdint.h>
+
+/*
+ * The part of the CMSIS storage driver API the firmware uses, with the
+ * K64F internal flash driver on top of host::FileFlash (source/storage.cpp).
+ * Operations always complete synchronously.
+ */
+#define ARM_DRIVER_OK                   0
+#define ARM_DRIVER_ERROR                -1
+#define ARM_DRIVER_ERROR_PARAMETER      -5
+
+typedef enum _ARM_STORAGE_OPERATION {
+    ARM_STORAGE_OPERATION_GET_VERSION,
+    ARM_STORAGE_OPERATION_GET_CAPABILITIES,
+    ARM_STORAGE_OPERATION_INITIALIZE,
+    ARM_STORAGE_OPERATION_UNINITIALIZE,
+    ARM_STORAGE_OPERATION_POWER_CONTROL,
+    ARM_STORAGE_OPERATION_READ_DATA,
+    ARM_STORAGE_OPERATION_PROGRAM_DATA,
+    ARM_STORAGE_OPERATION_ERASE,
+    ARM_STORAGE_OPERATION_ERASE_ALL
+} ARM_STORAGE_OPERATION;
+
+typedef void (*ARM_Storage_Callback_t)(int32_t status, ARM_STORAGE_OPERATION operation);
+
+typedef struct _ARM_STORAGE_CAPABILITIES {
+    uint32_t asynchronous_ops   : 1;
+    uint32_t erase_all          : 1;
+    uint32_t reserved           : 30;
+} ARM_STORAGE_CAPABILITIES;
+
+typedef struct _ARM_STORAGE_BLOCK_ATTRIBUTES {
+    uint32_t erasable           : 1;
+    uint32_t programmable       : 1;
+    uint32_t executable         : 1;
+    uint32_t protectable        : 1;
+    uint32_t reserved           : 28;
+    uint32_t erase_unit;
+    uint32_t protection_unit;
+} ARM_STORAGE_BLOCK_ATTRIBUTES;
+
+typedef struct _ARM_STORAGE_BLOCK {
+    uint64_t                        addr;
+    uint64_t                        size;
+    ARM_STORAGE_BLOCK_ATTRIBUTES    attributes;
+} ARM_STORAGE_BLOCK;
+
+typedef struct _ARM_STORAGE_INFO {
+    uint64_t total_storage;
+    uint32_t program_unit;
+    uint32_t optimal_program_unit;
+    uint32_t program_cycles;
+    uint32_t erased_value       : 1;
+    uint32_t memory_mapped      : 1;
+    uint32_t reserved           : 30;
+} ARM_STORAGE_INFO;
+
+typedef struct _ARM_DRIVER_STORAGE {
+    ARM_STORAGE_CAPABILITIES (*GetCapabilities)(void);
+    int32_t (*Initialize)(ARM_Storage_Callback_t callback);
+    int32_t (*ReadData)(uint64_t addr, void *data, uint32_t size);
+    int32_t (*ProgramData)(uint64_t addr, const void *data, uint32_t size);
+    int32_t (*Erase)(uint64_t addr, uint32_t size);
+    int32_t (*GetInfo)(ARM_STORAGE_INFO *info);
+    int32_t (*GetBlock)(uint64_t addr, ARM_STORAGE_BLOCK *block);
+} const ARM_DRIVER_STORAGE;
+
+extern ARM_DRIVER_STORAGE ARM_Driver_Storage_MTD_K64F;
+
+#endif // __HOST_SHIM_DRIVER_STORAGE_H__
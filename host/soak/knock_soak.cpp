@@ -0,0 +1,457 @@
+/*
+ * Copyright (c) 2016 ARM Limited. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <getopt.h>
+#include <stdlib.h>
+#include <string>
+#include "host.h"
+#ifdef KNOCK_SOAK_ETHERNET
+#include "simpleclient.h"
+#else
+#include "mbedclient.h"
+#endif
+#include "mbed-client/m2minterfacefactory.h"
+#include "mbed-hal/sleep_api.h"
+#include "knock-core/clock_sync.h"
+#include "knock-core/heap_resource.h"
+#include "knock-core/xorshift.h"
+
+/*
+ * Reconnect soak for the MbedClient of firmware-6lowpan, or of
+ * firmware-ethernet when built with KNOCK_SOAK_ETHERNET: registers, breaks
+ * the connection, waits for the client to register again, and so on, with
+ * network errors and refusals by the server taking turns. After a warm-up
+ * the heap must not grow; the process exits with 1 when it does.
+ *
+ * With --stall the client stays registered instead, while a callback blocks
+ * the event loop now and then the way a slow knock handler would. Every
+ * registration update must then still be answered before the lifetime of
+ * the last one runs out, and the client must never register again.
+ *
+ * --sleep does the same with the loop in deepsleep() between events, where
+ * the us_ticker stands still, and a knock every --knock-every updates an
+ * observable resource through MbedClient::set_value(). Each knock must be
+ * notified within the minimum interval, and when the knocks are close enough that one
+ * always comes between the piggyback point and the planned update, every
+ * registration update must go out together with one.
+ *
+ * Both also run the clock pings of /time/0, which the simulated server
+ * never answers, like mbed Device Connector; after the first hour not one
+ * more may go out while the client stays registered.
+ *
+ * The server is simulated and time is virtual, and the backoff is shortened
+ * at build time, so 100k cycles take seconds.
+ */
+namespace {
+
+struct SoakOptions {
+    uint32_t    cycles;
+    uint32_t    warmup;         // cycles before the baseline is taken
+    uint32_t    slack;          // bytes the heap may grow over the baseline
+    uint32_t    stall_ms;       // 0 for none
+    uint32_t    stall_every_ms; // mean time between two stalls
+    bool        sleep;          // deepsleep() between events
+    uint32_t    knock_every_ms; // 0 for no knocks
+    uint32_t    hours;          // length of a --stall or --sleep run
+
+    // stays registered, no reconnect cycles
+    bool registered() const {
+        return stall_ms || sleep;
+    }
+};
+
+#ifdef KNOCK_SOAK_ETHERNET
+typedef EthernetClientConfig SoakConfig;
+#else
+typedef MbedClientConfig SoakConfig;
+#endif
+
+SoakOptions soak;
+MbedClient *client;
+uint64_t seen = 0;              // registrations seen so far
+uint32_t cycles = 0;
+HeapStats baseline;
+HeapStats highest;              // the largest `used` after the warm-up
+bool failed = false;
+
+// --stall and --sleep
+uint64_t refreshed = 0;         // registrations and updates answered so far
+uint64_t last_refresh_us = 0;
+uint64_t longest_gap_us = 0;    // between two refreshes
+uint64_t stalls = 0;
+
+// knocks
+M2MResource *knock_res = NULL;
+uint32_t knocks = 0;
+uint32_t notified = 0;          // notifications of knock_res
+uint32_t last_notified = 0;     // the knock it carried
+uint64_t pending_since_us = 0;  // oldest knock not notified yet, 0 none
+uint64_t slowest_us = 0;        // from a knock to its notification
+uint64_t piggybacked = 0;       // updates sent along with a knock
+
+// clock pings
+struct SoakClock {
+    uint64_t now() {
+        return host::now_us();
+    }
+};
+SoakClock soak_clock;
+ClockSyncResource<SoakClock> *clock_sync = NULL;
+uint32_t pings = 0;
+uint32_t late_pings = 0;        // after the first hour
+const uint64_t PINGS_STOP_US = 3600000000ULL;
+
+MbedClientDevice device = {
+    "Manufacturer_String",
+    "Type_String",
+    "ModelNumber_String",
+    "SerialNumber_String",
+    "knock-soak"
+};
+#ifndef KNOCK_SOAK_ETHERNET
+uint8_t mac_addr[8] = { 0x02, 0, 0, 0, 0, 0, 0, 0x01 };
+#endif
+
+// every registration that went through ends one cycle and breaks the next
+void check() {
+    uint64_t registered = host::client_stats().registered;
+    if (registered == seen) {
+        return;
+    }
+    seen = registered;
+    cycles++;
+    host::clear_client_latencies();
+
+    HeapStats heap = HeapStats::read();
+    if (cycles == soak.warmup) {
+        baseline = heap;
+        highest = heap;
+    } else if (cycles > soak.warmup && heap.used > highest.used) {
+        highest = heap;
+    }
+    if (cycles >= soak.cycles) {
+        minar::Scheduler::stop();
+        return;
+    }
+    client->error(cycles % 2 ? M2MInterface::NetworkError : M2MInterface::NotAllowed);
+}
+
+// every refresh the server answered, and how long it was since the last
+void check_refresh() {
+    const host::ClientStats &stats = host::client_stats();
+    uint64_t answered = stats.registered + stats.updated;
+    if (answered != refreshed) {
+        uint64_t now = host::now_us();
+        if (refreshed && now - last_refresh_us > longest_gap_us) {
+            longest_gap_us = now - last_refresh_us;
+        }
+        refreshed = answered;
+        last_refresh_us = now;
+        host::clear_client_latencies();
+    }
+    if (soak.sleep) {
+        // until the next timer, the us_ticker stops meanwhile
+        deepsleep();
+    }
+}
+
+void knock() {
+    char buffer[INT_FORMAT_SIZE];
+    size_t length = format_uint(buffer, ++knocks);
+    if (!pending_since_us) {
+        pending_since_us = host::now_us();
+    }
+    uint64_t updates = host::client_stats().updates;
+    client->set_value(knock_res, (uint8_t *)buffer, length);
+    piggybacked += host::client_stats().updates - updates;
+}
+
+// longest time between knocks that still puts one between the piggyback
+// point and the earliest planned update, 0 when there is no such time
+uint64_t piggyback_window_ms() {
+    int32_t window = (int32_t)SoakConfig::UPDATE_FRACTION - SoakConfig::UPDATE_JITTER - SoakConfig::PIGGYBACK;
+    if (!SoakConfig::PIGGYBACK || window <= 0) {
+        return 0;
+    }
+    return ((uint64_t)SoakConfig::LIFETIME * 1000 * window) >> 15;
+}
+
+void knock_notified(const M2MResourceInstance &res) {
+    if (&res != knock_res) {
+        return;
+    }
+    uint64_t now = host::now_us();
+    if (pending_since_us && now - pending_since_us > slowest_us) {
+        slowest_us = now - pending_since_us;
+    }
+    pending_since_us = 0;
+    notified++;
+    last_notified = strtoul(std::string((const char *)res.value(), res.value_length()).c_str(), NULL, 10);
+}
+
+void ping_notified(const M2MResourceInstance &res) {
+    if (res.uri_path() != "time/0/ping") {
+        return;
+    }
+    pings++;
+    if (host::now_us() > PINGS_STOP_US) {
+        late_pings++;
+    }
+}
+
+void client_registered() {
+    clock_sync->client_registered();
+}
+
+// blocks the loop, then comes back after a random 0 to 2 mean intervals
+void stall() {
+    static Xorshift32 random;
+    wait_ms(soak.stall_ms);
+    stalls++;
+    uint32_t delay = random.below_or_equal(2 * soak.stall_every_ms);
+    minar::Scheduler::postCallback(mbed::util::FunctionPointer(&stall).bind())
+        .delay(minar::milliseconds(delay));
+}
+
+void finish() {
+    minar::Scheduler::stop();
+}
+
+void registered_report(FILE *out) {
+    const host::ClientStats &stats = host::client_stats();
+    fprintf(out, "soak: %u h registered, %llu stalls of %u ms, %llu registrations, %llu updates answered\n",
+            (unsigned)soak.hours, (unsigned long long)stalls, (unsigned)soak.stall_ms,
+            (unsigned long long)stats.registered, (unsigned long long)stats.updated);
+    if (knocks) {
+        fprintf(out, "soak: %u knocks, %u notified, at most %llu ms late, %llu of %llu updates sent with one\n",
+                (unsigned)knocks, (unsigned)notified, (unsigned long long)(slowest_us / 1000),
+                (unsigned long long)piggybacked, (unsigned long long)stats.updates);
+    }
+    fprintf(out, "soak: %u clock pings, %u after the first hour\n", (unsigned)pings, (unsigned)late_pings);
+    uint64_t gap_ms = longest_gap_us / 1000;
+    uint64_t now = host::now_us();
+    uint64_t since_ms = (now - last_refresh_us) / 1000;
+    fprintf(out, "soak: refreshed at most %llu s apart, lifetime %u s\n", (unsigned long long)(gap_ms / 1000),
+            (unsigned)SoakConfig::LIFETIME);
+    if (stats.registered != 1) {
+        fprintf(out, "soak: FAILED, the client registered %llu times\n", (unsigned long long)stats.registered);
+        failed = true;
+    } else if (gap_ms >= SoakConfig::LIFETIME * 1000ull || since_ms >= SoakConfig::LIFETIME * 1000ull) {
+        fprintf(out, "soak: FAILED, the registration lapsed\n");
+        failed = true;
+    } else if (slowest_us > SoakConfig::NOTIFY_MIN_INTERVAL * 1000ull ||
+               (pending_since_us && now - pending_since_us > SoakConfig::NOTIFY_MIN_INTERVAL * 1000ull)) {
+        fprintf(out, "soak: FAILED, a knock waited longer than the minimum interval (%u ms) for its notification\n",
+                (unsigned)SoakConfig::NOTIFY_MIN_INTERVAL);
+        failed = true;
+    } else if (knocks && soak.knock_every_ms < piggyback_window_ms() && piggybacked != stats.updates) {
+        fprintf(out, "soak: FAILED, %llu updates did not wait for the next knock, one comes every %u ms\n",
+                (unsigned long long)(stats.updates - piggybacked), (unsigned)soak.knock_every_ms);
+        failed = true;
+    } else if (!pending_since_us && last_notified != knocks) {
+        fprintf(out, "soak: FAILED, the last knock notified is %u of %u\n", (unsigned)last_notified,
+                (unsigned)knocks);
+        failed = true;
+    } else if (!pings || late_pings) {
+        fprintf(out, "soak: FAILED, unanswered clock pings did not stop\n");
+        failed = true;
+    } else {
+        fprintf(out, "soak: registration kept\n");
+    }
+}
+
+void report(FILE *out) {
+    HeapStats heap = HeapStats::read();
+    fprintf(out, "soak: %u reconnect cycles, heap after %u: %u used, %u free in %u chunks, %u from the system\n",
+            (unsigned)cycles, (unsigned)soak.warmup, (unsigned)baseline.used, (unsigned)baseline.free,
+            (unsigned)baseline.free_chunks, (unsigned)baseline.arena);
+    fprintf(out, "soak: at the end: %u used, %u free in %u chunks, %u from the system, at most %u used\n",
+            (unsigned)heap.used, (unsigned)heap.free, (unsigned)heap.free_chunks, (unsigned)heap.arena,
+            (unsigned)highest.used);
+    if (cycles < soak.cycles) {
+        fprintf(out, "soak: FAILED, the client stopped registering after %u cycles\n", (unsigned)cycles);
+        failed = true;
+    } else if (highest.used > baseline.used + soak.slack || heap.arena > baseline.arena + soak.slack) {
+        fprintf(out, "soak: FAILED, the heap grew by %d bytes\n", (int)(highest.used - baseline.used));
+        failed = true;
+    } else {
+        fprintf(out, "soak: heap flat\n");
+    }
+}
+
+void usage(const char *name) {
+    fprintf(stderr,
+            "usage: %s [options]\n"
+            "  -n, --cycles N        reconnect N times (default 100000)\n"
+            "  -w, --warmup N        take the heap baseline after N cycles (default 100)\n"
+            "      --slack BYTES     allowed heap growth over the baseline (default 0)\n"
+            "      --stall MS        stay registered and block the loop for MS now and then\n"
+            "      --stall-every MS  mean time between two stalls (default 2000)\n"
+            "      --sleep           stay registered and deep sleep between events\n"
+            "      --knock-every MS  with --stall or --sleep, set an observable value every MS\n"
+            "      --hours N         length of a --stall or --sleep run in virtual hours (default 48)\n"
+            "  -v, --verbose         firmware output\n",
+            name);
+}
+
+bool parse_options(int argc, char *argv[], host::Options &options) {
+    static const struct option long_options[] = {
+        { "cycles", required_argument, 0, 'n' },
+        { "warmup", required_argument, 0, 'w' },
+        { "slack", required_argument, 0, 'S' },
+        { "stall", required_argument, 0, 's' },
+        { "stall-every", required_argument, 0, 'e' },
+        { "sleep", no_argument, 0, 'z' },
+        { "knock-every", required_argument, 0, 'k' },
+        { "hours", required_argument, 0, 'H' },
+        { "verbose", no_argument, 0, 'v' },
+        { "help", no_argument, 0, 'h' },
+        { 0, 0, 0, 0 }
+    };
+
+    options.trace = NULL;
+    options.server = NULL;
+    options.realtime = false;
+    options.verbose = false;
+    options.duration_ms = 0;
+    options.tail_ms = 0;
+    options.rtt_ms = 50;
+    options.flash = NULL;
+    options.outage_start_ms = 0;
+    options.outage_ms = 0;
+
+    soak.cycles = 100000;
+    soak.warmup = 100;
+    soak.slack = 0;
+    soak.stall_ms = 0;
+    soak.stall_every_ms = 2000;
+    soak.sleep = false;
+    soak.knock_every_ms = 0;
+    soak.hours = 48;
+
+    int c;
+    while ((c = getopt_long(argc, argv, "n:w:vh", long_options, NULL)) != -1) {
+        switch (c) {
+            case 'n':
+                soak.cycles = strtoul(optarg, NULL, 10);
+                break;
+            case 'w':
+                soak.warmup = strtoul(optarg, NULL, 10);
+                break;
+            case 'S':
+                soak.slack = strtoul(optarg, NULL, 10);
+                break;
+            case 's':
+                soak.stall_ms = strtoul(optarg, NULL, 10);
+                break;
+            case 'e':
+                soak.stall_every_ms = strtoul(optarg, NULL, 10);
+                break;
+            case 'z':
+                soak.sleep = true;
+                break;
+            case 'k':
+                soak.knock_every_ms = strtoul(optarg, NULL, 10);
+                break;
+            case 'H':
+                soak.hours = strtoul(optarg, NULL, 10);
+                break;
+            case 'v':
+                options.verbose = true;
+                break;
+            default:
+                usage(argv[0]);
+                return false;
+        }
+    }
+    if (soak.registered()) {
+        if (!soak.stall_every_ms || !soak.hours) {
+            usage(argv[0]);
+            return false;
+        }
+    } else if (!soak.warmup || soak.warmup >= soak.cycles) {
+        usage(argv[0]);
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+#ifndef KNOCK_SOAK_ETHERNET
+uint8_t *get_mac_address() {
+    return mac_addr;
+}
+#endif
+
+#ifdef KNOCK_HOST_SANITIZE
+// the client lives until exit, like on the board
+extern "C" const char *__asan_default_options() {
+    return "detect_leaks=0";
+}
+#endif
+
+int main(int argc, char *argv[]) {
+    host::Options options;
+    if (!parse_options(argc, argv, options)) {
+        return 2;
+    }
+    host::init(options);
+
+    if (!options.verbose) {
+        // a few lines per cycle
+        if (!freopen("/dev/null", "w", stdout)) {
+            fprintf(stderr, "soak: can not silence the firmware output\n");
+        }
+    }
+
+    client = new MbedClient(device);
+    if (soak.registered() && soak.knock_every_ms) {
+        M2MObject *object = M2MInterfaceFactory::create_object("accelerometer");
+        knock_res = object->create_object_instance()->create_dynamic_resource("last_knock", "Knock",
+            M2MResourceInstance::INTEGER, true /* observable */);
+        knock_res->set_operation(M2MBase::GET_ALLOWED);
+        knock_res->set_value((uint8_t *)"0", 1);
+        client->object_list_push(object);
+        host::on_notification(knock_notified);
+        minar::Scheduler::postCallback(mbed::util::FunctionPointer(&knock).bind())
+            .period(minar::milliseconds(soak.knock_every_ms));
+    }
+    if (soak.registered()) {
+        clock_sync = new ClockSyncResource<SoakClock>(soak_clock);
+        client->object_list_push(clock_sync->get_object());
+        client->on_registered(mbed::util::FunctionPointer0<void>(&client_registered));
+        host::on_notification(ping_notified);
+    }
+    client->network_connected();
+    if (soak.registered()) {
+        minar::Scheduler::postCallback(mbed::util::FunctionPointer(&check_refresh).bind())
+            .period(minar::milliseconds(10));
+        if (soak.stall_ms) {
+            minar::Scheduler::postCallback(mbed::util::FunctionPointer(&stall).bind())
+                .delay(minar::milliseconds(soak.stall_every_ms));
+        }
+        minar::Scheduler::postCallback(mbed::util::FunctionPointer(&finish).bind())
+            .delay(minar::milliseconds(soak.hours * 3600000u));
+        host::add_report(registered_report);
+    } else {
+        minar::Scheduler::postCallback(mbed::util::FunctionPointer(&check).bind())
+            .period(minar::milliseconds(10));
+        host::add_report(report);
+    }
+    host::run();
+    return failed ? 1 : 0;
+}
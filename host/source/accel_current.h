@@ -0,0 +1,61 @@
+/*
+ * Copyright (c) 2016 ARM Limited. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __HOST_ACCEL_CURRENT_H__
+#define __HOST_ACCEL_CURRENT_H__
+
+#include <stdint.h>
+
+/*
+ * Supply current of the FXOS8700CQ accelerometer, as a model rather than a
+ * measurement: the sensor draws in proportion to the conversions it makes,
+ * the output data rate times the oversampling ratio of its power mode, on
+ * top of the standby current. The constants land in the range of the
+ * datasheet figures; use them to compare settings, not as absolute values.
+ * Accelerometer only, the magnetometer of hybrid mode is left out.
+ */
+namespace host {
+
+const double ACCEL_STANDBY_UA = 2.0;
+const double ACCEL_UA_PER_CONVERSION_HZ = 0.1;
+
+// CTRL_REG1[DR] in Hz
+inline double accel_rate_hz(uint8_t dr) {
+    static const double RATE_HZ[] = { 800, 400, 200, 100, 50, 12.5, 6.25, 1.5625 };
+    return RATE_HZ[dr & 7];
+}
+
+// oversampling ratio for CTRL_REG1[DR] and CTRL_REG2[MODS]
+inline uint32_t accel_oversampling(uint8_t dr, uint8_t mods) {
+    static const uint16_t OSR[4][8] = {
+        { 2, 4, 4, 4, 4, 4, 4, 4 },                 // normal
+        { 2, 4, 4, 4, 4, 4, 4, 4 },                 // low noise low power
+        { 2, 4, 8, 16, 32, 128, 256, 1024 },        // high resolution
+        { 2, 2, 2, 2, 2, 2, 2, 2 }                  // low power
+    };
+    return OSR[mods & 3][dr & 7];
+}
+
+inline double accel_current_ua(bool active, uint8_t dr, uint8_t mods) {
+    if (!active) {
+        return ACCEL_STANDBY_UA;
+    }
+    return ACCEL_STANDBY_UA + ACCEL_UA_PER_CONVERSION_HZ * accel_rate_hz(dr) * accel_oversampling(dr, mods);
+}
+
+} // namespace host
+
+#endif // __HOST_ACCEL_CURRENT_H__
@@ -0,0 +1,221 @@
+/*
+ * Copyright (c) 2016 ARM Limited. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <stdio.h>
+#include <algorithm>
+#include "coap.h"
+
+namespace host {
+namespace coap {
+
+namespace {
+
+bool option_less(const Option &a, const Option &b) {
+    return a.number < b.number;
+}
+
+// the 4 bit nibble and the extended bytes of an option delta or length
+void encode_extended(uint32_t value, uint8_t &nibble, std::string &extended) {
+    if (value < 13) {
+        nibble = value;
+    } else if (value < 269) {
+        nibble = 13;
+        extended += (char)(value - 13);
+    } else {
+        nibble = 14;
+        value -= 269;
+        extended += (char)(value >> 8);
+        extended += (char)value;
+    }
+}
+
+bool decode_extended(uint8_t nibble, const uint8_t *&p, const uint8_t *end, uint32_t &value) {
+    if (nibble < 13) {
+        value = nibble;
+    } else if (nibble == 13) {
+        if (p + 1 > end) {
+            return false;
+        }
+        value = *p++ + 13;
+    } else if (nibble == 14) {
+        if (p + 2 > end) {
+            return false;
+        }
+        value = ((uint32_t)p[0] << 8 | p[1]) + 269;
+        p += 2;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+void Message::add_option(uint16_t number, const std::string &value) {
+    Option option = { number, value };
+    options.push_back(option);
+}
+
+void Message::add_uint_option(uint16_t number, uint32_t value) {
+    std::string bytes;
+    for (int shift = 24; shift >= 0; shift -= 8) {
+        if (!bytes.empty() || (value >> shift) & 0xFF) {
+            bytes += (char)(value >> shift);
+        }
+    }
+    add_option(number, bytes);
+}
+
+void Message::add_path(uint16_t number, const std::string &path) {
+    size_t start = 0;
+    while (start <= path.size()) {
+        size_t slash = path.find('/', start);
+        if (slash == std::string::npos) {
+            slash = path.size();
+        }
+        if (slash > start) {
+            add_option(number, path.substr(start, slash - start));
+        }
+        start = slash + 1;
+    }
+}
+
+bool Message::has_option(uint16_t number) const {
+    for (size_t i = 0; i < options.size(); i++) {
+        if (options[i].number == number) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool Message::uint_option(uint16_t number, uint32_t &value) const {
+    for (size_t i = 0; i < options.size(); i++) {
+        if (options[i].number == number && options[i].value.size() <= 4) {
+            value = 0;
+            for (size_t b = 0; b < options[i].value.size(); b++) {
+                value = value << 8 | (uint8_t)options[i].value[b];
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+std::string Message::path(uint16_t number) const {
+    std::string result;
+    for (size_t i = 0; i < options.size(); i++) {
+        if (options[i].number == number) {
+            if (!result.empty()) {
+                result += '/';
+            }
+            result += options[i].value;
+        }
+    }
+    return result;
+}
+
+bool Message::query(const std::string &name, std::string &value) const {
+    for (size_t i = 0; i < options.size(); i++) {
+        const std::string &option = options[i].value;
+        if (options[i].number == URI_QUERY && option.size() > name.size() &&
+            option.compare(0, name.size(), name) == 0 && option[name.size()] == '=') {
+            value = option.substr(name.size() + 1);
+            return true;
+        }
+    }
+    return false;
+}
+
+std::string encode(const Message &message) {
+    std::string out;
+    out += (char)(0x40 | (message.type & 3) << 4 | (message.token.size() & 0x0F));
+    out += (char)message.code;
+    out += (char)(message.id >> 8);
+    out += (char)message.id;
+    out += message.token.substr(0, 8);
+
+    std::vector<Option> options(message.options);
+    std::stable_sort(options.begin(), options.end(), option_less);
+    uint16_t previous = 0;
+    for (size_t i = 0; i < options.size(); i++) {
+        uint8_t delta_nibble, length_nibble;
+        std::string extended;
+        encode_extended(options[i].number - previous, delta_nibble, extended);
+        std::string length_extended;
+        encode_extended(options[i].value.size(), length_nibble, length_extended);
+        out += (char)(delta_nibble << 4 | length_nibble);
+        out += extended;
+        out += length_extended;
+        out += options[i].value;
+        previous = options[i].number;
+    }
+
+    if (!message.payload.empty()) {
+        out += (char)0xFF;
+        out += message.payload;
+    }
+    return out;
+}
+
+bool decode(const uint8_t *data, size_t length, Message &message) {
+    if (length < 4 || (data[0] >> 6) != 1) {
+        return false;
+    }
+    size_t token_length = data[0] & 0x0F;
+    if (token_length > 8 || length < 4 + token_length) {
+        return false;
+    }
+    message.type = (data[0] >> 4) & 3;
+    message.code = data[1];
+    message.id = (uint16_t)data[2] << 8 | data[3];
+    message.token.assign((const char *)data + 4, token_length);
+    message.options.clear();
+    message.payload.clear();
+
+    const uint8_t *p = data + 4 + token_length;
+    const uint8_t *end = data + length;
+    uint32_t number = 0;
+    while (p < end && *p != 0xFF) {
+        uint8_t header = *p++;
+        uint32_t delta, option_length;
+        if (!decode_extended(header >> 4, p, end, delta) ||
+            !decode_extended(header & 0x0F, p, end, option_length) ||
+            option_length > (size_t)(end - p)) {
+            return false;
+        }
+        number += delta;
+        Option option = { (uint16_t)number, std::string((const char *)p, option_length) };
+        message.options.push_back(option);
+        p += option_length;
+    }
+    if (p < end) {
+        // payload marker followed by at least one byte
+        if (++p == end) {
+            return false;
+        }
+        message.payload.assign((const char *)p, end - p);
+    }
+    return true;
+}
+
+std::string code_name(uint8_t code) {
+    char buffer[8];
+    snprintf(buffer, sizeof(buffer), "%u.%02u", code >> 5, code & 0x1F);
+    return buffer;
+}
+
+} // namespace coap
+} // namespace host
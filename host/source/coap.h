@@ -0,0 +1,148 @@
+/*
+ * Copyright (c) 2016 ARM Limited. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef __HOST_COAP_H__
+#define __HOST_COAP_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+/*
+ * The part of CoAP (RFC 7252) and observe (RFC 7641) that LWM2M
+ * registration and notifications need, and Block2 (RFC 7959) for large
+ * GET responses. No Block1, no DTLS.
+ */
+namespace host {
+namespace coap {
+
+enum Type {
+    CON = 0,
+    NON = 1,
+    ACK = 2,
+    RST = 3
+};
+
+// class << 5 | detail
+enum Code {
+    EMPTY               = 0x00,
+    GET                 = 0x01,
+    POST                = 0x02,
+    PUT                 = 0x03,
+    DELETE              = 0x04,
+    CREATED             = 0x41,     // 2.01
+    DELETED             = 0x42,     // 2.02
+    CHANGED             = 0x44,     // 2.04
+    CONTENT             = 0x45,     // 2.05
+    BAD_REQUEST         = 0x80,     // 4.00
+    BAD_OPTION          = 0x82,     // 4.02
+    FORBIDDEN           = 0x83,     // 4.03
+    NOT_FOUND           = 0x84,     // 4.04
+    METHOD_NOT_ALLOWED  = 0x85,     // 4.05
+    INTERNAL_ERROR      = 0xA0      // 5.00
+};
+
+enum OptionNumber {
+    OBSERVE             = 6,
+    LOCATION_PATH       = 8,
+    URI_PATH            = 11,
+    CONTENT_FORMAT      = 12,
+    URI_QUERY           = 15,
+    BLOCK2              = 23,
+    SIZE2               = 28
+};
+
+enum ContentFormat {
+    TEXT_PLAIN          = 0,
+    LINK_FORMAT         = 40,
+    OCTET_STREAM        = 42
+};
+
+// RFC 7252 section 4.8 transmission parameters, in ms
+const uint32_t ACK_TIMEOUT = 2000;
+const uint32_t MAX_RETRANSMIT = 4;
+
+/*
+ * Value of a Block2 option: block `num` of 16 << szx bytes, `more` when
+ * further blocks follow
+ */
+struct Block {
+    uint32_t    num;
+    bool        more;
+    uint8_t     szx;
+
+    static Block from(uint32_t value) {
+        Block block = { value >> 4, (value & 0x08) != 0, (uint8_t)(value & 0x07) };
+        return block;
+    }
+
+    uint32_t value() const {
+        return num << 4 | (more ? 0x08 : 0) | szx;
+    }
+
+    size_t size() const {
+        return (size_t)16 << szx;
+    }
+};
+
+struct Option {
+    uint16_t    number;
+    std::string value;
+};
+
+struct Message {
+    Message() : type(CON), code(EMPTY), id(0) {
+    }
+
+    uint8_t             type;
+    uint8_t             code;
+    uint16_t            id;
+    std::string         token;
+    std::vector<Option> options;
+    std::string         payload;
+
+    void add_option(uint16_t number, const std::string &value);
+
+    // shortest big endian encoding, 0 is the empty string
+    void add_uint_option(uint16_t number, uint32_t value);
+
+    // one option per segment of `path`, e.g. "rd/4" with URI_PATH
+    void add_path(uint16_t number, const std::string &path);
+
+    bool has_option(uint16_t number) const;
+    bool uint_option(uint16_t number, uint32_t &value) const;
+
+    // the options `number` joined with '/', e.g. the Uri-Path
+    std::string path(uint16_t number = URI_PATH) const;
+
+    // the value of query option "name=value", false when there is none
+    bool query(const std::string &name, std::string &value) const;
+
+    bool is_request() const {
+        return code >= GET && code <= DELETE;
+    }
+};
+
+std::string encode(const Message &message);
+bool decode(const uint8_t *data, size_t length, Message &message);
+
+// "2.05" and the like, for logging
+std::string code_name(uint8_t code);
+
+} // namespace coap
+} // namespace host
+
+#endif // __HOST_COAP_H__
@@ -0,0 +1,236 @@
+/*
+ * Copyright (c) 2016 ARM Limited. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdarg.h>
+#include <map>
+#include <vector>
+#include "host.h"
+#include "knock-core/perf_probe.h"
+
+namespace host {
+
+namespace {
+
+std::vector<mbed::InterruptIn *> &interrupts() {
+    static std::vector<mbed::InterruptIn *> instance;
+    return instance;
+}
+
+std::map<int, I2CDevice *> &i2c_devices() {
+    static std::map<int, I2CDevice *> instance;
+    return instance;
+}
+
+uint64_t handled_edges = 0;
+bool in_handler = false;   // an InterruptIn handler is running
+
+/*
+ * Time on the simulated I2C bus, 9 clocks per byte with the address byte,
+ * split by who waits for it
+ */
+struct I2CStats {
+    uint64_t    blocking;           // read() and write() calls
+    uint64_t    blocking_us;
+    uint64_t    in_handlers;        // of them, from an interrupt handler
+    uint64_t    in_handlers_us;
+    uint64_t    transfers;          // transfer() calls
+    uint64_t    transfers_us;
+};
+
+I2CStats i2c_stats_instance;
+
+void i2c_report(FILE *out) {
+    const I2CStats &stats = i2c_stats_instance;
+    if (!stats.blocking && !stats.transfers) {
+        return;
+    }
+    fprintf(out, "i2c: %llu blocking calls, %.1f ms the CPU waited (%llu calls, %.1f ms in interrupt handlers), "
+            "%llu asynchronous transfers, %.1f ms\n",
+            (unsigned long long)stats.blocking, stats.blocking_us / 1e3, (unsigned long long)stats.in_handlers,
+            stats.in_handlers_us / 1e3, (unsigned long long)stats.transfers, stats.transfers_us / 1e3);
+}
+
+uint64_t bus_us(int hz, int bytes) {
+    return hz > 0 ? (uint64_t)(bytes + 1) * 9 * 1000000 / hz : 0;
+}
+
+I2CStats &i2c_stats() {
+    static bool reported = false;
+    if (!reported) {
+        add_report(i2c_report);
+        reported = true;
+    }
+    return i2c_stats_instance;
+}
+
+void count_blocking(int hz, int bytes) {
+    I2CStats &stats = i2c_stats();
+    uint64_t us = bus_us(hz, bytes);
+    // so the perf probes around the call see the wait
+    perf_host_stall_ns() += us * 1000;
+    stats.blocking++;
+    stats.blocking_us += us;
+    if (in_handler) {
+        stats.in_handlers++;
+        stats.in_handlers_us += us;
+    }
+}
+
+} // namespace
+
+uint64_t interrupt_count() {
+    return handled_edges;
+}
+
+void pin_edge(PinName pin, bool rising) {
+    std::vector<mbed::InterruptIn *> &list = interrupts();
+    for (size_t i = 0; i < list.size(); i++) {
+        if (list[i]->pin() == pin) {
+            list[i]->edge(rising);
+        }
+    }
+}
+
+void attach_i2c(int address, I2CDevice *device) {
+    i2c_devices()[address] = device;
+}
+
+I2CDevice *i2c_device(int address) {
+    std::map<int, I2CDevice *>::iterator it = i2c_devices().find(address);
+    return it == i2c_devices().end() ? NULL : it->second;
+}
+
+} // namespace host
+
+namespace mbed {
+
+DigitalOut::DigitalOut(PinName pin)
+    : _pin(pin), _value(0) {
+}
+
+void DigitalOut::write(int value) {
+    _value = value;
+}
+
+int DigitalOut::read() {
+    return _value;
+}
+
+InterruptIn::InterruptIn(PinName pin)
+    : _pin(pin), _mode(PullNone) {
+    host::interrupts().push_back(this);
+}
+
+InterruptIn::~InterruptIn() {
+    std::vector<InterruptIn *> &list = host::interrupts();
+    for (size_t i = 0; i < list.size(); i++) {
+        if (list[i] == this) {
+            list.erase(list.begin() + i);
+            break;
+        }
+    }
+}
+
+void InterruptIn::edge(bool rising) {
+    mbed::util::FunctionPointer &handler = rising ? _rise : _fall;
+    if (handler) {
+        host::handled_edges++;
+        host::in_handler = true;
+        handler.call();
+        host::in_handler = false;
+    }
+}
+
+Serial::Serial(PinName /*tx*/, PinName /*rx*/)
+    : _baud(9600) {
+}
+
+void Serial::baud(int baudrate) {
+    _baud = baudrate;
+}
+
+int Serial::printf(const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    int length = vprintf(format, args);
+    va_end(args);
+    return length;
+}
+
+int Serial::putc(int c) {
+    return putchar(c);
+}
+
+int Serial::write(const uint8_t *data, int length) {
+    return fwrite(data, 1, length, stdout);
+}
+
+I2C::I2C(PinName /*sda*/, PinName /*scl*/)
+    : _hz(100000), _dma_usage(DMA_USAGE_NEVER) {
+}
+
+void I2C::frequency(int hz) {
+    _hz = hz;
+}
+
+int I2C::read(int address, char *data, int length, bool /*repeated*/) {
+    host::I2CDevice *device = host::i2c_device(address);
+    host::count_blocking(_hz, length);
+    return device && device->i2c_read((uint8_t *)data, length) ? 0 : 1;
+}
+
+int I2C::write(int address, const char *data, int length, bool repeated) {
+    host::I2CDevice *device = host::i2c_device(address);
+    host::count_blocking(_hz, length);
+    return device && device->i2c_write((const uint8_t *)data, length, repeated) ? 0 : 1;
+}
+
+int I2C::transfer(int address, const char *tx_buffer, int tx_length, char *rx_buffer, int rx_length,
+                  const event_callback_t &callback, int event, bool repeated) {
+    host::I2CDevice *device = host::i2c_device(address);
+    bool ok = device != NULL;
+    if (ok && tx_length) {
+        ok = device->i2c_write((const uint8_t *)tx_buffer, tx_length, rx_length > 0 || repeated);
+    }
+    if (ok && rx_length) {
+        ok = device->i2c_read((uint8_t *)rx_buffer, rx_length);
+    }
+    host::I2CStats &stats = host::i2c_stats();
+    stats.transfers++;
+    stats.transfers_us += host::bus_us(_hz, tx_length) + (rx_length ? host::bus_us(_hz, rx_length) : 0);
+
+    int result = ok ? I2C_EVENT_TRANSFER_COMPLETE : I2C_EVENT_ERROR_NO_SLAVE;
+    // from the I2C interrupt on a board, which may start the next transfer
+    if (callback && (result & event)) {
+        callback.call(result);
+    }
+    return 0;
+}
+
+void I2C::abort_transfer() {
+}
+
+int I2C::set_dma_usage(DMAUsage usage) {
+    _dma_usage = usage;
+    return 0;
+}
+
+} // namespace mbed
+
+mbed::Serial &get_stdio_serial() {
+    static mbed::Serial serial(USBTX, USBRX);
+    return serial;
+}
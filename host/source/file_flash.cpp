@@ -0,0 +1,132 @@
+/*
+ * Copyright (c) 2016 ARM Limited. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "file_flash.h"
+
+namespace host {
+
+FileFlash::FileFlash(uint32_t size, uint32_t sector_size, uint32_t program_size)
+    : _fd(-1), _size(size), _sector_size(sector_size), _program_size(program_size), _cut(false),
+      _units_left(0), _programmed(0), _erases(0), _sector_erases(sector_size ? size / sector_size : 0) {
+}
+
+FileFlash::~FileFlash() {
+    if (_fd >= 0) {
+        close(_fd);
+    }
+}
+
+bool FileFlash::open(const char *path) {
+    if (_fd >= 0 || _sector_size == 0 || _program_size == 0 || _size % _sector_size ||
+        _sector_size % _program_size) {
+        return false;
+    }
+    if (path) {
+        _fd = ::open(path, O_RDWR | O_CREAT, 0644);
+    } else {
+        char name[] = "/tmp/knock-flash-XXXXXX";
+        _fd = mkstemp(name);
+        if (_fd >= 0) {
+            unlink(name);
+        }
+    }
+    if (_fd < 0) {
+        return false;
+    }
+
+    // what the file does not cover yet is erased
+    struct stat st;
+    if (fstat(_fd, &st) != 0) {
+        return false;
+    }
+    std::vector<uint8_t> erased(_sector_size, 0xFF);
+    for (uint32_t address = 0; address < _size; address += _sector_size) {
+        if ((off_t)(address + _sector_size) > st.st_size &&
+            pwrite(_fd, &erased[0], _sector_size, address) != (ssize_t)_sector_size) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool FileFlash::read(uint32_t address, void *data, uint32_t length) {
+    if (_fd < 0 || address > _size || length > _size - address) {
+        return false;
+    }
+    return pread(_fd, data, length, address) == (ssize_t)length;
+}
+
+bool FileFlash::program(uint32_t address, const void *data, uint32_t length) {
+    if (_fd < 0 || address > _size || length > _size - address || address % _program_size ||
+        length % _program_size) {
+        return false;
+    }
+    std::vector<uint8_t> current(length);
+    if (pread(_fd, &current[0], length, address) != (ssize_t)length) {
+        return false;
+    }
+    for (uint32_t i = 0; i < length; i++) {
+        if (current[i] != 0xFF) {
+            return false;
+        }
+    }
+
+    uint32_t units = length / _program_size;
+    if (_cut && units > _units_left) {
+        // the power goes half way, what made it is kept
+        units = _units_left;
+    }
+    uint32_t written = units * _program_size;
+    if (written && pwrite(_fd, data, written, address) != (ssize_t)written) {
+        return false;
+    }
+    _programmed += written;
+    if (_cut) {
+        _units_left -= units;
+    }
+    return written == length;
+}
+
+bool FileFlash::erase(uint32_t address) {
+    if (_fd < 0 || address >= _size || (_cut && _units_left == 0)) {
+        return false;
+    }
+    address -= address % _sector_size;
+    std::vector<uint8_t> erased(_sector_size, 0xFF);
+    if (pwrite(_fd, &erased[0], _sector_size, address) != (ssize_t)_sector_size) {
+        return false;
+    }
+    _erases++;
+    _sector_erases[address / _sector_size]++;
+    return true;
+}
+
+void FileFlash::cut_power_after(uint32_t units) {
+    _cut = true;
+    _units_left = units;
+}
+
+void FileFlash::restore_power() {
+    _cut = false;
+}
+
+} // namespace host
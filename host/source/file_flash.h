@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) 2016 ARM Limited. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __HOST_FILE_FLASH_H__
+#define __HOST_FILE_FLASH_H__
+
+#include <stdint.h>
+#include <vector>
+
+namespace host {
+
+/*
+ * NOR flash kept in a file, the Flash of KnockJournal on the host. Erasing
+ * sets a sector to 0xFF; programming needs aligned program units that are
+ * still erased, like the K64F, which does not program a phrase twice
+ * between erases.
+ *
+ * Counts what a real part would wear out on, and can cut the power in the
+ * middle of a program to leave a torn record behind.
+ */
+class FileFlash {
+public:
+    FileFlash(uint32_t size, uint32_t sector_size, uint32_t program_size);
+    ~FileFlash();
+
+    /*
+    * Opens or creates `path`, NULL for an anonymous temporary file. A new
+    * file starts out erased.
+    */
+    bool open(const char *path);
+
+    uint32_t size() const {
+        return _size;
+    }
+
+    uint32_t sector_size() const {
+        return _sector_size;
+    }
+
+    uint32_t program_size() const {
+        return _program_size;
+    }
+
+    bool read(uint32_t address, void *data, uint32_t length);
+    bool program(uint32_t address, const void *data, uint32_t length);
+    bool erase(uint32_t address);
+
+    /*
+    * Programs only `units` more program units and fails every write after
+    * that, until restore_power()
+    */
+    void cut_power_after(uint32_t units);
+    void restore_power();
+
+    uint64_t programmed() const {
+        return _programmed;
+    }
+
+    uint64_t erases() const {
+        return _erases;
+    }
+
+    // erases of each sector since open()
+    const std::vector<uint32_t> &sector_erases() const {
+        return _sector_erases;
+    }
+
+private:
+    FileFlash(const FileFlash &);
+    FileFlash &operator=(const FileFlash &);
+
+    int                     _fd;
+    uint32_t                _size;
+    uint32_t                _sector_size;
+    uint32_t                _program_size;
+    bool                    _cut;           // the power goes after _units_left more units
+    uint32_t                _units_left;
+    uint64_t                _programmed;    // bytes
+    uint64_t                _erases;
+    std::vector<uint32_t>   _sector_erases;
+};
+
+} // namespace host
+
+#endif // __HOST_FILE_FLASH_H__
@@ -0,0 +1,144 @@
+/*
+ * Copyright (c) 2016 ARM Limited. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __HOST_HOST_H__
+#define __HOST_HOST_H__
+
+#include <stdint.h>
+#include <stdio.h>
+#include <functional>
+#include <vector>
+#include "mbed-drivers/mbed.h"
+
+class M2MResourceInstance;
+
+/*
+ * Runtime behind the shim headers: command line options, the virtual clock,
+ * the minar event loop and the registry of simulated hardware.
+ *
+ * Time is virtual. The loop jumps straight to the next callback or hardware
+ * event, and the host CPU time each callback takes is added to the clock, so
+ * a slow callback delays the ones after it like it would on the board.
+ * With --realtime the loop also sleeps to keep pace with the wall clock.
+ */
+namespace host {
+
+struct Options {
+    const char  *trace;         // sensor trace to replay, NULL for a board at rest
+    const char  *server;        // LWM2M server host:port, NULL for a simulated one
+    bool        realtime;
+    bool        verbose;
+    uint32_t    duration_ms;    // 0 = until the trace is over
+    uint32_t    tail_ms;        // keep running this long after the trace ended
+    uint32_t    rtt_ms;         // round trip to the simulated server
+    const char  *flash;         // file behind the internal flash, NULL for a temporary one
+    uint32_t    outage_start_ms;    // the simulated server is out of reach from here
+    uint32_t    outage_ms;          // for this long, 0 never
+};
+
+const Options &options();
+
+// set the options before anything else, then run() the loop until the end
+void init(const Options &options);
+int run();
+
+// virtual microseconds since start
+uint64_t now_us();
+
+/*
+ * Simulated hardware. The loop calls advance() with the current time before
+ * running callbacks; that is where a device raises its interrupts.
+ */
+class Device {
+public:
+    static const uint64_t NEVER = UINT64_MAX;
+
+    virtual ~Device() {
+    }
+
+    virtual uint64_t next_event() const = 0;
+    virtual void advance(uint64_t now) = 0;
+};
+
+void add_device(Device *device);
+
+// register file style I2C slave, addresses as the mbed I2C driver takes them
+class I2CDevice {
+public:
+    virtual ~I2CDevice() {
+    }
+
+    virtual bool i2c_write(const uint8_t *data, int length, bool repeated) = 0;
+    virtual bool i2c_read(uint8_t *data, int length) = 0;
+};
+
+void attach_i2c(int address, I2CDevice *device);
+I2CDevice *i2c_device(int address);
+
+/*
+ * Calls `readable` from the loop whenever `fd` has data. Sockets only make
+ * sense with Options::realtime, virtual time does not wait for them.
+ */
+void watch(int fd, const std::function<void()> &readable);
+void unwatch(int fd);
+
+// drives the InterruptIn objects on `pin`
+void pin_edge(PinName pin, bool rising);
+
+// edges that reached an interrupt handler so far, a sleep ends at the next
+uint64_t interrupt_count();
+
+// stops the loop `tail_ms` from now, for the end of a trace
+void finish_soon();
+
+/*
+ * Counters of the host M2MInterface, summed over all clients in the
+ * process. Latencies are in us.
+ */
+struct ClientStats {
+    uint64_t registrations;         // register requests sent
+    uint64_t registered;            // answered with 2.01
+    uint64_t updates;
+    uint64_t updated;               // updates answered with 2.04
+    uint64_t notifications;         // sent to an observer
+    uint64_t acknowledged;          // notifications the server acknowledged
+    uint64_t retransmissions;
+    uint64_t timeouts;              // requests given up after all retransmissions
+    uint64_t requests;              // requests from the server
+    uint64_t blocks;                // Block2 answers among them
+    uint64_t datagrams;             // sent
+    uint64_t bytes;                 // sent
+    std::vector<uint32_t> registration_latency;     // register until 2.01
+    std::vector<uint32_t> notification_latency;     // set_value() until the ACK
+};
+
+const ClientStats &client_stats();
+
+// frees the latencies recorded so far, for long runs that do not report them
+void clear_client_latencies();
+
+// called with the resource of every notification sent to an observer
+void on_notification(const std::function<void(const M2MResourceInstance &)> &listener);
+
+// extra lines for the summary printed at exit
+void add_report(const std::function<void(FILE *)> &report);
+
+// sets up the simulated sensor, in sim_fxos8700cq.cpp
+bool start_accelerometer(const char *trace);
+
+} // namespace host
+
+#endif // __HOST_HOST_H__
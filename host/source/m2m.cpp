@@ -0,0 +1,806 @@
+/*
+ * Copyright (c) 2016 ARM Limited. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <map>
+#include <string>
+#include "host.h"
+#include "coap.h"
+#include "minar/minar.h"
+#include "mbed-client/m2minterfacefactory.h"
+#include "knock-core/xorshift.h"
+#include "security.h"
+
+/*
+ * Host M2MInterface.
+ *
+ * Without --server the registration always succeeds after the simulated
+ * round trip and notifications only get counted. During --outage the
+ * registered clients get a network error and registrations fail.
+ *
+ * With --server every client speaks LWM2M over plain CoAP on a UDP socket
+ * of its own: register, update and deregister with the resource directory
+ * at /rd, GET, PUT and POST on the resources, observe, and confirmable
+ * notifications. Requests are retransmitted like RFC 7252 asks. GET
+ * answers larger than a block go out in Block2 blocks. There is no DTLS,
+ * no Block1 and no duplicate detection.
+ */
+namespace host {
+
+namespace {
+
+using namespace coap;
+
+ClientStats stats;
+std::vector<std::function<void(const M2MResourceInstance &)> > notification_listeners;
+
+// 256 byte blocks, the usual coap-max-blockwise-payload-size of mbed-client
+const uint8_t MAX_BLOCK_SZX = 4;
+
+class Client;
+
+// which clients registered a resource, the M2MDevice object is shared
+std::map<const M2MResourceInstance *, std::vector<Client *> > registered_resources;
+
+std::vector<Client *> clients;
+
+struct sockaddr_storage server_address;
+socklen_t server_address_length = 0;
+
+// resolves --server once, false when it does not resolve
+bool resolve_server() {
+    static bool resolved = false;
+    if (resolved) {
+        return server_address_length > 0;
+    }
+    resolved = true;
+
+    std::string server = options().server;
+    size_t colon = server.rfind(':');
+    if (colon == std::string::npos) {
+        fprintf(stderr, "host: --server needs host:port\n");
+        return false;
+    }
+    std::string name = server.substr(0, colon);
+    std::string port = server.substr(colon + 1);
+    if (name.size() > 2 && name[0] == '[' && name[name.size() - 1] == ']') {
+        name = name.substr(1, name.size() - 2);
+    }
+
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_DGRAM;
+    struct addrinfo *result;
+    if (getaddrinfo(name.c_str(), port.c_str(), &hints, &result) != 0) {
+        fprintf(stderr, "host: can not resolve %s\n", server.c_str());
+        return false;
+    }
+    memcpy(&server_address, result->ai_addr, result->ai_addrlen);
+    server_address_length = result->ai_addrlen;
+    freeaddrinfo(result);
+    return true;
+}
+
+// in the --outage of the simulated server
+bool out_of_reach() {
+    uint64_t now_ms = now_us() / 1000;
+    return options().outage_ms && now_ms >= options().outage_start_ms &&
+           now_ms < (uint64_t)options().outage_start_ms + options().outage_ms;
+}
+
+void record(std::vector<uint32_t> &latencies, uint64_t start) {
+    uint64_t latency = now_us() - start;
+    latencies.push_back(latency > UINT32_MAX ? UINT32_MAX : (uint32_t)latency);
+}
+
+class Client : public M2MInterface {
+public:
+    Client(M2MInterfaceObserver &observer, const String &endpoint, const String &type,
+           const String &domain, uint32_t lifetime)
+        : _observer(observer), _endpoint(endpoint), _type(type), _domain(domain),
+          _lifetime(lifetime), _security(NULL), _registered(false), _fd(-1),
+          _register_start(0) {
+        // FNV-1a of the name, so the ids and tokens of clients differ
+        uint32_t hash = 2166136261u;
+        for (size_t i = 0; i < _endpoint.size(); i++) {
+            hash = (hash ^ (uint8_t)_endpoint[i]) * 16777619u;
+        }
+        _random.seed(hash);
+        _next_id = _random.next();
+        _next_token = _random.next();
+        clients.push_back(this);
+    }
+
+    ~Client() {
+        forget_resources();
+        for (std::map<uint16_t, Exchange>::iterator it = _exchanges.begin(); it != _exchanges.end(); ++it) {
+            minar::Scheduler::cancelCallback(it->second.timer);
+        }
+        if (_fd >= 0) {
+            unwatch(_fd);
+            close(_fd);
+        }
+        for (size_t i = 0; i < clients.size(); i++) {
+            if (clients[i] == this) {
+                clients.erase(clients.begin() + i);
+                break;
+            }
+        }
+    }
+
+    void register_object(M2MSecurity *security, const M2MObjectList &object_list) {
+        _security = security;
+        forget_resources();
+        _objects = object_list;
+        for_each_resource([this](M2MResource *res) { registered_resources[res].push_back(this); });
+
+        stats.registrations++;
+        _register_start = now_us();
+        if (!options().server) {
+            later(out_of_reach() ? &Client::unreachable : &Client::registered);
+            return;
+        }
+        if (!open_socket()) {
+            _observer.error(M2MInterface::NetworkError);
+            return;
+        }
+
+        Message request;
+        request.code = POST;
+        request.add_path(URI_PATH, "rd");
+        request.add_option(URI_QUERY, "ep=" + _endpoint);
+        if (!_type.empty()) {
+            request.add_option(URI_QUERY, "et=" + _type);
+        }
+        request.add_option(URI_QUERY, "lt=" + std::to_string(_lifetime));
+        request.add_option(URI_QUERY, "b=U");
+        if (!_domain.empty()) {
+            request.add_option(URI_QUERY, "d=" + _domain);
+        }
+        request.add_uint_option(CONTENT_FORMAT, LINK_FORMAT);
+        for_each_resource([&request](M2MResource *res) {
+            if (!request.payload.empty()) {
+                request.payload += ",";
+            }
+            request.payload += "</" + res->uri_path() + ">";
+            if (res->is_observable()) {
+                request.payload += ";obs";
+            }
+        });
+        send_request(request, REGISTER);
+    }
+
+    void update_registration(M2MSecurity * /*security*/, const uint32_t lifetime) {
+        if (lifetime) {
+            _lifetime = lifetime;
+        }
+        stats.updates++;
+        if (!options().server) {
+            later(&Client::updated);
+            return;
+        }
+        if (_location.empty()) {
+            _observer.error(M2MInterface::NotRegistered);
+            return;
+        }
+        Message request;
+        request.code = POST;
+        request.add_path(URI_PATH, _location);
+        request.add_option(URI_QUERY, "lt=" + std::to_string(_lifetime));
+        send_request(request, UPDATE);
+    }
+
+    void unregister_object(M2MSecurity * /*security*/) {
+        if (!options().server) {
+            later(&Client::unregistered);
+            return;
+        }
+        if (_location.empty()) {
+            _observer.error(M2MInterface::NotRegistered);
+            return;
+        }
+        Message request;
+        request.code = DELETE;
+        request.add_path(URI_PATH, _location);
+        send_request(request, DEREGISTER);
+    }
+
+    // every resource value, like a GET on each would return them
+    void dump(FILE *out) const {
+        for_each_resource([out](const M2MResource *res) {
+            fprintf(out, "  /%s = ", res->uri_path().c_str());
+            if (res->resource_instance_type() == M2MResourceInstance::OPAQUE) {
+                for (uint32_t b = 0; b < res->value_length(); b++) {
+                    fprintf(out, "%02x", res->value()[b]);
+                }
+            } else {
+                fwrite(res->value(), 1, res->value_length(), out);
+            }
+            fputc('\n', out);
+        });
+    }
+
+    void notify(const M2MResourceInstance &res) {
+        if (!_registered || !res.is_observable()) {
+            return;
+        }
+        if (!options().server) {
+            stats.notifications++;
+            log_notification(res);
+            return;
+        }
+        for (size_t i = 0; i < _observations.size(); i++) {
+            Observation &observation = _observations[i];
+            if (observation.resource != &res) {
+                continue;
+            }
+            Message message;
+            message.code = CONTENT;
+            message.token = observation.token;
+            message.add_uint_option(OBSERVE, ++observation.sequence & 0xFFFFFF);
+            add_content(message, res);
+            send_request(message, NOTIFY, &res);
+            stats.notifications++;
+            log_notification(res);
+        }
+    }
+
+    const std::string &endpoint() const {
+        return _endpoint;
+    }
+
+    // the simulated server went out of reach
+    void lose_server() {
+        if (_registered) {
+            _registered = false;
+            _observer.error(M2MInterface::NetworkError);
+        }
+    }
+
+private:
+    enum Kind {
+        REGISTER,
+        UPDATE,
+        DEREGISTER,
+        NOTIFY
+    };
+
+    // a confirmable message waiting for its ACK, or a request for its response
+    struct Exchange {
+        Kind                        kind;
+        std::string                 token;
+        std::string                 datagram;
+        uint64_t                    start;
+        uint32_t                    timeout;        // ms until the next retransmission
+        uint32_t                    retransmissions;
+        bool                        acknowledged;   // empty ACK, the response comes separately
+        const M2MResourceInstance   *resource;      // NOTIFY only
+        minar::callback_handle_t    timer;
+    };
+
+    struct Observation {
+        const M2MResourceInstance   *resource;
+        std::string                 token;
+        uint32_t                    sequence;
+    };
+
+    void later(void (Client::*member)()) {
+        minar::Scheduler::postCallback(mbed::util::FunctionPointer(this, member).bind())
+            .delay(minar::milliseconds(options().rtt_ms));
+    }
+
+    void registered() {
+        _registered = true;
+        record(stats.registration_latency, _register_start);
+        stats.registered++;
+        _observer.object_registered(_security, _server);
+    }
+
+    void updated() {
+        stats.updated++;
+        _observer.registration_updated(_security, _server);
+    }
+
+    void unreachable() {
+        _observer.error(M2MInterface::NetworkError);
+    }
+
+    void unregistered() {
+        _registered = false;
+        _location.clear();
+        _observations.clear();
+        _observer.object_unregistered(_security);
+    }
+
+    template <typename F>
+    void for_each_resource(F f) const {
+        for (size_t o = 0; o < _objects.size(); o++) {
+            const std::vector<M2MObjectInstance *> &instances = _objects[o]->instances();
+            for (size_t i = 0; i < instances.size(); i++) {
+                const std::vector<M2MResource *> &resources = instances[i]->resources();
+                for (size_t r = 0; r < resources.size(); r++) {
+                    f(resources[r]);
+                }
+            }
+        }
+    }
+
+    M2MResource *find_resource(const std::string &path) const {
+        M2MResource *found = NULL;
+        for_each_resource([&found, &path](M2MResource *res) {
+            if (res->uri_path() == path) {
+                found = res;
+            }
+        });
+        return found;
+    }
+
+    void forget_resources() {
+        for_each_resource([this](M2MResource *res) {
+            std::vector<Client *> &owners = registered_resources[res];
+            for (size_t i = 0; i < owners.size(); i++) {
+                if (owners[i] == this) {
+                    owners.erase(owners.begin() + i);
+                    break;
+                }
+            }
+        });
+    }
+
+    void log_notification(const M2MResourceInstance &res) {
+        for (size_t i = 0; i < notification_listeners.size(); i++) {
+            notification_listeners[i](res);
+        }
+        if (options().verbose) {
+            printf("[host] %s: notify /%s (%u bytes)\r\n", _endpoint.c_str(), res.uri_path().c_str(),
+                   (unsigned)res.value_length());
+        }
+    }
+
+    bool open_socket() {
+        if (_fd >= 0) {
+            return true;
+        }
+        if (!resolve_server()) {
+            return false;
+        }
+        _fd = socket(server_address.ss_family, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (_fd < 0) {
+            fprintf(stderr, "host: %s: socket: %s\n", _endpoint.c_str(), strerror(errno));
+            return false;
+        }
+        if (connect(_fd, (struct sockaddr *)&server_address, server_address_length) != 0) {
+            fprintf(stderr, "host: %s: connect to %s: %s\n", _endpoint.c_str(), options().server, strerror(errno));
+            close(_fd);
+            _fd = -1;
+            return false;
+        }
+        watch(_fd, [this]() { receive(); });
+        return true;
+    }
+
+    void send(const std::string &datagram) {
+        if (_fd >= 0 && ::send(_fd, datagram.data(), datagram.size(), 0) >= 0) {
+            stats.datagrams++;
+            stats.bytes += datagram.size();
+        }
+    }
+
+    void send_reply(const Message &reply) {
+        send(encode(reply));
+    }
+
+    // sends `message` as CON, then retransmits until it is acknowledged
+    void send_request(Message &message, Kind kind, const M2MResourceInstance *resource = NULL) {
+        message.type = CON;
+        message.id = _next_id++;
+        if (kind != NOTIFY) {
+            uint32_t token = _next_token++;
+            message.token.assign((const char *)&token, sizeof(token));
+        }
+
+        Exchange &exchange = _exchanges[message.id];
+        exchange.kind = kind;
+        exchange.token = message.token;
+        exchange.datagram = encode(message);
+        exchange.start = now_us();
+        // ACK_TIMEOUT * ACK_RANDOM_FACTOR, the factor between 1 and 1.5
+        exchange.timeout = ACK_TIMEOUT + _random.below_or_equal(ACK_TIMEOUT / 2);
+        exchange.retransmissions = 0;
+        exchange.acknowledged = false;
+        exchange.resource = resource;
+        exchange.timer = NULL;
+        send(exchange.datagram);
+        arm(message.id, exchange);
+    }
+
+    void arm(uint16_t id, Exchange &exchange) {
+        mbed::util::FunctionPointer1<void, uint16_t> fp(this, &Client::retransmit);
+        exchange.timer = minar::Scheduler::postCallback(fp.bind(id))
+            .delay(minar::milliseconds(exchange.timeout))
+            .getHandle();
+    }
+
+    void retransmit(uint16_t id) {
+        std::map<uint16_t, Exchange>::iterator it = _exchanges.find(id);
+        if (it == _exchanges.end()) {
+            return;
+        }
+        Exchange &exchange = it->second;
+        exchange.timer = NULL;
+        if (exchange.acknowledged || exchange.retransmissions == MAX_RETRANSMIT) {
+            // a separate response gets the same time as the retransmissions
+            stats.timeouts++;
+            Exchange failed = exchange;
+            _exchanges.erase(it);
+            fail(failed, M2MInterface::NetworkError);
+            return;
+        }
+        exchange.retransmissions++;
+        exchange.timeout *= 2;
+        stats.retransmissions++;
+        send(exchange.datagram);
+        arm(id, exchange);
+    }
+
+    void fail(const Exchange &exchange, M2MInterface::Error error) {
+        if (exchange.kind == NOTIFY) {
+            // the observer is gone, RFC 7641 section 4.5
+            remove_observation(exchange.token);
+            return;
+        }
+        _observer.error(error);
+    }
+
+    void receive() {
+        uint8_t buffer[1500];
+        ssize_t length;
+        while ((length = recv(_fd, buffer, sizeof(buffer), 0)) >= 0) {
+            Message message;
+            if (!decode(buffer, length, message)) {
+                continue;
+            }
+            if (message.is_request()) {
+                serve(message);
+            } else if (message.type == ACK || message.type == RST) {
+                acknowledged(message);
+            } else if (message.code != EMPTY) {
+                separate_response(message);
+            }
+        }
+    }
+
+    void acknowledged(const Message &message) {
+        std::map<uint16_t, Exchange>::iterator it = _exchanges.find(message.id);
+        if (it == _exchanges.end()) {
+            return;
+        }
+        Exchange &exchange = it->second;
+        minar::Scheduler::cancelCallback(exchange.timer);
+        exchange.timer = NULL;
+
+        if (message.type == RST) {
+            Exchange failed = exchange;
+            _exchanges.erase(it);
+            fail(failed, M2MInterface::NetworkError);
+        } else if (exchange.kind == NOTIFY) {
+            stats.acknowledged++;
+            record(stats.notification_latency, exchange.start);
+            _exchanges.erase(it);
+        } else if (message.code == EMPTY) {
+            // the response comes later as a request of its own
+            exchange.acknowledged = true;
+            arm(it->first, exchange);
+        } else {
+            Exchange done = exchange;
+            _exchanges.erase(it);
+            response(done, message);
+        }
+    }
+
+    void separate_response(const Message &message) {
+        if (message.type == CON) {
+            Message ack;
+            ack.type = ACK;
+            ack.id = message.id;
+            send_reply(ack);
+        }
+        for (std::map<uint16_t, Exchange>::iterator it = _exchanges.begin(); it != _exchanges.end(); ++it) {
+            if (it->second.kind != NOTIFY && it->second.token == message.token) {
+                minar::Scheduler::cancelCallback(it->second.timer);
+                Exchange done = it->second;
+                _exchanges.erase(it);
+                response(done, message);
+                return;
+            }
+        }
+    }
+
+    void response(const Exchange &exchange, const Message &message) {
+        switch (exchange.kind) {
+            case REGISTER:
+                if (message.code == CREATED) {
+                    _location = message.path(LOCATION_PATH);
+                    registered();
+                } else {
+                    _observer.error(message.code == FORBIDDEN ? M2MInterface::NotAllowed
+                                                              : M2MInterface::InvalidParameters);
+                }
+                break;
+            case UPDATE:
+                if (message.code == CHANGED) {
+                    updated();
+                } else {
+                    if (message.code == NOT_FOUND) {
+                        _registered = false;
+                        _location.clear();
+                    }
+                    _observer.error(M2MInterface::NotRegistered);
+                }
+                break;
+            case DEREGISTER:
+                if (message.code == DELETED) {
+                    unregistered();
+                } else {
+                    _observer.error(M2MInterface::NotRegistered);
+                }
+                break;
+            case NOTIFY:
+                break;
+        }
+    }
+
+    // GET (with observe), PUT and POST from the server
+    void serve(const Message &request) {
+        stats.requests++;
+        Message reply;
+        reply.type = request.type == CON ? ACK : NON;
+        reply.id = request.type == CON ? request.id : _next_id++;
+        reply.token = request.token;
+
+        M2MResource *res = find_resource(request.path());
+        if (!res) {
+            reply.code = NOT_FOUND;
+        } else if (request.code == GET) {
+            if (!(res->operation() & M2MBase::GET_ALLOWED)) {
+                reply.code = METHOD_NOT_ALLOWED;
+            } else {
+                reply.code = CONTENT;
+                uint32_t observe;
+                if (request.uint_option(OBSERVE, observe)) {
+                    remove_observation(request.token);
+                    if (observe == 0 && res->is_observable()) {
+                        Observation observation;
+                        observation.resource = res;
+                        observation.token = request.token;
+                        observation.sequence = 0;
+                        _observations.push_back(observation);
+                        reply.add_uint_option(OBSERVE, 0);
+                    }
+                }
+                add_content(reply, *res, &request);
+            }
+        } else if (request.code == PUT) {
+            if (!(res->operation() & M2MBase::PUT_ALLOWED)) {
+                reply.code = METHOD_NOT_ALLOWED;
+            } else {
+                reply.code = CHANGED;
+                res->set_value((const uint8_t *)request.payload.data(), request.payload.size());
+                res->execute_value_updated(res->name());
+                _observer.value_updated(res, M2MBase::Resource);
+            }
+        } else if (request.code == POST) {
+            if (!(res->operation() & M2MBase::POST_ALLOWED)) {
+                reply.code = METHOD_NOT_ALLOWED;
+            } else {
+                reply.code = CHANGED;
+                res->execute((void *)&request.payload);
+            }
+        } else {
+            reply.code = METHOD_NOT_ALLOWED;
+        }
+        if (options().verbose) {
+            printf("[host] %s: %s /%s -> %s\r\n", _endpoint.c_str(), code_name(request.code).c_str(),
+                   request.path().c_str(), code_name(reply.code).c_str());
+        }
+        send_reply(reply);
+    }
+
+    /*
+    * The value of `res`, for a GET `request` in blocks when it is larger
+    * than one or the request asked for a block
+    */
+    void add_content(Message &message, const M2MResourceInstance &res, const Message *request = NULL) {
+        bool opaque = res.resource_instance_type() == M2MResourceInstance::OPAQUE;
+        message.add_uint_option(CONTENT_FORMAT, opaque ? OCTET_STREAM : TEXT_PLAIN);
+
+        uint8_t *value = res.value();
+        uint32_t length = res.value_length();
+        if (request) {
+            res.outgoing_block_message(value, length);
+        }
+
+        Block block = { 0, false, MAX_BLOCK_SZX };
+        uint32_t option;
+        bool asked = request && request->uint_option(BLOCK2, option);
+        if (asked) {
+            Block wanted = Block::from(option);
+            if (wanted.szx == 7) {
+                message.code = BAD_OPTION;
+                return;
+            }
+            // a smaller block than asked for, so the number scales up
+            block.num = wanted.szx > block.szx ? wanted.num << (wanted.szx - block.szx) : wanted.num;
+            block.szx = wanted.szx < block.szx ? wanted.szx : block.szx;
+        }
+        if (!request || (!asked && length <= block.size())) {
+            message.payload.assign((const char *)value, length);
+            return;
+        }
+
+        size_t offset = block.num * block.size();
+        if (offset > length || (offset == length && length)) {
+            message.code = BAD_OPTION;
+            return;
+        }
+        size_t size = length - offset < block.size() ? length - offset : block.size();
+        block.more = offset + size < length;
+        message.add_uint_option(BLOCK2, block.value());
+        if (block.num == 0) {
+            message.add_uint_option(SIZE2, length);
+        }
+        message.payload.assign((const char *)value + offset, size);
+        stats.blocks++;
+    }
+
+    void remove_observation(const std::string &token) {
+        for (size_t i = 0; i < _observations.size(); i++) {
+            if (_observations[i].token == token) {
+                _observations.erase(_observations.begin() + i);
+                return;
+            }
+        }
+    }
+
+    M2MInterfaceObserver            &_observer;
+    std::string                     _endpoint;
+    std::string                     _type;
+    std::string                     _domain;
+    uint32_t                        _lifetime;
+    M2MSecurity                     *_security;
+    M2MServer                       _server;
+    M2MObjectList                   _objects;
+    bool                            _registered;
+    int                             _fd;
+    std::string                     _location;      // Location-Path of the registration, e.g. "rd/4"
+    uint64_t                        _register_start;
+    Xorshift32                      _random;
+    uint16_t                        _next_id;
+    uint32_t                        _next_token;
+    std::map<uint16_t, Exchange>    _exchanges;     // by message id
+    std::vector<Observation>        _observations;
+};
+
+void report(FILE *out) {
+    fprintf(out, "m2m: %llu registrations (%llu accepted), %llu updates, %llu notifications",
+            (unsigned long long)stats.registrations,
+            (unsigned long long)stats.registered,
+            (unsigned long long)stats.updates,
+            (unsigned long long)stats.notifications);
+    if (options().server) {
+        fprintf(out, " (%llu acknowledged), %llu requests served (%llu blocks), %llu retransmissions, "
+                "%llu timeouts, %llu datagrams (%llu bytes) sent",
+                (unsigned long long)stats.acknowledged,
+                (unsigned long long)stats.requests,
+                (unsigned long long)stats.blocks,
+                (unsigned long long)stats.retransmissions,
+                (unsigned long long)stats.timeouts,
+                (unsigned long long)stats.datagrams,
+                (unsigned long long)stats.bytes);
+    }
+    fputc('\n', out);
+    if (options().verbose && clients.size() == 1) {
+        fprintf(out, "resources at exit:\n");
+        clients[0]->dump(out);
+    }
+}
+
+void outage_begins() {
+    for (size_t i = 0; i < clients.size(); i++) {
+        clients[i]->lose_server();
+    }
+}
+
+M2MDevice *device_instance = NULL;
+
+} // namespace
+
+const ClientStats &client_stats() {
+    return stats;
+}
+
+void clear_client_latencies() {
+    std::vector<uint32_t>().swap(stats.registration_latency);
+    std::vector<uint32_t>().swap(stats.notification_latency);
+}
+
+void on_notification(const std::function<void(const M2MResourceInstance &)> &listener) {
+    notification_listeners.push_back(listener);
+}
+
+} // namespace host
+
+bool M2MResourceInstance::set_value(const uint8_t *value, const uint32_t length) {
+    if (_value.size() == length && (length == 0 || memcmp(&_value[0], value, length) == 0)) {
+        return true;
+    }
+    _value.assign(value, value + length);
+    std::map<const M2MResourceInstance *, std::vector<host::Client *> >::iterator it =
+        host::registered_resources.find(this);
+    if (it != host::registered_resources.end()) {
+        for (size_t i = 0; i < it->second.size(); i++) {
+            it->second[i]->notify(*this);
+        }
+    }
+    return true;
+}
+
+M2MInterface *M2MInterfaceFactory::create_interface(M2MInterfaceObserver &observer,
+                                                    const String &endpoint_name,
+                                                    const String &endpoint_type,
+                                                    const int32_t life_time,
+                                                    const uint16_t /*listen_port*/,
+                                                    const String &domain,
+                                                    M2MInterface::BindingMode /*mode*/,
+                                                    M2MInterface::NetworkStack /*stack*/,
+                                                    const String & /*context_address*/) {
+    static bool reporting = false;
+    if (!reporting) {
+        reporting = true;
+        host::add_report(host::report);
+        const host::Options &options = host::options();
+        if (options.outage_ms && !options.server) {
+            uint64_t now_ms = host::now_us() / 1000;
+            uint64_t delay = options.outage_start_ms > now_ms ? options.outage_start_ms - now_ms : 0;
+            minar::Scheduler::postCallback(mbed::util::FunctionPointer(host::outage_begins).bind())
+                .delay(minar::milliseconds(delay));
+        }
+    }
+    return new host::Client(observer, endpoint_name, endpoint_type, domain, life_time < 0 ? 0 : life_time);
+}
+
+M2MDevice *M2MDevice::get_instance() {
+    if (!host::device_instance) {
+        host::device_instance = new M2MDevice();
+    }
+    return host::device_instance;
+}
+
+void M2MDevice::delete_instance() {
+    delete host::device_instance;
+    host::device_instance = NULL;
+}
+
+const char *host_endpoint_name() {
+    const char *name = getenv("KNOCK_HOST_ENDPOINT");
+    return name && *name ? name : "knock-host";
+}
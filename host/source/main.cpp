@@ -0,0 +1,142 @@
+/*
+ * Copyright (c) 2016 ARM Limited. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <getopt.h>
+#include <stdlib.h>
+#include "host.h"
+
+// the firmware entry point, from its main.cpp
+void app_start(int argc, char *argv[]);
+
+namespace {
+
+void usage(const char *name) {
+    fprintf(stderr,
+            "usage: %s [options]\n"
+            "  -t, --trace FILE      replay accelerometer samples from FILE\n"
+            "  -s, --server H:P      register with the LWM2M server at host:port (CoAP)\n"
+            "  -d, --duration MS     stop after MS of virtual time\n"
+            "      --tail MS         keep running MS after the trace (default 5000)\n"
+            "      --rtt MS          round trip of the simulated server (default 50)\n"
+            "      --outage AT:MS    the simulated server is out of reach for MS from AT ms on\n"
+            "      --flash FILE      keep the internal flash in FILE\n"
+            "  -r, --realtime        pace virtual time with the wall clock\n"
+            "  -v, --verbose         log every notification\n",
+            name);
+}
+
+bool parse_options(int argc, char *argv[], host::Options &options) {
+    static const struct option long_options[] = {
+        { "trace", required_argument, 0, 't' },
+        { "server", required_argument, 0, 's' },
+        { "duration", required_argument, 0, 'd' },
+        { "tail", required_argument, 0, 'T' },
+        { "rtt", required_argument, 0, 'R' },
+        { "outage", required_argument, 0, 'O' },
+        { "flash", required_argument, 0, 'F' },
+        { "realtime", no_argument, 0, 'r' },
+        { "verbose", no_argument, 0, 'v' },
+        { "help", no_argument, 0, 'h' },
+        { 0, 0, 0, 0 }
+    };
+
+    options.trace = NULL;
+    options.server = NULL;
+    options.realtime = false;
+    options.verbose = false;
+    options.duration_ms = 0;
+    options.tail_ms = 5000;
+    options.rtt_ms = 50;
+    options.flash = NULL;
+    options.outage_start_ms = 0;
+    options.outage_ms = 0;
+
+    int c;
+    while ((c = getopt_long(argc, argv, "t:s:d:rvh", long_options, NULL)) != -1) {
+        switch (c) {
+            case 't':
+                options.trace = optarg;
+                break;
+            case 's':
+                options.server = optarg;
+                break;
+            case 'd':
+                options.duration_ms = strtoul(optarg, NULL, 10);
+                break;
+            case 'T':
+                options.tail_ms = strtoul(optarg, NULL, 10);
+                break;
+            case 'R':
+                options.rtt_ms = strtoul(optarg, NULL, 10);
+                break;
+            case 'O': {
+                char *end;
+                options.outage_start_ms = strtoul(optarg, &end, 10);
+                if (*end != ':') {
+                    usage(argv[0]);
+                    return false;
+                }
+                options.outage_ms = strtoul(end + 1, NULL, 10);
+                break;
+            }
+            case 'F':
+                options.flash = optarg;
+                break;
+            case 'r':
+                options.realtime = true;
+                break;
+            case 'v':
+                options.verbose = true;
+                break;
+            default:
+                usage(argv[0]);
+                return false;
+        }
+    }
+    if (!options.trace && !options.duration_ms) {
+        // a board at rest never ends by itself
+        options.duration_ms = 10000;
+    }
+    if (options.server) {
+        // a real server answers in real time
+        options.realtime = true;
+    }
+    return true;
+}
+
+} // namespace
+
+#ifdef KNOCK_HOST_SANITIZE
+// the firmware allocates its objects once and never frees them, like on the board
+extern "C" const char *__asan_default_options() {
+    return "detect_leaks=0";
+}
+#endif
+
+int main(int argc, char *argv[]) {
+    host::Options options;
+    if (!parse_options(argc, argv, options)) {
+        return 2;
+    }
+    host::init(options);
+
+    if (!host::start_accelerometer(options.trace)) {
+        return 1;
+    }
+
+    app_start(argc, argv);
+    return host::run();
+}
@@ -0,0 +1,66 @@
+/*
+ * Copyright (c) 2016 ARM Limited. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+#include "host.h"
+#include "atmel-rf-driver/driverRFPhy.h"
+#include "mbed-mesh-api/AbstractMesh.h"
+#include "minar/minar.h"
+#include "ns_trace.h"
+#include "security.h"
+
+// the host mesh comes up after this long
+const uint32_t MESH_CONNECT_MS = 100;
+
+int8_t AbstractMesh::connect() {
+    minar::Scheduler::postCallback(_handler.bind(MESH_CONNECTED))
+        .delay(minar::milliseconds(MESH_CONNECT_MS));
+    return MESH_ERROR_NONE;
+}
+
+int8_t AbstractMesh::disconnect() {
+    minar::Scheduler::postCallback(_handler.bind(MESH_DISCONNECTED));
+    return MESH_ERROR_NONE;
+}
+
+int8_t rf_device_register(void) {
+    return 1;
+}
+
+void rf_read_mac_address(uint8_t *ptr) {
+    // FNV-1a of the endpoint name, so every host node gets its own MAC
+    uint64_t hash = 14695981039346656037ull;
+    for (const char *p = host_endpoint_name(); *p; p++) {
+        hash = (hash ^ (uint8_t)*p) * 1099511628211ull;
+    }
+    for (int i = 0; i < 8; i++) {
+        ptr[i] = hash >> (56 - 8 * i);
+    }
+}
+
+rf_trx_part_e rf_radio_type_read(void) {
+    return ATMEL_AT86RF233;
+}
+
+char *trace_array(const uint8_t *buf, uint16_t len) {
+    static char buffer[3 * 32 + 1];
+    size_t pos = 0;
+    buffer[0] = '\0';
+    for (uint16_t i = 0; i < len && pos + 3 < sizeof(buffer); i++) {
+        pos += snprintf(buffer + pos, sizeof(buffer) - pos, i ? ":%02x" : "%02x", buf[i]);
+    }
+    return buffer;
+}
@@ -0,0 +1,279 @@
+/*
+ * Copyright (c) 2016 ARM Limited. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <getopt.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <thread>
+#include <vector>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+#include "trace_file.h"
+#include "knock-core/knock_detector.h"
+#include "knock-core/knock_features.h"
+
+/*
+ * Replays an accelerometer trace straight into KnockDetector, as fast as
+ * possible or in real time, and reports the knocks and the throughput. The
+ * same trace through the whole firmware is `knock-host-<app> --trace`.
+ *
+ * With the knock onsets of the trace in a labels file it also scores the
+ * detector: a knock within the tolerance of a label finds it, any other
+ * knock is false. Exits with 1 when the precision or the recall is too low.
+ * Labels of a synthetic trace say so in a "# synthetic" comment, and so
+ * does the score, which then only shows how the detector does on the
+ * models it was tuned on.
+ */
+namespace {
+
+typedef std::chrono::steady_clock WallClock;
+
+/*
+ * Reads a labels file, one knock onset per line in s from the start of the
+ * trace, '#' starts a comment. `synthetic` is set by a "# synthetic" line.
+ */
+bool load_labels(const char *path, std::vector<double> &labels, bool &synthetic) {
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        perror(path);
+        return false;
+    }
+    char line[256];
+    synthetic = false;
+    while (fgets(line, sizeof(line), file)) {
+        if (strncmp(line, "# synthetic", 11) == 0) {
+            synthetic = true;
+        }
+        char *end;
+        double at = strtod(line, &end);
+        if (end != line) {
+            labels.push_back(at);
+        }
+    }
+    fclose(file);
+    return true;
+}
+
+// TSC ticks, which run at the nominal clock of x86 CPUs; 0 elsewhere
+uint64_t cycles() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+void usage(const char *name) {
+    fprintf(stderr,
+            "usage: %s [options] TRACE\n"
+            "  -r, --realtime        play samples at their timestamps\n"
+            "  -n, --repeat N        replay N times, for timing (default 1)\n"
+            "  -q, --quiet           only print the summary\n"
+            "  -w, --write FILE      also save the trace in the binary format\n"
+            "      --dump            print the samples as a text trace and exit\n"
+            "  -l, --labels FILE     score the knocks against the onsets in FILE\n"
+            "      --tolerance MS    how far a knock may be from its label (default 50)\n"
+            "      --min-precision P percent of the knocks that must be labelled (default 95)\n"
+            "      --min-recall R    percent of the labels that must be found (default 95)\n",
+            name);
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    static const struct option long_options[] = {
+        { "realtime", no_argument, 0, 'r' },
+        { "repeat", required_argument, 0, 'n' },
+        { "quiet", no_argument, 0, 'q' },
+        { "write", required_argument, 0, 'w' },
+        { "dump", no_argument, 0, 'D' },
+        { "labels", required_argument, 0, 'l' },
+        { "tolerance", required_argument, 0, 'T' },
+        { "min-precision", required_argument, 0, 'P' },
+        { "min-recall", required_argument, 0, 'R' },
+        { "help", no_argument, 0, 'h' },
+        { 0, 0, 0, 0 }
+    };
+
+    bool realtime = false;
+    bool quiet = false;
+    bool dump = false;
+    unsigned repeat = 1;
+    const char *write = NULL;
+    const char *labels_path = NULL;
+    double tolerance_ms = 50;
+    double min_precision = 95;
+    double min_recall = 95;
+
+    int c;
+    while ((c = getopt_long(argc, argv, "rn:qw:l:h", long_options, NULL)) != -1) {
+        switch (c) {
+            case 'r':
+                realtime = true;
+                break;
+            case 'n':
+                repeat = strtoul(optarg, NULL, 0);
+                break;
+            case 'q':
+                quiet = true;
+                break;
+            case 'w':
+                write = optarg;
+                break;
+            case 'D':
+                dump = true;
+                break;
+            case 'l':
+                labels_path = optarg;
+                break;
+            case 'T':
+                tolerance_ms = strtod(optarg, NULL);
+                break;
+            case 'P':
+                min_precision = strtod(optarg, NULL);
+                break;
+            case 'R':
+                min_recall = strtod(optarg, NULL);
+                break;
+            default:
+                usage(argv[0]);
+                return 2;
+        }
+    }
+    if (optind != argc - 1 || repeat == 0) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    host::Trace trace;
+    if (!host::load_trace(argv[optind], trace)) {
+        return 1;
+    }
+    if (write && !host::save_trace(write, trace)) {
+        return 1;
+    }
+    std::vector<double> labels;
+    bool synthetic = false;
+    if (labels_path && !load_labels(labels_path, labels, synthetic)) {
+        return 1;
+    }
+    if (dump) {
+        printf("# %zu samples, %u us apart\n", trace.samples.size(), (unsigned)trace.period);
+        for (size_t i = 0; i < trace.samples.size(); i++) {
+            const AccelSample &s = trace.samples[i];
+            printf("%d %d %d\n", s.x, s.y, s.z);
+        }
+        return 0;
+    }
+
+    uint64_t knocks = 0;
+    double wall = 0;
+    uint64_t tsc = 0;
+    std::vector<double> found;      // onsets of the first run, in s
+    KnockFeatureExtractor<> extractor;
+    for (unsigned run = 0; run < repeat; run++) {
+        KnockDetector detector;
+        KnockOnset knock;
+        WallClock::time_point start = WallClock::now();
+        uint64_t start_tsc = cycles();
+        for (size_t i = 0; i < trace.samples.size(); i++) {
+            if (realtime) {
+                uint32_t offset = trace.timestamps[i] - trace.timestamps[0];
+                std::this_thread::sleep_until(start + std::chrono::microseconds(offset));
+            }
+            if (!detector.process(trace.samples[i], knock)) {
+                continue;
+            }
+            knocks++;
+            if (run == 0) {
+                found.push_back((trace.timestamps[knock.sample] - trace.timestamps[0]) / 1e6);
+            }
+            if (!quiet && run == 0) {
+                printf("knock at %.3f s: peak %ld, axis %u, %u ms after the previous one\n",
+                       (trace.timestamps[knock.sample] - trace.timestamps[0]) / 1e6,
+                       (long)knock.peak, knock.axis,
+                       (unsigned)((uint64_t)knock.interval * trace.period / 1000));
+                // the same window as the firmware, 4 samples before the onset
+                if (trace.samples.size() >= KnockFeatureExtractor<>::WINDOW) {
+                    size_t first = knock.sample < 4 ? 0 : knock.sample - 4;
+                    if (first + KnockFeatureExtractor<>::WINDOW > trace.samples.size()) {
+                        first = trace.samples.size() - KnockFeatureExtractor<>::WINDOW;
+                    }
+                    KnockFeatures features;
+                    extractor.extract(trace.samples, first, features);
+                    printf("  magnitude %u, direction %c%c, centroid %u Hz\n", (unsigned)features.magnitude,
+                           features.sign < 0 ? '-' : '+', 'x' + features.axis,
+                           (unsigned)KnockFeatureExtractor<>::centroid_hz(features, 1000000 / trace.period));
+                }
+            }
+        }
+        tsc += cycles() - start_tsc;
+        wall += std::chrono::duration<double>(WallClock::now() - start).count();
+    }
+
+    uint64_t samples = (uint64_t)trace.samples.size() * repeat;
+    fflush(stdout);
+    fprintf(stderr, "%s: %s trace, %zu samples, %u interrupt markers, %u bad frames\n",
+            argv[optind], trace.binary ? "binary" : "text", trace.samples.size(),
+            trace.interrupts, trace.bad_frames);
+    fprintf(stderr, "%llu knocks in %u run(s), %.3f s, %.1f ns per sample",
+            (unsigned long long)knocks, repeat, wall, samples ? wall * 1e9 / samples : 0.0);
+    if (tsc && samples) {
+        fprintf(stderr, ", %.1f TSC cycles per sample", (double)tsc / samples);
+    }
+    fprintf(stderr, "\n");
+    if (!labels_path) {
+        return 0;
+    }
+
+    // each label takes the nearest knock within the tolerance that no other
+    // label took; both lists are in time order
+    std::vector<bool> taken(found.size(), false);
+    size_t hits = 0;
+    for (size_t l = 0; l < labels.size(); l++) {
+        size_t best = found.size();
+        for (size_t k = 0; k < found.size(); k++) {
+            double distance = fabs(found[k] - labels[l]) * 1000;
+            if (!taken[k] && distance <= tolerance_ms &&
+                (best == found.size() || distance < fabs(found[best] - labels[l]) * 1000)) {
+                best = k;
+            }
+        }
+        if (best < found.size()) {
+            taken[best] = true;
+            hits++;
+        } else if (!quiet) {
+            printf("missed knock at %.3f s\n", labels[l]);
+        }
+    }
+    for (size_t k = 0; k < found.size(); k++) {
+        if (!taken[k] && !quiet) {
+            printf("false knock at %.3f s\n", found[k]);
+        }
+    }
+    double precision = found.empty() ? 100 : 100.0 * hits / found.size();
+    double recall = labels.empty() ? 100 : 100.0 * hits / labels.size();
+    bool passed = precision >= min_precision && recall >= min_recall;
+    fflush(stdout);
+    fprintf(stderr, "%s: %zu labelled knocks, %zu found, %zu missed, %zu false, precision %.1f%%, recall %.1f%%%s%s\n",
+            labels_path, labels.size(), hits, labels.size() - hits, found.size() - hits, precision, recall,
+            synthetic ? ", synthetic trace" : "", passed ? "" : ", FAILED");
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,485 @@
+/*
+ * Copyright (c) 2016 ARM Limited. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdarg.h>
+#include <sys/epoll.h>
+#include <unistd.h>
+#include <time.h>
+#include <chrono>
+#include <map>
+#include <set>
+#include <thread>
+#include <vector>
+#include "host.h"
+#include "minar/minar.h"
+#include "mbed-hal/lp_ticker_api.h"
+#include "mbed-hal/rtc_api.h"
+#include "mbed-hal/sleep_api.h"
+#include "mbed-hal/us_ticker_api.h"
+#include "mbed-drivers/test_env.h"
+
+namespace host {
+
+namespace {
+
+typedef std::chrono::steady_clock WallClock;
+
+struct Callback {
+    uint64_t            due;
+    uint64_t            period;     // 0 for one-shot
+    mbed::util::Event   event;
+};
+
+// (due, id): ids grow, so equal due times run in posting order
+typedef std::pair<uint64_t, uint64_t> QueueEntry;
+
+struct Loop {
+    Options options;
+    uint64_t now;
+    uint64_t end;               // 0 = no end set yet
+    bool stopped;
+    time_t rtc_start;
+    uint64_t next_id;
+    std::map<uint64_t, Callback> callbacks;
+    std::set<QueueEntry> queue;     // cancel() takes entries out, like minar frees them
+    std::vector<Device *> devices;
+    std::vector<std::function<void(FILE *)> > reports;
+    int epoll_fd;               // -1 until the first watch()
+    std::map<int, std::function<void()> > watches;
+    WallClock::time_point wall_start;
+
+    // sleep() and deepsleep() by the firmware
+    uint64_t sleep_us;
+    uint64_t deep_sleep_us;
+    bool deep_sleeping;         // the us_ticker stands still meanwhile
+    uint64_t sleep_start;
+    uint64_t sleeps;
+    uint64_t sleep_wall_us;     // host time spent in there, not callback work
+
+    // statistics
+    uint64_t ran;
+    uint64_t lateness_total;
+    uint64_t lateness_max;
+    uint64_t busy;
+};
+
+Loop &loop() {
+    // never destroyed, firmware globals still cancel callbacks at exit
+    static Loop *instance = NULL;
+    if (!instance) {
+        instance = new Loop();
+        instance->epoll_fd = -1;
+    }
+    return *instance;
+}
+
+uint64_t next_due() {
+    Loop &l = loop();
+    return l.queue.empty() ? Device::NEVER : l.queue.begin()->first;
+}
+
+void run_due() {
+    Loop &l = loop();
+    while (!l.stopped && next_due() <= l.now) {
+        QueueEntry entry = *l.queue.begin();
+        l.queue.erase(l.queue.begin());
+
+        Callback &callback = l.callbacks[entry.second];
+        uint64_t lateness = l.now - callback.due;
+        l.lateness_total += lateness;
+        if (lateness > l.lateness_max) {
+            l.lateness_max = lateness;
+        }
+        l.ran++;
+
+        // the callback may post or cancel others, which can move this entry
+        mbed::util::Event event = callback.event;
+        if (!callback.period) {
+            l.callbacks.erase(entry.second);
+        }
+
+        WallClock::time_point start = WallClock::now();
+        uint64_t slept = l.sleep_wall_us;
+        event.call();
+        uint64_t spent = std::chrono::duration_cast<std::chrono::microseconds>(WallClock::now() - start).count();
+        // a sleep inside the callback moved the clock itself
+        slept = l.sleep_wall_us - slept;
+        spent = spent > slept ? spent - slept : 0;
+        l.now += spent;
+        l.busy += spent;
+
+        std::map<uint64_t, Callback>::iterator it = l.callbacks.find(entry.second);
+        if (it != l.callbacks.end() && it->second.period) {
+            it->second.due += it->second.period;
+            l.queue.insert(QueueEntry(it->second.due, entry.second));
+        }
+    }
+}
+
+void print_summary(double wall) {
+    Loop &l = loop();
+    // after the firmware output, not in the middle of it
+    fflush(stdout);
+    fprintf(stderr, "host: %.3f s virtual in %.3f s, %llu callbacks, %.1f%% busy, lateness avg %llu us max %llu us\n",
+            l.now / 1e6, wall,
+            (unsigned long long)l.ran,
+            l.now ? 100.0 * l.busy / l.now : 0.0,
+            (unsigned long long)(l.ran ? l.lateness_total / l.ran : 0),
+            (unsigned long long)l.lateness_max);
+    for (size_t i = 0; i < l.reports.size(); i++) {
+        l.reports[i](stderr);
+    }
+}
+
+void power_report(FILE *out) {
+    Loop &l = loop();
+    uint64_t awake = l.now - l.sleep_us - l.deep_sleep_us;
+    fprintf(out, "power: %.3f s awake, %.3f s asleep, %.3f s in deep sleep, %llu wake-ups, duty cycle %.3f%%\n",
+            awake / 1e6, l.sleep_us / 1e6, l.deep_sleep_us / 1e6, (unsigned long long)l.sleeps,
+            l.now ? 100.0 * (l.now - l.deep_sleep_us) / l.now : 100.0);
+}
+
+} // namespace
+
+const Options &options() {
+    return loop().options;
+}
+
+uint64_t now_us() {
+    return loop().now;
+}
+
+void add_device(Device *device) {
+    loop().devices.push_back(device);
+}
+
+void finish_soon() {
+    Loop &l = loop();
+    uint64_t end = l.now + (uint64_t)l.options.tail_ms * 1000;
+    if (!l.end || end < l.end) {
+        l.end = end;
+    }
+}
+
+void add_report(const std::function<void(FILE *)> &report) {
+    loop().reports.push_back(report);
+}
+
+uint64_t post(const mbed::util::Event &event, uint32_t delay_ms, uint32_t period_ms) {
+    Loop &l = loop();
+    uint64_t id = ++l.next_id;
+    Callback callback;
+    callback.due = l.now + (uint64_t)delay_ms * 1000;
+    callback.period = (uint64_t)period_ms * 1000;
+    callback.event = event;
+    l.callbacks[id] = callback;
+    l.queue.insert(QueueEntry(callback.due, id));
+    return id;
+}
+
+bool cancel(uint64_t id) {
+    Loop &l = loop();
+    std::map<uint64_t, Callback>::iterator it = l.callbacks.find(id);
+    if (it == l.callbacks.end()) {
+        return false;
+    }
+    l.queue.erase(QueueEntry(it->second.due, id));
+    l.callbacks.erase(it);
+    return true;
+}
+
+void stop() {
+    loop().stopped = true;
+}
+
+namespace {
+
+uint64_t next_event() {
+    Loop &l = loop();
+    uint64_t next = next_due();
+    for (size_t i = 0; i < l.devices.size(); i++) {
+        uint64_t event = l.devices[i]->next_event();
+        if (event < next) {
+            next = event;
+        }
+    }
+    return next;
+}
+
+uint64_t wall_us(WallClock::time_point start) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(WallClock::now() - start).count();
+}
+
+/*
+ * Waits for the watched sockets until `until` (virtual us, NEVER for no
+ * limit), then catches the clock up and runs the handlers of the readable
+ * ones. A timeout of 0 only polls.
+ */
+void poll_watches(WallClock::time_point wall_start, uint64_t until, bool wait) {
+    Loop &l = loop();
+    int timeout = 0;
+    if (wait) {
+        uint64_t wall = wall_us(wall_start);
+        timeout = until == Device::NEVER ? -1 : until > wall ? (until - wall + 999) / 1000 : 0;
+    }
+
+    struct epoll_event events[64];
+    int count = l.epoll_fd < 0 ? 0 : epoll_wait(l.epoll_fd, events, 64, timeout);
+    if (l.epoll_fd < 0 && timeout) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(timeout < 0 ? 0 : timeout));
+    }
+    if (l.options.realtime) {
+        uint64_t wall = wall_us(wall_start);
+        if (wall > l.now) {
+            l.now = wall;
+        }
+    }
+    for (int i = 0; i < count; i++) {
+        std::map<int, std::function<void()> >::iterator it = l.watches.find(events[i].data.fd);
+        if (it != l.watches.end()) {
+            // the handler may unwatch itself
+            std::function<void()> readable = it->second;
+            readable();
+        }
+    }
+}
+
+} // namespace
+
+void watch(int fd, const std::function<void()> &readable) {
+    Loop &l = loop();
+    if (l.epoll_fd < 0) {
+        l.epoll_fd = epoll_create1(0);
+    }
+    struct epoll_event event;
+    event.events = EPOLLIN;
+    event.data.fd = fd;
+    epoll_ctl(l.epoll_fd, EPOLL_CTL_ADD, fd, &event);
+    l.watches[fd] = readable;
+}
+
+void unwatch(int fd) {
+    Loop &l = loop();
+    if (l.watches.erase(fd) && l.epoll_fd >= 0) {
+        epoll_ctl(l.epoll_fd, EPOLL_CTL_DEL, fd, NULL);
+    }
+}
+
+void init(const Options &options) {
+    Loop &l = loop();
+    l.options = options;
+    l.rtc_start = time(NULL);
+}
+
+namespace {
+
+/*
+ * Jumps the clock to the next interrupt or due callback, for sleep() and
+ * deepsleep(). Sensor samples in between are taken without waking up.
+ */
+void sleep_until_event(bool deep) {
+    Loop &l = loop();
+    if (!l.sleeps) {
+        add_report(power_report);
+    }
+    l.sleeps++;
+
+    uint64_t start = l.now;
+    l.deep_sleeping = deep;
+    l.sleep_start = start;
+    WallClock::time_point wall = WallClock::now();
+    uint64_t edges = interrupt_count();
+    while (!l.stopped) {
+        uint64_t next = next_event();
+        if (l.end && next > l.end) {
+            // the callback that slept would only sleep again
+            l.now = l.end;
+            l.stopped = true;
+            break;
+        }
+        if (next == Device::NEVER && l.watches.empty()) {
+            // nothing left that could wake it up
+            l.stopped = true;
+            break;
+        }
+        if (l.options.realtime) {
+            poll_watches(l.wall_start, next, true);
+        } else if (next > l.now) {
+            l.now = next;
+        }
+        for (size_t i = 0; i < l.devices.size(); i++) {
+            l.devices[i]->advance(l.now);
+        }
+        if (interrupt_count() != edges || next_due() <= l.now) {
+            break;
+        }
+    }
+    (deep ? l.deep_sleep_us : l.sleep_us) += l.now - start;
+    l.deep_sleeping = false;
+    l.sleep_wall_us += wall_us(wall);
+}
+
+} // namespace
+
+int run() {
+    Loop &l = loop();
+    if (l.options.duration_ms) {
+        l.end = (uint64_t)l.options.duration_ms * 1000;
+    }
+
+    l.wall_start = WallClock::now();
+    WallClock::time_point wall_start = l.wall_start;
+    while (!l.stopped) {
+        uint64_t next = next_event();
+        bool watching = !l.watches.empty();
+        if (l.end && next > l.end) {
+            if (!l.options.realtime || !watching) {
+                l.now = l.end;
+                break;
+            }
+            // sockets may still have something to say until the end
+            next = l.end;
+        }
+        if (next == Device::NEVER && !watching) {
+            break;
+        }
+
+        if (l.options.realtime) {
+            poll_watches(wall_start, next, true);
+            if (l.end && l.now >= l.end) {
+                break;
+            }
+        } else {
+            if (watching) {
+                poll_watches(wall_start, next, false);
+            }
+            if (next > l.now) {
+                l.now = next;
+            }
+        }
+
+        for (size_t i = 0; i < l.devices.size(); i++) {
+            l.devices[i]->advance(l.now);
+        }
+        run_due();
+    }
+
+    double wall = std::chrono::duration<double>(WallClock::now() - wall_start).count();
+    print_summary(wall);
+    return 0;
+}
+
+} // namespace host
+
+namespace minar {
+
+CallbackAdder::CallbackAdder(const mbed::util::Event &event)
+    : _event(event), _delay(0), _period(0), _pending(true), _handle(NULL) {
+}
+
+CallbackAdder::CallbackAdder(const CallbackAdder &other)
+    : _event(other._event), _delay(other._delay), _period(other._period),
+      _pending(other._pending), _handle(other._handle) {
+    // only one of the copies queues the callback
+    other._pending = false;
+}
+
+CallbackAdder::~CallbackAdder() {
+    commit();
+}
+
+CallbackAdder &CallbackAdder::delay(tick_t delay) {
+    _delay = delay;
+    return *this;
+}
+
+CallbackAdder &CallbackAdder::period(tick_t period) {
+    _period = period;
+    if (!_delay) {
+        // minar runs the first one a period from now
+        _delay = period;
+    }
+    return *this;
+}
+
+CallbackAdder &CallbackAdder::tolerance(tick_t /*tolerance*/) {
+    return *this;
+}
+
+callback_handle_t CallbackAdder::getHandle() {
+    return commit();
+}
+
+callback_handle_t CallbackAdder::commit() {
+    if (_pending) {
+        _pending = false;
+        _handle = (callback_handle_t)(uintptr_t)host::post(_event, _delay, _period);
+    }
+    return _handle;
+}
+
+int Scheduler::cancelCallback(callback_handle_t handle) {
+    return host::cancel((uint64_t)(uintptr_t)handle) ? 0 : -1;
+}
+
+int Scheduler::start() {
+    return host::run();
+}
+
+void Scheduler::stop() {
+    host::stop();
+}
+
+} // namespace minar
+
+uint32_t us_ticker_read(void) {
+    host::Loop &l = host::loop();
+    return (uint32_t)((l.deep_sleeping ? l.sleep_start : l.now) - l.deep_sleep_us);
+}
+
+uint32_t lp_ticker_read(void) {
+    return (uint32_t)host::now_us();
+}
+
+void sleep(void) {
+    host::sleep_until_event(false);
+}
+
+void deepsleep(void) {
+    host::sleep_until_event(true);
+}
+
+void wait_us(int us) {
+    host::Loop &l = host::loop();
+    l.now += us;
+    l.busy += us;
+}
+
+void wait_ms(int ms) {
+    wait_us(ms * 1000);
+}
+
+void wait(float s) {
+    wait_us((int)(s * 1000000));
+}
+
+time_t rtc_read(void) {
+    return host::loop().rtc_start + host::now_us() / 1000000;
+}
+
+void notify_completion(bool success) {
+    printf("{{%s}}\r\n", success ? "success" : "failure");
+}
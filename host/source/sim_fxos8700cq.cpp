@@ -0,0 +1,360 @@
+/*
+ * Copyright (c) 2016 ARM Limited. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdlib.h>
+#include <vector>
+#include "accel_current.h"
+#include "host.h"
+#include "trace_file.h"
+#include "fxos8700cq/fxos8700cq.h"
+#include "knock-core/accel_sample.h"
+
+namespace host {
+
+namespace {
+
+/*
+ * Register level model of the FXOS8700CQ accelerometer, enough for the
+ * FXOS8700CQ driver and FXOS8700CQFifo: output data rate, the 32 sample
+ * FIFO with its watermark, the latched motion detector and the INT1 line.
+ * Samples come from a trace, or a board lying flat once it runs out. The
+ * trace plays in its own time, so at a lower data rate the sensor skips the
+ * samples in between. The supply current follows accel_current.h.
+ */
+class SimFXOS8700CQ : public Device, public I2CDevice {
+public:
+    SimFXOS8700CQ()
+        : _pointer(0), _fifo_head(0), _fifo_count(0), _overflow(false), _motion(false),
+          _line(false), _next_sample(NEVER), _position(0), _trace_period(0), _trace_start(NEVER),
+          _trace_done(false), _samples(0), _interrupts(0), _overflows(0), _rate_changes(0), _charge(0),
+          _charged_until(0) {
+        for (int i = 0; i < 128; i++) {
+            _regs[i] = 0;
+        }
+        _rest.x = 0;
+        _rest.y = 0;
+        _rest.z = COUNTS_PER_G;
+        _out = _rest;
+    }
+
+    // see trace_file.h for the formats
+    bool load(const char *path) {
+        Trace trace;
+        if (!load_trace(path, trace)) {
+            return false;
+        }
+        _trace.swap(trace.samples);
+        _trace_period = trace.period;
+        if (trace.bad_frames) {
+            fprintf(stderr, "host: %s: %u frame(s) with a bad CRC skipped\n", path, trace.bad_frames);
+        }
+        return true;
+    }
+
+    bool has_trace() const {
+        return !_trace.empty();
+    }
+
+    uint64_t next_event() const {
+        return _next_sample;
+    }
+
+    void advance(uint64_t now) {
+        while (_next_sample <= now) {
+            sample(_next_sample);
+            _next_sample += period();
+        }
+        update_line();
+    }
+
+    bool i2c_write(const uint8_t *data, int length, bool /*repeated*/) {
+        if (length < 1) {
+            return false;
+        }
+        _pointer = data[0] & 0x7F;
+        for (int i = 1; i < length; i++) {
+            write_reg(_pointer, data[i]);
+            _pointer = (_pointer + 1) & 0x7F;
+        }
+        update_line();
+        return true;
+    }
+
+    bool i2c_read(uint8_t *data, int length) {
+        for (int i = 0; i < length; i++) {
+            data[i] = read_next();
+        }
+        update_line();
+        return true;
+    }
+
+    void report(FILE *out) const {
+        fprintf(out, "accel: %llu samples (%zu from the trace), %llu interrupts, %llu FIFO overflows\n",
+                (unsigned long long)_samples, _position,
+                (unsigned long long)_interrupts, (unsigned long long)_overflows);
+        uint64_t now = now_us();
+        if (now) {
+            double charge = _charge + current_ua() * (now - _charged_until);
+            fprintf(out, "accel: %.1f uA average, %llu rate changes\n",
+                    charge / now, (unsigned long long)_rate_changes);
+        }
+    }
+
+private:
+    enum {
+        REG_STATUS          = 0x00,
+        REG_OUT_X_MSB       = 0x01,
+        REG_OUT_Z_LSB       = 0x06,
+        REG_F_SETUP         = 0x09,
+        REG_INT_SOURCE      = 0x0C,
+        REG_WHO_AM_I        = 0x0D,
+        REG_FF_MT_CFG       = 0x15,
+        REG_FF_MT_SRC       = 0x16,
+        REG_FF_MT_THS       = 0x17,
+        REG_CTRL_REG1       = 0x2A,
+        REG_CTRL_REG2       = 0x2B,
+        REG_CTRL_REG4       = 0x2D,
+        REG_CTRL_REG5       = 0x2E,
+        REG_M_OUT_X_MSB     = 0x33,
+        REG_M_CTRL_REG1     = 0x5B,
+        REG_M_CTRL_REG2     = 0x5C
+    };
+
+    enum {
+        COUNTS_PER_G        = 4096,
+        FIFO_SIZE           = 32,
+        WHO_AM_I            = 0xC7,
+        SRC_FFMT            = 0x04,
+        SRC_FIFO            = 0x40
+    };
+
+    bool active() const {
+        return _regs[REG_CTRL_REG1] & 0x01;
+    }
+
+    uint8_t fifo_mode() const {
+        return _regs[REG_F_SETUP] >> 6;
+    }
+
+    uint8_t watermark() const {
+        return _regs[REG_F_SETUP] & 0x3F;
+    }
+
+    uint64_t period() const {
+        static const uint32_t period_us[] = { 1250, 2500, 5000, 10000, 20000, 80000, 160000, 640000 };
+        uint64_t period = period_us[(_regs[REG_CTRL_REG1] >> 3) & 7];
+        // hybrid mode alternates accelerometer and magnetometer
+        if ((_regs[REG_M_CTRL_REG1] & 0x03) == 0x03) {
+            period *= 2;
+        }
+        return period;
+    }
+
+    double current_ua() const {
+        return accel_current_ua(active(), (_regs[REG_CTRL_REG1] >> 3) & 7, _regs[REG_CTRL_REG2] & 3);
+    }
+
+    void write_reg(uint8_t reg, uint8_t value) {
+        bool was_active = active();
+        uint8_t old = _regs[reg];
+        if (reg == REG_CTRL_REG1 || reg == REG_CTRL_REG2) {
+            uint64_t now = now_us();
+            _charge += current_ua() * (now - _charged_until);
+            _charged_until = now;
+            if (reg == REG_CTRL_REG1 && ((old ^ value) & 0x38)) {
+                _rate_changes++;
+            }
+        }
+        _regs[reg] = value;
+
+        if (reg == REG_CTRL_REG1 || reg == REG_M_CTRL_REG1) {
+            if (active() && (!was_active || old != value)) {
+                _next_sample = now_us() + period();
+            } else if (!active()) {
+                _next_sample = NEVER;
+            }
+        } else if (reg == REG_F_SETUP && fifo_mode() == 0) {
+            _fifo_count = 0;
+            _overflow = false;
+        }
+    }
+
+    uint8_t read_next() {
+        uint8_t reg = _pointer;
+        uint8_t value;
+        uint8_t next = (reg + 1) & 0x7F;
+
+        if (reg == REG_STATUS) {
+            if (fifo_mode()) {
+                value = (_overflow ? 0x80 : 0) | (watermark_reached() ? 0x40 : 0) | _fifo_count;
+                _overflow = false;
+            } else {
+                value = 0x0F;   // new data on all axes
+            }
+        } else if (reg >= REG_OUT_X_MSB && reg <= REG_OUT_Z_LSB) {
+            if (reg == REG_OUT_X_MSB && fifo_mode() && _fifo_count) {
+                _out = _fifo[_fifo_head];
+                _fifo_head = (_fifo_head + 1) % FIFO_SIZE;
+                _fifo_count--;
+            }
+            int16_t axis[3] = { _out.x, _out.y, _out.z };
+            uint16_t raw = (uint16_t)axis[(reg - REG_OUT_X_MSB) / 2] << 2;
+            value = (reg - REG_OUT_X_MSB) % 2 ? raw & 0xFF : raw >> 8;
+            if (reg == REG_OUT_Z_LSB) {
+                // accelerometer only wraps back to X, hybrid auto increment
+                // moves on to the magnetometer
+                next = (_regs[REG_M_CTRL_REG2] & 0x20) ? REG_M_OUT_X_MSB : REG_OUT_X_MSB;
+            }
+        } else if (reg == REG_INT_SOURCE) {
+            value = sources();
+        } else if (reg == REG_WHO_AM_I) {
+            value = WHO_AM_I;
+        } else if (reg == REG_FF_MT_SRC) {
+            value = _motion ? 0x80 : 0;
+            _motion = false;
+        } else {
+            value = _regs[reg];
+        }
+
+        _pointer = next;
+        return value;
+    }
+
+    bool watermark_reached() const {
+        return fifo_mode() && watermark() && _fifo_count >= watermark();
+    }
+
+    uint8_t sources() const {
+        uint8_t ctrl4 = _regs[REG_CTRL_REG4];
+        uint8_t sources = 0;
+        if ((ctrl4 & SRC_FIFO) && watermark_reached()) {
+            sources |= SRC_FIFO;
+        }
+        if ((ctrl4 & SRC_FFMT) && _motion) {
+            sources |= SRC_FFMT;
+        }
+        return sources;
+    }
+
+    // the sample taken at `at`, the trace starts with the first one
+    void sample(uint64_t at) {
+        AccelSample s = _rest;
+        if (!_trace.empty() && !_trace_done) {
+            if (_trace_start == NEVER) {
+                _trace_start = at;
+            }
+            size_t position = (at - _trace_start) / _trace_period;
+            if (position < _trace.size()) {
+                s = _trace[position];
+                _rest = s;
+                _position = position + 1;
+            } else {
+                _trace_done = true;
+                finish_soon();
+            }
+        }
+        _samples++;
+
+        if (fifo_mode()) {
+            if (_fifo_count == FIFO_SIZE) {
+                _overflow = true;
+                _overflows++;
+                if (fifo_mode() == 1) {
+                    // circular, the oldest sample goes
+                    _fifo_head = (_fifo_head + 1) % FIFO_SIZE;
+                    _fifo_count--;
+                }
+            }
+            if (_fifo_count < FIFO_SIZE) {
+                _fifo[(_fifo_head + _fifo_count) % FIFO_SIZE] = s;
+                _fifo_count++;
+            }
+        } else {
+            _out = s;
+        }
+
+        detect_motion(s);
+    }
+
+    // latched motion detection, OR of the enabled axes above FF_MT_THS
+    void detect_motion(const AccelSample &s) {
+        uint8_t cfg = _regs[REG_FF_MT_CFG];
+        if (!(cfg & 0x40)) {
+            return;
+        }
+        int32_t threshold = (_regs[REG_FF_MT_THS] & 0x7F) * 63 * COUNTS_PER_G / 1000;
+        if (((cfg & 0x08) && abs(s.x) > threshold) ||
+            ((cfg & 0x10) && abs(s.y) > threshold) ||
+            ((cfg & 0x20) && abs(s.z) > threshold)) {
+            _motion = true;
+        }
+    }
+
+    // INT1 is active low; CTRL_REG5 routes each source to INT1 (1) or INT2
+    void update_line() {
+        bool asserted = sources() & _regs[REG_CTRL_REG5];
+        if (asserted == _line) {
+            return;
+        }
+        _line = asserted;
+        if (asserted) {
+            _interrupts++;
+        }
+        pin_edge(PTC13, !asserted);
+    }
+
+    uint8_t                     _regs[128];
+    uint8_t                     _pointer;
+    AccelSample                 _fifo[FIFO_SIZE];
+    int                         _fifo_head;
+    int                         _fifo_count;
+    bool                        _overflow;
+    bool                        _motion;
+    bool                        _line;
+    AccelSample                 _out;
+    AccelSample                 _rest;
+    uint64_t                    _next_sample;
+    std::vector<AccelSample>    _trace;
+    size_t                      _position;
+    uint32_t                    _trace_period;
+    uint64_t                    _trace_start;
+    bool                        _trace_done;
+    uint64_t                    _samples;
+    uint64_t                    _interrupts;
+    uint64_t                    _overflows;
+    uint64_t                    _rate_changes;
+    double                      _charge;            // uA times us
+    uint64_t                    _charged_until;
+};
+
+} // namespace
+
+bool start_accelerometer(const char *trace) {
+    static SimFXOS8700CQ accel;
+    if (trace && !accel.load(trace)) {
+        return false;
+    }
+    if (trace && !accel.has_trace()) {
+        fprintf(stderr, "host: trace %s has no samples\n", trace);
+        return false;
+    }
+    attach_i2c(FXOS8700CQ_SLAVE_ADDR1, &accel);
+    add_device(&accel);
+    add_report([](FILE *out) { accel.report(out); });
+    return true;
+}
+
+} // namespace host
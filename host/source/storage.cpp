@@ -0,0 +1,132 @@
+/*
+ * Copyright (c) 2016 ARM Limited. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include "host.h"
+#include "file_flash.h"
+#include "storage-abstraction/Driver_Storage.h"
+
+/*
+ * The internal flash of the K64F behind the CMSIS storage driver: 1 MB in
+ * 4 KB sectors, programmed in 8 byte phrases. It lives in the file of
+ * --flash, so what the firmware journals survives a restart, or in a
+ * temporary file without it.
+ */
+namespace host {
+
+namespace {
+
+const uint32_t K64F_FLASH_SIZE = 1024 * 1024;
+const uint32_t K64F_SECTOR_SIZE = 4096;
+const uint32_t K64F_PHRASE_SIZE = 8;
+
+FileFlash *flash = NULL;
+
+void report(FILE *out) {
+    fprintf(out, "flash: %llu bytes programmed, %llu sectors erased\n",
+            (unsigned long long)flash->programmed(), (unsigned long long)flash->erases());
+}
+
+bool in_range(uint64_t addr, uint32_t size) {
+    return flash && addr <= K64F_FLASH_SIZE && size <= K64F_FLASH_SIZE - addr;
+}
+
+ARM_STORAGE_CAPABILITIES get_capabilities(void) {
+    ARM_STORAGE_CAPABILITIES capabilities = { 0, 1, 0 };
+    return capabilities;
+}
+
+int32_t initialize(ARM_Storage_Callback_t /*callback*/) {
+    if (flash) {
+        return ARM_DRIVER_OK;
+    }
+    flash = new FileFlash(K64F_FLASH_SIZE, K64F_SECTOR_SIZE, K64F_PHRASE_SIZE);
+    if (!flash->open(options().flash)) {
+        fprintf(stderr, "host: can not open the flash file %s\n", options().flash ? options().flash : "");
+        delete flash;
+        flash = NULL;
+        return ARM_DRIVER_ERROR;
+    }
+    add_report(report);
+    return ARM_DRIVER_OK;
+}
+
+int32_t read_data(uint64_t addr, void *data, uint32_t size) {
+    if (!in_range(addr, size)) {
+        return ARM_DRIVER_ERROR_PARAMETER;
+    }
+    return flash->read(addr, data, size) ? (int32_t)size : ARM_DRIVER_ERROR;
+}
+
+int32_t program_data(uint64_t addr, const void *data, uint32_t size) {
+    if (!in_range(addr, size)) {
+        return ARM_DRIVER_ERROR_PARAMETER;
+    }
+    return flash->program(addr, data, size) ? (int32_t)size : ARM_DRIVER_ERROR;
+}
+
+int32_t erase(uint64_t addr, uint32_t size) {
+    if (!in_range(addr, size) || addr % K64F_SECTOR_SIZE || size % K64F_SECTOR_SIZE) {
+        return ARM_DRIVER_ERROR_PARAMETER;
+    }
+    for (uint32_t offset = 0; offset < size; offset += K64F_SECTOR_SIZE) {
+        if (!flash->erase(addr + offset)) {
+            return ARM_DRIVER_ERROR;
+        }
+    }
+    return size;
+}
+
+int32_t get_info(ARM_STORAGE_INFO *info) {
+    info->total_storage = K64F_FLASH_SIZE;
+    info->program_unit = K64F_PHRASE_SIZE;
+    info->optimal_program_unit = K64F_PHRASE_SIZE;
+    info->program_cycles = 10000;
+    info->erased_value = 1;
+    info->memory_mapped = 1;
+    info->reserved = 0;
+    return ARM_DRIVER_OK;
+}
+
+int32_t get_block(uint64_t addr, ARM_STORAGE_BLOCK *block) {
+    if (addr >= K64F_FLASH_SIZE) {
+        return ARM_DRIVER_ERROR_PARAMETER;
+    }
+    block->addr = 0;
+    block->size = K64F_FLASH_SIZE;
+    block->attributes.erasable = 1;
+    block->attributes.programmable = 1;
+    block->attributes.executable = 1;
+    block->attributes.protectable = 1;
+    block->attributes.reserved = 0;
+    block->attributes.erase_unit = K64F_SECTOR_SIZE;
+    block->attributes.protection_unit = 32 * 1024;
+    return ARM_DRIVER_OK;
+}
+
+} // namespace
+
+} // namespace host
+
+ARM_DRIVER_STORAGE ARM_Driver_Storage_MTD_K64F = {
+    host::get_capabilities,
+    host::initialize,
+    host::read_data,
+    host::program_data,
+    host::erase,
+    host::get_info,
+    host::get_block
+};
@@ -0,0 +1,154 @@
+/*
+ * Copyright (c) 2016 ARM Limited. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "trace_file.h"
+#include "knock-core/trace_format.h"
+
+namespace host {
+
+MappedFile::MappedFile() : _data(NULL), _size(0) {
+}
+
+MappedFile::~MappedFile() {
+    if (_data) {
+        munmap(_data, _size);
+    }
+}
+
+bool MappedFile::open(const char *path) {
+    int fd = ::open(path, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    bool ok = fstat(fd, &st) == 0;
+    if (ok && st.st_size > 0) {
+        void *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            ok = false;
+        } else {
+            _data = (uint8_t *)data;
+            _size = st.st_size;
+            madvise(_data, _size, MADV_SEQUENTIAL);
+        }
+    }
+    close(fd);
+    return ok;
+}
+
+namespace {
+
+bool parse_text(const char *path, const uint8_t *data, size_t size, Trace &trace) {
+    const char *p = (const char *)data;
+    const char *end = p + size;
+    unsigned line_number = 0;
+    while (p < end) {
+        const char *eol = (const char *)memchr(p, '\n', end - p);
+        if (!eol) {
+            eol = end;
+        }
+        line_number++;
+
+        char line[128];
+        size_t length = eol - p < (ptrdiff_t)sizeof(line) - 1 ? eol - p : sizeof(line) - 1;
+        memcpy(line, p, length);
+        line[length] = '\0';
+        p = eol + 1;
+
+        if (line[0] == '#' || line[strspn(line, " \t\r")] == '\0') {
+            continue;
+        }
+        int x, y, z;
+        if (sscanf(line, "%d %d %d", &x, &y, &z) != 3) {
+            fprintf(stderr, "%s:%u: bad trace line\n", path, line_number);
+            return false;
+        }
+        AccelSample sample = { (int16_t)x, (int16_t)y, (int16_t)z };
+        trace.timestamps.push_back(trace.samples.size() * TEXT_TRACE_PERIOD_US);
+        trace.samples.push_back(sample);
+    }
+    return true;
+}
+
+} // namespace
+
+bool load_trace(const char *path, Trace &trace) {
+    trace.samples.clear();
+    trace.timestamps.clear();
+    trace.period = TEXT_TRACE_PERIOD_US;
+    trace.interrupts = 0;
+    trace.bad_frames = 0;
+    trace.binary = false;
+
+    MappedFile file;
+    if (!file.open(path)) {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        return false;
+    }
+
+    TraceReader reader(file.data(), file.size());
+    TraceRecord record;
+    while (reader.next(record)) {
+        if (record.type == TRACE_SAMPLES) {
+            trace.samples.push_back(record.sample);
+            trace.timestamps.push_back(record.timestamp);
+        } else {
+            trace.interrupts++;
+        }
+    }
+    if (reader.frames()) {
+        trace.binary = true;
+        trace.period = reader.period() ? reader.period() : TEXT_TRACE_PERIOD_US;
+        trace.bad_frames = reader.bad_frames();
+        return true;
+    }
+    return parse_text(path, file.data(), file.size(), trace);
+}
+
+bool save_trace(const char *path, const Trace &trace) {
+    FILE *f = fopen(path, "wb");
+    if (!f) {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        return false;
+    }
+
+    TraceFrame frame;
+    const uint8_t *start = frame.start(TRACE_COUNTS_PER_G);
+    bool ok = fwrite(start, 1, frame.length(), f) == frame.length();
+    size_t i = 0;
+    while (ok && i < trace.samples.size()) {
+        // a new frame whenever the timestamps are not evenly spaced
+        frame.begin_samples(trace.timestamps[i], trace.period);
+        uint32_t expected = trace.timestamps[i];
+        while (i < trace.samples.size() && trace.timestamps[i] == expected &&
+               frame.add_sample(trace.samples[i])) {
+            expected += trace.period;
+            i++;
+        }
+        const uint8_t *data = frame.finish();
+        ok = fwrite(data, 1, frame.length(), f) == frame.length();
+    }
+    return fclose(f) == 0 && ok;
+}
+
+} // namespace host
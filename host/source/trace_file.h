@@ -0,0 +1,81 @@
+/*
+ * Copyright (c) 2016 ARM Limited. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef __HOST_TRACE_FILE_H__
+#define __HOST_TRACE_FILE_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+#include "knock-core/accel_sample.h"
+
+namespace host {
+
+/*
+ * A whole file mapped read-only into memory
+ */
+class MappedFile {
+public:
+    MappedFile();
+    ~MappedFile();
+
+    bool open(const char *path);
+
+    const uint8_t *data() const {
+        return _data;
+    }
+
+    size_t size() const {
+        return _size;
+    }
+
+private:
+    MappedFile(const MappedFile &);
+    MappedFile &operator=(const MappedFile &);
+
+    uint8_t *_data;
+    size_t  _size;
+};
+
+// sample period assumed for text traces, the firmware's 400 Hz FIFO rate
+const uint32_t TEXT_TRACE_PERIOD_US = 2500;
+
+// +/-2g range, like the firmware configures
+const uint16_t TRACE_COUNTS_PER_G = 4096;
+
+/*
+ * An accelerometer trace loaded from either format:
+ *
+ * - binary, see knock-core/trace_format.h; recorded from the serial port of
+ *   a board running APPL_ACCEL_TRACE_MODE, junk in between is skipped
+ * - text, one "x y z" sample per line in 14 bit counts, '#' for comments
+ */
+struct Trace {
+    std::vector<AccelSample>    samples;
+    std::vector<uint32_t>       timestamps;     // per sample, in us
+    uint32_t                    period;         // us, from the last SAMPLES frame
+    uint32_t                    interrupts;     // interrupt markers
+    uint32_t                    bad_frames;
+    bool                        binary;
+};
+
+bool load_trace(const char *path, Trace &trace);
+
+// writes `trace` in the binary format, without interrupt markers
+bool save_trace(const char *path, const Trace &trace);
+
+} // namespace host
+
+#endif // __HOST_TRACE_FILE_H__
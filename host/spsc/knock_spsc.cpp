@@ -0,0 +1,261 @@
+/*
+ * Copyright (c) 2016 ARM Limited. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "knock-core/accel_event.h"
+#include "knock-core/spsc_ring.h"
+
+/*
+ * Hammers SpscRing from two threads, a producer in the place of the
+ * accelerometer interrupt handler and a consumer in the place of the
+ * drain_events() callback, and checks:
+ *
+ *     order       every event the producer got in comes out once, in the
+ *                 order it went in, and no other
+ *     tearing     no event comes out with half of it from another push
+ *     counters    pushed() and dropped() add up to the pushes tried, and
+ *                 match what push() returned
+ *
+ * once with a consumer that keeps up and once with one that stops now and
+ * then, so the ring fills up and rejects pushes. The ring has the type and
+ * capacity of the firmware, and a second run uses events of 64 bytes,
+ * which no CPU copies in one go. Exits with 1 when a check fails.
+ */
+namespace {
+
+struct SpscOptions {
+    uint32_t    events;         // pushes per run
+    uint32_t    pause;          // slow consumer: spins between pops
+    bool        verbose;
+};
+
+SpscOptions spsc_options;
+
+// events of the firmware, AccelEvent in a ring of 16
+struct SmallEvent {
+    static SmallEvent make(uint32_t sequence) {
+        SmallEvent event;
+        event.event.timestamp = sequence;
+        event.event.ticks = ~sequence;
+        return event;
+    }
+
+    uint32_t sequence() const {
+        return event.timestamp;
+    }
+
+    bool whole() const {
+        return event.ticks == ~event.timestamp;
+    }
+
+    AccelEvent event;
+};
+
+// the same, spread over a cache line
+struct WideEvent {
+    static WideEvent make(uint32_t sequence) {
+        WideEvent event;
+        for (int i = 0; i < 16; i++) {
+            event.words[i] = sequence * 16 + i;
+        }
+        return event;
+    }
+
+    uint32_t sequence() const {
+        return words[0] / 16;
+    }
+
+    bool whole() const {
+        for (int i = 1; i < 16; i++) {
+            if (words[i] != words[0] + i) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    uint32_t words[16];
+};
+
+// keeps the compiler from dropping the spin
+void spin(uint32_t count) {
+    static std::atomic<uint32_t> sink(0);
+    for (uint32_t i = 0; i < count; i++) {
+        sink.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+template <typename Event, size_t N>
+bool run(const char *name, bool slow) {
+    SpscRing<Event, N> ring;
+    std::vector<uint8_t> accepted(spsc_options.events, 0);
+    std::vector<uint32_t> received;
+    received.reserve(spsc_options.events);
+    std::atomic<bool> done(false);
+    uint32_t refused = 0;
+    uint32_t torn = 0;
+
+    std::thread consumer([&]() {
+        Event event;
+        uint32_t pops = 0;
+        for (;;) {
+            // read the flag first, so a pop that comes up empty after it saw
+            // the producer finish really is the end
+            bool finished = done.load(std::memory_order_acquire);
+            if (!ring.pop(event)) {
+                if (finished) {
+                    break;
+                }
+                std::this_thread::yield();
+                continue;
+            }
+            if (!event.whole()) {
+                torn++;
+            }
+            received.push_back(event.sequence());
+            if (slow && ++pops % 64 == 0) {
+                spin(spsc_options.pause);
+            }
+        }
+    });
+
+    std::thread producer([&]() {
+        // bursts of edges, some longer than the ring, with a pause between
+        // them in which the consumer gets the CPU even on a single core
+        uint32_t seed = 1;
+        uint32_t sequence = 0;
+        while (sequence < spsc_options.events) {
+            seed ^= seed << 13;
+            seed ^= seed >> 17;
+            seed ^= seed << 5;
+            uint32_t burst = 1 + seed % (N + N / 2);
+            for (uint32_t i = 0; i < burst && sequence < spsc_options.events; i++, sequence++) {
+                if (ring.push(Event::make(sequence))) {
+                    accepted[sequence] = 1;
+                } else {
+                    refused++;
+                }
+            }
+            std::this_thread::yield();
+        }
+        done.store(true, std::memory_order_release);
+    });
+
+    producer.join();
+    consumer.join();
+
+    const char *mode = slow ? "slow consumer" : "fast consumer";
+    uint32_t in = spsc_options.events - refused;
+    if (torn) {
+        printf("%s, %s: FAILED, %u torn events\n", name, mode, torn);
+        return false;
+    }
+    if (ring.pushed() != in || ring.dropped() != refused) {
+        printf("%s, %s: FAILED, pushed() %u and dropped() %u, push() took %u and refused %u\n", name, mode,
+               ring.pushed(), ring.dropped(), in, refused);
+        return false;
+    }
+    if (received.size() != in) {
+        printf("%s, %s: FAILED, %zu events came out, %u went in\n", name, mode, received.size(), in);
+        return false;
+    }
+    size_t next = 0;
+    for (uint32_t sequence = 0; sequence < spsc_options.events; sequence++) {
+        if (!accepted[sequence]) {
+            continue;
+        }
+        if (received[next] != sequence) {
+            printf("%s, %s: FAILED, event %zu out is %u, expected %u\n", name, mode, next, received[next],
+                   sequence);
+            return false;
+        }
+        next++;
+    }
+    if (in < spsc_options.events / 4) {
+        printf("%s, %s: FAILED, only %u of %u events got in, the threads did not interleave\n", name, mode,
+               in, spsc_options.events);
+        return false;
+    }
+    if (slow && refused == 0) {
+        printf("%s, %s: FAILED, the ring never filled up, raise --pause\n", name, mode);
+        return false;
+    }
+    printf("%s, %s: %u events, %u in order, %u dropped and counted, none torn\n", name, mode,
+           spsc_options.events, in, refused);
+    return true;
+}
+
+void usage(const char *name) {
+    fprintf(stderr,
+            "usage: %s [options]\n"
+            "  -n, --events N        pushes per run (default 500000)\n"
+            "  -p, --pause N         spins of the slow consumer every 64 pops (default 20000)\n"
+            "  -v, --verbose         print the hardware threads\n",
+            name);
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    static const struct option long_options[] = {
+        { "events", required_argument, 0, 'n' },
+        { "pause", required_argument, 0, 'p' },
+        { "verbose", no_argument, 0, 'v' },
+        { "help", no_argument, 0, 'h' },
+        { 0, 0, 0, 0 }
+    };
+
+    spsc_options.events = 500000;
+    spsc_options.pause = 20000;
+    spsc_options.verbose = false;
+
+    int c;
+    while ((c = getopt_long(argc, argv, "n:p:vh", long_options, NULL)) != -1) {
+        switch (c) {
+            case 'n':
+                spsc_options.events = strtoul(optarg, NULL, 10);
+                break;
+            case 'p':
+                spsc_options.pause = strtoul(optarg, NULL, 10);
+                break;
+            case 'v':
+                spsc_options.verbose = true;
+                break;
+            default:
+                usage(argv[0]);
+                return 2;
+        }
+    }
+    if (spsc_options.events == 0) {
+        usage(argv[0]);
+        return 2;
+    }
+    if (spsc_options.verbose) {
+        printf("%u hardware threads\n", std::thread::hardware_concurrency());
+    }
+
+    bool passed = true;
+    for (int slow = 0; slow < 2; slow++) {
+        passed = run<SmallEvent, 16>("AccelEvent x 16", slow) && passed;
+        passed = run<WideEvent, 16>("64 byte event x 16", slow) && passed;
+    }
+    return passed ? 0 : 1;
+}
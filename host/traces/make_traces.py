@@ -0,0 +1,164 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2016 ARM Limited. All rights reserved.
+# SPDX-License-Identifier: Apache-2.0
+# Licensed under the Apache License, Version 2.0 (the License); you may
+# not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an AS IS BASIS, WITHOUT
+# WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""Writes the reference traces in this directory, with their labels.
+
+Each trace is a text trace at 400 Hz (see host/README.md) of a board on a
+door, and each .labels file lists the onsets of the knocks in it, one per
+line in seconds. Everything else in a trace must not be taken for a knock.
+
+    knocks      rhythms of two to five knocks, strong and weak, on all axes
+    door        knocks between door slams, footsteps and the door swinging
+    burst       rapid knocking, up to eight knocks a second
+
+The traces are synthetic, from the same impulse and ringing models the
+detector was tuned on, so a score on them catches regressions and says
+nothing about knocks on a real door. The build runs this script into
+traces/ of the build directory; the output only depends on the seed:
+
+    host/traces/make_traces.py _gate_build/traces
+"""
+
+import math
+import os
+import random
+import sys
+
+RATE = 400
+COUNTS_PER_G = 4096
+FULL_SCALE = 8191
+
+
+class Trace:
+    def __init__(self, seconds, seed, gravity_axis):
+        self.samples = [[0.0, 0.0, 0.0] for _ in range(int(seconds * RATE))]
+        self.random = random.Random(seed)
+        self.gravity_axis = gravity_axis
+        self.knocks = []
+
+    def add(self, start, length, axis, shape):
+        first = int(start * RATE)
+        for n in range(first, min(first + int(length * RATE) + 1, len(self.samples))):
+            self.samples[n][axis] += shape((n - first) / RATE)
+
+    def knock(self, at, g, hz, tau, axis):
+        """A decaying sinusoid, the panel ringing after a knuckle hit it"""
+        phase = self.random.uniform(0, math.pi)
+        self.add(at, 6 * tau, axis,
+                 lambda t: g * COUNTS_PER_G * math.exp(-t / tau) * math.sin(2 * math.pi * hz * t + phase))
+        self.knocks.append((at, axis, g))
+
+    def slam(self, at, g):
+        """The door hitting its frame: strong, low and ringing for long"""
+        hz = self.random.uniform(25, 40)
+        tau = self.random.uniform(0.15, 0.3)
+        for axis in (0, 1):
+            share = self.random.uniform(0.5, 1)
+            self.add(at, 6 * tau, axis,
+                     lambda t, s=share: s * g * COUNTS_PER_G * math.exp(-t / tau) * math.sin(2 * math.pi * hz * t))
+
+    def step(self, at, g):
+        """A footstep in the hall: a slow bump through the floor"""
+        width = self.random.uniform(0.08, 0.15)
+        self.add(at, width, self.gravity_axis,
+                 lambda t: g * COUNTS_PER_G * 0.5 * (1 - math.cos(2 * math.pi * t / width)))
+
+    def swing(self, at, g, seconds):
+        """The door opening and closing again"""
+        self.add(at, seconds, 1, lambda t: g * COUNTS_PER_G * math.sin(math.pi * t / seconds))
+
+    def rhythm(self, at, count, g_range=(0.2, 1.0)):
+        """`count` knocks of one visitor, returns when the last one ends"""
+        axis = self.random.choice((0, 1, 2))
+        hz = self.random.uniform(60, 180)
+        for i in range(count):
+            g = self.random.uniform(*g_range)
+            tau = self.random.uniform(0.004, 0.015)
+            self.knock(at, g, hz * self.random.uniform(0.9, 1.1), tau, axis)
+            at += self.random.uniform(0.15, 0.45)
+        return at
+
+    def write(self, directory, name, description):
+        noise = random.Random(len(self.samples))
+        path = os.path.join(directory, name)
+        with open(path + '.txt', 'w') as out:
+            out.write('# %s, %d samples at %d Hz, made by make_traces.py\n'
+                      % (description, len(self.samples), RATE))
+            for sample in self.samples:
+                values = []
+                for axis in range(3):
+                    value = sample[axis] + noise.randint(-20, 20)
+                    if axis == self.gravity_axis:
+                        value += COUNTS_PER_G
+                    values.append(max(-FULL_SCALE - 1, min(FULL_SCALE, int(round(value)))))
+                out.write('%d %d %d\n' % tuple(values))
+        with open(path + '.labels', 'w') as out:
+            out.write('# synthetic, made by make_traces.py\n')
+            out.write('# knock onsets in %s.txt, in s\n' % name)
+            for at, axis, g in sorted(self.knocks):
+                out.write('%.4f  # %s, %.2f g\n' % (at, 'xyz'[axis], g))
+
+
+def knocks(directory):
+    trace = Trace(40, 1, 2)
+    at = 1.0
+    while at < 33:
+        at = trace.rhythm(at, trace.random.randint(2, 5))
+        at += trace.random.uniform(1.5, 3)
+    # quiet knocks, a few times the noise
+    at = 37.2
+    for _ in range(3):
+        trace.knock(at, trace.random.uniform(0.08, 0.12), 120, 0.008, 0)
+        at += 0.8
+    trace.write(directory, 'knocks', 'rhythms of knocks')
+
+
+def door(directory):
+    trace = Trace(40, 2, 2)
+    # someone walks up, knocks, the door opens and slams
+    for visit in range(4):
+        start = 1 + visit * 9.5
+        for i in range(6):
+            trace.step(start + i * 0.5, trace.random.uniform(0.05, 0.15))
+        at = trace.rhythm(start + 3.3, trace.random.randint(2, 4))
+        trace.swing(at + 1, trace.random.uniform(0.3, 0.6), trace.random.uniform(1, 2))
+        trace.slam(at + 3.5, trace.random.uniform(0.8, 1.8))
+    trace.write(directory, 'door', 'knocks between footsteps, door swings and slams')
+
+
+def burst(directory):
+    trace = Trace(22, 3, 1)
+    at = 1.0
+    for _ in range(4):
+        axis = trace.random.choice((0, 2))
+        for i in range(trace.random.randint(8, 12)):
+            trace.knock(at, trace.random.uniform(0.3, 0.8), trace.random.uniform(100, 160),
+                        trace.random.uniform(0.004, 0.008), axis)
+            at += trace.random.uniform(0.125, 0.16)
+        at += trace.random.uniform(2, 3)
+    trace.write(directory, 'burst', 'bursts of rapid knocks, the board on its side')
+
+
+def main():
+    directory = sys.argv[1] if len(sys.argv) > 1 else os.path.dirname(os.path.abspath(__file__))
+    os.makedirs(directory, exist_ok=True)
+    knocks(directory)
+    door(directory)
+    burst(directory)
+
+
+if __name__ == '__main__':
+    main()
@@ -20,7 +20,7 @@ urls = (
 token = os.environ['TOKEN'] # Get from connector.mbed.com
 if token == '':
     raise Exception('Missing token, run \'TOKEN=xxx python connector.py\'')
-connector = mdc_api.connector(token, 'https://ds-test-sl.dev.mbed.com')
+connector = mdc_api.connector(token, os.environ.get('CONNECTOR_HOST', 'https://ds-test-sl.dev.mbed.com'))
 # connector.debug(True)
 compiler = Compiler() # pybars compiler
 
@@ -0,0 +1,45 @@
+// Decoder for the /accelerometer/0/knocks resource, the format is described
+// in common/knock-core/knock_batch.h
+const AXES = [ 'x', 'y', 'z', null ];
+
+function readUInt64BE(buffer, offset) {
+  return buffer.readUInt32BE(offset) * 4294967296 + buffer.readUInt32BE(offset + 4);
+}
+
+// Returns [{ time, local, axis, magnitude }]: time in ms since the epoch on
+// the server clock, null when the device has not aligned its clock yet, and
+// local in us since the device booted
+exports.decode = function(buffer) {
+  if (buffer.length < 18 || buffer[0] !== 2) {
+    throw new Error('Unsupported knock batch');
+  }
+
+  var count = buffer[1];
+  var local = readUInt64BE(buffer, 2);
+  var server = readUInt64BE(buffer, 10);
+  var offset = 18;
+  var knocks = [];
+
+  for (var i = 0; i < count; i++) {
+    var value = 0, shift = 0, byte;
+    do {
+      if (offset >= buffer.length) throw new Error('Truncated knock batch');
+      byte = buffer[offset++];
+      value += (byte & 0x7f) * Math.pow(2, shift);
+      shift += 7;
+    } while (byte & 0x80);
+    if (offset >= buffer.length) throw new Error('Truncated knock batch');
+
+    var delta = Math.floor(value / 4);
+    local += delta;
+    if (server) server += delta;
+    knocks.push({
+      time: server ? server / 1000 : null,
+      local: local,
+      axis: AXES[value % 4],
+      magnitude: buffer[offset++]
+    });
+  }
+
+  return knocks;
+};
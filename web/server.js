@@ -4,12 +4,14 @@ var app = require('express')();
 var server = require('http').Server(app);
 var io = require('socket.io')(server);
 var bodyParser = require('body-parser');
+var knockBatch = require('./knock-batch');
 
 const KNOCK_RESOURCE = '/accelerometer/0/last_knock';
+const KNOCKS_RESOURCE = '/accelerometer/0/knocks';
 
 var connector = new MbedConnector({
   accessKey: process.env.TOKEN,
-  host: 'https://ds-test-sl.dev.mbed.com'
+  host: process.env.CONNECTOR_HOST || 'https://ds-test-sl.dev.mbed.com'
 });
 
 app.set('view engine', 'html');
@@ -34,15 +36,29 @@ app.get('/knock-sensor/:id', function(req, res, next) {
   });
 });
 
+// Notifications are sent over a web socket
+var notifications = new EventEmitter();
+
 app.put('/notification', function(req, res, next) {
+  // knock batches are binary, decode them before handleNotifications turns
+  // every payload into a string
+  (req.body.notifications || []).forEach(function(n) {
+    if (n.path !== KNOCKS_RESOURCE) return;
+    try {
+      notifications.emit(n.ep + '/' + n.path, knockBatch.decode(new Buffer(n.payload, 'base64')));
+    }
+    catch (err) {
+      console.error('Could not decode knocks from', n.ep, err.message);
+    }
+  });
+
   connector.handleNotifications(req.body);
   res.send('OK');
 });
 
-// Notifications are sent over a web socket
-var notifications = new EventEmitter();
 connector.on('notifications', function(data) {
   data.forEach(function(n) {
+    if (n.path === KNOCKS_RESOURCE) return;
     notifications.emit(n.ep + '/' + n.path, n.payload);
   });
 });
@@ -50,11 +66,16 @@ connector.on('notifications', function(data) {
 io.on('connection', function(socket) {
   socket.on('subscribe-knocks', function(id) {
     connector.putResourceSubscription(id, KNOCK_RESOURCE, function() {});
+    connector.putResourceSubscription(id, KNOCKS_RESOURCE, function() {});
     notifications.on(id + '/' + KNOCK_RESOURCE, function(data) {
       socket.emit('knock', data);
     });
+    notifications.on(id + '/' + KNOCKS_RESOURCE, function(knocks) {
+      socket.emit('knocks', knocks);
+    });
     socket.on('disconnect', function() {
       connector.deleteResourceSubscription(id, KNOCK_RESOURCE, function() {});
+      connector.deleteResourceSubscription(id, KNOCKS_RESOURCE, function() {});
     });
   });
 });